@@ -77,27 +77,69 @@ void bgp_addpath_init_bgp_data(struct bgp_addpath_bgp_data *d)
 	int i;
 
 	FOREACH_AFI_SAFI (afi, safi) {
-		for (i = 0; i < BGP_ADDPATH_MAX; i++) {
-			d->id_allocators[afi][safi][i] = NULL;
+		for (i = 0; i < BGP_ADDPATH_MAX; i++)
 			d->peercount[afi][safi][i] = 0;
-		}
 		d->total_peercount[afi][safi] = 0;
 	}
 }
 
 /*
- * Free up resources associated with BGP route info structures.
+ * Addpath IDs only need to be unique per prefix (RFC 7911 Section 3), so
+ * they are handed out per dest: a path gets the lowest ID that no other
+ * path on the same dest holds for that strategy. An ID given up by a path
+ * is reused by the next path needing one, which lets best-per-as swap the
+ * path sent under an ID without a withdraw.
+ *
+ * The IDs in use are gathered into a small bitmap, dests with more paths
+ * than it covers fall back to counting up from the highest ID in use.
  */
-void bgp_addpath_free_info_data(struct bgp_addpath_info_data *d,
-			      struct bgp_addpath_node_data *nd)
+#define BGP_ADDPATH_ID_MAP_WORDS 4
+
+struct bgp_addpath_id_map {
+	uint64_t used[BGP_ADDPATH_ID_MAP_WORDS];
+	uint32_t max;
+};
+
+static void bgp_addpath_id_map_init(struct bgp_addpath_id_map *map,
+				    struct bgp_dest *dest,
+				    enum bgp_addpath_strat addpath_type)
 {
+	struct bgp_path_info *pi;
+	uint32_t id;
+
+	memset(map, 0, sizeof(*map));
+	map->max = BGP_ADDPATH_TX_ID_FOR_DEFAULT_ORIGINATE;
+	map->used[0] = (2ULL << BGP_ADDPATH_TX_ID_FOR_DEFAULT_ORIGINATE) - 1;
+
+	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
+		id = pi->tx_addpath.addpath_tx_id[addpath_type];
+		if (id == IDALLOC_INVALID)
+			continue;
+
+		if (id < BGP_ADDPATH_ID_MAP_WORDS * 64)
+			map->used[id / 64] |= 1ULL << (id % 64);
+		if (id > map->max)
+			map->max = id;
+	}
+}
+
+static uint32_t bgp_addpath_id_map_alloc(struct bgp_addpath_id_map *map)
+{
+	uint32_t id;
 	int i;
 
-	for (i = 0; i < BGP_ADDPATH_MAX; i++) {
-		if (d->addpath_tx_id[i] != IDALLOC_INVALID)
-			idalloc_free_to_pool(&nd->free_ids[i],
-					     d->addpath_tx_id[i]);
+	for (i = 0; i < BGP_ADDPATH_ID_MAP_WORDS; i++) {
+		if (map->used[i] == UINT64_MAX)
+			continue;
+
+		id = i * 64 + __builtin_ctzll(~map->used[i]);
+		map->used[i] |= 1ULL << (id % 64);
+		if (id > map->max)
+			map->max = id;
+		return id;
 	}
+
+	return ++map->max;
 }
 
 /*
@@ -131,21 +173,6 @@ bool bgp_addpath_info_has_ids(struct bgp_addpath_info_data *d)
 	return false;
 }
 
-/*
- * Releases any ID's associated with the BGP prefix.
- */
-void bgp_addpath_free_node_data(struct bgp_addpath_bgp_data *bd,
-			      struct bgp_addpath_node_data *nd, afi_t afi,
-			      safi_t safi)
-{
-	int i;
-
-	for (i = 0; i < BGP_ADDPATH_MAX; i++) {
-		idalloc_drain_pool(bd->id_allocators[afi][safi][i],
-				   &(nd->free_ids[i]));
-	}
-}
-
 /*
  * Check to see if the addpath strategy requires DMED to be configured to work.
  */
@@ -179,29 +206,13 @@ bool bgp_addpath_tx_path(enum bgp_addpath_strat strat, struct bgp_path_info *pi)
 	assert(!"Reached end of function we should never hit");
 }
 
-static void bgp_addpath_flush_type_rn(struct bgp *bgp, afi_t afi, safi_t safi,
-				      enum bgp_addpath_strat addpath_type,
+static void bgp_addpath_flush_type_rn(enum bgp_addpath_strat addpath_type,
 				      struct bgp_dest *dest)
 {
 	struct bgp_path_info *pi;
 
-	if (safi == SAFI_LABELED_UNICAST)
-		safi = SAFI_UNICAST;
-
-	idalloc_drain_pool(
-		bgp->tx_addpath.id_allocators[afi][safi][addpath_type],
-		&(dest->tx_addpath.free_ids[addpath_type]));
-	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
-		if (pi->tx_addpath.addpath_tx_id[addpath_type]
-		    != IDALLOC_INVALID) {
-			idalloc_free(
-				bgp->tx_addpath
-					.id_allocators[afi][safi][addpath_type],
-				pi->tx_addpath.addpath_tx_id[addpath_type]);
-			pi->tx_addpath.addpath_tx_id[addpath_type] =
-				IDALLOC_INVALID;
-		}
-	}
+	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
+		pi->tx_addpath.addpath_tx_id[addpath_type] = IDALLOC_INVALID;
 }
 
 /*
@@ -230,29 +241,30 @@ static void bgp_addpath_flush_type(struct bgp *bgp, afi_t afi, safi_t safi,
 
 			for (ndest = bgp_table_top(table); ndest;
 			     ndest = bgp_route_next(ndest))
-				bgp_addpath_flush_type_rn(bgp, afi, safi,
-							  addpath_type, ndest);
+				bgp_addpath_flush_type_rn(addpath_type, ndest);
 		} else {
-			bgp_addpath_flush_type_rn(bgp, afi, safi, addpath_type,
-						  dest);
+			bgp_addpath_flush_type_rn(addpath_type, dest);
 		}
 	}
-
-	idalloc_destroy(bgp->tx_addpath.id_allocators[afi][safi][addpath_type]);
-	bgp->tx_addpath.id_allocators[afi][safi][addpath_type] = NULL;
 }
 
 /*
- * Allocate an Addpath ID for the given type on a path, if necessary.
+ * Allocate Addpath IDs for the given type on the paths of a dest, if
+ * necessary.
  */
-static void bgp_addpath_populate_path(struct id_alloc *allocator,
-				      struct bgp_path_info *path,
-				      enum bgp_addpath_strat addpath_type)
+static void bgp_addpath_populate_rn(struct bgp_dest *dest,
+				    enum bgp_addpath_strat addpath_type)
 {
-	if (bgp_addpath_tx_path(addpath_type, path)) {
-		path->tx_addpath.addpath_tx_id[addpath_type] =
-			idalloc_allocate(allocator);
-	}
+	struct bgp_addpath_id_map map;
+	struct bgp_path_info *pi;
+
+	bgp_addpath_id_map_init(&map, dest, addpath_type);
+	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
+		if (pi->tx_addpath.addpath_tx_id[addpath_type] ==
+			    IDALLOC_INVALID &&
+		    bgp_addpath_tx_path(addpath_type, pi))
+			pi->tx_addpath.addpath_tx_id[addpath_type] =
+				bgp_addpath_id_map_alloc(&map);
 }
 
 /*
@@ -266,31 +278,15 @@ static void bgp_addpath_populate_type(struct bgp *bgp, afi_t afi, safi_t safi,
 				    enum bgp_addpath_strat addpath_type)
 {
 	struct bgp_dest *dest, *ndest;
-	char buf[200];
-	struct id_alloc *allocator;
 
 	if (safi == SAFI_LABELED_UNICAST)
 		safi = SAFI_UNICAST;
 
-	snprintf(buf, sizeof(buf), "Addpath ID Allocator %s:%d/%d",
-		 bgp_addpath_names(addpath_type)->config_name, (int)afi,
-		 (int)safi);
-	buf[sizeof(buf) - 1] = '\0';
 	zlog_info("Computing addpath IDs for addpath type %s",
 		bgp_addpath_names(addpath_type)->human_name);
 
-	bgp->tx_addpath.id_allocators[afi][safi][addpath_type] =
-		idalloc_new(buf);
-
-	idalloc_reserve(bgp->tx_addpath.id_allocators[afi][safi][addpath_type],
-		BGP_ADDPATH_TX_ID_FOR_DEFAULT_ORIGINATE);
-
-	allocator = bgp->tx_addpath.id_allocators[afi][safi][addpath_type];
-
 	for (dest = bgp_table_top(bgp->rib[afi][safi]); dest;
 	     dest = bgp_route_next(dest)) {
-		struct bgp_path_info *bi;
-
 		if (safi == SAFI_MPLS_VPN) {
 			struct bgp_table *table;
 
@@ -300,15 +296,9 @@ static void bgp_addpath_populate_type(struct bgp *bgp, afi_t afi, safi_t safi,
 
 			for (ndest = bgp_table_top(table); ndest;
 			     ndest = bgp_route_next(ndest))
-				for (bi = bgp_dest_get_bgp_path_info(ndest); bi;
-				     bi = bi->next)
-					bgp_addpath_populate_path(allocator, bi,
-								  addpath_type);
+				bgp_addpath_populate_rn(ndest, addpath_type);
 		} else {
-			for (bi = bgp_dest_get_bgp_path_info(dest); bi;
-			     bi = bi->next)
-				bgp_addpath_populate_path(allocator, bi,
-							  addpath_type);
+			bgp_addpath_populate_rn(dest, addpath_type);
 		}
 	}
 }
@@ -477,41 +467,25 @@ void bgp_addpath_update_ids(struct bgp *bgp, struct bgp_dest *bn, afi_t afi,
 {
 	int i;
 	struct bgp_path_info *pi;
-	struct id_alloc_pool **pool_ptr;
 
 	if (safi == SAFI_LABELED_UNICAST)
 		safi = SAFI_UNICAST;
 
 	for (i = 0; i < BGP_ADDPATH_MAX; i++) {
-		struct id_alloc *alloc =
-			bgp->tx_addpath.id_allocators[afi][safi][i];
-		pool_ptr = &(bn->tx_addpath.free_ids[i]);
-
 		if (bgp->tx_addpath.peercount[afi][safi][i] == 0)
 			continue;
 
-		/* Free Unused IDs back to the pool.*/
+		/* Take IDs back from paths that no longer need them. */
 		for (pi = bgp_dest_get_bgp_path_info(bn); pi; pi = pi->next) {
 			if (pi->tx_addpath.addpath_tx_id[i] != IDALLOC_INVALID
-			    && !bgp_addpath_tx_path(i, pi)) {
-				idalloc_free_to_pool(pool_ptr,
-					pi->tx_addpath.addpath_tx_id[i]);
+			    && !bgp_addpath_tx_path(i, pi))
 				pi->tx_addpath.addpath_tx_id[i] =
 					IDALLOC_INVALID;
-			}
 		}
 
-		/* Give IDs to paths that need them (pulling from the pool) */
-		for (pi = bgp_dest_get_bgp_path_info(bn); pi; pi = pi->next) {
-			if (pi->tx_addpath.addpath_tx_id[i] == IDALLOC_INVALID
-			    && bgp_addpath_tx_path(i, pi)) {
-				pi->tx_addpath.addpath_tx_id[i] =
-					idalloc_allocate_prefer_pool(
-						alloc, pool_ptr);
-			}
-		}
-
-		/* Free any IDs left in the pool to the main allocator */
-		idalloc_drain_pool(alloc, pool_ptr);
+		/* Give IDs to paths that need them, reusing the ones just
+		 * taken back first.
+		 */
+		bgp_addpath_populate_rn(bn, i);
 	}
 }
@@ -34,14 +34,6 @@ void bgp_addpath_init_bgp_data(struct bgp_addpath_bgp_data *d);
 bool bgp_addpath_is_addpath_used(struct bgp_addpath_bgp_data *d, afi_t afi,
 				 safi_t safi);
 
-void bgp_addpath_free_node_data(struct bgp_addpath_bgp_data *bd,
-			      struct bgp_addpath_node_data *nd,
-			      afi_t afi, safi_t safi);
-
-void bgp_addpath_free_info_data(struct bgp_addpath_info_data *d,
-			      struct bgp_addpath_node_data *nd);
-
-
 bool bgp_addpath_info_has_ids(struct bgp_addpath_info_data *d);
 
 uint32_t bgp_addpath_id_for_peer(struct peer *peer, afi_t afi, safi_t safi,
@@ -21,11 +21,6 @@ enum bgp_addpath_strat {
 struct bgp_addpath_bgp_data {
 	unsigned int peercount[AFI_MAX][SAFI_MAX][BGP_ADDPATH_MAX];
 	unsigned int total_peercount[AFI_MAX][SAFI_MAX];
-	struct id_alloc *id_allocators[AFI_MAX][SAFI_MAX][BGP_ADDPATH_MAX];
-};
-
-struct bgp_addpath_node_data {
-	struct id_alloc_pool *free_ids[BGP_ADDPATH_MAX];
 };
 
 struct bgp_addpath_info_data {
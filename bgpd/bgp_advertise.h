@@ -87,6 +87,12 @@ RB_PROTOTYPE(bgp_adj_out_rb, bgp_adj_out, adj_entry,
 	     bgp_adj_out_compare);
 
 /* BGP adjacency in. */
+/*
+ * One of these exists per prefix and per soft-reconfiguration inbound peer.
+ * Both attr and labels are interned, so the pre-policy attributes share
+ * storage with the post-policy path whenever inbound policy did not modify
+ * them.
+ */
 struct bgp_adj_in {
 	/* Linked list pointer.  */
 	struct bgp_adj_in *next;
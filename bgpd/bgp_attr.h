@@ -408,6 +408,7 @@ extern void bgp_path_attribute_withdraw_vty(struct vty *vty, struct peer *peer,
 extern enum bgp_attr_parse_ret bgp_attr_ignore(struct peer *peer, uint8_t type);
 
 /* Cluster list prototypes. */
+extern struct cluster_list *cluster_parse(struct in_addr *pnt, int length);
 extern bool cluster_loop_check(struct cluster_list *cluster,
 			       struct in_addr originator);
 
@@ -1003,15 +1003,21 @@ static struct stream *bmp_withdraw(const struct prefix *p,
 	return s;
 }
 
-static void bmp_monitor(struct bmp *bmp, struct peer *peer, uint8_t flags,
-			uint8_t peer_type_flag, const struct prefix *p,
-			struct prefix_rd *prd, struct attr *attr, afi_t afi,
-			safi_t safi, time_t uptime, mpls_label_t *label,
-			uint32_t num_labels)
-{
-	struct stream *hdr, *msg;
+/* room for one Route Monitoring message, BMP headers + BGP UPDATE */
+#define BMP_MON_MSG_MAXLEN (BGP_MAX_PACKET_SIZE + 64)
+
+/* Append a Route Monitoring message to s.  Returns false if it was skipped. */
+static bool bmp_monitor_put(struct stream *s, struct bmp *bmp,
+			    struct peer *peer, uint8_t flags,
+			    uint8_t peer_type_flag, const struct prefix *p,
+			    struct prefix_rd *prd, struct attr *attr, afi_t afi,
+			    safi_t safi, time_t uptime, mpls_label_t *label,
+			    uint32_t num_labels)
+{
+	struct stream *msg;
 	struct timeval tv = { .tv_sec = uptime, .tv_usec = 0 };
 	struct timeval uptime_real;
+	size_t hdr_pos;
 
 	uint64_t peer_distinguisher = 0;
 	/* skip this message if peer distinguisher is not available */
@@ -1019,7 +1025,7 @@ static void bmp_monitor(struct bmp *bmp, struct peer *peer, uint8_t flags,
 				       &peer_distinguisher)) {
 		zlog_warn(
 			"skipping bmp message for reason: can't get peer distinguisher");
-		return;
+		return false;
 	}
 
 	monotime_to_realtime(&tv, &uptime_real);
@@ -1029,20 +1035,34 @@ static void bmp_monitor(struct bmp *bmp, struct peer *peer, uint8_t flags,
 	else
 		msg = bmp_withdraw(p, prd, afi, safi);
 
-	hdr = stream_new(BGP_MAX_PACKET_SIZE);
-	bmp_common_hdr(hdr, BMP_VERSION_3, BMP_TYPE_ROUTE_MONITORING);
-	bmp_per_peer_hdr(hdr, bmp->targets->bgp, peer, flags, peer_type_flag,
+	hdr_pos = stream_get_endp(s);
+	bmp_common_hdr(s, BMP_VERSION_3, BMP_TYPE_ROUTE_MONITORING);
+	bmp_per_peer_hdr(s, bmp->targets->bgp, peer, flags, peer_type_flag,
 			 peer_distinguisher,
 			 uptime == (time_t)(-1L) ? NULL : &uptime_real);
 
-	stream_putl_at(hdr, BMP_LENGTH_POS,
-			stream_get_endp(hdr) + stream_get_endp(msg));
+	stream_putl_at(s, hdr_pos + BMP_LENGTH_POS,
+		       stream_get_endp(s) - hdr_pos + stream_get_endp(msg));
+	stream_put(s, STREAM_DATA(msg), stream_get_endp(msg));
 
-	bmp->cnt_update++;
-	pullwr_write_stream(bmp->pullwr, hdr);
-	pullwr_write_stream(bmp->pullwr, msg);
-	stream_free(hdr);
 	stream_free(msg);
+	return true;
+}
+
+static void bmp_monitor(struct bmp *bmp, struct peer *peer, uint8_t flags,
+			uint8_t peer_type_flag, const struct prefix *p,
+			struct prefix_rd *prd, struct attr *attr, afi_t afi,
+			safi_t safi, time_t uptime, mpls_label_t *label,
+			uint32_t num_labels)
+{
+	struct stream *s = stream_new(BMP_MON_MSG_MAXLEN);
+
+	if (bmp_monitor_put(s, bmp, peer, flags, peer_type_flag, p, prd, attr,
+			    afi, safi, uptime, label, num_labels)) {
+		bmp->cnt_update++;
+		pullwr_write_stream(bmp->pullwr, s);
+	}
+	stream_free(s);
 }
 
 static bool bmp_wrsync(struct bmp *bmp, struct pullwr *pullwr)
@@ -1253,6 +1273,39 @@ afibreak:
 	return true;
 }
 
+static void bmp_qentry_free(struct bmp_queue_entry *bqe)
+{
+	stream_free(bqe->encoded);
+	XFREE(MTYPE_BMP_QUEUE, bqe);
+}
+
+/* Send messages already encoded for this entry by another session */
+static bool bmp_qentry_write_encoded(struct bmp *bmp,
+				     struct bmp_queue_entry *bqe)
+{
+	if (!bqe->encoded)
+		return false;
+
+	bmp->cnt_update += bqe->encoded_cnt;
+	pullwr_write_stream(bmp->pullwr, bqe->encoded);
+	return true;
+}
+
+/* Send the messages encoded into s, keeping a copy on the entry if other
+ * sessions of the target still have to send it.
+ */
+static void bmp_qentry_write(struct bmp *bmp, struct bmp_queue_entry *bqe,
+			     struct stream *s, uint32_t cnt)
+{
+	bmp->cnt_update += cnt;
+	pullwr_write_stream(bmp->pullwr, s);
+
+	if (bqe->refcount) {
+		bqe->encoded = stream_dup(s);
+		bqe->encoded_cnt = cnt;
+	}
+}
+
 static struct bmp_queue_entry *
 bmp_pull_from_queue(struct bmp_qlist_head *list, struct bmp_qhash_head *hash,
 		    struct bmp_queue_entry **queuepos_ptr)
@@ -1295,6 +1348,7 @@ static bool bmp_wrqueue_locrib(struct bmp *bmp, struct pullwr *pullwr)
 	struct bmp_queue_entry *bqe;
 	struct peer *peer;
 	struct bgp_dest *bn = NULL;
+	struct stream *s;
 	bool written = false;
 	uint8_t bpi_num_labels;
 
@@ -1344,6 +1398,11 @@ static bool bmp_wrqueue_locrib(struct bmp *bmp, struct pullwr *pullwr)
 
 	struct prefix_rd *prd = is_vpn ? &bqe->rd : NULL;
 
+	if (bmp_qentry_write_encoded(bmp, bqe)) {
+		written = true;
+		goto out;
+	}
+
 	bn = bgp_safi_node_lookup(bmp->targets->bgp->rib[afi][safi], safi,
 				  &bqe->p, prd);
 
@@ -1358,17 +1417,20 @@ static bool bmp_wrqueue_locrib(struct bmp *bmp, struct pullwr *pullwr)
 
 	bpi_num_labels = BGP_PATH_INFO_NUM_LABELS(bpi);
 
-	bmp_monitor(bmp, peer, 0, BMP_PEER_TYPE_LOC_RIB_INSTANCE, &bqe->p, prd,
-		    bpi ? bpi->attr : NULL, afi, safi,
-		    bpi && bpi->extra ? bpi->extra->bgp_rib_uptime
-				      : (time_t)(-1L),
-		    bpi_num_labels ? bpi->extra->labels->label : NULL,
-		    bpi_num_labels);
+	s = stream_new(BMP_MON_MSG_MAXLEN);
+	if (bmp_monitor_put(s, bmp, peer, 0, BMP_PEER_TYPE_LOC_RIB_INSTANCE,
+			    &bqe->p, prd, bpi ? bpi->attr : NULL, afi, safi,
+			    bpi && bpi->extra ? bpi->extra->bgp_rib_uptime
+					      : (time_t)(-1L),
+			    bpi_num_labels ? bpi->extra->labels->label : NULL,
+			    bpi_num_labels))
+		bmp_qentry_write(bmp, bqe, s, 1);
+	stream_free(s);
 	written = true;
 
 out:
 	if (!bqe->refcount)
-		XFREE(MTYPE_BMP_QUEUE, bqe);
+		bmp_qentry_free(bqe);
 
 	if (bn)
 		bgp_dest_unlock_node(bn);
@@ -1381,6 +1443,8 @@ static bool bmp_wrqueue(struct bmp *bmp, struct pullwr *pullwr)
 	struct bmp_queue_entry *bqe;
 	struct peer *peer;
 	struct bgp_dest *bn = NULL;
+	struct stream *s;
+	uint32_t cnt = 0;
 	bool written = false;
 	uint8_t bpi_num_labels;
 
@@ -1420,9 +1484,18 @@ static bool bmp_wrqueue(struct bmp *bmp, struct pullwr *pullwr)
 		      (bqe->safi == SAFI_MPLS_VPN);
 
 	struct prefix_rd *prd = is_vpn ? &bqe->rd : NULL;
+
+	if (bmp_qentry_write_encoded(bmp, bqe)) {
+		written = true;
+		goto out;
+	}
+
 	bn = bgp_safi_node_lookup(bmp->targets->bgp->rib[afi][safi], safi,
 				  &bqe->p, prd);
 
+	/* pre- and post-policy messages go out together */
+	s = stream_new(2 * BMP_MON_MSG_MAXLEN);
+
 	if (CHECK_FLAG(bmp->targets->afimon[afi][safi], BMP_MON_POSTPOLICY)) {
 		struct bgp_path_info *bpi;
 
@@ -1436,12 +1509,14 @@ static bool bmp_wrqueue(struct bmp *bmp, struct pullwr *pullwr)
 
 		bpi_num_labels = BGP_PATH_INFO_NUM_LABELS(bpi);
 
-		bmp_monitor(bmp, peer, BMP_PEER_FLAG_L,
-			    BMP_PEER_TYPE_GLOBAL_INSTANCE, &bqe->p, prd,
-			    bpi ? bpi->attr : NULL, afi, safi,
-			    bpi ? bpi->uptime : monotime(NULL),
-			    bpi_num_labels ? bpi->extra->labels->label : NULL,
-			    bpi_num_labels);
+		if (bmp_monitor_put(s, bmp, peer, BMP_PEER_FLAG_L,
+				    BMP_PEER_TYPE_GLOBAL_INSTANCE, &bqe->p,
+				    prd, bpi ? bpi->attr : NULL, afi, safi,
+				    bpi ? bpi->uptime : monotime(NULL),
+				    bpi_num_labels ? bpi->extra->labels->label
+						   : NULL,
+				    bpi_num_labels))
+			cnt++;
 		written = true;
 	}
 
@@ -1454,15 +1529,22 @@ static bool bmp_wrqueue(struct bmp *bmp, struct pullwr *pullwr)
 				break;
 		}
 		/* TODO: set label here when adjin supports labels */
-		bmp_monitor(bmp, peer, 0, BMP_PEER_TYPE_GLOBAL_INSTANCE,
-			    &bqe->p, prd, adjin ? adjin->attr : NULL, afi, safi,
-			    adjin ? adjin->uptime : monotime(NULL), NULL, 0);
+		if (bmp_monitor_put(s, bmp, peer, 0,
+				    BMP_PEER_TYPE_GLOBAL_INSTANCE, &bqe->p,
+				    prd, adjin ? adjin->attr : NULL, afi, safi,
+				    adjin ? adjin->uptime : monotime(NULL),
+				    NULL, 0))
+			cnt++;
 		written = true;
 	}
 
+	if (cnt)
+		bmp_qentry_write(bmp, bqe, s, cnt);
+	stream_free(s);
+
 out:
 	if (!bqe->refcount)
-		XFREE(MTYPE_BMP_QUEUE, bqe);
+		bmp_qentry_free(bqe);
 
 	if (bn)
 		bgp_dest_unlock_node(bn);
@@ -1533,6 +1615,10 @@ bmp_process_one(struct bmp_targets *bt, struct bmp_qhash_head *updhash,
 			return NULL;
 
 		bmp_qlist_del(updlist, bqe);
+		/* table changed, the encoding is stale */
+		stream_free(bqe->encoded);
+		bqe->encoded = NULL;
+		bqe->encoded_cnt = 0;
 	} else {
 		bqe = XMALLOC(MTYPE_BMP_QUEUE, sizeof(*bqe));
 		memcpy(bqe, &bqeref, sizeof(*bqe));
@@ -1550,6 +1636,35 @@ bmp_process_one(struct bmp_targets *bt, struct bmp_qhash_head *updhash,
 	 */
 }
 
+/* Drop the sessions holding on to the oldest queue entry when the queue has
+ * grown past the configured limit.  A collector that cannot keep up would
+ * otherwise make bgpd buffer without bound; after reconnecting it gets a
+ * fresh table sync instead.
+ */
+static void bmp_queue_limit_check(struct bmp_targets *bt, bool locrib)
+{
+	struct bmp_qlist_head *list = locrib ? &bt->locupdlist : &bt->updlist;
+	struct bmp_queue_entry *first;
+	struct bmp *bmp;
+
+	if (!bt->queue_limit || bmp_qlist_count(list) <= bt->queue_limit)
+		return;
+
+	first = bmp_qlist_first(list);
+
+	frr_each_safe (bmp_session, &bt->sessions, bmp) {
+		if ((locrib ? bmp->locrib_queuepos : bmp->queuepos) != first)
+			continue;
+
+		zlog_warn("bmp[%s] %s queue over limit (%u entries), closing session to resync",
+			  bmp->remote, locrib ? "loc-rib" : "adj-rib-in",
+			  bt->queue_limit);
+		bt->cnt_queue_overruns++;
+		bmp_close(bmp);
+		bmp_free(bmp);
+	}
+}
+
 static int bmp_process(struct bgp *bgp, afi_t afi, safi_t safi,
 		       struct bgp_dest *bn, struct peer *peer, bool withdraw)
 {
@@ -1585,6 +1700,8 @@ static int bmp_process(struct bgp *bgp, afi_t afi, safi_t safi,
 		if (!last_item)
 			continue;
 
+		bmp_queue_limit_check(bt, false);
+
 		frr_each(bmp_session, &bt->sessions, bmp) {
 			if (!bmp->queuepos)
 				bmp->queuepos = last_item;
@@ -1811,10 +1928,10 @@ static void bmp_close(struct bmp *bmp)
 			XFREE(MTYPE_BMP_MIRRORQ, bmq);
 	while ((bqe = bmp_pull(bmp)))
 		if (!bqe->refcount)
-			XFREE(MTYPE_BMP_QUEUE, bqe);
+			bmp_qentry_free(bqe);
 	while ((bqe = bmp_pull_locrib(bmp)))
 		if (!bqe->refcount)
-			XFREE(MTYPE_BMP_QUEUE, bqe);
+			bmp_qentry_free(bqe);
 
 	EVENT_OFF(bmp->t_read);
 	pullwr_del(bmp->pullwr);
@@ -2511,6 +2628,35 @@ DEFPY(bmp_stats_send_experimental,
 	return CMD_SUCCESS;
 }
 
+DEFPY(bmp_queue_limit_cfg,
+      bmp_queue_limit_cmd,
+      "bmp queue-limit (1-4294967294)",
+      BMP_STR
+      "Limit the number of queued route monitoring updates\n"
+      "Number of queue entries\n")
+{
+	VTY_DECLVAR_CONTEXT_SUB(bmp_targets, bt);
+
+	bt->queue_limit = queue_limit;
+
+	return CMD_SUCCESS;
+}
+
+DEFPY(no_bmp_queue_limit_cfg,
+      no_bmp_queue_limit_cmd,
+      "no bmp queue-limit [(1-4294967294)]",
+      NO_STR
+      BMP_STR
+      "Limit the number of queued route monitoring updates\n"
+      "Number of queue entries\n")
+{
+	VTY_DECLVAR_CONTEXT_SUB(bmp_targets, bt);
+
+	bt->queue_limit = 0;
+
+	return CMD_SUCCESS;
+}
+
 #define BMP_POLICY_IS_LOCRIB(str) ((str)[0] == 'l') /* __l__oc-rib */
 #define BMP_POLICY_IS_PRE(str) ((str)[1] == 'r')    /* p__r__e-policy */
 
@@ -2662,6 +2808,14 @@ DEFPY(show_bmp,
 			vty_out(vty, "  Targets \"%s\":\n", bt->name);
 			vty_out(vty, "    Route Mirroring %sabled\n",
 				bt->mirror ? "en" : "dis");
+			vty_out(vty, "    Route Monitoring queue %zu entries (loc-rib %zu)",
+				bmp_qlist_count(&bt->updlist),
+				bmp_qlist_count(&bt->locupdlist));
+			if (bt->queue_limit)
+				vty_out(vty, ", limit %u, %" PRIu64 " overruns",
+					bt->queue_limit,
+					bt->cnt_queue_overruns);
+			vty_out(vty, "\n");
 
 			afi_t afi;
 			safi_t safi;
@@ -2810,6 +2964,9 @@ static int bmp_config_write(struct bgp *bgp, struct vty *vty)
 			vty_out(vty, "  bmp stats interval %d\n",
 					bt->stat_msec);
 
+		if (bt->queue_limit)
+			vty_out(vty, "  bmp queue-limit %u\n", bt->queue_limit);
+
 		if (bt->mirror)
 			vty_out(vty, "  bmp mirror\n");
 
@@ -2863,6 +3020,8 @@ static int bgp_bmp_init(struct event_loop *tm)
 	install_element(BMP_NODE, &bmp_acl_cmd);
 	install_element(BMP_NODE, &bmp_stats_send_experimental_cmd);
 	install_element(BMP_NODE, &bmp_stats_cmd);
+	install_element(BMP_NODE, &bmp_queue_limit_cmd);
+	install_element(BMP_NODE, &no_bmp_queue_limit_cmd);
 	install_element(BMP_NODE, &bmp_monitor_cmd);
 	install_element(BMP_NODE, &bmp_mirror_cmd);
 
@@ -2932,6 +3091,8 @@ static int bmp_route_update(struct bgp *bgp, afi_t afi, safi_t safi,
 			if (!last_item)
 				continue;
 
+			bmp_queue_limit_check(bt, true);
+
 			frr_each (bmp_session, &bt->sessions, bmp) {
 				if (!bmp->locrib_queuepos)
 					bmp->locrib_queuepos = last_item;
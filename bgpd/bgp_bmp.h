@@ -51,6 +51,15 @@
  * entry, i.e. number of BMP sessions where we still want to send this out.
  * Decremented on send so we know when we're done with an entry (i.e. this
  * always happens from the front of the queue.)
+ *
+ * The first session to send an entry keeps the encoded Route Monitoring
+ * messages in "encoded" while other sessions still need them, so they are
+ * encoded once per target rather than once per session.  Re-adding the
+ * entry drops the encoding since the table has changed.
+ *
+ * The number of entries can be limited per target (queue_limit); sessions
+ * that fall that far behind are disconnected and get a fresh table sync
+ * when they come back.
  */
 
 PREDECL_DLIST(bmp_qlist);
@@ -69,6 +78,10 @@ struct bmp_queue_entry {
 
 	/* initialized only for L2VPN/EVPN (S)AFIs */
 	struct prefix_rd rd;
+
+	/* must stay after the fields above, which are hashed by offset */
+	struct stream *encoded;
+	uint32_t encoded_cnt;
 };
 
 /* This is for BMP Route Mirroring, which feeds fully raw BGP PDUs out to BMP
@@ -238,7 +251,12 @@ struct bmp_targets {
 	struct bmp_qhash_head locupdhash;
 	struct bmp_qlist_head locupdlist;
 
+	/* max. entries on updlist / locupdlist, 0 = unlimited */
+	uint32_t queue_limit;
+
 	uint64_t cnt_accept, cnt_aclrefused;
+	/* sessions disconnected for exceeding queue_limit */
+	uint64_t cnt_queue_overruns;
 
 	bool stats_send_experimental;
 
@@ -10,49 +10,63 @@
 #include "bgpd/bgp_conditional_adv.h"
 #include "bgpd/bgp_vty.h"
 
-static route_map_result_t
-bgp_check_rmap_prefixes_in_bgp_table(struct bgp_table *table,
-				     struct route_map *rmap)
+/* Whether any path of dest is permitted by rmap */
+static bool bgp_check_rmap_prefixes_in_dest(struct bgp_dest *dest,
+					    struct route_map *rmap)
 {
 	struct attr dummy_attr = {0};
-	struct bgp_dest *dest;
 	struct bgp_path_info *pi;
 	struct bgp_path_info path = {0};
 	struct bgp_path_info_extra path_extra = {0};
 	const struct prefix *dest_p;
-	route_map_result_t ret = RMAP_DENYMATCH;
+	route_map_result_t ret;
 
-	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
-		dest_p = bgp_dest_get_prefix(dest);
-		assert(dest_p);
+	dest_p = bgp_dest_get_prefix(dest);
+	assert(dest_p);
 
-		for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
-			dummy_attr = *pi->attr;
+	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
+		dummy_attr = *pi->attr;
 
-			/* Fill temp path_info */
-			prep_for_rmap_apply(&path, &path_extra, dest, pi,
-					    pi->peer, &dummy_attr);
+		/* Fill temp path_info */
+		prep_for_rmap_apply(&path, &path_extra, dest, pi, pi->peer,
+				    &dummy_attr);
 
-			RESET_FLAG(dummy_attr.rmap_change_flags);
+		RESET_FLAG(dummy_attr.rmap_change_flags);
 
-			ret = route_map_apply(rmap, dest_p, &path);
-			bgp_attr_flush(&dummy_attr);
+		ret = route_map_apply(rmap, dest_p, &path);
+		bgp_attr_flush(&dummy_attr);
 
-			if (ret == RMAP_PERMITMATCH) {
-				bgp_dest_unlock_node(dest);
-				bgp_cond_adv_debug(
-					"%s: Condition map routes present in BGP table",
-					__func__);
+		if (ret == RMAP_PERMITMATCH)
+			return true;
+	}
 
-				return ret;
-			}
+	return false;
+}
+
+/* On a match, the matching prefix is stored in match */
+static route_map_result_t
+bgp_check_rmap_prefixes_in_bgp_table(struct bgp_table *table,
+				     struct route_map *rmap,
+				     struct prefix *match)
+{
+	struct bgp_dest *dest;
+
+	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
+		if (bgp_check_rmap_prefixes_in_dest(dest, rmap)) {
+			prefix_copy(match, bgp_dest_get_prefix(dest));
+			bgp_dest_unlock_node(dest);
+			bgp_cond_adv_debug(
+				"%s: Condition map routes present in BGP table",
+				__func__);
+
+			return RMAP_PERMITMATCH;
 		}
 	}
 
 	bgp_cond_adv_debug("%s: Condition map routes not present in BGP table",
 			   __func__);
 
-	return ret;
+	return RMAP_DENYMATCH;
 }
 
 static void bgp_conditional_adv_routes(struct peer *peer, afi_t afi,
@@ -243,7 +257,9 @@ static void bgp_conditional_adv_timer(struct event *t)
 			 * non-exist-map) map validation
 			 */
 			ret = bgp_check_rmap_prefixes_in_bgp_table(
-				table, filter->advmap.cmap);
+				table, filter->advmap.cmap,
+				&filter->advmap.cprefix);
+			filter->advmap.cmatch = (ret == RMAP_PERMITMATCH);
 
 			/* Derive conditional advertisement status from
 			 * condition and return value of condition-map
@@ -308,6 +324,180 @@ static void bgp_conditional_adv_timer(struct event *t)
 	}
 }
 
+/* Peers whose advertise-map on an AFI/SAFI uses the same condition-map */
+struct bgp_cond_adv_group {
+	afi_t afi;
+	safi_t safi;
+	char *cname;
+	struct list *peers;
+};
+
+static void bgp_conditional_adv_group_free(void *arg)
+{
+	struct bgp_cond_adv_group *group = arg;
+
+	list_delete(&group->peers);
+	XFREE(MTYPE_BGP_FILTER_NAME, group->cname);
+	XFREE(MTYPE_BGP_COND_ADV_GROUP, group);
+}
+
+/*
+ * Drop the condition-map index, it is rebuilt on the next route change.
+ * Called whenever an advertise-map or a peer goes away.
+ */
+void bgp_conditional_adv_index_reset(struct bgp *bgp)
+{
+	if (bgp->condition_index)
+		list_delete(&bgp->condition_index);
+}
+
+static void bgp_conditional_adv_index_build(struct bgp *bgp)
+{
+	struct bgp_cond_adv_group *group;
+	struct bgp_filter *filter;
+	struct listnode *node, *gnode;
+	struct peer *peer;
+	afi_t afi;
+	safi_t safi;
+
+	bgp->condition_index = list_new();
+	bgp->condition_index->del = bgp_conditional_adv_group_free;
+
+	for (ALL_LIST_ELEMENTS_RO(bgp->peer, node, peer)) {
+		if (!CHECK_FLAG(peer->flags, PEER_FLAG_CONFIG_NODE))
+			continue;
+
+		FOREACH_AFI_SAFI (afi, safi) {
+			filter = &peer->filter[afi][safi];
+			if (!filter->advmap.aname || !filter->advmap.cname)
+				continue;
+
+			for (ALL_LIST_ELEMENTS_RO(bgp->condition_index, gnode,
+						  group))
+				if (group->afi == afi && group->safi == safi &&
+				    strmatch(group->cname,
+					     filter->advmap.cname))
+					break;
+
+			if (!gnode) {
+				group = XCALLOC(MTYPE_BGP_COND_ADV_GROUP,
+						sizeof(*group));
+				group->afi = afi;
+				group->safi = safi;
+				group->cname = XSTRDUP(MTYPE_BGP_FILTER_NAME,
+						       filter->advmap.cname);
+				group->peers = list_new();
+				listnode_add(bgp->condition_index, group);
+			}
+
+			listnode_add(group->peers, peer);
+		}
+	}
+}
+
+/*
+ * Mark the peers of group whose condition may be flipped by a change to
+ * dest.  While a peer's condition-map matches, only a change to the route
+ * that made it match can do that.  Otherwise dest has to be covered by the
+ * prefix index of the condition-map and one of its paths has to be
+ * permitted by it.  Returns true if any peer was marked.
+ */
+static bool bgp_conditional_adv_group_watch(struct bgp_cond_adv_group *group,
+					     struct bgp_dest *dest)
+{
+	const struct prefix *dest_p = bgp_dest_get_prefix(dest);
+	struct bgp_filter *filter;
+	struct route_map *cmap;
+	struct listnode *node;
+	struct peer *peer;
+	int permitted = -1;
+	bool changed = false;
+
+	cmap = route_map_lookup_by_name(group->cname);
+	if (!cmap)
+		return false;
+
+	/*
+	 * Without a prefix index every route change would trigger a scan,
+	 * leave such condition-maps to the periodic scanner.  A route that
+	 * made the condition match is covered by the index, so nothing
+	 * outside of it can flip the condition either way.
+	 */
+	if (!route_map_prefix_indexed(cmap, dest_p->family) ||
+	    !route_map_prefix_may_match(cmap, dest_p))
+		return false;
+
+	for (ALL_LIST_ELEMENTS_RO(group->peers, node, peer)) {
+		if (!peer_established(peer->connection))
+			continue;
+
+		filter = &peer->filter[group->afi][group->safi];
+		if (!filter->advmap.amap || !filter->advmap.cmap)
+			continue;
+
+		if (filter->advmap.cmatch) {
+			if (!prefix_same(&filter->advmap.cprefix, dest_p))
+				continue;
+		} else {
+			if (permitted < 0)
+				permitted = bgp_check_rmap_prefixes_in_dest(
+					dest, cmap);
+			if (!permitted)
+				continue;
+		}
+
+		peer->advmap_table_change = true;
+		changed = true;
+	}
+
+	return changed;
+}
+
+/*
+ * Called when the paths of dest have changed, only while some peer has an
+ * advertise-map.  If that can change the outcome of a condition-map, run
+ * the scanner right away rather than waiting for the next period.
+ */
+void bgp_conditional_adv_dest_changed(struct bgp *bgp, afi_t afi,
+				      safi_t safi, struct bgp_dest *dest)
+{
+	struct bgp_cond_adv_group *group;
+	struct listnode *node;
+	bool changed = false;
+
+	if (!bgp->condition_index)
+		bgp_conditional_adv_index_build(bgp);
+
+	for (ALL_LIST_ELEMENTS_RO(bgp->condition_index, node, group)) {
+		if (group->afi != afi)
+			continue;
+
+		/* labeled-unicast conditions look at the unicast table */
+		if (group->safi != safi &&
+		    !(safi == SAFI_UNICAST &&
+		      group->safi == SAFI_LABELED_UNICAST))
+			continue;
+
+		if (bgp_conditional_adv_group_watch(group, dest))
+			changed = true;
+	}
+
+	if (!changed)
+		return;
+
+	bgp_cond_adv_debug("%s: %pBD may change a condition, scanning in %u ms",
+			   __func__, dest, BGP_CONDITIONAL_ADV_WATCH_DELAY);
+
+	if (event_timer_remain_msec(bgp->t_condition_check) <=
+	    BGP_CONDITIONAL_ADV_WATCH_DELAY)
+		return;
+
+	EVENT_OFF(bgp->t_condition_check);
+	event_add_timer_msec(bm->master, bgp_conditional_adv_timer, bgp,
+			     BGP_CONDITIONAL_ADV_WATCH_DELAY,
+			     &bgp->t_condition_check);
+}
+
 void bgp_conditional_adv_enable(struct peer *peer, afi_t afi, safi_t safi)
 {
 	struct bgp *bgp = peer->bgp;
@@ -355,6 +545,7 @@ void bgp_conditional_adv_disable(struct peer *peer, afi_t afi, safi_t safi)
 
 	/* Last filter removed. So cancel conditional routes polling thread. */
 	EVENT_OFF(bgp->t_condition_check);
+	bgp_conditional_adv_index_reset(bgp);
 }
 
 static void peer_advertise_map_filter_update(struct peer *peer, afi_t afi,
@@ -369,6 +560,8 @@ static void peer_advertise_map_filter_update(struct peer *peer, afi_t afi,
 
 	filter = &peer->filter[afi][safi];
 
+	bgp_conditional_adv_index_reset(peer->bgp);
+
 	/* advertise-map is already configured. */
 	if (filter->advmap.aname) {
 		filter_exists = true;
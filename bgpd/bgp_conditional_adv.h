@@ -30,10 +30,19 @@ extern "C" {
 /* Polling time for monitoring condition-map routes in route table */
 #define DEFAULT_CONDITIONAL_ROUTES_POLL_TIME 60
 
+/* Delay (msec) before scanning after a change that may affect a condition;
+ * batches up bursts of route changes.
+ */
+#define BGP_CONDITIONAL_ADV_WATCH_DELAY 100
+
 extern void bgp_conditional_adv_enable(struct peer *peer, afi_t afi,
 				       safi_t safi);
 extern void bgp_conditional_adv_disable(struct peer *peer, afi_t afi,
 					safi_t safi);
+extern void bgp_conditional_adv_index_reset(struct bgp *bgp);
+extern void bgp_conditional_adv_dest_changed(struct bgp *bgp, afi_t afi,
+					     safi_t safi,
+					     struct bgp_dest *dest);
 extern int peer_advertise_map_set(struct peer *peer, afi_t afi, safi_t safi,
 				  const char *advertise_name,
 				  struct route_map *advertise_map,
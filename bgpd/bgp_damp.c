@@ -22,37 +22,92 @@
 #include "bgpd/bgp_advertise.h"
 #include "bgpd/bgp_vty.h"
 
-static void bgp_reuselist_add(struct reuselist *list, struct bgp_damp_info *info)
+/*
+ * Dampening info is carved out of chunks instead of being allocated per
+ * route, so a flap storm mostly recycles entries off the free list.
+ */
+#define BGP_DAMP_CHUNK_SIZE 256
+
+struct bgp_damp_chunk {
+	struct bgp_damp_chunk *next;
+	struct bgp_damp_info info[BGP_DAMP_CHUNK_SIZE];
+};
+
+static struct {
+	struct bgp_damp_chunk *chunks;
+	struct reuselist free;
+	unsigned long chunk_count;
+	unsigned long used;
+} damp_pool;
+
+static struct bgp_damp_info *bgp_damp_info_alloc(void)
 {
-	assert(info);
-	SLIST_INSERT_HEAD(list, info, entry);
+	struct bgp_damp_chunk *chunk;
+	struct bgp_damp_info *bdi;
+	unsigned int i;
+
+	if (LIST_EMPTY(&damp_pool.free)) {
+		chunk = XCALLOC(MTYPE_BGP_DAMP_INFO, sizeof(*chunk));
+		chunk->next = damp_pool.chunks;
+		damp_pool.chunks = chunk;
+		damp_pool.chunk_count++;
+		for (i = 0; i < BGP_DAMP_CHUNK_SIZE; i++)
+			LIST_INSERT_HEAD(&damp_pool.free, &chunk->info[i],
+					 entry);
+	}
+
+	bdi = LIST_FIRST(&damp_pool.free);
+	LIST_REMOVE(bdi, entry);
+	memset(bdi, 0, sizeof(*bdi));
+	damp_pool.used++;
+
+	return bdi;
 }
 
-static void bgp_reuselist_del(struct reuselist *list, struct bgp_damp_info *info)
+static void bgp_damp_info_release(struct bgp_damp_info *bdi)
+{
+	struct bgp_damp_chunk *chunk;
+
+	LIST_INSERT_HEAD(&damp_pool.free, bdi, entry);
+	if (--damp_pool.used)
+		return;
+
+	/* Last one gone, give the chunks back. */
+	LIST_INIT(&damp_pool.free);
+	while ((chunk = damp_pool.chunks)) {
+		damp_pool.chunks = chunk->next;
+		XFREE(MTYPE_BGP_DAMP_INFO, chunk);
+	}
+	damp_pool.chunk_count = 0;
+}
+
+unsigned long bgp_damp_info_count(size_t *memory)
+{
+	if (memory)
+		*memory = damp_pool.chunk_count * sizeof(struct bgp_damp_chunk);
+
+	return damp_pool.used;
+}
+
+/* Reuse lists are doubly linked, moving an entry is O(1). */
+static void bgp_reuselist_add(struct reuselist *list, struct bgp_damp_info *info)
 {
 	assert(info);
-	SLIST_REMOVE(list, info, bgp_damp_info, entry);
+	LIST_INSERT_HEAD(list, info, entry);
 }
 
-static void bgp_reuselist_switch(struct reuselist *source,
-				 struct bgp_damp_info *info,
+static void bgp_reuselist_switch(struct bgp_damp_info *info,
 				 struct reuselist *target)
 {
-	assert(source && target && info);
-	SLIST_REMOVE(source, info, bgp_damp_info, entry);
-	SLIST_INSERT_HEAD(target, info, entry);
+	assert(target && info);
+	LIST_REMOVE(info, entry);
+	LIST_INSERT_HEAD(target, info, entry);
 }
 
-static void bgp_damp_info_unclaim(struct bgp_damp_info *bdi,
-				  struct reuselist *list)
+static void bgp_damp_info_unclaim(struct bgp_damp_info *bdi)
 {
 	assert(bdi && bdi->config);
-	if (bdi->index == BGP_DAMP_NO_REUSE_LIST_INDEX)
-		bgp_reuselist_del(&bdi->config->no_reuse_list, bdi);
-	else
-		bgp_reuselist_del(list ? list
-				       : &bdi->config->reuse_list[bdi->index],
-				  bdi);
+	LIST_REMOVE(bdi, entry);
 	bdi->config = NULL;
 }
 
@@ -64,7 +119,7 @@ static void bgp_damp_info_claim(struct bgp_damp_info *bdi,
 		bdi->config = bdc;
 		return;
 	}
-	bgp_damp_info_unclaim(bdi, NULL);
+	bgp_damp_info_unclaim(bdi);
 	bdi->config = bdc;
 	bdi->afi = bdc->afi;
 	bdi->safi = bdc->safi;
@@ -90,17 +145,20 @@ struct bgp_damp_config *get_active_bdc_from_pi(struct bgp_path_info *pi,
 /* Calculate reuse list index by penalty value.  */
 static int bgp_reuse_index(int penalty, struct bgp_damp_config *bdc)
 {
-	unsigned int i;
+	uint64_t i, excess;
 	unsigned int index;
 
-	/*
-	 * reuse_limit can't be zero, this is for Coverity
-	 * to bypass division by zero test.
-	 */
-	assert(bdc->reuse_limit);
-
-	i = (int)(((double)penalty / bdc->reuse_limit - 1.0)
-		  * bdc->scale_factor);
+	/* (penalty / reuse_limit - 1) * scale_factor, in fixed point */
+	if ((unsigned int)penalty <= bdc->reuse_limit)
+		i = 0;
+	else {
+		excess = penalty - bdc->reuse_limit;
+		if (excess > UINT64_MAX / bdc->reuse_index_scale)
+			i = bdc->reuse_index_size;
+		else
+			i = (excess * bdc->reuse_index_scale) >>
+			    BGP_DAMP_REUSE_SHIFT;
+	}
 
 	if (i >= bdc->reuse_index_size)
 		i = bdc->reuse_index_size - 1;
@@ -122,7 +180,7 @@ static void bgp_reuse_list_add(struct bgp_damp_info *bdi,
 /* Delete BGP dampening information from reuse list.  */
 static void bgp_reuse_list_delete(struct bgp_damp_info *bdi)
 {
-	bgp_damp_info_unclaim(bdi, NULL);
+	bgp_damp_info_unclaim(bdi);
 }
 
 static void bgp_no_reuse_list_add(struct bgp_damp_info *bdi,
@@ -135,23 +193,23 @@ static void bgp_no_reuse_list_add(struct bgp_damp_info *bdi,
 
 static void bgp_no_reuse_list_delete(struct bgp_damp_info *bdi)
 {
-	bgp_damp_info_unclaim(bdi, NULL);
+	bgp_damp_info_unclaim(bdi);
 }
 
 /* Return decayed penalty value.  */
 int bgp_damp_decay(time_t tdiff, int penalty, struct bgp_damp_config *bdc)
 {
-	unsigned int i;
+	time_t i;
 
-	i = (int)((double)tdiff / DELTA_T);
-
-	if (i == 0)
+	if (tdiff < DELTA_T)
 		return penalty;
 
+	i = tdiff / DELTA_T;
 	if (i >= bdc->decay_array_size)
 		return 0;
 
-	return (int)(penalty * bdc->decay_array[i]);
+	return ((uint64_t)penalty * bdc->decay_array[i]) >>
+	       BGP_DAMP_DECAY_SHIFT;
 }
 
 /* Handler of reuse timer event.  Each route in the current reuse-list
@@ -160,6 +218,8 @@ static void bgp_reuse_timer(struct event *t)
 {
 	struct bgp_damp_info *bdi, *bdi_next;
 	struct reuselist plist;
+	struct reuselist *slot;
+	struct bgp_dest *dest;
 	struct bgp *bgp;
 	time_t t_now, t_diff;
 	struct bgp_damp_config *bdc = EVENT_ARG(t);
@@ -173,8 +233,10 @@ static void bgp_reuse_timer(struct event *t)
 	/* 1.  save a pointer to the current queue head and zero the list head
 	 * list head entry. */
 	assert(bdc->reuse_offset < bdc->reuse_list_size);
-	plist = bdc->reuse_list[bdc->reuse_offset];
-	SLIST_INIT(&bdc->reuse_list[bdc->reuse_offset]);
+	slot = &bdc->reuse_list[bdc->reuse_offset];
+	LIST_INIT(&plist);
+	while ((bdi = LIST_FIRST(slot)))
+		bgp_reuselist_switch(bdi, &plist);
 
 	/* 2.  set offset = modulo reuse-list-size ( offset + 1 ), thereby
 	   rotating the circular queue of list-heads.  */
@@ -182,8 +244,9 @@ static void bgp_reuse_timer(struct event *t)
 	assert(bdc->reuse_offset < bdc->reuse_list_size);
 
 	/* 3. if ( the saved list head pointer is non-empty ) */
-	SLIST_FOREACH_SAFE (bdi, &plist, entry, bdi_next) {
+	LIST_FOREACH_SAFE (bdi, &plist, entry, bdi_next) {
 		bgp = bdi->path->peer->bgp;
+		dest = bdi->path->net;
 
 		/* Set t-diff = t-now - t-updated.  */
 		t_diff = t_now - bdi->t_updated;
@@ -198,37 +261,36 @@ static void bgp_reuse_timer(struct event *t)
 		/* if (figure-of-merit < reuse).  */
 		if (bdi->penalty < bdc->reuse_limit) {
 			/* Reuse the route.  */
-			bgp_path_info_unset_flag(bdi->dest, bdi->path,
+			bgp_path_info_unset_flag(dest, bdi->path,
 						 BGP_PATH_DAMPED);
 			bdi->suppress_time = 0;
 
 			if (bdi->lastrecord == BGP_RECORD_UPDATE) {
-				bgp_path_info_unset_flag(bdi->dest, bdi->path,
+				bgp_path_info_unset_flag(dest, bdi->path,
 							 BGP_PATH_HISTORY);
 				bgp_aggregate_increment(
-					bgp, bgp_dest_get_prefix(bdi->dest),
+					bgp, bgp_dest_get_prefix(dest),
 					bdi->path, bdi->afi, bdi->safi);
-				bgp_process(bgp, bdi->dest, bdi->path, bdi->afi,
+				bgp_process(bgp, dest, bdi->path, bdi->afi,
 					    bdi->safi);
 			}
 
-			if (bdi->penalty <= bdc->reuse_limit / 2.0) {
-				bgp_damp_info_free(bdi, &plist, 1);
+			if (bdi->penalty * 2 <= bdc->reuse_limit) {
+				bgp_damp_info_free(bdi, 1);
 			} else {
 				bdi->index = BGP_DAMP_NO_REUSE_LIST_INDEX;
-				bgp_reuselist_switch(&plist, bdi,
-						     &bdc->no_reuse_list);
+				bgp_reuselist_switch(bdi, &bdc->no_reuse_list);
 			}
 		} else {
 			/* Re-insert into another list (See RFC2439 Section
 			 * 4.8.6).  */
 			bdi->index = bgp_reuse_index(bdi->penalty, bdc);
-			bgp_reuselist_switch(&plist, bdi,
+			bgp_reuselist_switch(bdi,
 					     &bdc->reuse_list[bdi->index]);
 		}
 	}
 
-	assert(SLIST_EMPTY(&plist));
+	assert(LIST_EMPTY(&plist));
 }
 
 /* A route becomes unreachable (RFC2439 Section 4.8.2).  */
@@ -247,7 +309,7 @@ int bgp_damp_withdraw(struct bgp_path_info *path, struct bgp_dest *dest,
 	t_now = monotime(NULL);
 	/* Processing Unreachable Messages.  */
 	if (path->extra)
-		bdi = path->extra->damp_info;
+		bdi = bgp_extra_damp_info(path->extra);
 
 	if (bdi == NULL) {
 		/* If there is no previous stability history. */
@@ -257,10 +319,8 @@ int bgp_damp_withdraw(struct bgp_path_info *path, struct bgp_dest *dest,
 		   2. set figure-of-merit = 1.
 		   3. withdraw the route.  */
 
-		bdi = XCALLOC(MTYPE_BGP_DAMP_INFO,
-			      sizeof(struct bgp_damp_info));
+		bdi = bgp_damp_info_alloc();
 		bdi->path = path;
-		bdi->dest = dest;
 		bdi->penalty =
 			(attr_change ? DEFAULT_PENALTY / 2 : DEFAULT_PENALTY);
 		bdi->flap = 1;
@@ -269,7 +329,8 @@ int bgp_damp_withdraw(struct bgp_path_info *path, struct bgp_dest *dest,
 		bdi->index = BGP_DAMP_NO_REUSE_LIST_INDEX;
 		bdi->afi = afi;
 		bdi->safi = safi;
-		(bgp_path_info_extra_get(path))->damp_info = bdi;
+		bgp_path_info_extra_ext_set(bgp_path_info_extra_get(path),
+					    BGP_PATH_EXTRA_DAMP_INFO, bdi);
 		bgp_no_reuse_list_add(bdi, bdc);
 	} else {
 		if (bdi->config != bdc) {
@@ -294,7 +355,7 @@ int bgp_damp_withdraw(struct bgp_path_info *path, struct bgp_dest *dest,
 		bdi->flap++;
 	}
 
-	assert((dest == bdi->dest) && (path == bdi->path));
+	assert((dest == path->net) && (path == bdi->path));
 
 	bdi->lastrecord = BGP_RECORD_WITHDRAW;
 	bdi->t_updated = t_now;
@@ -334,7 +395,7 @@ int bgp_damp_update(struct bgp_path_info *path, struct bgp_dest *dest,
 	bdc = get_active_bdc_from_pi(path, afi, safi);
 	assert(bdc);
 
-	if (!path->extra || !((bdi = path->extra->damp_info)))
+	if (!path->extra || !((bdi = bgp_extra_damp_info(path->extra))))
 		return BGP_DAMP_USED;
 
 	t_now = monotime(NULL);
@@ -357,29 +418,28 @@ int bgp_damp_update(struct bgp_path_info *path, struct bgp_dest *dest,
 	} else
 		status = BGP_DAMP_SUPPRESSED;
 
-	if (bdi->penalty > bdc->reuse_limit / 2.0)
+	if (bdi->penalty * 2 > bdc->reuse_limit)
 		bdi->t_updated = t_now;
 	else
-		bgp_damp_info_free(bdi, NULL, 0);
+		bgp_damp_info_free(bdi, 0);
 
 	return status;
 }
 
-void bgp_damp_info_free(struct bgp_damp_info *bdi, struct reuselist *list,
-			int withdraw)
+void bgp_damp_info_free(struct bgp_damp_info *bdi, int withdraw)
 {
 	assert(bdi);
 
 	afi_t afi = bdi->afi;
 	safi_t safi = bdi->safi;
 	struct bgp_path_info *bpi = bdi->path;
-	struct bgp_dest *dest = bdi->dest;
+	struct bgp_dest *dest = bpi->net;
 	struct bgp *bgp = bpi->peer->bgp;
-	const struct prefix *p = bgp_dest_get_prefix(bdi->dest);
+	const struct prefix *p = bgp_dest_get_prefix(dest);
 
-	bgp_damp_info_unclaim(bdi, list);
+	bgp_damp_info_unclaim(bdi);
 
-	bpi->extra->damp_info = NULL;
+	bgp_path_info_extra_ext_set(bpi->extra, BGP_PATH_EXTRA_DAMP_INFO, NULL);
 	bgp_path_info_unset_flag(dest, bpi, BGP_PATH_HISTORY | BGP_PATH_DAMPED);
 	if (bdi->lastrecord == BGP_RECORD_WITHDRAW && withdraw) {
 		bgp_aggregate_decrement(bgp, p, bpi, afi, SAFI_UNICAST);
@@ -387,7 +447,7 @@ void bgp_damp_info_free(struct bgp_damp_info *bdi, struct reuselist *list,
 		bgp_process(bgp, dest, bpi, afi, safi);
 	}
 
-	XFREE(MTYPE_BGP_DAMP_INFO, bdi);
+	bgp_damp_info_release(bdi);
 }
 
 static void bgp_damp_parameter_set(time_t hlife, unsigned int reuse,
@@ -397,6 +457,8 @@ static void bgp_damp_parameter_set(time_t hlife, unsigned int reuse,
 	double reuse_max_ratio;
 	unsigned int i;
 	double j;
+	double decay, decay_step;
+	double scale;
 
 	bdc->suppress_value = sup;
 	bdc->half_life = hlife;
@@ -413,15 +475,16 @@ static void bgp_damp_parameter_set(time_t hlife, unsigned int reuse,
 	/* Decay-array computations */
 	bdc->decay_array_size = ceil((double)bdc->max_suppress_time / DELTA_T);
 	bdc->decay_array = XMALLOC(MTYPE_BGP_DAMP_ARRAY,
-				   sizeof(double) * (bdc->decay_array_size));
-	bdc->decay_array[0] = 1.0;
-	bdc->decay_array[1] =
-		exp((1.0 / ((double)bdc->half_life / DELTA_T)) * log(0.5));
+				   sizeof(uint32_t) * (bdc->decay_array_size));
+	decay_step = exp((1.0 / ((double)bdc->half_life / DELTA_T)) * log(0.5));
 
-	/* Calculate decay values for all possible times */
-	for (i = 2; i < bdc->decay_array_size; i++)
+	/* Calculate decay values for all possible times, the per route
+	 * decay is then integer only.
+	 */
+	for (i = 0, decay = 1.0; i < bdc->decay_array_size;
+	     i++, decay *= decay_step)
 		bdc->decay_array[i] =
-			bdc->decay_array[i - 1] * bdc->decay_array[1];
+			(uint32_t)(decay * BGP_DAMP_DECAY_ONE + 0.5);
 
 	/* Reuse-list computations */
 	i = ceil((double)bdc->max_suppress_time / DELTA_REUSE) + 1;
@@ -443,6 +506,12 @@ static void bgp_damp_parameter_set(time_t hlife, unsigned int reuse,
 
 	bdc->scale_factor =
 		(double)bdc->reuse_index_size / (reuse_max_ratio - 1);
+	scale = bdc->scale_factor * ((uint64_t)1 << BGP_DAMP_REUSE_SHIFT) /
+		bdc->reuse_limit;
+	if (scale >= (double)UINT64_MAX)
+		bdc->reuse_index_scale = UINT64_MAX;
+	else
+		bdc->reuse_index_scale = MAX((uint64_t)scale, 1);
 
 	for (i = 0; i < bdc->reuse_index_size; i++) {
 		bdc->reuse_index[i] =
@@ -491,22 +560,22 @@ void bgp_damp_info_clean(struct bgp *bgp, struct bgp_damp_config *bdc,
 	bdc->reuse_offset = 0;
 	for (i = 0; i < bdc->reuse_list_size; ++i) {
 		list = &bdc->reuse_list[i];
-		while ((bdi = SLIST_FIRST(list)) != NULL) {
+		while ((bdi = LIST_FIRST(list)) != NULL) {
 			if (bdi->lastrecord == BGP_RECORD_UPDATE) {
 				bgp_aggregate_increment(bgp,
 							bgp_dest_get_prefix(
-								bdi->dest),
+								bdi->path->net),
 							bdi->path, bdi->afi,
 							bdi->safi);
-				bgp_process(bgp, bdi->dest, bdi->path, bdi->afi,
-					    bdi->safi);
+				bgp_process(bgp, bdi->path->net, bdi->path,
+					    bdi->afi, bdi->safi);
 			}
-			bgp_damp_info_free(bdi, list, 1);
+			bgp_damp_info_free(bdi, 1);
 		}
 	}
 
-	while ((bdi = SLIST_FIRST(&bdc->no_reuse_list)) != NULL)
-		bgp_damp_info_free(bdi, &bdc->no_reuse_list, 1);
+	while ((bdi = LIST_FIRST(&bdc->no_reuse_list)) != NULL)
+		bgp_damp_info_free(bdi, 1);
 
 	/* Free decay array */
 	XFREE(MTYPE_BGP_DAMP_ARRAY, bdc->decay_array);
@@ -582,9 +651,8 @@ static const char *bgp_get_reuse_time(struct bgp_damp_config *bdc,
 	int time_store = 0;
 
 	if (penalty > bdc->reuse_limit) {
-		reuse_time = (int)(DELTA_T *
-				   ((log((double)bdc->reuse_limit / penalty)) /
-				    (log(bdc->decay_array[1]))));
+		reuse_time = (int)(bdc->half_life *
+				   log2((double)penalty / bdc->reuse_limit));
 
 		if (reuse_time > bdc->max_suppress_time)
 			reuse_time = bdc->max_suppress_time;
@@ -653,7 +721,7 @@ void bgp_damp_info_vty(struct vty *vty, struct bgp *bgp,
 		return;
 
 	/* BGP dampening information.  */
-	bdi = path->extra->damp_info;
+	bdi = bgp_extra_damp_info(path->extra);
 
 	/* If dampening is not enabled or there is no dampening information,
 	   return immediately.  */
@@ -714,7 +782,7 @@ const char *bgp_damp_reuse_time_vty(struct vty *vty, struct bgp_path_info *path,
 		return NULL;
 
 	/* BGP dampening information.  */
-	bdi = path->extra->damp_info;
+	bdi = bgp_extra_damp_info(path->extra);
 
 	/* If dampening is not enabled or there is no dampening information,
 	   return immediately.  */
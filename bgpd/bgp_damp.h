@@ -8,34 +8,37 @@
 
 #include "bgpd/bgp_table.h"
 
-/* Structure maintained on a per-route basis. */
+/* Structure maintained on a per-route basis.
+ *
+ * These are carved out of chunks (see bgp_damp_info_alloc()), keep it small.
+ */
 struct bgp_damp_info {
+	/* Entry in the reuse list, or in the free list when unused. */
+	LIST_ENTRY(bgp_damp_info) entry;
+
+	/* Back reference to associated dampening configuration. */
+	struct bgp_damp_config *config;
+
+	/* Back reference to bgp_path_info, the route is path->net. */
+	struct bgp_path_info *path;
+
 	/* Figure-of-merit.  */
-	unsigned int penalty;
+	uint32_t penalty;
 
 	/* Number of flapping.  */
-	unsigned int flap;
+	uint32_t flap;
 
-	/* First flap time  */
-	time_t start_time;
+	/* First flap time (monotime seconds) */
+	uint32_t start_time;
 
 	/* Last time penalty was updated.  */
-	time_t t_updated;
+	uint32_t t_updated;
 
 	/* Time of route start to be suppressed.  */
-	time_t suppress_time;
-
-	/* Back reference to associated dampening configuration. */
-	struct bgp_damp_config *config;
-
-	/* Back reference to bgp_path_info. */
-	struct bgp_path_info *path;
-
-	/* Back reference to bgp_node. */
-	struct bgp_dest *dest;
+	uint32_t suppress_time;
 
 	/* Current index in the reuse_list. */
-	int index;
+	int16_t index;
 #define BGP_DAMP_NO_REUSE_LIST_INDEX                                           \
 	(-1) /* index for elements on no_reuse_list */
 
@@ -44,13 +47,11 @@ struct bgp_damp_info {
 #define BGP_RECORD_UPDATE	1U
 #define BGP_RECORD_WITHDRAW	2U
 
-	afi_t afi;
-	safi_t safi;
-
-	SLIST_ENTRY(bgp_damp_info) entry;
+	uint8_t afi;
+	uint8_t safi;
 };
 
-SLIST_HEAD(reuselist, bgp_damp_info);
+LIST_HEAD(reuselist, bgp_damp_info);
 
 /* Specified parameter set configuration. */
 struct bgp_damp_config {
@@ -80,9 +81,11 @@ struct bgp_damp_config {
 	unsigned int decay_array_size; /* Calculated using config parameters */
 	unsigned int reuse_scale_factor;
 	double scale_factor;
+	/* scale_factor / reuse_limit, BGP_DAMP_REUSE_SHIFT fixed point */
+	uint64_t reuse_index_scale;
 
-	/* Decay array per-set based. */
-	double *decay_array;
+	/* Decay array per-set based, BGP_DAMP_DECAY_SHIFT fixed point. */
+	uint32_t *decay_array;
 
 	/* Reuse index array per-set based. */
 	int *reuse_index;
@@ -111,6 +114,13 @@ struct bgp_damp_config {
 /* Time granularity for decay arrays */
 #define DELTA_T 	           5
 
+/* Fixed point decay factors, BGP_DAMP_DECAY_ONE is 1.0 */
+#define BGP_DAMP_DECAY_SHIFT      16
+#define BGP_DAMP_DECAY_ONE        (1U << BGP_DAMP_DECAY_SHIFT)
+
+/* Fixed point reuse index scale, fine enough for any reuse-limit */
+#define BGP_DAMP_REUSE_SHIFT      32
+
 #define DEFAULT_PENALTY         1000
 
 #define DEFAULT_HALF_LIFE         15
@@ -130,8 +140,8 @@ extern int bgp_damp_withdraw(struct bgp_path_info *path, struct bgp_dest *dest,
 			     afi_t afi, safi_t safi, int attr_change);
 extern int bgp_damp_update(struct bgp_path_info *path, struct bgp_dest *dest,
 			   afi_t afi, safi_t saff);
-extern void bgp_damp_info_free(struct bgp_damp_info *bdi,
-			       struct reuselist *list, int withdraw);
+extern void bgp_damp_info_free(struct bgp_damp_info *bdi, int withdraw);
+extern unsigned long bgp_damp_info_count(size_t *memory);
 extern void bgp_damp_info_clean(struct bgp *bgp, struct bgp_damp_config *bdc,
 				afi_t afi, safi_t safi);
 extern void bgp_damp_config_clean(struct bgp_damp_config *bdc);
@@ -73,8 +73,44 @@ struct bgp_dump {
 	struct event *t_interval;
 };
 
+/* Number of table nodes visited per slice of the routes-mrt walk */
+#define BGP_DUMP_ROUTES_WALK_CHUNK 10000
+
+/* stdio buffer for the routes-mrt file, records are small */
+#define BGP_DUMP_ROUTES_BUFSIZE (1024 * 1024)
+
+/*
+ * State of the TABLE_DUMP_V2 walk for 'dump bgp routes-mrt'.  The table is
+ * walked in slices from the event loop so a full table dump does not stall
+ * the daemon; the current dest stays locked between slices.  Routes that
+ * change while the walk is in progress are dumped in whatever state the
+ * walk finds them.
+ */
+static struct bgp_dump_routes_walk {
+	struct bgp *bgp;
+	struct bgp_table *table;
+	struct bgp_dest *dest;
+	afi_t afi;
+
+	unsigned int seq;
+
+	/* timing, logged when the dump completes */
+	struct timeval start;
+	int64_t slice_max;
+	unsigned int slices;
+
+	struct event *t_walk;
+} bgp_dump_walk;
+
 static int bgp_dump_unset(struct bgp_dump *bgp_dump);
 static void bgp_dump_interval_func(struct event *);
+static void bgp_dump_routes_walk_stop(void);
+
+/*
+ * Bumped for every PEER_INDEX_TABLE written; peers created after the
+ * index of the running routes dump was written are not in it.
+ */
+static uint32_t bgp_dump_routes_gen;
 
 /* BGP packet dump output buffer. */
 struct stream *bgp_dump_obuf;
@@ -215,6 +251,9 @@ static void bgp_dump_routes_index_table(struct bgp *bgp)
 	obuf = bgp_dump_obuf;
 	stream_reset(obuf);
 
+	if (++bgp_dump_routes_gen == 0)
+		bgp_dump_routes_gen++;
+
 	/* MRT header */
 	bgp_dump_header(obuf, MSG_TABLE_DUMP_V2, TABLE_DUMP_V2_PEER_INDEX_TABLE,
 			BGP_DUMP_ROUTES);
@@ -283,6 +322,7 @@ static void bgp_dump_routes_index_table(struct bgp *bgp)
 
 		/* Store the peer number for this peer */
 		peer->table_dump_index = peerno;
+		peer->table_dump_gen = bgp_dump_routes_gen;
 		peerno++;
 	}
 
@@ -292,9 +332,22 @@ static void bgp_dump_routes_index_table(struct bgp *bgp)
 	fflush(bgp_dump_routes.fp);
 }
 
+/*
+ * Whether a path can be referred to from the PEER_INDEX_TABLE of the running
+ * routes dump: locally originated routes use the fake peer at index 0,
+ * anything else must come from a peer listed in the index.
+ */
+static bool bgp_dump_path_indexed(const struct bgp_path_info *path)
+{
+	if (path->peer == path->peer->bgp->peer_self)
+		return true;
+
+	return path->peer->table_dump_gen == bgp_dump_routes_gen;
+}
+
 static struct bgp_path_info *
 bgp_dump_route_node_record(int afi, struct bgp_dest *dest,
-			   struct bgp_path_info *path, unsigned int seq)
+			   struct bgp_path_info *path, unsigned int *seq)
 {
 	struct stream *obuf;
 	size_t sizep;
@@ -305,6 +358,11 @@ bgp_dump_route_node_record(int afi, struct bgp_dest *dest,
 	obuf = bgp_dump_obuf;
 	stream_reset(obuf);
 
+	while (path && !bgp_dump_path_indexed(path))
+		path = path->next;
+	if (!path)
+		return NULL;
+
 	addpath_capable = bgp_addpath_encode_rx(path->peer, afi, SAFI_UNICAST);
 
 	/* MRT header */
@@ -326,7 +384,7 @@ bgp_dump_route_node_record(int afi, struct bgp_dest *dest,
 				BGP_DUMP_ROUTES);
 
 	/* Sequence number */
-	stream_putl(obuf, seq);
+	stream_putl(obuf, *seq);
 
 	/* Prefix length */
 	stream_putc(obuf, p->prefixlen);
@@ -357,6 +415,9 @@ bgp_dump_route_node_record(int afi, struct bgp_dest *dest,
 	for (; path; path = path->next) {
 		size_t cur_endp;
 
+		if (!bgp_dump_path_indexed(path))
+			continue;
+
 		/* Peer index */
 		stream_putw(obuf, path->peer->table_dump_index);
 
@@ -389,48 +450,143 @@ bgp_dump_route_node_record(int afi, struct bgp_dest *dest,
 
 	bgp_dump_set_size(obuf, MSG_TABLE_DUMP_V2);
 	fwrite(STREAM_DATA(obuf), stream_get_endp(obuf), 1, bgp_dump_routes.fp);
+	(*seq)++;
 
 	return path;
 }
 
 
-/* Runs under child process. */
-static unsigned int bgp_dump_routes_func(int afi, int first_run,
-					 unsigned int seq)
+static void bgp_dump_routes_walk_table(struct bgp_dump_routes_walk *walk,
+				       afi_t afi)
+{
+	walk->afi = afi;
+	walk->table = walk->bgp->rib[afi][SAFI_UNICAST];
+	walk->dest = NULL;
+	if (walk->table)
+		bgp_table_lock(walk->table);
+}
+
+static void bgp_dump_routes_walk_stop(void)
+{
+	struct bgp_dump_routes_walk *walk = &bgp_dump_walk;
+
+	EVENT_OFF(walk->t_walk);
+
+	if (walk->dest)
+		bgp_dest_unlock_node(walk->dest);
+	if (walk->table)
+		bgp_table_unlock(walk->table);
+	if (walk->bgp)
+		bgp_unlock(walk->bgp);
+
+	memset(walk, 0, sizeof(*walk));
+}
+
+static void bgp_dump_routes_walk_finish(struct bgp_dump_routes_walk *walk)
+{
+	int64_t elapsed = monotime_since(&walk->start, NULL);
+
+	if (bgp_dump_routes.fp) {
+		fflush(bgp_dump_routes.fp);
+		/* Close the file now. For a RIB dump there's no point in
+		 * leaving it open until the next scheduled dump starts.
+		 */
+		fclose(bgp_dump_routes.fp);
+		bgp_dump_routes.fp = NULL;
+	}
+
+	zlog_info("MRT routes dump: %u records in %" PRId64
+		  " ms, %u slices, longest slice %" PRId64 " us",
+		  walk->seq, elapsed / 1000, walk->slices, walk->slice_max);
+
+	bgp_dump_routes_walk_stop();
+}
+
+static void bgp_dump_routes_walk_func(struct event *t)
 {
+	struct bgp_dump_routes_walk *walk = EVENT_ARG(t);
 	struct bgp_path_info *path;
 	struct bgp_dest *dest;
+	struct timeval slice_start;
+	unsigned int count = 0;
+	int64_t slice;
+
+	if (bgp_dump_routes.fp == NULL) {
+		bgp_dump_routes_walk_stop();
+		return;
+	}
+
+	monotime(&slice_start);
+
+	while (walk->table) {
+		if (walk->dest)
+			dest = bgp_route_next(walk->dest);
+		else
+			dest = bgp_table_top(walk->table);
+
+		for (; dest; dest = bgp_route_next(dest)) {
+			path = bgp_dest_get_bgp_path_info(dest);
+			while (path) {
+				path = bgp_dump_route_node_record(walk->afi,
+								  dest, path,
+								  &walk->seq);
+			}
+
+			if (++count >= BGP_DUMP_ROUTES_WALK_CHUNK)
+				break;
+		}
+
+		/* dest is still locked if the walk stopped on it */
+		walk->dest = dest;
+		if (dest)
+			break;
+
+		bgp_table_unlock(walk->table);
+		walk->table = NULL;
+		if (walk->afi == AFI_IP)
+			bgp_dump_routes_walk_table(walk, AFI_IP6);
+	}
+
+	slice = monotime_since(&slice_start, NULL);
+	if (slice > walk->slice_max)
+		walk->slice_max = slice;
+	walk->slices++;
+
+	if (!walk->table) {
+		bgp_dump_routes_walk_finish(walk);
+		return;
+	}
+
+	event_add_event(bm->master, bgp_dump_routes_walk_func, walk, 0,
+			&walk->t_walk);
+}
+
+/* Start the routes-mrt walk on a freshly opened bgp_dump_routes.fp */
+static void bgp_dump_routes_walk_start(void)
+{
+	struct bgp_dump_routes_walk *walk = &bgp_dump_walk;
 	struct bgp *bgp;
-	struct bgp_table *table;
 
 	bgp = bgp_get_default();
-	if (!bgp)
-		return seq;
-
-	if (bgp_dump_routes.fp == NULL)
-		return seq;
-
-	/* Note that bgp_dump_routes_index_table will do ipv4 and ipv6 peers,
-	   so this should only be done on the first call to
-	   bgp_dump_routes_func.
-	   ( this function will be called once for ipv4 and once for ipv6 ) */
-	if (first_run)
-		bgp_dump_routes_index_table(bgp);
-
-	/* Walk down each BGP route. */
-	table = bgp->rib[afi][SAFI_UNICAST];
-
-	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
-		path = bgp_dest_get_bgp_path_info(dest);
-		while (path) {
-			path = bgp_dump_route_node_record(afi, dest, path, seq);
-			seq++;
-		}
+	if (!bgp) {
+		fclose(bgp_dump_routes.fp);
+		bgp_dump_routes.fp = NULL;
+		return;
 	}
 
-	fflush(bgp_dump_routes.fp);
+	setvbuf(bgp_dump_routes.fp, NULL, _IOFBF, BGP_DUMP_ROUTES_BUFSIZE);
+
+	memset(walk, 0, sizeof(*walk));
+	monotime(&walk->start);
+	walk->bgp = bgp_lock(bgp);
+
+	/* The index table covers both ipv4 and ipv6 peers */
+	bgp_dump_routes_index_table(bgp);
 
-	return seq;
+	bgp_dump_routes_walk_table(walk, AFI_IP);
+
+	event_add_event(bm->master, bgp_dump_routes_walk_func, walk, 0,
+			&walk->t_walk);
 }
 
 static void bgp_dump_interval_func(struct event *t)
@@ -439,18 +595,18 @@ static void bgp_dump_interval_func(struct event *t)
 	bgp_dump = EVENT_ARG(t);
 
 	/* Reschedule dump even if file couldn't be opened this time... */
-	if (bgp_dump_open_file(bgp_dump) != NULL) {
+	if (bgp_dump->type == BGP_DUMP_ROUTES && bgp_dump_walk.bgp) {
+		/* The previous routes dump is still being written, leave its
+		 * file alone.
+		 */
+		flog_warn(EC_BGP_DUMP,
+			  "%s: previous routes dump still in progress, skipping",
+			  __func__);
+	} else if (bgp_dump_open_file(bgp_dump) != NULL) {
 		/* In case of bgp_dump_routes, we need special route dump
 		 * function. */
-		if (bgp_dump->type == BGP_DUMP_ROUTES) {
-			unsigned int seq = bgp_dump_routes_func(AFI_IP, 1, 0);
-			bgp_dump_routes_func(AFI_IP6, 0, seq);
-			/* Close the file now. For a RIB dump there's no point
-			 * in leaving
-			 * it open until the next scheduled dump starts. */
-			fclose(bgp_dump->fp);
-			bgp_dump->fp = NULL;
-		}
+		if (bgp_dump->type == BGP_DUMP_ROUTES)
+			bgp_dump_routes_walk_start();
 	}
 
 	/* if interval is set reschedule */
@@ -688,6 +844,9 @@ static int bgp_dump_set(struct vty *vty, struct bgp_dump *bgp_dump,
 
 static int bgp_dump_unset(struct bgp_dump *bgp_dump)
 {
+	if (bgp_dump == &bgp_dump_routes)
+		bgp_dump_routes_walk_stop();
+
 	/* Removing file name. */
 	XFREE(MTYPE_BGP_DUMP_STR, bgp_dump->filename);
 
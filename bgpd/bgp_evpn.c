@@ -51,6 +51,7 @@ DEFINE_QOBJ_TYPE(bgp_evpn_es);
 
 DEFINE_MTYPE_STATIC(BGPD, BGP_EVPN_INFO, "BGP EVPN instance information");
 DEFINE_MTYPE_STATIC(BGPD, VRF_ROUTE_TARGET, "L3 Route Target");
+DEFINE_MTYPE_STATIC(BGPD, BGP_EVPN_RT_INDEX, "BGP EVPN import RT index");
 
 /*
  * Static function declarations
@@ -318,15 +319,19 @@ static int is_vni_present_in_irt_vnis(struct list *vnis, struct bgpevpn *vpn)
  */
 bool is_route_injectable_into_evpn_non_supp(struct bgp_path_info *pi)
 {
+	struct bgp_path_info_extra_vrfleak *vrfleak;
 	struct bgp_path_info *parent_pi;
 	struct bgp_table *table;
 	struct bgp_dest *dest;
 
-	if (pi->sub_type != BGP_ROUTE_IMPORTED || !pi->extra ||
-	    !pi->extra->vrfleak || !pi->extra->vrfleak->parent)
+	if (pi->sub_type != BGP_ROUTE_IMPORTED)
 		return true;
 
-        parent_pi = (struct bgp_path_info *)pi->extra->vrfleak->parent;
+	vrfleak = bgp_extra_vrfleak(pi->extra);
+	if (!vrfleak || !vrfleak->parent)
+		return true;
+
+	parent_pi = (struct bgp_path_info *)vrfleak->parent;
         dest = parent_pi->net;
         if (!dest)
 		return true;
@@ -466,6 +471,363 @@ static void vrf_rt2ecom_val(struct ecommunity_val *to_eval,
 		mask_ecom_global_admin(to_eval, eval);
 }
 
+/*
+ * Import RT index.
+ *
+ * Every global EVPN route that goes through import is recorded under each
+ * of its RTs, both as-is and with the global-admin field masked out (the
+ * two forms an import RT can be mapped with, see map_vni_to_rt() and
+ * vrf_rt2ecom_val()). A VNI or VRF coming up then only looks at the routes
+ * filed under its own import RTs instead of walking the whole table. The
+ * index may hold more routes than match; callers still do the full RT check
+ * on every candidate.
+ */
+PREDECL_HASH(evpn_rt_index_dests);
+
+struct evpn_rt_index_dest {
+	struct evpn_rt_index_dests_item item;
+	struct bgp_dest *dest;
+};
+
+struct evpn_rt_index_entry {
+	struct evpn_rt_index_item item;
+	struct ecommunity_val rt;
+	struct evpn_rt_index_dests_head dests;
+};
+
+static int evpn_rt_index_cmp(const struct evpn_rt_index_entry *a,
+			     const struct evpn_rt_index_entry *b)
+{
+	return memcmp(a->rt.val, b->rt.val, ECOMMUNITY_SIZE);
+}
+
+static uint32_t evpn_rt_index_hash(const struct evpn_rt_index_entry *entry)
+{
+	return jhash(entry->rt.val, ECOMMUNITY_SIZE, 0x5ea1c0de);
+}
+
+DECLARE_HASH(evpn_rt_index, struct evpn_rt_index_entry, item,
+	     evpn_rt_index_cmp, evpn_rt_index_hash);
+
+static int evpn_rt_index_dests_cmp(const struct evpn_rt_index_dest *a,
+				   const struct evpn_rt_index_dest *b)
+{
+	return numcmp((uintptr_t)a->dest, (uintptr_t)b->dest);
+}
+
+static uint32_t evpn_rt_index_dests_hash(const struct evpn_rt_index_dest *idest)
+{
+	return jhash(&idest->dest, sizeof(idest->dest), 0);
+}
+
+DECLARE_HASH(evpn_rt_index_dests, struct evpn_rt_index_dest, item,
+	     evpn_rt_index_dests_cmp, evpn_rt_index_dests_hash);
+
+/*
+ * Fill in the index keys for the RT at pnt, returns the number of keys.
+ */
+static int evpn_rt_index_keys(const uint8_t *pnt, struct ecommunity_val *keys)
+{
+	uint8_t type = pnt[0];
+
+	memcpy(&keys[0], pnt, ECOMMUNITY_SIZE);
+	if (type != ECOMMUNITY_ENCODE_AS && type != ECOMMUNITY_ENCODE_AS4 &&
+	    type != ECOMMUNITY_ENCODE_IP)
+		return 1;
+
+	memcpy(&keys[1], pnt, ECOMMUNITY_SIZE);
+	mask_ecom_global_admin(&keys[1], &keys[0]);
+	return 2;
+}
+
+static bool evpn_rt_index_path_has_key(const struct bgp_path_info *pi,
+				       const struct ecommunity_val *key)
+{
+	struct ecommunity *ecom;
+	struct ecommunity_val keys[2];
+	const uint8_t *pnt;
+	uint32_t i;
+	int j, n;
+
+	ecom = bgp_attr_get_ecommunity(pi->attr);
+	if (!ecom)
+		return false;
+
+	for (i = 0; i < ecom->size; i++) {
+		pnt = ecom->val + (i * ecom->unit_size);
+		if (pnt[1] != ECOMMUNITY_ROUTE_TARGET)
+			continue;
+
+		n = evpn_rt_index_keys(pnt, keys);
+		for (j = 0; j < n; j++)
+			if (!memcmp(keys[j].val, key->val, ECOMMUNITY_SIZE))
+				return true;
+	}
+
+	return false;
+}
+
+static bool evpn_rt_index_dest_has_key(struct bgp_dest *dest,
+				       const struct bgp_path_info *skip,
+				       const struct ecommunity_val *key)
+{
+	const struct bgp_path_info *pi;
+
+	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
+		if (pi != skip && evpn_rt_index_path_has_key(pi, key))
+			return true;
+
+	return false;
+}
+
+static void evpn_rt_index_entry_free(struct bgp_evpn_info *ei,
+				     struct evpn_rt_index_entry *entry)
+{
+	evpn_rt_index_del(&ei->rt_index, entry);
+	evpn_rt_index_dests_fini(&entry->dests);
+	XFREE(MTYPE_BGP_EVPN_RT_INDEX, entry);
+}
+
+static void evpn_rt_index_dest_free(struct evpn_rt_index_entry *entry,
+				    struct evpn_rt_index_dest *idest,
+				    bool unlock)
+{
+	evpn_rt_index_dests_del(&entry->dests, idest);
+	if (unlock)
+		bgp_dest_unlock_node(idest->dest);
+	XFREE(MTYPE_BGP_EVPN_RT_INDEX, idest);
+}
+
+static void evpn_rt_index_add_key(struct bgp_evpn_info *ei,
+				  const struct ecommunity_val *key,
+				  struct bgp_dest *dest)
+{
+	struct evpn_rt_index_entry lookup, *entry;
+	struct evpn_rt_index_dest dref, *idest;
+
+	memcpy(&lookup.rt, key, sizeof(lookup.rt));
+	entry = evpn_rt_index_find(&ei->rt_index, &lookup);
+	if (!entry) {
+		entry = XCALLOC(MTYPE_BGP_EVPN_RT_INDEX, sizeof(*entry));
+		memcpy(&entry->rt, key, sizeof(entry->rt));
+		evpn_rt_index_dests_init(&entry->dests);
+		evpn_rt_index_add(&ei->rt_index, entry);
+	}
+
+	dref.dest = dest;
+	if (evpn_rt_index_dests_find(&entry->dests, &dref))
+		return;
+
+	idest = XCALLOC(MTYPE_BGP_EVPN_RT_INDEX, sizeof(*idest));
+	idest->dest = bgp_dest_lock_node(dest);
+	evpn_rt_index_dests_add(&entry->dests, idest);
+}
+
+static void evpn_rt_index_del_key(struct bgp_evpn_info *ei,
+				  const struct ecommunity_val *key,
+				  struct bgp_dest *dest,
+				  const struct bgp_path_info *pi)
+{
+	struct evpn_rt_index_entry lookup, *entry;
+	struct evpn_rt_index_dest dref, *idest;
+
+	memcpy(&lookup.rt, key, sizeof(lookup.rt));
+	entry = evpn_rt_index_find(&ei->rt_index, &lookup);
+	if (!entry)
+		return;
+
+	dref.dest = dest;
+	idest = evpn_rt_index_dests_find(&entry->dests, &dref);
+	if (!idest)
+		return;
+
+	/* Another path for the same prefix still carries this RT */
+	if (evpn_rt_index_dest_has_key(dest, pi, key))
+		return;
+
+	evpn_rt_index_dest_free(entry, idest, true);
+	if (!evpn_rt_index_dests_count(&entry->dests))
+		evpn_rt_index_entry_free(ei, entry);
+}
+
+/*
+ * Record a global EVPN route under its RTs, called when it is imported.
+ */
+void bgp_evpn_rt_index_add(struct bgp *bgp, struct bgp_path_info *pi)
+{
+	struct bgp_evpn_info *ei = bgp->evpn_info;
+	const struct prefix_evpn *evp;
+	struct ecommunity *ecom;
+	struct ecommunity_val keys[2];
+	const uint8_t *pnt;
+	uint32_t i;
+	int j, n;
+
+	if (!ei || !pi->net)
+		return;
+
+	/* Only the route types that are imported by RT into VNIs and VRFs */
+	evp = (const struct prefix_evpn *)bgp_dest_get_prefix(pi->net);
+	if (evp->prefix.route_type != BGP_EVPN_MAC_IP_ROUTE &&
+	    evp->prefix.route_type != BGP_EVPN_IMET_ROUTE &&
+	    evp->prefix.route_type != BGP_EVPN_AD_ROUTE &&
+	    evp->prefix.route_type != BGP_EVPN_IP_PREFIX_ROUTE)
+		return;
+
+	ecom = bgp_attr_get_ecommunity(pi->attr);
+	if (!ecom)
+		return;
+
+	for (i = 0; i < ecom->size; i++) {
+		pnt = ecom->val + (i * ecom->unit_size);
+		if (pnt[1] != ECOMMUNITY_ROUTE_TARGET)
+			continue;
+
+		n = evpn_rt_index_keys(pnt, keys);
+		for (j = 0; j < n; j++)
+			evpn_rt_index_add_key(ei, &keys[j], pi->net);
+	}
+}
+
+/*
+ * Drop a global EVPN route from the index, called when it is unimported.
+ * Routes whose RTs changed without an unimport are pruned by the next
+ * bgp_evpn_rt_index_collect() that runs into them.
+ */
+void bgp_evpn_rt_index_del(struct bgp *bgp, struct bgp_path_info *pi)
+{
+	struct bgp_evpn_info *ei = bgp->evpn_info;
+	struct ecommunity *ecom;
+	struct ecommunity_val keys[2];
+	const uint8_t *pnt;
+	uint32_t i;
+	int j, n;
+
+	if (!ei || !pi->net || !evpn_rt_index_count(&ei->rt_index))
+		return;
+
+	ecom = bgp_attr_get_ecommunity(pi->attr);
+	if (!ecom)
+		return;
+
+	for (i = 0; i < ecom->size; i++) {
+		pnt = ecom->val + (i * ecom->unit_size);
+		if (pnt[1] != ECOMMUNITY_ROUTE_TARGET)
+			continue;
+
+		n = evpn_rt_index_keys(pnt, keys);
+		for (j = 0; j < n; j++)
+			evpn_rt_index_del_key(ei, &keys[j], pi->net, pi);
+	}
+}
+
+static int evpn_rt_index_dest_ptr_cmp(const void *a, const void *b)
+{
+	const struct bgp_dest *const *da = a;
+	const struct bgp_dest *const *db = b;
+
+	return numcmp((uintptr_t)*da, (uintptr_t)*db);
+}
+
+/*
+ * Collect the global EVPN routes filed under any of the given keys. Each
+ * route is returned once and locked; the caller hands the array back to
+ * bgp_evpn_rt_index_release() when done.
+ */
+size_t bgp_evpn_rt_index_collect(struct bgp *bgp,
+				 const struct ecommunity_val *keys,
+				 size_t nkeys, struct bgp_dest ***dests)
+{
+	struct bgp_evpn_info *ei = bgp->evpn_info;
+	struct evpn_rt_index_entry lookup, *entry;
+	struct evpn_rt_index_dest *idest;
+	struct bgp_dest **arr = NULL;
+	size_t count = 0, size = 0, i, j;
+
+	*dests = NULL;
+	if (!ei)
+		return 0;
+
+	for (i = 0; i < nkeys; i++) {
+		memcpy(&lookup.rt, &keys[i], sizeof(lookup.rt));
+		entry = evpn_rt_index_find(&ei->rt_index, &lookup);
+		if (!entry)
+			continue;
+
+		frr_each_safe (evpn_rt_index_dests, &entry->dests, idest) {
+			if (!evpn_rt_index_dest_has_key(idest->dest, NULL,
+							&entry->rt)) {
+				evpn_rt_index_dest_free(entry, idest, true);
+				continue;
+			}
+
+			if (count == size) {
+				size = size ? size * 2 : 64;
+				arr = XREALLOC(MTYPE_TMP, arr,
+					       size * sizeof(*arr));
+			}
+			arr[count++] = bgp_dest_lock_node(idest->dest);
+		}
+
+		if (!evpn_rt_index_dests_count(&entry->dests))
+			evpn_rt_index_entry_free(ei, entry);
+	}
+
+	/* A route carrying more than one of the keys is listed once per key */
+	if (count > 1) {
+		qsort(arr, count, sizeof(*arr), evpn_rt_index_dest_ptr_cmp);
+		for (i = 1, j = 1; i < count; i++) {
+			if (arr[i] == arr[j - 1]) {
+				bgp_dest_unlock_node(arr[i]);
+				continue;
+			}
+			arr[j++] = arr[i];
+		}
+		count = j;
+	}
+
+	*dests = arr;
+	return count;
+}
+
+void bgp_evpn_rt_index_release(struct bgp_dest **dests, size_t count)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++)
+		bgp_dest_unlock_node(dests[i]);
+
+	XFREE(MTYPE_TMP, dests);
+}
+
+/*
+ * Empty the index. The route locks are only given back when the tables
+ * are still around.
+ */
+void bgp_evpn_rt_index_flush(struct bgp *bgp, bool unlock)
+{
+	struct bgp_evpn_info *ei = bgp->evpn_info;
+	struct evpn_rt_index_entry *entry;
+	struct evpn_rt_index_dest *idest;
+
+	if (!ei)
+		return;
+
+	while ((entry = evpn_rt_index_first(&ei->rt_index))) {
+		while ((idest = evpn_rt_index_dests_first(&entry->dests)))
+			evpn_rt_index_dest_free(entry, idest, unlock);
+		evpn_rt_index_entry_free(ei, entry);
+	}
+}
+
+size_t bgp_evpn_rt_index_count(struct bgp *bgp)
+{
+	if (!bgp->evpn_info)
+		return 0;
+
+	return evpn_rt_index_count(&bgp->evpn_info->rt_index);
+}
+
 /*
  * Map one RT to specified VRF.
  * bgp_vrf = BGP vrf instance
@@ -2030,7 +2392,7 @@ static int update_evpn_route_entry(struct bgp *bgp, struct bgpevpn *vpn,
 
 		/* Mark route as self type-2 route */
 		if (flags && CHECK_FLAG(flags, ZEBRA_MACIP_TYPE_SVI_IP))
-			tmp_pi->extra->evpn->af_flags =
+			bgp_extra_evpn(tmp_pi->extra)->af_flags =
 				BGP_EVPN_MACIP_TYPE_SVI_IP;
 		bgp_path_info_add(dest, tmp_pi);
 	} else {
@@ -2526,7 +2888,7 @@ void bgp_evpn_update_type2_route_entry(struct bgp *bgp, struct bgpevpn *vpn,
 	}
 	memcpy(&attr.esi, &local_pi->attr->esi, sizeof(esi_t));
 	bgp_evpn_get_rmac_nexthop(vpn, &evp, &attr,
-				  local_pi->extra->evpn->af_flags);
+				  bgp_extra_evpn(local_pi->extra)->af_flags);
 	vni2label(vpn->vni, &(attr.label));
 	/* Add L3 VNI RTs and RMAC for non IPv6 link-local if
 	 * using L3 VNI for type-2 routes also.
@@ -2991,6 +3353,8 @@ bgp_create_evpn_bgp_path_info(struct bgp_path_info *parent_pi,
 {
 	struct attr *attr_new;
 	struct bgp_path_info *pi;
+	struct bgp_path_info_extra *extra;
+	struct bgp_path_info_extra_vrfleak *vrfleak;
 
 	/* Add (or update) attribute to hash. */
 	attr_new = bgp_attr_intern(attr);
@@ -2999,12 +3363,15 @@ bgp_create_evpn_bgp_path_info(struct bgp_path_info *parent_pi,
 	pi = info_make(parent_pi->type, BGP_ROUTE_IMPORTED, 0, parent_pi->peer,
 		       attr_new, dest);
 	SET_FLAG(pi->flags, BGP_PATH_VALID);
-	bgp_path_info_extra_get(pi);
-	if (!pi->extra->vrfleak)
-		pi->extra->vrfleak =
-			XCALLOC(MTYPE_BGP_ROUTE_EXTRA_VRFLEAK,
-				sizeof(struct bgp_path_info_extra_vrfleak));
-	pi->extra->vrfleak->parent = bgp_path_info_lock(parent_pi);
+	extra = bgp_path_info_extra_get(pi);
+	vrfleak = bgp_extra_vrfleak(extra);
+	if (!vrfleak) {
+		vrfleak = XCALLOC(MTYPE_BGP_ROUTE_EXTRA_VRFLEAK,
+				  sizeof(struct bgp_path_info_extra_vrfleak));
+		bgp_path_info_extra_ext_set(extra, BGP_PATH_EXTRA_VRFLEAK,
+					    vrfleak);
+	}
+	vrfleak->parent = bgp_path_info_lock(parent_pi);
 	bgp_dest_lock_node((struct bgp_dest *)parent_pi->net);
 	if (parent_pi->extra)
 		pi->extra->igpmetric = parent_pi->extra->igpmetric;
@@ -3026,6 +3393,7 @@ static int install_evpn_route_entry_in_vrf(struct bgp *bgp_vrf,
 {
 	struct bgp_dest *dest;
 	struct bgp_path_info *pi;
+	struct bgp_path_info_extra_vrfleak *vrfleak;
 	struct attr attr;
 	struct attr *attr_new;
 	int ret = 0;
@@ -3110,11 +3478,11 @@ static int install_evpn_route_entry_in_vrf(struct bgp *bgp_vrf,
 		attr.es_flags |= ATTR_ES_L3_NHG_ACTIVE;
 
 	/* Check if route entry is already present. */
-	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
-		if (pi->extra && pi->extra->vrfleak &&
-		    (struct bgp_path_info *)pi->extra->vrfleak->parent ==
-			    parent_pi)
+	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
+		vrfleak = bgp_extra_vrfleak(pi->extra);
+		if (vrfleak && vrfleak->parent == parent_pi)
 			break;
+	}
 
 	if (!pi) {
 		pi = bgp_create_evpn_bgp_path_info(parent_pi, dest, &attr);
@@ -3209,6 +3577,7 @@ static int install_evpn_route_entry_in_vni_common(
 	struct bgp_dest *dest, struct bgp_path_info *parent_pi)
 {
 	struct bgp_path_info *pi;
+	struct bgp_path_info_extra_vrfleak *vrfleak;
 	struct bgp_path_info *local_pi;
 	struct attr *attr_new;
 	int ret;
@@ -3216,11 +3585,11 @@ static int install_evpn_route_entry_in_vni_common(
 	bool new_local_es;
 
 	/* Check if route entry is already present. */
-	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
-		if (pi->extra && pi->extra->vrfleak &&
-		    (struct bgp_path_info *)pi->extra->vrfleak->parent ==
-			    parent_pi)
+	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
+		vrfleak = bgp_extra_vrfleak(pi->extra);
+		if (vrfleak && vrfleak->parent == parent_pi)
 			break;
+	}
 
 	if (!pi) {
 		/* Create an info */
@@ -3309,15 +3678,16 @@ static int uninstall_evpn_route_entry_in_vni_common(
 	struct bgp_dest *dest, struct bgp_path_info *parent_pi)
 {
 	struct bgp_path_info *pi;
+	struct bgp_path_info_extra_vrfleak *vrfleak;
 	struct bgp_path_info *local_pi;
 	int ret;
 
 	/* Find matching route entry. */
-	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
-		if (pi->extra && pi->extra->vrfleak &&
-		    (struct bgp_path_info *)pi->extra->vrfleak->parent ==
-			    parent_pi)
+	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
+		vrfleak = bgp_extra_vrfleak(pi->extra);
+		if (vrfleak && vrfleak->parent == parent_pi)
 			break;
+	}
 
 	if (!pi)
 		return 0;
@@ -3461,6 +3831,7 @@ static int uninstall_evpn_route_entry_in_vrf(struct bgp *bgp_vrf,
 {
 	struct bgp_dest *dest;
 	struct bgp_path_info *pi;
+	struct bgp_path_info_extra_vrfleak *vrfleak;
 	int ret = 0;
 	struct prefix p;
 	struct prefix *pp = &p;
@@ -3492,11 +3863,11 @@ static int uninstall_evpn_route_entry_in_vrf(struct bgp *bgp_vrf,
 		return 0;
 
 	/* Find matching route entry. */
-	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
-		if (pi->extra && pi->extra->vrfleak &&
-		    (struct bgp_path_info *)pi->extra->vrfleak->parent ==
-			    parent_pi)
+	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
+		vrfleak = bgp_extra_vrfleak(pi->extra);
+		if (vrfleak && vrfleak->parent == parent_pi)
 			break;
+	}
 
 	if (!pi) {
 		bgp_dest_unlock_node(dest);
@@ -3897,67 +4268,85 @@ int bgp_evpn_route_entry_install_if_vrf_match(struct bgp *bgp_vrf,
 	return ret;
 }
 
+/*
+ * Build the import RT index keys for a list of RTs. Both the RT and its
+ * masked form are looked up, whichever of the two the RT was mapped with.
+ */
+static void evpn_import_keys_add(struct ecommunity_val **keys, size_t *nkeys,
+				 size_t *size, const struct ecommunity *ecom)
+{
+	const struct ecommunity_val *eval;
+	uint32_t i;
+
+	if (*nkeys + ecom->size * 2 > *size) {
+		*size = MAX(*size * 2, *nkeys + ecom->size * 2);
+		*keys = XREALLOC(MTYPE_TMP, *keys, *size * sizeof(**keys));
+	}
+
+	for (i = 0; i < ecom->size; i++) {
+		eval = (const struct ecommunity_val *)(ecom->val +
+						       (i * ECOMMUNITY_SIZE));
+		memcpy(&(*keys)[*nkeys], eval, ECOMMUNITY_SIZE);
+		memcpy(&(*keys)[*nkeys + 1], eval, ECOMMUNITY_SIZE);
+		mask_ecom_global_admin(&(*keys)[*nkeys + 1], eval);
+		*nkeys += 2;
+	}
+}
+
 /*
  * Install or uninstall mac-ip routes are appropriate for this
  * particular VRF.
  */
 static int install_uninstall_routes_for_vrf(struct bgp *bgp_vrf, bool install)
 {
-	afi_t afi;
-	safi_t safi;
-	struct bgp_dest *rd_dest, *dest;
-	struct bgp_table *table;
+	struct bgp_dest *dest;
+	struct bgp_dest **dests;
 	struct bgp_path_info *pi;
-	int ret;
 	struct bgp *bgp_evpn = NULL;
+	struct vrf_route_target *l3rt;
+	struct listnode *node;
+	struct ecommunity_val *keys = NULL;
+	size_t nkeys = 0, size = 0, count, i;
+	int ret = 0;
 
-	afi = AFI_L2VPN;
-	safi = SAFI_EVPN;
 	bgp_evpn = bgp_get_evpn();
 	if (!bgp_evpn)
 		return -1;
 
-	/* Walk entire global routing table and evaluate routes which could be
-	 * imported into this VRF. Note that we need to loop through all global
-	 * routes to determine which route matches the import rt on vrf
+	/* Only the global routes filed under one of the VRF's import RTs
+	 * can be imported into it.
 	 */
-	for (rd_dest = bgp_table_top(bgp_evpn->rib[afi][safi]); rd_dest;
-	     rd_dest = bgp_route_next(rd_dest)) {
-		table = bgp_dest_get_bgp_table_info(rd_dest);
-		if (!table)
+	for (ALL_LIST_ELEMENTS_RO(bgp_vrf->vrf_import_rtl, node, l3rt))
+		evpn_import_keys_add(&keys, &nkeys, &size, l3rt->ecom);
+
+	count = bgp_evpn_rt_index_collect(bgp_evpn, keys, nkeys, &dests);
+	for (i = 0; i < count && !ret; i++) {
+		dest = dests[i];
+		const struct prefix_evpn *evp =
+			(const struct prefix_evpn *)bgp_dest_get_prefix(dest);
+
+		/* if not mac-ip route skip this route */
+		if (!(evp->prefix.route_type == BGP_EVPN_MAC_IP_ROUTE
+		      || evp->prefix.route_type == BGP_EVPN_IP_PREFIX_ROUTE))
 			continue;
 
-		for (dest = bgp_table_top(table); dest;
-		     dest = bgp_route_next(dest)) {
-			const struct prefix_evpn *evp =
-				(const struct prefix_evpn *)bgp_dest_get_prefix(
-					dest);
-
-			/* if not mac-ip route skip this route */
-			if (!(evp->prefix.route_type == BGP_EVPN_MAC_IP_ROUTE
-			      || evp->prefix.route_type
-					 == BGP_EVPN_IP_PREFIX_ROUTE))
-				continue;
-
-			/* if not a mac+ip route skip this route */
-			if (!(is_evpn_prefix_ipaddr_v4(evp)
-			      || is_evpn_prefix_ipaddr_v6(evp)))
-				continue;
+		/* if not a mac+ip route skip this route */
+		if (!(is_evpn_prefix_ipaddr_v4(evp)
+		      || is_evpn_prefix_ipaddr_v6(evp)))
+			continue;
 
-			for (pi = bgp_dest_get_bgp_path_info(dest); pi;
-			     pi = pi->next) {
-				ret = bgp_evpn_route_entry_install_if_vrf_match(
-					bgp_vrf, pi, install);
-				if (ret) {
-					bgp_dest_unlock_node(rd_dest);
-					bgp_dest_unlock_node(dest);
-					return ret;
-				}
-			}
+		for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
+			ret = bgp_evpn_route_entry_install_if_vrf_match(
+				bgp_vrf, pi, install);
+			if (ret)
+				break;
 		}
 	}
 
-	return 0;
+	bgp_evpn_rt_index_release(dests, count);
+	XFREE(MTYPE_TMP, keys);
+
+	return ret;
 }
 
 /*
@@ -3967,84 +4356,72 @@ static int install_uninstall_routes_for_vrf(struct bgp *bgp_vrf, bool install)
 static int install_uninstall_routes_for_vni(struct bgp *bgp,
 					    struct bgpevpn *vpn, bool install)
 {
-	afi_t afi;
-	safi_t safi;
-	struct bgp_dest *rd_dest, *dest;
-	struct bgp_table *table;
+	struct bgp_dest *dest;
+	struct bgp_dest **dests;
 	struct bgp_path_info *pi;
-	int ret;
-
-	afi = AFI_L2VPN;
-	safi = SAFI_EVPN;
+	struct ecommunity *ecom;
+	struct listnode *node;
+	struct ecommunity_val *keys = NULL;
+	size_t nkeys = 0, size = 0, count, i;
+	int ret = 0;
 
-	/* Walk entire global routing table and evaluate routes which could be
-	 * imported into this VPN. Note that we cannot just look at the routes
-	 * for
-	 * the VNI's RD - remote routes applicable for this VNI could have any
-	 * RD.
+	/* Remote routes applicable for this VNI could have any RD, but they
+	 * have to carry one of its import RTs.
 	 */
-	/* EVPN routes are a 2-level table. */
-	for (rd_dest = bgp_table_top(bgp->rib[afi][safi]); rd_dest;
-	     rd_dest = bgp_route_next(rd_dest)) {
-		table = bgp_dest_get_bgp_table_info(rd_dest);
-		if (!table)
+	for (ALL_LIST_ELEMENTS_RO(vpn->import_rtl, node, ecom))
+		evpn_import_keys_add(&keys, &nkeys, &size, ecom);
+
+	count = bgp_evpn_rt_index_collect(bgp, keys, nkeys, &dests);
+	for (i = 0; i < count && !ret; i++) {
+		dest = dests[i];
+		const struct prefix_evpn *evp =
+			(const struct prefix_evpn *)bgp_dest_get_prefix(dest);
+
+		if (evp->prefix.route_type != BGP_EVPN_IMET_ROUTE &&
+		    evp->prefix.route_type != BGP_EVPN_AD_ROUTE &&
+		    evp->prefix.route_type != BGP_EVPN_MAC_IP_ROUTE)
 			continue;
 
-		for (dest = bgp_table_top(table); dest;
-		     dest = bgp_route_next(dest)) {
-			const struct prefix_evpn *evp =
-				(const struct prefix_evpn *)bgp_dest_get_prefix(
-					dest);
-
-			if (evp->prefix.route_type != BGP_EVPN_IMET_ROUTE &&
-			    evp->prefix.route_type != BGP_EVPN_AD_ROUTE &&
-			    evp->prefix.route_type != BGP_EVPN_MAC_IP_ROUTE)
+		for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
+			/* Consider "valid" remote routes applicable for
+			 * this VNI. */
+			if (!(CHECK_FLAG(pi->flags, BGP_PATH_VALID)
+			      && pi->type == ZEBRA_ROUTE_BGP
+			      && pi->sub_type == BGP_ROUTE_NORMAL))
 				continue;
 
-			for (pi = bgp_dest_get_bgp_path_info(dest); pi;
-			     pi = pi->next) {
-				/* Consider "valid" remote routes applicable for
-				 * this VNI. */
-				if (!(CHECK_FLAG(pi->flags, BGP_PATH_VALID)
-				      && pi->type == ZEBRA_ROUTE_BGP
-				      && pi->sub_type == BGP_ROUTE_NORMAL))
-					continue;
+			if (!is_route_matching_for_vni(bgp, vpn, pi))
+				continue;
 
-				if (!is_route_matching_for_vni(bgp, vpn, pi))
+			if (install) {
+				if (bgp_evpn_route_matches_macvrf_soo(pi, evp))
 					continue;
 
-				if (install) {
-					if (bgp_evpn_route_matches_macvrf_soo(
-						    pi, evp))
-						continue;
+				ret = install_evpn_route_entry(bgp, vpn, evp,
+							       pi);
+			} else
+				ret = uninstall_evpn_route_entry(bgp, vpn, evp,
+								 pi);
 
-					ret = install_evpn_route_entry(bgp, vpn,
-								       evp, pi);
-				} else
-					ret = uninstall_evpn_route_entry(
-						bgp, vpn, evp, pi);
-
-				if (ret) {
-					flog_err(EC_BGP_EVPN_FAIL,
-						 "%u: Failed to %s EVPN %s route in VNI %u",
-						 bgp->vrf_id,
-						 install ? "install"
-							 : "uninstall",
-						 evp->prefix.route_type ==
-								 BGP_EVPN_MAC_IP_ROUTE
-							 ? "MACIP"
-							 : "IMET",
-						 vpn->vni);
-
-					bgp_dest_unlock_node(rd_dest);
-					bgp_dest_unlock_node(dest);
-					return ret;
-				}
+			if (ret) {
+				flog_err(EC_BGP_EVPN_FAIL,
+					 "%u: Failed to %s EVPN %s route in VNI %u",
+					 bgp->vrf_id,
+					 install ? "install" : "uninstall",
+					 evp->prefix.route_type ==
+							 BGP_EVPN_MAC_IP_ROUTE
+						 ? "MACIP"
+						 : "IMET",
+					 vpn->vni);
+				break;
 			}
 		}
 	}
 
-	return 0;
+	bgp_evpn_rt_index_release(dests, count);
+	XFREE(MTYPE_TMP, keys);
+
+	return ret;
 }
 
 /* Install any existing remote routes applicable for this VRF into VRF RIB. This
@@ -4326,6 +4703,11 @@ static int install_uninstall_evpn_route(struct bgp *bgp, afi_t afi, safi_t safi,
 					const struct prefix *p,
 					struct bgp_path_info *pi, int import)
 {
+	if (import)
+		bgp_evpn_rt_index_add(bgp, pi);
+	else
+		bgp_evpn_rt_index_del(bgp, pi);
+
 	return bgp_evpn_install_uninstall_table(bgp, afi, safi, p, pi, import,
 						true, true);
 }
@@ -6343,7 +6725,7 @@ void bgp_evpn_free(struct bgp *bgp, struct bgpevpn *vpn)
 	     dest = dest_next) {
 		dest_next = zebra_announce_next(&bm->zebra_announce_head, dest);
 		if (dest->za_vpn == vpn) {
-			zebra_announce_del(&bm->zebra_announce_head, dest);
+			bgp_zebra_announce_del(dest);
 			bgp_path_info_unlock(dest->za_bgp_pi);
 			bgp_dest_unlock_node(dest);
 		}
@@ -7245,6 +7627,9 @@ void bgp_evpn_cleanup(struct bgp *bgp)
 	list_delete(&bgp->l2vnis);
 
 	if (bgp->evpn_info) {
+		/* The tables are gone by now, nothing left to unlock */
+		bgp_evpn_rt_index_flush(bgp, false);
+		evpn_rt_index_fini(&bgp->evpn_info->rt_index);
 		ecommunity_free(&bgp->evpn_info->soo);
 		XFREE(MTYPE_BGP_EVPN_INFO, bgp->evpn_info);
 	}
@@ -7291,6 +7676,7 @@ void bgp_evpn_init(struct bgp *bgp)
 	 * and freeze time (auto-recovery) is disabled.
 	 */
 	if (bgp->evpn_info) {
+		evpn_rt_index_init(&bgp->evpn_info->rt_index);
 		bgp->evpn_info->dup_addr_detect = true;
 		bgp->evpn_info->dad_time = EVPN_DAD_DEFAULT_TIME;
 		bgp->evpn_info->dad_max_moves = EVPN_DAD_DEFAULT_MAX_MOVES;
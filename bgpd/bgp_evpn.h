@@ -51,15 +51,16 @@ get_route_parent_evpn(struct bgp_path_info *ri)
 	struct bgp_path_info *parent_ri;
 
 	/* If not imported (or doesn't have a parent), bail. */
-	if (ri->sub_type != BGP_ROUTE_IMPORTED || !ri->extra ||
-	    !ri->extra->vrfleak || !ri->extra->vrfleak->parent)
+	if (ri->sub_type != BGP_ROUTE_IMPORTED ||
+	    !bgp_extra_vrfleak(ri->extra) ||
+	    !bgp_extra_vrfleak(ri->extra)->parent)
 		return NULL;
 
 	/* Determine parent recursively */
-	for (parent_ri = ri->extra->vrfleak->parent;
-	     parent_ri->extra && parent_ri->extra->vrfleak &&
-	     parent_ri->extra->vrfleak->parent;
-	     parent_ri = parent_ri->extra->vrfleak->parent)
+	for (parent_ri = bgp_extra_vrfleak(ri->extra)->parent;
+	     bgp_extra_vrfleak(parent_ri->extra) &&
+	     bgp_extra_vrfleak(parent_ri->extra)->parent;
+	     parent_ri = bgp_extra_vrfleak(parent_ri->extra)->parent)
 		;
 
 	return parent_ri;
@@ -181,6 +181,8 @@ static int bgp_evpn_es_route_install(struct bgp *bgp,
 	int ret = 0;
 	struct bgp_dest *dest = NULL;
 	struct bgp_path_info *pi = NULL;
+	struct bgp_path_info_extra *extra;
+	struct bgp_path_info_extra_vrfleak *vrfleak;
 	struct attr *attr_new = NULL;
 
 	/* Create (or fetch) route within the VNI.
@@ -189,11 +191,11 @@ static int bgp_evpn_es_route_install(struct bgp *bgp,
 	dest = bgp_node_get(es->route_table, (struct prefix *)p);
 
 	/* Check if route entry is already present. */
-	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
-		if (pi->extra && pi->extra->vrfleak &&
-		    (struct bgp_path_info *)pi->extra->vrfleak->parent ==
-			    parent_pi)
+	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
+		vrfleak = bgp_extra_vrfleak(pi->extra);
+		if (vrfleak && vrfleak->parent == parent_pi)
 			break;
+	}
 
 	if (!pi) {
 		/* Add (or update) attribute to hash. */
@@ -203,12 +205,16 @@ static int bgp_evpn_es_route_install(struct bgp *bgp,
 		pi = info_make(parent_pi->type, BGP_ROUTE_IMPORTED, 0,
 			       parent_pi->peer, attr_new, dest);
 		SET_FLAG(pi->flags, BGP_PATH_VALID);
-		bgp_path_info_extra_get(pi);
-		if (!pi->extra->vrfleak)
-			pi->extra->vrfleak =
-				XCALLOC(MTYPE_BGP_ROUTE_EXTRA_VRFLEAK,
-					sizeof(struct bgp_path_info_extra_vrfleak));
-		pi->extra->vrfleak->parent = bgp_path_info_lock(parent_pi);
+		extra = bgp_path_info_extra_get(pi);
+		vrfleak = bgp_extra_vrfleak(extra);
+		if (!vrfleak) {
+			vrfleak = XCALLOC(MTYPE_BGP_ROUTE_EXTRA_VRFLEAK,
+					  sizeof(*vrfleak));
+			bgp_path_info_extra_ext_set(extra,
+						    BGP_PATH_EXTRA_VRFLEAK,
+						    vrfleak);
+		}
+		vrfleak->parent = bgp_path_info_lock(parent_pi);
 		bgp_dest_lock_node((struct bgp_dest *)parent_pi->net);
 		bgp_path_info_add(dest, pi);
 	} else {
@@ -250,6 +256,7 @@ static int bgp_evpn_es_route_uninstall(struct bgp *bgp, struct bgp_evpn_es *es,
 	int ret;
 	struct bgp_dest *dest;
 	struct bgp_path_info *pi;
+	struct bgp_path_info_extra_vrfleak *vrfleak;
 
 	if (!es->route_table)
 		return 0;
@@ -262,11 +269,11 @@ static int bgp_evpn_es_route_uninstall(struct bgp *bgp, struct bgp_evpn_es *es,
 		return 0;
 
 	/* Find matching route entry. */
-	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
-		if (pi->extra && pi->extra->vrfleak &&
-		    (struct bgp_path_info *)pi->extra->vrfleak->parent ==
-			    parent_pi)
+	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
+		vrfleak = bgp_extra_vrfleak(pi->extra);
+		if (vrfleak && vrfleak->parent == parent_pi)
 			break;
+	}
 
 	if (!pi) {
 		bgp_dest_unlock_node(dest);
@@ -1581,16 +1588,16 @@ void bgp_evpn_path_mh_info_free(struct bgp_path_mh_info *mh_info)
 static struct bgp_path_es_info *
 bgp_evpn_path_es_info_new(struct bgp_path_info *pi, vni_t vni)
 {
-	struct bgp_path_info_extra *e;
+	struct bgp_path_info_extra_evpn *evpn;
 	struct bgp_path_mh_info *mh_info;
 	struct bgp_path_es_info *es_info;
 
-	e = bgp_path_info_extra_get(pi);
+	evpn = bgp_extra_evpn(bgp_path_info_extra_get(pi));
 
 	/* If mh_info doesn't exist allocate it */
-	mh_info = e->evpn->mh_info;
+	mh_info = evpn->mh_info;
 	if (!mh_info)
-		e->evpn->mh_info = mh_info =
+		evpn->mh_info = mh_info =
 			XCALLOC(MTYPE_BGP_EVPN_PATH_MH_INFO,
 				sizeof(struct bgp_path_mh_info));
 
@@ -1641,13 +1648,13 @@ static void bgp_evpn_path_es_unlink(struct bgp_path_es_info *es_info)
 
 void bgp_evpn_path_es_link(struct bgp_path_info *pi, vni_t vni, esi_t *esi)
 {
+	struct bgp_path_info_extra_evpn *evpn;
 	struct bgp_path_es_info *es_info;
 	struct bgp_evpn_es *es;
 	struct bgp *bgp_evpn;
 
-	es_info = (pi->extra && pi->extra->evpn && pi->extra->evpn->mh_info)
-			  ? pi->extra->evpn->mh_info->es_info
-			  : NULL;
+	evpn = bgp_extra_evpn(pi->extra);
+	es_info = (evpn && evpn->mh_info) ? evpn->mh_info->es_info : NULL;
 	/* if the esi is zero just unlink the path from the old es */
 	if (!esi || !memcmp(esi, zero_esi, sizeof(*esi))) {
 		if (es_info)
@@ -3195,6 +3202,7 @@ bool bgp_evpn_path_es_use_nhg(struct bgp *bgp_vrf, struct bgp_path_info *pi,
 	esi_t *esi;
 	struct bgp_evpn_es_vrf *es_vrf = NULL;
 	struct bgp_path_info *parent_pi;
+	struct bgp_path_info_extra_vrfleak *vrfleak;
 	struct bgp_dest *bd;
 	struct prefix_evpn *evp;
 	struct bgp_path_info *mpinfo;
@@ -3204,7 +3212,8 @@ bool bgp_evpn_path_es_use_nhg(struct bgp *bgp_vrf, struct bgp_path_info *pi,
 	*nhg_p = 0;
 
 	/* we don't support NHG for routes leaked from another VRF yet */
-	if (pi->extra && pi->extra->vrfleak && pi->extra->vrfleak->bgp_orig)
+	vrfleak = bgp_extra_vrfleak(pi->extra);
+	if (vrfleak && vrfleak->bgp_orig)
 		return false;
 
 	parent_pi = get_route_parent_evpn(pi);
@@ -4725,16 +4734,16 @@ static void bgp_evpn_path_nh_info_free(struct bgp_path_evpn_nh_info *nh_info)
 static struct bgp_path_evpn_nh_info *
 bgp_evpn_path_nh_info_new(struct bgp_path_info *pi)
 {
-	struct bgp_path_info_extra *e;
+	struct bgp_path_info_extra_evpn *evpn;
 	struct bgp_path_mh_info *mh_info;
 	struct bgp_path_evpn_nh_info *nh_info;
 
-	e = bgp_path_info_extra_get(pi);
+	evpn = bgp_extra_evpn(bgp_path_info_extra_get(pi));
 
 	/* If mh_info doesn't exist allocate it */
-	mh_info = e->evpn->mh_info;
+	mh_info = evpn->mh_info;
 	if (!mh_info)
-		e->evpn->mh_info = mh_info =
+		evpn->mh_info = mh_info =
 			XCALLOC(MTYPE_BGP_EVPN_PATH_MH_INFO,
 				sizeof(struct bgp_path_mh_info));
 
@@ -4787,6 +4796,7 @@ static void bgp_evpn_path_nh_unlink(struct bgp_path_evpn_nh_info *nh_info)
 
 static void bgp_evpn_path_nh_link(struct bgp *bgp_vrf, struct bgp_path_info *pi)
 {
+	struct bgp_path_info_extra_evpn *evpn;
 	struct bgp_path_evpn_nh_info *nh_info;
 	struct bgp_evpn_nh *nh;
 	struct ipaddr ip;
@@ -4802,9 +4812,8 @@ static void bgp_evpn_path_nh_link(struct bgp *bgp_vrf, struct bgp_path_info *pi)
 		return;
 	}
 
-	nh_info = (pi->extra && pi->extra->evpn && pi->extra->evpn->mh_info)
-			  ? pi->extra->evpn->mh_info->nh_info
-			  : NULL;
+	evpn = bgp_extra_evpn(pi->extra);
+	nh_info = (evpn && evpn->mh_info) ? evpn->mh_info->nh_info : NULL;
 
 	/* if NHG is not being used for this path we don't need to manage the
 	 * nexthops in bgp (they are managed by zebra instead)
@@ -4868,11 +4877,11 @@ static void bgp_evpn_path_nh_link(struct bgp *bgp_vrf, struct bgp_path_info *pi)
 
 void bgp_evpn_path_nh_del(struct bgp *bgp_vrf, struct bgp_path_info *pi)
 {
+	struct bgp_path_info_extra_evpn *evpn;
 	struct bgp_path_evpn_nh_info *nh_info;
 
-	nh_info = (pi->extra && pi->extra->evpn && pi->extra->evpn->mh_info)
-			  ? pi->extra->evpn->mh_info->nh_info
-			  : NULL;
+	evpn = bgp_extra_evpn(pi->extra);
+	nh_info = (evpn && evpn->mh_info) ? evpn->mh_info->nh_info : NULL;
 
 	if (!nh_info)
 		return;
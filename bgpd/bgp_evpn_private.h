@@ -8,6 +8,7 @@
 
 #include "vxlan.h"
 #include "zebra.h"
+#include "typesafe.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_ecommunity.h"
@@ -146,6 +147,8 @@ struct vrf_irt_node {
 #define EVPN_DAD_DEFAULT_MAX_MOVES 5 /* default from RFC 7432 */
 #define EVPN_DAD_DEFAULT_AUTO_RECOVERY_TIME 1800 /* secs */
 
+PREDECL_HASH(evpn_rt_index);
+
 struct bgp_evpn_info {
 	/* enable disable dup detect */
 	bool dup_addr_detect;
@@ -179,6 +182,12 @@ struct bgp_evpn_info {
 	struct ethaddr pip_rmac_static;
 	struct ethaddr pip_rmac_zebra;
 	bool is_anycast_mac;
+
+	/* Global EVPN routes by import key (RT and RT with the global-admin
+	 * field masked), used to find the candidate routes for a VNI or VRF
+	 * without walking the whole table.
+	 */
+	struct evpn_rt_index_head rt_index;
 };
 
 /* This structure defines an entry in remote_ip_hash */
@@ -581,32 +590,32 @@ evpn_type2_prefix_vni_mac_copy(struct prefix_evpn *vni_p,
 static inline struct ethaddr *
 evpn_type2_path_info_get_mac(const struct bgp_path_info *local_pi)
 {
-	assert(local_pi->extra && local_pi->extra->evpn);
-	return &local_pi->extra->evpn->vni_info.mac;
+	assert(bgp_extra_evpn(local_pi->extra));
+	return &bgp_extra_evpn(local_pi->extra)->vni_info.mac;
 }
 
 /* Get IP of path_info prefix */
 static inline struct ipaddr *
 evpn_type2_path_info_get_ip(const struct bgp_path_info *local_pi)
 {
-	assert(local_pi->extra && local_pi->extra->evpn);
-	return &local_pi->extra->evpn->vni_info.ip;
+	assert(bgp_extra_evpn(local_pi->extra));
+	return &bgp_extra_evpn(local_pi->extra)->vni_info.ip;
 }
 
 /* Set MAC of path_info prefix */
 static inline void evpn_type2_path_info_set_mac(struct bgp_path_info *local_pi,
 						const struct ethaddr mac)
 {
-	assert(local_pi->extra && local_pi->extra->evpn);
-	local_pi->extra->evpn->vni_info.mac = mac;
+	assert(bgp_extra_evpn(local_pi->extra));
+	bgp_extra_evpn(local_pi->extra)->vni_info.mac = mac;
 }
 
 /* Set IP of path_info prefix */
 static inline void evpn_type2_path_info_set_ip(struct bgp_path_info *local_pi,
 					       const struct ipaddr ip)
 {
-	assert(local_pi->extra && local_pi->extra->evpn);
-	local_pi->extra->evpn->vni_info.ip = ip;
+	assert(bgp_extra_evpn(local_pi->extra));
+	bgp_extra_evpn(local_pi->extra)->vni_info.ip = ip;
 }
 
 /* Is the IP empty for the RT's dest? */
@@ -759,6 +768,14 @@ extern int bgp_evpn_route_entry_install_if_vrf_match(struct bgp *bgp_vrf,
 						     int install);
 extern void bgp_evpn_import_type2_route(struct bgp_path_info *pi, int import);
 extern void bgp_evpn_xxport_delete_ecomm(void *val);
+extern void bgp_evpn_rt_index_add(struct bgp *bgp, struct bgp_path_info *pi);
+extern void bgp_evpn_rt_index_del(struct bgp *bgp, struct bgp_path_info *pi);
+extern size_t bgp_evpn_rt_index_collect(struct bgp *bgp,
+					const struct ecommunity_val *keys,
+					size_t nkeys, struct bgp_dest ***dests);
+extern void bgp_evpn_rt_index_release(struct bgp_dest **dests, size_t count);
+extern void bgp_evpn_rt_index_flush(struct bgp *bgp, bool unlock);
+extern size_t bgp_evpn_rt_index_count(struct bgp *bgp);
 extern int bgp_evpn_route_target_cmp(struct ecommunity *ecom1,
 				     struct ecommunity *ecom2);
 #endif /* _BGP_EVPN_PRIVATE_H */
@@ -351,12 +351,11 @@ void route_vty_out_flowspec(struct vty *vty, const struct prefix *p,
 			json_object_array_add(json_paths, json_time_path);
 	}
 	if (display == NLRI_STRING_FORMAT_LARGE) {
-		struct bgp_path_info_extra *extra =
-			bgp_path_info_extra_get(path);
+		struct bgp_path_info_extra_fs *fs =
+			bgp_extra_flowspec(bgp_path_info_extra_get(path));
 		bool list_began = false;
 
-		if (extra->flowspec && extra->flowspec->bgp_fs_pbr &&
-		    listcount(extra->flowspec->bgp_fs_pbr)) {
+		if (fs && fs->bgp_fs_pbr && listcount(fs->bgp_fs_pbr)) {
 			struct listnode *node;
 			struct bgp_pbr_match_entry *bpme;
 			struct bgp_pbr_match *bpm;
@@ -364,8 +363,7 @@ void route_vty_out_flowspec(struct vty *vty, const struct prefix *p,
 
 			list_bpm = list_new();
 			vty_out(vty, "\tinstalled in PBR");
-			for (ALL_LIST_ELEMENTS_RO(extra->flowspec->bgp_fs_pbr, node,
-						  bpme)) {
+			for (ALL_LIST_ELEMENTS_RO(fs->bgp_fs_pbr, node, bpme)) {
 				bpm = bpme->backpointer;
 				if (listnode_lookup(list_bpm, bpm))
 					continue;
@@ -379,15 +377,14 @@ void route_vty_out_flowspec(struct vty *vty, const struct prefix *p,
 			}
 			list_delete(&list_bpm);
 		}
-		if (extra->flowspec && extra->flowspec->bgp_fs_iprule &&
-		    listcount(extra->flowspec->bgp_fs_iprule)) {
+		if (fs && fs->bgp_fs_iprule && listcount(fs->bgp_fs_iprule)) {
 			struct listnode *node;
 			struct bgp_pbr_rule *bpr;
 
 			if (!list_began)
 				vty_out(vty, "\tinstalled in PBR");
-			for (ALL_LIST_ELEMENTS_RO(extra->flowspec->bgp_fs_iprule,
-						  node, bpr)) {
+			for (ALL_LIST_ELEMENTS_RO(fs->bgp_fs_iprule, node,
+						  bpr)) {
 				if (!bpr->action)
 					continue;
 				if (!list_began) {
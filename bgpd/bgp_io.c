@@ -101,6 +101,7 @@ void bgp_reads_off(struct peer_connection *connection)
 	event_cancel_async(fpt->master, &connection->t_read, NULL);
 	EVENT_OFF(connection->t_process_packet);
 	EVENT_OFF(connection->t_process_packet_error);
+	bgp_input_sched_remove(connection);
 
 	UNSET_FLAG(connection->thread_flags, PEER_THREAD_READS_ON);
 }
@@ -32,6 +32,13 @@ extern struct zclient *zclient;
 /* MPLS Labels hash routines. */
 static struct hash *labels_hash;
 
+/*
+ * Label pool requests for labeled-unicast FECs, collected while the
+ * process queue runs and handed to bgp_lp_get_batch() in one go.
+ */
+static struct list *lu_label_requests;
+static struct event *t_lu_label_requests;
+
 static void *bgp_labels_hash_alloc(void *p)
 {
 	const struct bgp_labels *labels = p;
@@ -81,6 +88,11 @@ static void bgp_labels_free(void *labels)
 void bgp_labels_finish(void)
 {
 	hash_clean_and_free(&labels_hash, bgp_labels_free);
+
+	/* the tables are gone by now, just drop the pending requests */
+	EVENT_OFF(t_lu_label_requests);
+	if (lu_label_requests)
+		list_delete(&lu_label_requests);
 }
 
 struct bgp_labels *bgp_labels_intern(struct bgp_labels *labels)
@@ -346,6 +358,50 @@ int bgp_reg_for_label_callback(mpls_label_t new_label, void *labelid,
 	return 0;
 }
 
+static void bgp_lu_label_requests_send(struct event *thread)
+{
+	struct bgp_dest *dest;
+	struct listnode *node, *nnode;
+	void **labelids;
+	size_t count = 0;
+
+	labelids = XCALLOC(MTYPE_TMP,
+			   listcount(lu_label_requests) * sizeof(*labelids));
+
+	/* a request withdrawn in the meantime has its flag cleared */
+	for (ALL_LIST_ELEMENTS_RO(lu_label_requests, node, dest))
+		if (CHECK_FLAG(dest->flags, BGP_NODE_LABEL_REQUESTED))
+			labelids[count++] = dest;
+
+	if (BGP_DEBUG(labelpool, LABELPOOL))
+		zlog_debug("%s: requesting %zu labels", __func__, count);
+
+	if (count)
+		bgp_lp_get_batch(LP_TYPE_BGP_LU, labelids, count,
+				 bgp_reg_for_label_callback);
+
+	XFREE(MTYPE_TMP, labelids);
+
+	for (ALL_LIST_ELEMENTS(lu_label_requests, node, nnode, dest)) {
+		list_delete_node(lu_label_requests, node);
+		bgp_dest_unlock_node(dest);
+	}
+}
+
+/*
+ * Queue a label request for dest; the node stays locked until the
+ * request has been handed to the label pool.
+ */
+static void bgp_lu_label_request(struct bgp_dest *dest)
+{
+	if (!lu_label_requests)
+		lu_label_requests = list_new();
+
+	listnode_add(lu_label_requests, bgp_dest_lock_node(dest));
+	event_add_event(bm->master, bgp_lu_label_requests_send, NULL, 0,
+			&t_lu_label_requests);
+}
+
 void bgp_reg_dereg_for_label(struct bgp_dest *dest, struct bgp_path_info *pi,
 			     bool reg)
 {
@@ -396,8 +452,7 @@ void bgp_reg_dereg_for_label(struct bgp_dest *dest, struct bgp_path_info *pi,
 				 * the pool. This means we'll never register
 				 * FECs withoutvalid labels.
 				 */
-				bgp_lp_get(LP_TYPE_BGP_LU, dest,
-					   bgp_reg_for_label_callback);
+				bgp_lu_label_request(dest);
 				return;
 			}
 		}
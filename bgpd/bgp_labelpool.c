@@ -259,18 +259,20 @@ void bgp_lp_finish(void)
 	lp = NULL;
 }
 
-static mpls_label_t get_label_from_pool(void *labelid)
+/*
+ * Find free labels in the local pool: returns the length (at most want)
+ * of the run of free labels starting at *indexp in *chunkp, 0 if the
+ * pool is empty.
+ */
+static uint32_t lp_chunk_find_run(struct lp_chunk **chunkp, uint32_t *indexp,
+				  uint32_t want)
 {
 	struct listnode *node;
 	struct lp_chunk *chunk;
 	int debug = BGP_DEBUG(labelpool, LABELPOOL);
 
-	/*
-	 * Find a free label
-	 */
 	for (ALL_LIST_ELEMENTS_RO(lp->chunks, node, chunk)) {
-		uintptr_t lbl;
-		unsigned int index;
+		uint32_t index, size, len;
 
 		if (debug)
 			zlog_debug("%s: chunk first=%u last=%u",
@@ -296,25 +298,98 @@ static mpls_label_t get_label_from_pool(void *labelid)
 		 */
 		assert(index != WORD_MAX);
 
-		lbl = chunk->first + index;
-		if (skiplist_insert(lp->inuse, (void *)lbl, labelid)) {
-			/* something is very wrong */
-			zlog_err("%s: unable to insert inuse label %u (id %p)",
-				 __func__, (uint32_t)lbl, labelid);
-			return MPLS_LABEL_NONE;
-		}
+		size = chunk->last - chunk->first + 1;
+		for (len = 1; len < want && index + len < size; len++)
+			if (bf_test_index(chunk->allocated_map, index + len))
+				break;
 
-		/*
-		 * Success
-		 */
-		bf_set_bit(chunk->allocated_map, index);
-		chunk->idx_last_allocated = index;
-		chunk->nfree -= 1;
+		*chunkp = chunk;
+		*indexp = index;
+		return len;
+	}
+
+	return 0;
+}
+
+/* Mark a label found by lp_chunk_find_run() as in use by labelid */
+static mpls_label_t lp_chunk_take(struct lp_chunk *chunk, uint32_t index,
+				  void *labelid)
+{
+	uintptr_t lbl = chunk->first + index;
+
+	if (skiplist_insert(lp->inuse, (void *)lbl, labelid)) {
+		/* something is very wrong */
+		zlog_err("%s: unable to insert inuse label %u (id %p)",
+			 __func__, (uint32_t)lbl, labelid);
+		return MPLS_LABEL_NONE;
+	}
+
+	bf_set_bit(chunk->allocated_map, index);
+	chunk->idx_last_allocated = index;
+	chunk->nfree -= 1;
+
+	return lbl;
+}
+
+static mpls_label_t get_label_from_pool(void *labelid)
+{
+	struct lp_chunk *chunk;
+	uint32_t index;
+
+	/*
+	 * Find a free label
+	 */
+	if (!lp_chunk_find_run(&chunk, &index, 1))
+		return MPLS_LABEL_NONE;
+
+	return lp_chunk_take(chunk, index, labelid);
+}
 
-		return lbl;
+/*
+ * Ask zebra for the next chunk before the local pool runs dry, so that
+ * requests keep being filled from the fast path while labels are being
+ * handed out quickly.  The low-water mark is the number of labels
+ * allocated over the last second.
+ */
+static void lp_prefetch_check(uint32_t allocated)
+{
+	time_t now = monotime(NULL);
+	struct listnode *node;
+	struct lp_chunk *chunk;
+	uint32_t nfree = 0;
+	uint32_t want;
+
+	if (now != lp->alloc_window) {
+		lp->alloc_rate = (now == lp->alloc_window + 1)
+					 ? lp->alloc_window_count
+					 : 0;
+		lp->alloc_window = now;
+		lp->alloc_window_count = 0;
 	}
+	lp->alloc_window_count += allocated;
+
+	if (lp->pending_count)
+		return;
+
+	want = MAX(lp->alloc_rate, lp->alloc_window_count);
+	for (ALL_LIST_ELEMENTS_RO(lp->chunks, node, chunk)) {
+		nfree += chunk->nfree;
+		if (nfree >= want)
+			return;
+	}
+
+	if (BGP_DEBUG(labelpool, LABELPOOL))
+		zlog_debug("%s: %u labels free, %u allocated/s, prefetching %u",
+			   __func__, nfree, want, lp->next_chunksize);
+
+	if (!bgp_zebra_request_label_range(MPLS_LABEL_BASE_ANY,
+					   lp->next_chunksize, true))
+		return;
 
-	return MPLS_LABEL_NONE;
+	lp->pending_count += lp->next_chunksize;
+	if ((lp->next_chunksize << 1) <= LP_CHUNK_SIZE_MAX)
+		lp->next_chunksize <<= 1;
+	lp->prefetch_count++;
 }
 
 /*
@@ -420,6 +495,9 @@ void bgp_lp_get(
 
 		work_queue_add(lp->callback_q, q);
 
+		if (!requested)
+			lp_prefetch_check(1);
+
 		return;
 	}
 
@@ -462,6 +540,79 @@ void bgp_lp_get(
 			&bm->t_bgp_sync_label_manager);
 }
 
+/*
+ * Same as bgp_lp_get() for count labelids at once.  Labels are taken
+ * from the local pool in runs of consecutive free labels, one bitmap
+ * scan per run instead of one per label, so a batch usually gets a
+ * contiguous label range.  Labelids already known and requests the
+ * local pool can't fill go through bgp_lp_get().
+ */
+void bgp_lp_get_batch(
+	int	type,
+	void	**labelids,
+	size_t	count,
+	int	(*cbfunc)(mpls_label_t label, void *labelid, bool allocated))
+{
+	struct lp_chunk *chunk = NULL;
+	uint32_t index = 0, run = 0;
+	uint32_t allocated = 0;
+	struct lp_cbq_item *q;
+	struct lp_lcb *lcb;
+	size_t i;
+
+	if (BGP_DEBUG(labelpool, LABELPOOL))
+		zlog_debug("%s: %zu labelids", __func__, count);
+
+	for (i = 0; i < count; i++) {
+		void *labelid = labelids[i];
+
+		if (!skiplist_search(lp->ledger, labelid, (void **)&lcb)) {
+			bgp_lp_get(type, labelid, cbfunc);
+			continue;
+		}
+
+		if (!run)
+			run = lp_chunk_find_run(&chunk, &index,
+						MIN(count - i, UINT32_MAX));
+		if (!run) {
+			/* pool is empty, slow path for the rest */
+			bgp_lp_get(type, labelid, cbfunc);
+			continue;
+		}
+
+		lcb = XCALLOC(MTYPE_BGP_LABEL_CB, sizeof(struct lp_lcb));
+		lcb->label = lp_chunk_take(chunk, index, labelid);
+		lcb->type = type;
+		lcb->labelid = labelid;
+		lcb->cbfunc = cbfunc;
+		index++;
+		run--;
+
+		if (lcb->label == MPLS_LABEL_NONE ||
+		    skiplist_insert(lp->ledger, labelid, lcb)) {
+			flog_err(EC_BGP_LABEL,
+				 "%s: can't insert new LCB into ledger list",
+				 __func__);
+			XFREE(MTYPE_BGP_LABEL_CB, lcb);
+			continue;
+		}
+
+		q = XCALLOC(MTYPE_BGP_LABEL_CBQ, sizeof(struct lp_cbq_item));
+		q->cbfunc = lcb->cbfunc;
+		q->type = lcb->type;
+		q->label = lcb->label;
+		q->labelid = lcb->labelid;
+		q->allocated = true;
+
+		check_bgp_lu_cb_lock(lcb);
+		work_queue_add(lp->callback_q, q);
+		allocated++;
+	}
+
+	if (allocated)
+		lp_prefetch_check(allocated);
+}
+
 void bgp_lp_release(
 	int		type,
 	void		*labelid,
@@ -621,6 +772,13 @@ void bgp_lp_event_chunk(uint32_t first, uint32_t last)
 	listnode_add_head(lp->chunks, chunk);
 
 	lp->pending_count -= labelcount;
+
+	/* serve the blocked requests now rather than on the next retry */
+	if (lp_fifo_count(&lp->requests)) {
+		EVENT_OFF(bm->t_bgp_sync_label_manager);
+		event_add_event(bm->master, bgp_sync_label_manager, NULL, 0,
+				&bm->t_bgp_sync_label_manager);
+	}
 }
 
 /*
@@ -744,6 +902,8 @@ DEFUN(show_bgp_labelpool_summary, show_bgp_labelpool_summary_cmd,
 		json_object_int_add(json, "labelChunks", listcount(lp->chunks));
 		json_object_int_add(json, "pending", lp->pending_count);
 		json_object_int_add(json, "reconnects", lp->reconnect_count);
+		json_object_int_add(json, "prefetches", lp->prefetch_count);
+		json_object_int_add(json, "allocationRate", lp->alloc_rate);
 		vty_json(vty, json);
 	} else {
 		vty_out(vty, "Labelpool Summary\n");
@@ -757,6 +917,8 @@ DEFUN(show_bgp_labelpool_summary, show_bgp_labelpool_summary_cmd,
 			"LabelChunks:", listcount(lp->chunks));
 		vty_out(vty, "%-13s %d\n", "Pending:", lp->pending_count);
 		vty_out(vty, "%-13s %d\n", "Reconnects:", lp->reconnect_count);
+		vty_out(vty, "%-13s %u\n", "Prefetches:", lp->prefetch_count);
+		vty_out(vty, "%-13s %u/s\n", "AllocRate:", lp->alloc_rate);
 	}
 	return CMD_SUCCESS;
 }
@@ -1240,8 +1402,10 @@ struct lp_test {
 	unsigned int request_blocksize;
 	uintptr_t request_count; /* match type of labelid */
 	int label_type;
+	bool batch;
 	struct skiplist *labels;
 	struct timeval starttime;
+	int64_t elapsed; /* usec until all labels were allocated */
 	struct skiplist *timestamps_alloc;
 	struct skiplist *timestamps_dealloc;
 	struct event *event_thread;
@@ -1270,6 +1434,8 @@ static int test_cb(mpls_label_t label, void *labelid, bool allocated)
 
 	if (allocated) {
 		++tcb->counter[LPT_STAT_ALLOCATED];
+		if (tcb->counter[LPT_STAT_ALLOCATED] == tcb->request_maximum)
+			tcb->elapsed = monotime_since(&tcb->starttime, NULL);
 		if (!(tcb->counter[LPT_STAT_ALLOCATED] % LPT_TS_INTERVAL)) {
 			uintptr_t time_ms;
 
@@ -1318,6 +1484,9 @@ static void labelpool_test_event_handler(struct event *thread)
 	/*
 	 * request a bunch of labels
 	 */
+	static void *ids[LPT_BLKSIZE];
+	unsigned int n = 0;
+
 	for (unsigned int i = 0; (i < tcb->request_blocksize) &&
 				 (tcb->request_count < tcb->request_maximum);
 	     ++i) {
@@ -1331,12 +1500,18 @@ static void labelpool_test_event_handler(struct event *thread)
 		 */
 		id = ((uintptr_t)tcb->generation << 24) |
 		     (tcb->request_count & 0x00ffffff);
-		bgp_lp_get(LP_TYPE_VRF, (void *)id, test_cb);
+		if (tcb->batch)
+			ids[n++] = (void *)id;
+		else
+			bgp_lp_get(LP_TYPE_VRF, (void *)id, test_cb);
 	}
 
+	if (n)
+		bgp_lp_get_batch(LP_TYPE_VRF, ids, n, test_cb);
+
 	if (tcb->request_count < tcb->request_maximum)
-		thread_add_event(bm->master, labelpool_test_event_handler, NULL,
-				 0, &tcb->event_thread);
+		event_add_event(bm->master, labelpool_test_event_handler, NULL,
+				0, &tcb->event_thread);
 }
 
 static void lptest_stop(void)
@@ -1360,7 +1535,7 @@ static void lptest_stop(void)
 	lpt_inprogress = false;
 }
 
-static int lptest_start(struct vty *vty)
+static int lptest_start(struct vty *vty, bool batch)
 {
 	struct lp_test *tcb;
 
@@ -1411,11 +1586,12 @@ static int lptest_start(struct vty *vty)
 	tcb->label_type = LP_TYPE_VRF;
 	tcb->request_maximum = LPT_MAX_COUNT;
 	tcb->request_blocksize = LPT_BLKSIZE;
+	tcb->batch = batch;
 	tcb->labels = skiplist_new(0, NULL, NULL);
 	tcb->timestamps_alloc = skiplist_new(0, NULL, NULL);
 	tcb->timestamps_dealloc = skiplist_new(0, NULL, NULL);
-	thread_add_event(bm->master, labelpool_test_event_handler, NULL, 0,
-			 &tcb->event_thread);
+	event_add_event(bm->master, labelpool_test_event_handler, NULL, 0,
+			&tcb->event_thread);
 	monotime(&tcb->starttime);
 
 	skiplist_insert(lp_tests, (void *)(uintptr_t)tcb->generation, tcb);
@@ -1423,12 +1599,13 @@ static int lptest_start(struct vty *vty)
 }
 
 DEFPY(start_labelpool_perf_test, start_labelpool_perf_test_cmd,
-      "debug bgp lptest start",
+      "debug bgp lptest start [batch$batch]",
       DEBUG_STR BGP_STR
       "label pool test\n"
-      "start\n")
+      "start\n"
+      "Request labels in batches\n")
 {
-	lptest_start(vty);
+	lptest_start(vty, !!batch);
 	return CMD_SUCCESS;
 }
 
@@ -1455,7 +1632,8 @@ static void lptest_print_stats(struct vty *vty, struct lp_test *tcb)
 		}
 	}
 
-	vty_out(vty, "Test Generation %u:\n", tcb->generation);
+	vty_out(vty, "Test Generation %u (%s):\n", tcb->generation,
+		tcb->batch ? "batch" : "single");
 
 	vty_out(vty, "Counter   Value\n");
 	for (i = 0; i < LPT_STAT_MAX; ++i) {
@@ -1464,6 +1642,13 @@ static void lptest_print_stats(struct vty *vty, struct lp_test *tcb)
 	}
 	vty_out(vty, "\n");
 
+	if (tcb->elapsed)
+		vty_out(vty, "Throughput: %u labels in %.3f s, %.0f labels/s\n\n",
+			tcb->counter[LPT_STAT_ALLOCATED],
+			(double)tcb->elapsed / 1000000,
+			(double)tcb->counter[LPT_STAT_ALLOCATED] * 1000000 /
+				tcb->elapsed);
+
 	if (tcb->timestamps_alloc) {
 		void *Key;
 		void *Value;
@@ -31,12 +31,18 @@ struct labelpool {
 	uint32_t		pending_count;	/* requested from zebra */
 	uint32_t reconnect_count;		/* zebra reconnections */
 	uint32_t next_chunksize;		/* request this many labels */
+	uint32_t prefetch_count;		/* chunks requested early */
+	time_t alloc_window;			/* current 1s window */
+	uint32_t alloc_window_count;		/* allocated in window */
+	uint32_t alloc_rate;			/* allocated in last window */
 };
 
 extern void bgp_lp_init(struct event_loop *master, struct labelpool *pool);
 extern void bgp_lp_finish(void);
 extern void bgp_lp_get(int type, void *labelid,
 	int (*cbfunc)(mpls_label_t label, void *labelid, bool allocated));
+extern void bgp_lp_get_batch(int type, void **labelids, size_t count,
+	int (*cbfunc)(mpls_label_t label, void *labelid, bool allocated));
 extern void bgp_lp_release(int type, void *labelid, mpls_label_t label);
 extern void bgp_lp_event_chunk(uint32_t first, uint32_t last);
 extern void bgp_lp_event_zebra_down(void);
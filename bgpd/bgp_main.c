@@ -51,6 +51,7 @@
 #include "bgpd/bgp_nhg.h"
 #include "bgpd/bgp_routemap_nb.h"
 #include "bgpd/bgp_community_alias.h"
+#include "bgpd/bgp_snapshot.h"
 
 DEFINE_HOOK(bgp_hook_config_write_vrf, (struct vty *vty, struct vrf *vrf),
 	    (vty, vrf));
@@ -159,6 +160,9 @@ __attribute__((__noreturn__)) void sigint(void)
 	/* Disable BFD events to avoid wasting processing. */
 	bfd_protocol_integration_set_shutdown(true);
 
+	/* Save the table while the sessions are still up */
+	bgp_snapshot_terminate();
+
 	bgp_terminate();
 
 	bgp_exit(0);
@@ -209,10 +213,14 @@ static __attribute__((__noreturn__)) void bgp_exit(int status)
 	bgp_nhg_finish();
 
 	zebra_announce_fini(&bm->zebra_announce_head);
+	bgp_input_sched_fini(&bm->input_sched);
 
 	/* reverse bgp_dump_init */
 	bgp_dump_finish();
 
+	/* reverse bgp_snapshot_init */
+	bgp_snapshot_finish();
+
 	/* BGP community aliases */
 	bgp_community_alias_finish();
 
@@ -43,6 +43,7 @@ DEFINE_MTYPE(BGPD, BGP_ROUTE_EXTRA_EVPN, "BGP extra info for EVPN");
 DEFINE_MTYPE(BGPD, BGP_ROUTE_EXTRA_FS, "BGP extra info for flowspec");
 DEFINE_MTYPE(BGPD, BGP_ROUTE_EXTRA_VRFLEAK, "BGP extra info for vrf leaking");
 DEFINE_MTYPE(BGPD, BGP_ROUTE_EXTRA_VNC, "BGP extra info for vnc");
+DEFINE_MTYPE(BGPD, BGP_ROUTE_EXTRA_EXT, "BGP extra info slots");
 DEFINE_MTYPE(BGPD, BGP_CONN, "BGP connected");
 DEFINE_MTYPE(BGPD, BGP_STATIC, "BGP static");
 DEFINE_MTYPE(BGPD, BGP_ADVERTISE_ATTR, "BGP adv attr");
@@ -51,6 +52,7 @@ DEFINE_MTYPE(BGPD, BGP_SYNCHRONISE, "BGP synchronise");
 DEFINE_MTYPE(BGPD, BGP_ADJ_IN, "BGP adj in");
 DEFINE_MTYPE(BGPD, BGP_ADJ_OUT, "BGP adj out");
 DEFINE_MTYPE(BGPD, BGP_MPATH_INFO, "BGP multipath info");
+DEFINE_MTYPE(BGPD, BGP_MP_LIST, "BGP multipath candidates");
 
 DEFINE_MTYPE(BGPD, AS_LIST, "BGP AS list");
 DEFINE_MTYPE(BGPD, AS_FILTER, "BGP AS filter");
@@ -137,3 +139,9 @@ DEFINE_MTYPE(BGPD, BGP_NOTIFICATION, "BGP Notification Message");
 DEFINE_MTYPE(BGPD, BGP_SOFT_VERSION, "Software Version");
 
 DEFINE_MTYPE(BGPD, BGP_EVPN_OVERLAY, "BGP EVPN Overlay");
+
+DEFINE_MTYPE(BGPD, BGP_SHOW_STREAM, "BGP show table stream");
+
+DEFINE_MTYPE(BGPD, BGP_SNAPSHOT, "BGP table snapshot");
+
+DEFINE_MTYPE(BGPD, BGP_COND_ADV_GROUP, "BGP conditional advertisement group");
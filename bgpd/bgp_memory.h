@@ -39,6 +39,7 @@ DECLARE_MTYPE(BGP_ROUTE_EXTRA_EVPN);
 DECLARE_MTYPE(BGP_ROUTE_EXTRA_FS);
 DECLARE_MTYPE(BGP_ROUTE_EXTRA_VRFLEAK);
 DECLARE_MTYPE(BGP_ROUTE_EXTRA_VNC);
+DECLARE_MTYPE(BGP_ROUTE_EXTRA_EXT);
 DECLARE_MTYPE(BGP_CONN);
 DECLARE_MTYPE(BGP_STATIC);
 DECLARE_MTYPE(BGP_ADVERTISE_ATTR);
@@ -47,6 +48,7 @@ DECLARE_MTYPE(BGP_SYNCHRONISE);
 DECLARE_MTYPE(BGP_ADJ_IN);
 DECLARE_MTYPE(BGP_ADJ_OUT);
 DECLARE_MTYPE(BGP_MPATH_INFO);
+DECLARE_MTYPE(BGP_MP_LIST);
 
 DECLARE_MTYPE(AS_LIST);
 DECLARE_MTYPE(AS_FILTER);
@@ -136,4 +138,10 @@ DECLARE_MTYPE(BGP_SOFT_VERSION);
 
 DECLARE_MTYPE(BGP_EVPN_OVERLAY);
 
+DECLARE_MTYPE(BGP_SHOW_STREAM);
+
+DECLARE_MTYPE(BGP_SNAPSHOT);
+
+DECLARE_MTYPE(BGP_COND_ADV_GROUP);
+
 #endif /* _QUAGGA_BGP_MEMORY_H */
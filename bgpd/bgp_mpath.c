@@ -177,11 +177,14 @@ int bgp_path_info_nexthop_cmp(struct bgp_path_info *bpi1,
 	 * if they belong to same VRF
 	 */
 	if (!compare && bpi1->attr->nh_type != NEXTHOP_TYPE_BLACKHOLE) {
-		if (bpi1->extra && bpi1->extra->vrfleak &&
-		    bpi1->extra->vrfleak->bgp_orig && bpi2->extra &&
-		    bpi2->extra->vrfleak && bpi2->extra->vrfleak->bgp_orig) {
-			if (bpi1->extra->vrfleak->bgp_orig->vrf_id !=
-			    bpi2->extra->vrfleak->bgp_orig->vrf_id) {
+		struct bgp_path_info_extra_vrfleak *vrfleak1, *vrfleak2;
+
+		vrfleak1 = bgp_extra_vrfleak(bpi1->extra);
+		vrfleak2 = bgp_extra_vrfleak(bpi2->extra);
+		if (vrfleak1 && vrfleak1->bgp_orig && vrfleak2 &&
+		    vrfleak2->bgp_orig) {
+			if (vrfleak1->bgp_orig->vrf_id !=
+			    vrfleak2->bgp_orig->vrf_id) {
 				compare = 1;
 			}
 		}
@@ -202,14 +205,11 @@ int bgp_path_info_nexthop_cmp(struct bgp_path_info *bpi1,
  * The order of paths is determined first by received nexthop, and then
  * by peer address if the nexthops are the same.
  */
-static int bgp_path_info_mpath_cmp(void *val1, void *val2)
+static int bgp_path_info_mpath_cmp(struct bgp_path_info *bpi1,
+				   struct bgp_path_info *bpi2)
 {
-	struct bgp_path_info *bpi1, *bpi2;
 	int compare;
 
-	bpi1 = val1;
-	bpi2 = val2;
-
 	compare = bgp_path_info_nexthop_cmp(bpi1, bpi2);
 
 	if (!compare) {
@@ -233,11 +233,12 @@ static int bgp_path_info_mpath_cmp(void *val1, void *val2)
  * Initialize the mp_list, which holds the list of multipaths
  * selected by bgp_best_selection
  */
-void bgp_mp_list_init(struct list *mp_list)
+void bgp_mp_list_init(struct bgp_mp_list *mp_list)
 {
 	assert(mp_list);
-	memset(mp_list, 0, sizeof(struct list));
-	mp_list->cmp = bgp_path_info_mpath_cmp;
+	mp_list->paths = mp_list->inline_paths;
+	mp_list->count = 0;
+	mp_list->size = array_size(mp_list->inline_paths);
 }
 
 /*
@@ -245,21 +246,53 @@ void bgp_mp_list_init(struct list *mp_list)
  *
  * Clears all entries out of the mp_list
  */
-void bgp_mp_list_clear(struct list *mp_list)
+void bgp_mp_list_clear(struct bgp_mp_list *mp_list)
 {
 	assert(mp_list);
-	list_delete_all_node(mp_list);
+	if (mp_list->paths != mp_list->inline_paths)
+		XFREE(MTYPE_BGP_MP_LIST, mp_list->paths);
+	bgp_mp_list_init(mp_list);
 }
 
 /*
  * bgp_mp_list_add
  *
- * Adds a multipath entry to the mp_list
+ * Adds a multipath entry to the mp_list, after any entry it compares
+ * equal to
  */
-void bgp_mp_list_add(struct list *mp_list, struct bgp_path_info *mpinfo)
+void bgp_mp_list_add(struct bgp_mp_list *mp_list, struct bgp_path_info *mpinfo)
 {
+	uint32_t lo, hi, mid;
+
 	assert(mp_list && mpinfo);
-	listnode_add_sort(mp_list, mpinfo);
+
+	/* Only destinations with more candidates than fit inline allocate */
+	if (mp_list->count == mp_list->size) {
+		size_t old_size = mp_list->size * sizeof(mp_list->paths[0]);
+
+		mp_list->size *= 2;
+		if (mp_list->paths == mp_list->inline_paths) {
+			mp_list->paths = XMALLOC(MTYPE_BGP_MP_LIST, old_size * 2);
+			memcpy(mp_list->paths, mp_list->inline_paths, old_size);
+		} else
+			mp_list->paths = XREALLOC(MTYPE_BGP_MP_LIST,
+						  mp_list->paths, old_size * 2);
+	}
+
+	lo = 0;
+	hi = mp_list->count;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (bgp_path_info_mpath_cmp(mpinfo, mp_list->paths[mid]) < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	memmove(&mp_list->paths[lo + 1], &mp_list->paths[lo],
+		(mp_list->count - lo) * sizeof(mp_list->paths[0]));
+	mp_list->paths[lo] = mpinfo;
+	mp_list->count++;
 }
 
 /*
@@ -517,13 +550,14 @@ static void bgp_path_info_mpath_attr_set(struct bgp_path_info *path,
 void bgp_path_info_mpath_update(struct bgp *bgp, struct bgp_dest *dest,
 				struct bgp_path_info *new_best,
 				struct bgp_path_info *old_best,
-				struct list *mp_list,
+				struct bgp_mp_list *mp_list,
 				struct bgp_maxpaths_cfg *mpath_cfg)
 {
 	uint16_t maxpaths, mpath_count, old_mpath_count;
 	uint64_t bwval;
 	uint64_t cum_bw, old_cum_bw;
-	struct listnode *mp_node, *mp_next_node;
+	uint32_t mp_idx, mp_count;
+	struct bgp_path_info *mp_candidate;
 	struct bgp_path_info *cur_mpath, *new_mpath, *next_mpath, *prev_mpath;
 	int mpath_changed, debug;
 	bool all_paths_lb;
@@ -536,7 +570,8 @@ void bgp_path_info_mpath_update(struct bgp *bgp, struct bgp_dest *dest,
 	old_mpath_count = 0;
 	old_cum_bw = cum_bw = 0;
 	prev_mpath = new_best;
-	mp_node = listhead(mp_list);
+	mp_idx = 0;
+	mp_count = mp_list ? mp_list->count : 0;
 	debug = bgp_debug_bestpath(dest);
 
 	if (new_best) {
@@ -561,7 +596,7 @@ void bgp_path_info_mpath_update(struct bgp *bgp, struct bgp_dest *dest,
 		zlog_debug("%pBD(%s): starting mpath update, newbest %s num candidates %d old-mpath-count %d old-cum-bw %" PRIu64,
 			   dest, bgp->name_pretty,
 			   new_best ? new_best->peer->host : "NONE",
-			   mp_list ? listcount(mp_list) : 0, old_mpath_count,
+			   mp_count, old_mpath_count,
 			   old_cum_bw);
 
 	/*
@@ -576,7 +611,7 @@ void bgp_path_info_mpath_update(struct bgp *bgp, struct bgp_dest *dest,
 	 * to skip over it
 	 */
 	all_paths_lb = true; /* We'll reset if any path doesn't have LB. */
-	while (mp_node || cur_mpath) {
+	while (mp_idx < mp_count || cur_mpath) {
 		struct bgp_path_info *tmp_info;
 
 		/*
@@ -587,10 +622,11 @@ void bgp_path_info_mpath_update(struct bgp *bgp, struct bgp_dest *dest,
 		if (!cur_mpath && (mpath_count >= maxpaths))
 			break;
 
-		mp_next_node = mp_node ? listnextnode(mp_node) : NULL;
+		mp_candidate = mp_idx < mp_count ? mp_list->paths[mp_idx]
+						 : NULL;
 		next_mpath =
 			cur_mpath ? bgp_path_info_mpath_next(cur_mpath) : NULL;
-		tmp_info = mp_node ? listgetdata(mp_node) : NULL;
+		tmp_info = mp_candidate;
 
 		if (debug)
 			zlog_debug("%pBD(%s): comparing candidate %s with existing mpath %s",
@@ -602,8 +638,7 @@ void bgp_path_info_mpath_update(struct bgp *bgp, struct bgp_dest *dest,
 		 * If equal, the path was a multipath and is still a multipath.
 		 * Insert onto new multipath list if maxpaths allows.
 		 */
-		if (mp_node && (listgetdata(mp_node) == cur_mpath)) {
-			list_delete_node(mp_list, mp_node);
+		if (mp_candidate && mp_candidate == cur_mpath) {
 			bgp_path_info_mpath_dequeue(cur_mpath);
 			if ((mpath_count < maxpaths) && prev_mpath) {
 				mpath_count++;
@@ -654,20 +689,18 @@ void bgp_path_info_mpath_update(struct bgp *bgp, struct bgp_dest *dest,
 						   mpath_count);
 				}
 			}
-			mp_node = mp_next_node;
+			mp_idx++;
 			cur_mpath = next_mpath;
 			continue;
 		}
 
-		if (cur_mpath
-		    && (!mp_node
-			|| (bgp_path_info_mpath_cmp(cur_mpath,
-						    listgetdata(mp_node))
-			    < 0))) {
+		if (cur_mpath &&
+		    (!mp_candidate ||
+		     bgp_path_info_mpath_cmp(cur_mpath, mp_candidate) < 0)) {
 			/*
 			 * If here, we have an old multipath and either the
 			 * mp_list
-			 * is finished or the next mp_node points to a later
+			 * is finished or the next candidate points to a later
 			 * multipath, so we need to purge this path from the
 			 * multipath list
 			 */
@@ -701,8 +734,7 @@ void bgp_path_info_mpath_update(struct bgp *bgp, struct bgp_dest *dest,
 			 * - Dequeue the path from the multipath list just to
 			 * make sure
 			 */
-			new_mpath = listgetdata(mp_node);
-			list_delete_node(mp_list, mp_node);
+			new_mpath = mp_candidate;
 			assert(new_mpath);
 			assert(prev_mpath);
 			if ((mpath_count < maxpaths) && (new_mpath != new_best)) {
@@ -750,7 +782,7 @@ void bgp_path_info_mpath_update(struct bgp *bgp, struct bgp_dest *dest,
 				}
 				prev_mpath = new_mpath;
 			}
-			mp_node = mp_next_node;
+			mp_idx++;
 		}
 	}
 
@@ -37,6 +37,19 @@ struct bgp_path_info_mpath {
 	uint64_t cum_bw;
 };
 
+/* Multipath candidates collected by bgp_best_selection, sorted with
+ * bgp_path_info_mpath_cmp.  Backed by inline_paths until a destination has
+ * more candidates than that, so a best path run does not allocate.
+ */
+#define BGP_MP_LIST_INLINE 64
+
+struct bgp_mp_list {
+	struct bgp_path_info **paths;
+	uint32_t count;
+	uint32_t size;
+	struct bgp_path_info *inline_paths[BGP_MP_LIST_INLINE];
+};
+
 /* Functions to support maximum-paths configuration */
 extern int bgp_maximum_paths_set(struct bgp *bgp, afi_t afi, safi_t safi,
 				 int peertype, uint16_t maxpaths,
@@ -49,14 +62,15 @@ extern int bgp_maximum_paths_unset(struct bgp *bgp, afi_t afi, safi_t safi,
  */
 extern int bgp_path_info_nexthop_cmp(struct bgp_path_info *bpi1,
 				     struct bgp_path_info *bpi2);
-extern void bgp_mp_list_init(struct list *mp_list);
-extern void bgp_mp_list_clear(struct list *mp_list);
-extern void bgp_mp_list_add(struct list *mp_list, struct bgp_path_info *mpinfo);
+extern void bgp_mp_list_init(struct bgp_mp_list *mp_list);
+extern void bgp_mp_list_clear(struct bgp_mp_list *mp_list);
+extern void bgp_mp_list_add(struct bgp_mp_list *mp_list,
+			    struct bgp_path_info *mpinfo);
 extern void bgp_mp_dmed_deselect(struct bgp_path_info *dmed_best);
 extern void bgp_path_info_mpath_update(struct bgp *bgp, struct bgp_dest *dest,
 				       struct bgp_path_info *new_best,
 				       struct bgp_path_info *old_best,
-				       struct list *mp_list,
+				       struct bgp_mp_list *mp_list,
 				       struct bgp_maxpaths_cfg *mpath_cfg);
 extern void
 bgp_path_info_mpath_aggregate_update(struct bgp_path_info *new_best,
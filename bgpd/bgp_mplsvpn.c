@@ -15,6 +15,8 @@
 #include "mpls.h"
 #include "json.h"
 #include "zclient.h"
+#include "jhash.h"
+#include "typesafe.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_debug.h"
@@ -41,6 +43,7 @@
 
 DEFINE_MTYPE_STATIC(BGPD, MPLSVPN_NH_LABEL_BIND_CACHE,
 		    "BGP MPLSVPN nexthop label bind cache");
+DEFINE_MTYPE_STATIC(BGPD, MPLSVPN_IMPORT_INDEX, "BGP MPLSVPN import index");
 
 /*
  * Definitions and external declarations.
@@ -1006,6 +1009,7 @@ static bool leak_update_nexthop_valid(struct bgp *to_bgp, struct bgp_dest *bn,
 				      struct bgp *bgp_orig,
 				      const struct prefix *p, int debug)
 {
+	struct bgp_path_info_extra_vrfleak *vrfleak;
 	struct bgp_path_info *bpi_ultimate;
 	struct bgp *bgp_nexthop;
 	struct bgp_table *table;
@@ -1014,8 +1018,9 @@ static bool leak_update_nexthop_valid(struct bgp *to_bgp, struct bgp_dest *bn,
 	bpi_ultimate = bgp_get_imported_bpi_ultimate(source_bpi);
 	table = bgp_dest_table(bpi_ultimate->net);
 
-	if (bpi->extra && bpi->extra->vrfleak && bpi->extra->vrfleak->bgp_orig)
-		bgp_nexthop = bpi->extra->vrfleak->bgp_orig;
+	vrfleak = bgp_extra_vrfleak(bpi->extra);
+	if (vrfleak && vrfleak->bgp_orig)
+		bgp_nexthop = vrfleak->bgp_orig;
 	else
 		bgp_nexthop = bgp_orig;
 
@@ -1083,6 +1088,7 @@ leak_update(struct bgp *to_bgp, struct bgp_dest *bn,
 	struct bgp_path_info *bpi;
 	struct bgp_path_info *new;
 	struct bgp_path_info_extra *extra;
+	struct bgp_path_info_extra_vrfleak *vrfleak;
 	struct bgp_path_info *parent = source_bpi;
 	struct bgp_labels bgp_labels = {};
 	bool labelssame;
@@ -1116,8 +1122,8 @@ leak_update(struct bgp *to_bgp, struct bgp_dest *bn,
 	 * match parent
 	 */
 	for (bpi = bgp_dest_get_bgp_path_info(bn); bpi; bpi = bpi->next) {
-		if (bpi->extra && bpi->extra->vrfleak &&
-		    bpi->extra->vrfleak->parent == parent)
+		vrfleak = bgp_extra_vrfleak(bpi->extra);
+		if (vrfleak && vrfleak->parent == parent)
 			break;
 	}
 
@@ -1234,17 +1240,18 @@ leak_update(struct bgp *to_bgp, struct bgp_dest *bn,
 	new = info_make(ZEBRA_ROUTE_BGP, BGP_ROUTE_IMPORTED, 0,
 			to_bgp->peer_self, new_attr, bn);
 
-	bgp_path_info_extra_get(new);
-	if (!new->extra->vrfleak)
-		new->extra->vrfleak =
-			XCALLOC(MTYPE_BGP_ROUTE_EXTRA_VRFLEAK,
-				sizeof(struct bgp_path_info_extra_vrfleak));
-
-	if (source_bpi->peer) {
-		extra = bgp_path_info_extra_get(new);
-		extra->vrfleak->peer_orig = peer_lock(source_bpi->peer);
+	extra = bgp_path_info_extra_get(new);
+	vrfleak = bgp_extra_vrfleak(extra);
+	if (!vrfleak) {
+		vrfleak = XCALLOC(MTYPE_BGP_ROUTE_EXTRA_VRFLEAK,
+				  sizeof(struct bgp_path_info_extra_vrfleak));
+		bgp_path_info_extra_ext_set(extra, BGP_PATH_EXTRA_VRFLEAK,
+					    vrfleak);
 	}
 
+	if (source_bpi->peer)
+		vrfleak->peer_orig = peer_lock(source_bpi->peer);
+
 	if (nexthop_self_flag)
 		bgp_path_info_set_flag(bn, new, BGP_PATH_ANNC_NH_SELF);
 
@@ -1254,14 +1261,14 @@ leak_update(struct bgp *to_bgp, struct bgp_dest *bn,
 	if (bgp_labels.num_labels)
 		new->extra->labels = bgp_labels_intern(&bgp_labels);
 
-	new->extra->vrfleak->parent = bgp_path_info_lock(parent);
+	vrfleak->parent = bgp_path_info_lock(parent);
 	bgp_dest_lock_node(
 		(struct bgp_dest *)parent->net);
 
-	new->extra->vrfleak->bgp_orig = bgp_lock(bgp_orig);
+	vrfleak->bgp_orig = bgp_lock(bgp_orig);
 
 	if (nexthop_orig)
-		new->extra->vrfleak->nexthop_orig = *nexthop_orig;
+		vrfleak->nexthop_orig = *nexthop_orig;
 
 	if (leak_update_nexthop_valid(to_bgp, bn, new_attr, afi, safi,
 				      source_bpi, new, bgp_orig, p, debug))
@@ -1464,6 +1471,7 @@ vpn_leak_from_vrf_get_per_nexthop_label(afi_t afi, struct bgp_path_info *pi,
 					struct bgp *to_bgp)
 {
 	struct bgp_path_info *bpi_ultimate = bgp_get_imported_bpi_ultimate(pi);
+	struct bgp_path_info_extra_vrfleak *vrfleak;
 	struct bgp *bgp_nexthop = NULL;
 	bool nh_valid;
 	afi_t nh_afi;
@@ -1513,8 +1521,9 @@ vpn_leak_from_vrf_get_per_nexthop_label(afi_t afi, struct bgp_path_info *pi,
 	/* Check the next-hop reachability.
 	 * Get the bgp instance where the bgp_path_info originates.
 	 */
-	if (pi->extra && pi->extra->vrfleak && pi->extra->vrfleak->bgp_orig)
-		bgp_nexthop = pi->extra->vrfleak->bgp_orig;
+	vrfleak = bgp_extra_vrfleak(pi->extra);
+	if (vrfleak && vrfleak->bgp_orig)
+		bgp_nexthop = vrfleak->bgp_orig;
 	else
 		bgp_nexthop = from_bgp;
 
@@ -1913,6 +1922,7 @@ void vpn_leak_from_vrf_withdraw(struct bgp *to_bgp,		/* to */
 	afi_t afi = family2afi(p->family);
 	safi_t safi = SAFI_MPLS_VPN;
 	struct bgp_path_info *bpi;
+	struct bgp_path_info_extra_vrfleak *vrfleak;
 	struct bgp_dest *bn;
 	const char *debugmsg;
 
@@ -1955,10 +1965,9 @@ void vpn_leak_from_vrf_withdraw(struct bgp *to_bgp,		/* to */
 	 * match original bpi imported from
 	 */
 	for (bpi = bgp_dest_get_bgp_path_info(bn); bpi; bpi = bpi->next) {
-		if (bpi->extra && bpi->extra->vrfleak &&
-		    bpi->extra->vrfleak->parent == path_vrf) {
+		vrfleak = bgp_extra_vrfleak(bpi->extra);
+		if (vrfleak && vrfleak->parent == path_vrf)
 			break;
-		}
 	}
 
 	if (bpi) {
@@ -1988,6 +1997,7 @@ void vpn_leak_from_vrf_withdraw_all(struct bgp *to_bgp, struct bgp *from_bgp,
 		struct bgp_table *table;
 		struct bgp_dest *bn;
 		struct bgp_path_info *bpi, *next;
+		struct bgp_path_info_extra_vrfleak *vrfleak;
 
 		/* This is the per-RD table of prefixes */
 		table = bgp_dest_get_bgp_table_info(pdest);
@@ -2010,10 +2020,10 @@ void vpn_leak_from_vrf_withdraw_all(struct bgp *to_bgp, struct bgp *from_bgp,
 						   bpi->sub_type);
 				if (bpi->sub_type != BGP_ROUTE_IMPORTED)
 					continue;
-				if (!bpi->extra || !bpi->extra->vrfleak)
+				vrfleak = bgp_extra_vrfleak(bpi->extra);
+				if (!vrfleak)
 					continue;
-				if ((struct bgp *)bpi->extra->vrfleak->bgp_orig ==
-				    from_bgp) {
+				if (vrfleak->bgp_orig == from_bgp) {
 					/* delete route */
 					if (debug)
 						zlog_debug("%s: deleting it",
@@ -2026,7 +2036,7 @@ void vpn_leak_from_vrf_withdraw_all(struct bgp *to_bgp, struct bgp *from_bgp,
 					bgp_path_info_delete(bn, bpi);
 					bgp_process(to_bgp, bn, bpi, afi, safi);
 					bgp_mplsvpn_path_nh_label_unlink(
-						bpi->extra->vrfleak->parent);
+						vrfleak->parent);
 				}
 			}
 		}
@@ -2110,6 +2120,7 @@ static void vpn_leak_to_vrf_update_onevrf(struct bgp *to_bgp,   /* to */
 	int nexthop_self_flag = 1;
 	struct bgp_path_info *bpi_ultimate = NULL;
 	struct bgp_path_info *bpi;
+	struct bgp_path_info_extra_vrfleak *vrfleak;
 	int origin_local = 0;
 	struct bgp *src_vrf;
 	struct interface *ifp = NULL;
@@ -2135,9 +2146,9 @@ static void vpn_leak_to_vrf_update_onevrf(struct bgp *to_bgp,   /* to */
 	 */
 	struct bgp *src_bgp = bgp_lookup_by_rd(path_vpn, prd, afi);
 
-	if (path_vpn->extra && path_vpn->extra->vrfleak &&
-	    path_vpn->extra->vrfleak->bgp_orig)
-		src_vrf = path_vpn->extra->vrfleak->bgp_orig;
+	vrfleak = bgp_extra_vrfleak(path_vpn->extra);
+	if (vrfleak && vrfleak->bgp_orig)
+		src_vrf = vrfleak->bgp_orig;
 	else if (src_bgp)
 		src_vrf = src_bgp;
 	else
@@ -2203,8 +2214,8 @@ static void vpn_leak_to_vrf_update_onevrf(struct bgp *to_bgp,   /* to */
 	bn = bgp_afi_node_get(to_bgp->rib[afi][safi], afi, safi, p, NULL);
 
 	for (bpi = bgp_dest_get_bgp_path_info(bn); bpi; bpi = bpi->next) {
-		if (bpi->extra && bpi->extra->vrfleak &&
-		    bpi->extra->vrfleak->parent == path_vpn)
+		vrfleak = bgp_extra_vrfleak(bpi->extra);
+		if (vrfleak && vrfleak->parent == path_vpn)
 			break;
 	}
 
@@ -2367,42 +2378,248 @@ static void vpn_leak_to_vrf_update_onevrf(struct bgp *to_bgp,   /* to */
 		bgp_dest_unlock_node(bn);
 }
 
+/*
+ * Import index: route target -> VRFs importing it from VPN.
+ *
+ * Importing a VPN route used to check the import RTs of every BGP
+ * instance.  The index is rebuilt lazily from the import RT lists the
+ * first time it is used after a policy change, so a route only needs
+ * one lookup per RT it carries.  Matching follows ecommunity_include():
+ * a VRF imports a route if any of its import RTs is equal to any of
+ * the route's extended communities.
+ */
+PREDECL_HASH(vpn_import_rt);
+
+struct vpn_importer {
+	struct bgp *bgp;
+	uint32_t mark;
+};
+
+struct vpn_import_rt {
+	struct vpn_import_rt_item item;
+
+	afi_t afi;
+	uint8_t len;
+	uint8_t val[IPV6_ECOMMUNITY_SIZE];
+
+	uint32_t count;
+	uint32_t size;
+	struct vpn_importer **importers;
+};
+
+static int vpn_import_rt_cmp(const struct vpn_import_rt *a,
+			     const struct vpn_import_rt *b)
+{
+	if (a->afi != b->afi)
+		return numcmp(a->afi, b->afi);
+	if (a->len != b->len)
+		return numcmp(a->len, b->len);
+	return memcmp(a->val, b->val, a->len);
+}
+
+static uint32_t vpn_import_rt_hash(const struct vpn_import_rt *rt)
+{
+	return jhash(rt->val, rt->len, rt->afi);
+}
+
+DECLARE_HASH(vpn_import_rt, struct vpn_import_rt, item, vpn_import_rt_cmp,
+	     vpn_import_rt_hash);
+
+static struct {
+	bool valid;
+	uint32_t mark;
+	struct vpn_import_rt_head rts;
+	struct vpn_importer *importers;
+} vpn_import_index = {
+	.rts = INIT_HASH(vpn_import_index.rts),
+};
+
+static void vpn_import_index_flush(void)
+{
+	struct vpn_import_rt *rt;
+
+	while ((rt = vpn_import_rt_pop(&vpn_import_index.rts))) {
+		XFREE(MTYPE_MPLSVPN_IMPORT_INDEX, rt->importers);
+		XFREE(MTYPE_MPLSVPN_IMPORT_INDEX, rt);
+	}
+	XFREE(MTYPE_MPLSVPN_IMPORT_INDEX, vpn_import_index.importers);
+	vpn_import_index.valid = false;
+}
+
+/* Import RTs or instances changed, rebuild the index on next use */
+void vpn_import_index_invalidate(void)
+{
+	if (vpn_import_index.valid)
+		vpn_import_index_flush();
+}
+
+static void vpn_import_index_add(struct vpn_importer *importer, afi_t afi,
+				 const uint8_t *val, uint8_t len)
+{
+	struct vpn_import_rt ref = { .afi = afi, .len = len }, *rt;
+
+	memcpy(ref.val, val, len);
+	rt = vpn_import_rt_find(&vpn_import_index.rts, &ref);
+	if (!rt) {
+		rt = XCALLOC(MTYPE_MPLSVPN_IMPORT_INDEX, sizeof(*rt));
+		*rt = ref;
+		vpn_import_rt_add(&vpn_import_index.rts, rt);
+	}
+
+	if (rt->count && rt->importers[rt->count - 1] == importer)
+		return;
+
+	if (rt->count == rt->size) {
+		rt->size = MAX(4, rt->size * 2);
+		rt->importers = XREALLOC(MTYPE_MPLSVPN_IMPORT_INDEX,
+					 rt->importers,
+					 rt->size * sizeof(*rt->importers));
+	}
+	rt->importers[rt->count++] = importer;
+}
+
+static void vpn_import_index_build(void)
+{
+	struct listnode *node;
+	struct ecommunity *ecom;
+	struct bgp *bgp;
+	size_t n = 0;
+	uint32_t i;
+	afi_t afi;
+
+	vpn_import_index.importers =
+		XCALLOC(MTYPE_MPLSVPN_IMPORT_INDEX,
+			listcount(bm->bgp) * AFI_MAX *
+				sizeof(*vpn_import_index.importers));
+
+	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp)) {
+		for (afi = AFI_IP; afi < AFI_MAX; afi++) {
+			struct vpn_importer *importer;
+
+			ecom = bgp->vpn_policy[afi]
+				       .rtlist[BGP_VPN_POLICY_DIR_FROMVPN];
+			if (!ecom || !ecom->size)
+				continue;
+
+			importer = &vpn_import_index.importers[n++];
+			importer->bgp = bgp;
+
+			for (i = 0; i < ecom->size; i++)
+				vpn_import_index_add(importer, afi,
+						     ecom->val +
+							     i * ecom->unit_size,
+						     ecom->unit_size);
+		}
+	}
+
+	vpn_import_index.valid = true;
+}
+
+/*
+ * Collect the instances importing routes with these extended
+ * communities.  Returns the number of instances in *bgps, which is
+ * either buf (if bufsize is large enough) or an MTYPE_TMP array the
+ * caller has to free.
+ */
+static size_t vpn_import_index_lookup(afi_t afi, struct ecommunity *ecom,
+				      struct bgp **buf, size_t bufsize,
+				      struct bgp ***bgps)
+{
+	struct vpn_import_rt ref = { .afi = afi }, *rt;
+	struct bgp **out = buf;
+	size_t outsize = bufsize;
+	size_t count = 0;
+	uint32_t i, j;
+	uint8_t lens[2];
+	int nlens, l;
+
+	*bgps = out;
+	if (!ecom || !ecom->size)
+		return 0;
+
+	if (!vpn_import_index.valid)
+		vpn_import_index_build();
+
+	/* one mark per lookup, so an instance is only returned once */
+	if (++vpn_import_index.mark == 0)
+		++vpn_import_index.mark;
+
+	/* an 8-byte import RT matches the head of a longer value */
+	lens[0] = ecom->unit_size;
+	nlens = 1;
+	if (ecom->unit_size > ECOMMUNITY_SIZE)
+		lens[nlens++] = ECOMMUNITY_SIZE;
+
+	for (i = 0; i < ecom->size; i++) {
+		for (l = 0; l < nlens; l++) {
+			ref.len = lens[l];
+			memcpy(ref.val, ecom->val + i * ecom->unit_size,
+			       ref.len);
+			rt = vpn_import_rt_find(&vpn_import_index.rts, &ref);
+			if (!rt)
+				continue;
+
+			for (j = 0; j < rt->count; j++) {
+				struct vpn_importer *importer = rt->importers[j];
+
+				if (importer->mark == vpn_import_index.mark)
+					continue;
+				importer->mark = vpn_import_index.mark;
+
+				if (count == outsize) {
+					outsize *= 2;
+					if (out == buf) {
+						out = XMALLOC(MTYPE_TMP,
+							      outsize *
+								      sizeof(*out));
+						memcpy(out, buf,
+						       count * sizeof(*out));
+					} else
+						out = XREALLOC(MTYPE_TMP, out,
+							       outsize *
+								       sizeof(*out));
+				}
+				out[count++] = importer->bgp;
+			}
+		}
+	}
+
+	*bgps = out;
+	return count;
+}
+
 bool vpn_leak_to_vrf_no_retain_filter_check(struct bgp *from_bgp,
 					    struct attr *attr, afi_t afi)
 {
 	struct ecommunity *ecom_route_target = bgp_attr_get_ecommunity(attr);
 	int debug = BGP_DEBUG(vpn, VPN_LEAK_TO_VRF);
-	struct listnode *node;
+	struct bgp *buf[32], **to_bgps;
 	const char *debugmsg;
-	struct bgp *to_bgp;
-
-	/* Loop over BGP instances */
-	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, to_bgp)) {
-		if (!vpn_leak_from_vpn_active(to_bgp, afi, &debugmsg)) {
+	bool filtered = true;
+	size_t i, count;
+
+	/* Loop over BGP instances importing one of the route targets */
+	count = vpn_import_index_lookup(afi, ecom_route_target, buf,
+					array_size(buf), &to_bgps);
+	for (i = 0; i < count; i++) {
+		if (!vpn_leak_from_vpn_active(to_bgps[i], afi, &debugmsg)) {
 			if (debug)
 				zlog_debug(
 					"%s: from vpn (%s) to vrf (%s) afi %s, skipping: %s",
 					__func__, from_bgp->name_pretty,
-					to_bgp->name_pretty, afi2str(afi),
+					to_bgps[i]->name_pretty, afi2str(afi),
 					debugmsg);
 			continue;
 		}
 
-		/* Check for intersection of route targets */
-		if (!ecommunity_include(
-			    to_bgp->vpn_policy[afi]
-				    .rtlist[BGP_VPN_POLICY_DIR_FROMVPN],
-			    ecom_route_target)) {
-			if (debug)
-				zlog_debug(
-					"%s: from vpn (%s) to vrf (%s) afi %s %s, skipping after no intersection of route targets",
-					__func__, from_bgp->name_pretty,
-					to_bgp->name_pretty, afi2str(afi),
-					ecommunity_str(ecom_route_target));
-			continue;
-		}
-		return false;
+		filtered = false;
+		break;
 	}
+	if (to_bgps != buf)
+		XFREE(MTYPE_TMP, to_bgps);
+
+	if (!filtered)
+		return false;
 
 	if (debug)
 		zlog_debug(
@@ -2417,22 +2634,32 @@ void vpn_leak_to_vrf_update(struct bgp *from_bgp,
 			    struct bgp_path_info *path_vpn,
 			    struct prefix_rd *prd)
 {
-	struct listnode *mnode, *mnnode;
+	const struct prefix *p = bgp_dest_get_prefix(path_vpn->net);
+	struct bgp_path_info_extra_vrfleak *vrfleak;
+	struct bgp *buf[32], **bgps;
 	struct bgp *bgp;
+	size_t i, count;
 
 	int debug = BGP_DEBUG(vpn, VPN_LEAK_TO_VRF);
 
 	if (debug)
 		zlog_debug("%s: start (path_vpn=%p)", __func__, path_vpn);
 
-	/* Loop over VRFs */
-	for (ALL_LIST_ELEMENTS(bm->bgp, mnode, mnnode, bgp)) {
-		if (!path_vpn->extra || !path_vpn->extra->vrfleak ||
-		    path_vpn->extra->vrfleak->bgp_orig != bgp) { /* no loop */
+	vrfleak = bgp_extra_vrfleak(path_vpn->extra);
+
+	/* Loop over VRFs importing one of the route targets */
+	count = vpn_import_index_lookup(family2afi(p->family),
+					bgp_attr_get_ecommunity(path_vpn->attr),
+					buf, array_size(buf), &bgps);
+	for (i = 0; i < count; i++) {
+		bgp = bgps[i];
+		if (!vrfleak || vrfleak->bgp_orig != bgp) { /* no loop */
 			vpn_leak_to_vrf_update_onevrf(bgp, from_bgp, path_vpn,
 						      prd);
 		}
 	}
+	if (bgps != buf)
+		XFREE(MTYPE_TMP, bgps);
 }
 
 void vpn_leak_to_vrf_withdraw(struct bgp_path_info *path_vpn)
@@ -2440,10 +2667,12 @@ void vpn_leak_to_vrf_withdraw(struct bgp_path_info *path_vpn)
 	const struct prefix *p;
 	afi_t afi;
 	safi_t safi = SAFI_UNICAST;
+	struct bgp *buf[32], **bgps;
 	struct bgp *bgp;
-	struct listnode *mnode, *mnnode;
+	size_t i, count;
 	struct bgp_dest *bn;
 	struct bgp_path_info *bpi;
+	struct bgp_path_info_extra_vrfleak *vrfleak;
 	const char *debugmsg;
 
 	int debug = BGP_DEBUG(vpn, VPN_LEAK_TO_VRF);
@@ -2474,8 +2703,12 @@ void vpn_leak_to_vrf_withdraw(struct bgp_path_info *path_vpn)
 	p = bgp_dest_get_prefix(path_vpn->net);
 	afi = family2afi(p->family);
 
-	/* Loop over VRFs */
-	for (ALL_LIST_ELEMENTS(bm->bgp, mnode, mnnode, bgp)) {
+	/* Loop over VRFs importing one of the route targets */
+	count = vpn_import_index_lookup(afi,
+					bgp_attr_get_ecommunity(path_vpn->attr),
+					buf, array_size(buf), &bgps);
+	for (i = 0; i < count; i++) {
+		bgp = bgps[i];
 		if (!vpn_leak_from_vpn_active(bgp, afi, &debugmsg)) {
 			if (debug)
 				zlog_debug("%s: from %s, skipping: %s",
@@ -2484,15 +2717,6 @@ void vpn_leak_to_vrf_withdraw(struct bgp_path_info *path_vpn)
 			continue;
 		}
 
-		/* Check for intersection of route targets */
-		if (!ecommunity_include(
-			    bgp->vpn_policy[afi]
-				    .rtlist[BGP_VPN_POLICY_DIR_FROMVPN],
-			    bgp_attr_get_ecommunity(path_vpn->attr))) {
-
-			continue;
-		}
-
 		if (debug)
 			zlog_debug("%s: withdrawing from vrf %s", __func__,
 				   bgp->name_pretty);
@@ -2501,11 +2725,9 @@ void vpn_leak_to_vrf_withdraw(struct bgp_path_info *path_vpn)
 
 		for (bpi = bgp_dest_get_bgp_path_info(bn); bpi;
 		     bpi = bpi->next) {
-			if (bpi->extra && bpi->extra->vrfleak &&
-			    (struct bgp_path_info *)bpi->extra->vrfleak->parent ==
-				    path_vpn) {
+			vrfleak = bgp_extra_vrfleak(bpi->extra);
+			if (vrfleak && vrfleak->parent == path_vpn)
 				break;
-			}
 		}
 
 		if (bpi) {
@@ -2518,12 +2740,15 @@ void vpn_leak_to_vrf_withdraw(struct bgp_path_info *path_vpn)
 		}
 		bgp_dest_unlock_node(bn);
 	}
+	if (bgps != buf)
+		XFREE(MTYPE_TMP, bgps);
 }
 
 void vpn_leak_to_vrf_withdraw_all(struct bgp *to_bgp, afi_t afi)
 {
 	struct bgp_dest *bn;
 	struct bgp_path_info *bpi, *next;
+	struct bgp_path_info_extra_vrfleak *vrfleak;
 	safi_t safi = SAFI_UNICAST;
 	int debug = BGP_DEBUG(vpn, VPN_LEAK_TO_VRF);
 
@@ -2536,10 +2761,10 @@ void vpn_leak_to_vrf_withdraw_all(struct bgp *to_bgp, afi_t afi)
 	     bn = bgp_route_next(bn)) {
 		for (bpi = bgp_dest_get_bgp_path_info(bn);
 		     (bpi != NULL) && (next = bpi->next, 1); bpi = next) {
-			if (bpi->extra && bpi->extra->vrfleak &&
-			    bpi->extra->vrfleak->bgp_orig != to_bgp &&
-			    bpi->extra->vrfleak->parent &&
-			    is_pi_family_vpn(bpi->extra->vrfleak->parent)) {
+			vrfleak = bgp_extra_vrfleak(bpi->extra);
+			if (vrfleak && vrfleak->bgp_orig != to_bgp &&
+			    vrfleak->parent &&
+			    is_pi_family_vpn(vrfleak->parent)) {
 				/* delete route */
 				bgp_aggregate_decrement(to_bgp,
 							bgp_dest_get_prefix(bn),
@@ -2574,13 +2799,14 @@ void vpn_leak_no_retain(struct bgp *to_bgp, struct bgp *vpn_from, afi_t afi)
 			continue;
 
 		for (bn = bgp_table_top(table); bn; bn = bgp_route_next(bn)) {
+			struct bgp_path_info_extra_vrfleak *vrfleak;
 			struct bgp_path_info *next;
 
 			for (bpi = bgp_dest_get_bgp_path_info(bn);
 			     (bpi != NULL) && (next = bpi->next, 1);
 			     bpi = next) {
-				if (bpi->extra && bpi->extra->vrfleak &&
-				    bpi->extra->vrfleak->bgp_orig == to_bgp)
+				vrfleak = bgp_extra_vrfleak(bpi->extra);
+				if (vrfleak && vrfleak->bgp_orig == to_bgp)
 					continue;
 
 				if (bpi->sub_type != BGP_ROUTE_NORMAL)
@@ -2622,11 +2848,12 @@ void vpn_leak_to_vrf_update_all(struct bgp *to_bgp, struct bgp *vpn_from,
 			continue;
 
 		for (bn = bgp_table_top(table); bn; bn = bgp_route_next(bn)) {
+			struct bgp_path_info_extra_vrfleak *vrfleak;
 
 			for (bpi = bgp_dest_get_bgp_path_info(bn); bpi;
 			     bpi = bpi->next) {
-				if (bpi->extra && bpi->extra->vrfleak &&
-				    bpi->extra->vrfleak->bgp_orig == to_bgp)
+				vrfleak = bgp_extra_vrfleak(bpi->extra);
+				if (vrfleak && vrfleak->bgp_orig == to_bgp)
 					continue;
 
 				vpn_leak_to_vrf_update_onevrf(to_bgp, vpn_from,
@@ -2725,6 +2952,8 @@ void vpn_handle_router_id_update(struct bgp *bgp, bool withdraw,
 	struct ecommunity *ecom;
 	enum vpn_policy_direction idir, edir;
 
+	vpn_import_index_invalidate();
+
 	/*
 	 * Router-id change that is not explicitly configured
 	 * (a change from zebra, frr restart for example)
@@ -2851,6 +3080,8 @@ void vrf_import_from_vrf(struct bgp *to_bgp, struct bgp *from_bgp,
 	struct listnode *node;
 	bool is_inst_match = false;
 
+	vpn_import_index_invalidate();
+
 	export_name = to_bgp->name ? to_bgp->name : VRF_DEFAULT_NAME;
 	idir = BGP_VPN_POLICY_DIR_FROMVPN;
 	edir = BGP_VPN_POLICY_DIR_TOVPN;
@@ -2977,6 +3208,8 @@ void vrf_unimport_from_vrf(struct bgp *to_bgp, struct bgp *from_bgp,
 	struct listnode *node;
 	int debug;
 
+	vpn_import_index_invalidate();
+
 	export_name = to_bgp->name ? to_bgp->name : VRF_DEFAULT_NAME;
 	tmp_name = from_bgp->name ? from_bgp->name : VRF_DEFAULT_NAME;
 	idir = BGP_VPN_POLICY_DIR_FROMVPN;
@@ -63,6 +63,8 @@ extern void vpn_leak_no_retain(struct bgp *to_bgp, struct bgp *vpn_from,
 extern void vpn_leak_to_vrf_update_all(struct bgp *to_bgp, struct bgp *from_bgp,
 				       afi_t afi);
 
+extern void vpn_import_index_invalidate(void);
+
 extern bool vpn_leak_to_vrf_no_retain_filter_check(struct bgp *from_bgp,
 						   struct attr *attr,
 						   afi_t afi);
@@ -240,6 +242,9 @@ static inline void vpn_leak_prechange(enum vpn_policy_direction direction,
 				      afi_t afi, struct bgp *bgp_vpn,
 				      struct bgp *bgp_vrf)
 {
+	/* import RTs may change, see vpn_import_index_lookup() */
+	vpn_import_index_invalidate();
+
 	/* Detect when default bgp instance is not (yet) defined by config */
 	if (!bgp_vpn)
 		return;
@@ -259,6 +264,9 @@ static inline void vpn_leak_postchange(enum vpn_policy_direction direction,
 				       afi_t afi, struct bgp *bgp_vpn,
 				       struct bgp *bgp_vrf)
 {
+	/* import RTs may change, see vpn_import_index_lookup() */
+	vpn_import_index_invalidate();
+
 	/* Detect when default bgp instance is not (yet) defined by config */
 	if (!bgp_vpn)
 		return;
@@ -320,11 +328,13 @@ static inline bool is_route_injectable_into_vpn(struct bgp_path_info *pi)
 	struct bgp_table *table;
 	struct bgp_dest *dest;
 
-	if (pi->sub_type != BGP_ROUTE_IMPORTED || !pi->extra ||
-	    !pi->extra->vrfleak || !pi->extra->vrfleak->parent)
+	if (pi->sub_type != BGP_ROUTE_IMPORTED ||
+	    !bgp_extra_vrfleak(pi->extra) ||
+	    !bgp_extra_vrfleak(pi->extra)->parent)
 		return true;
 
-	parent_pi = (struct bgp_path_info *)pi->extra->vrfleak->parent;
+	parent_pi =
+		(struct bgp_path_info *)bgp_extra_vrfleak(pi->extra)->parent;
 	dest = parent_pi->net;
 	if (!dest)
 		return true;
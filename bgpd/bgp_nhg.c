@@ -6,10 +6,18 @@
 
 #include <zebra.h>
 
+#include "jhash.h"
+#include "typesafe.h"
+#include "zclient.h"
+
 #include <bgpd/bgpd.h>
 #include <bgpd/bgp_debug.h>
 #include <bgpd/bgp_nhg.h>
 
+DEFINE_MTYPE_STATIC(BGPD, BGP_NHG_ROUTE, "BGP route nexthop group");
+
+extern struct zclient *zclient;
+
 
 /****************************************************************************
  * L3 NHGs are used for fast failover of nexthops in the dplane. These are
@@ -97,3 +105,290 @@ void bgp_nhg_id_free(uint32_t nhg_id)
 
 	bf_release_index(bgp_nh_id_bitmap, nhg_id);
 }
+
+/****************************************************************************
+ * Nexthop groups for BGP routes.  Routes with the same set of nexthops
+ * share one NHG in zebra, so a route install only has to carry the
+ * prefix and the NHG id.  Only sets zebra can take as is are used (all
+ * nexthops with an interface, no SRv6/EVPN), everything else is still
+ * sent with its nexthops inline.
+ ***************************************************************************/
+PREDECL_HASH(bgp_nhg_route_set);
+PREDECL_HASH(bgp_nhg_route_id);
+
+struct bgp_nhg_route {
+	struct bgp_nhg_route_set_item set_item;
+	struct bgp_nhg_route_id_item id_item;
+
+	uint32_t id;
+	uint32_t refcnt;
+
+	/* Nexthops were removed by PIC, no longer found by nexthop set */
+	bool repaired;
+
+	uint16_t nexthop_num;
+	struct zapi_nexthop *nexthops;
+};
+
+static int bgp_nhg_route_set_cmp(const struct bgp_nhg_route *a,
+				 const struct bgp_nhg_route *b)
+{
+	if (a->nexthop_num != b->nexthop_num)
+		return numcmp(a->nexthop_num, b->nexthop_num);
+
+	return memcmp(a->nexthops, b->nexthops,
+		      a->nexthop_num * sizeof(*a->nexthops));
+}
+
+static uint32_t bgp_nhg_route_set_hash(const struct bgp_nhg_route *nhgr)
+{
+	return jhash(nhgr->nexthops, nhgr->nexthop_num * sizeof(*nhgr->nexthops),
+		     0x62676e68);
+}
+
+DECLARE_HASH(bgp_nhg_route_set, struct bgp_nhg_route, set_item,
+	     bgp_nhg_route_set_cmp, bgp_nhg_route_set_hash);
+
+static int bgp_nhg_route_id_cmp(const struct bgp_nhg_route *a,
+				const struct bgp_nhg_route *b)
+{
+	return numcmp(a->id, b->id);
+}
+
+static uint32_t bgp_nhg_route_id_hash(const struct bgp_nhg_route *nhgr)
+{
+	return nhgr->id;
+}
+
+DECLARE_HASH(bgp_nhg_route_id, struct bgp_nhg_route, id_item,
+	     bgp_nhg_route_id_cmp, bgp_nhg_route_id_hash);
+
+static struct bgp_nhg_route_set_head bgp_nhg_route_sets =
+	INIT_HASH(bgp_nhg_route_sets);
+static struct bgp_nhg_route_id_head bgp_nhg_route_ids =
+	INIT_HASH(bgp_nhg_route_ids);
+static uint64_t bgp_nhg_route_repairs;
+
+bool bgp_nhg_route_eligible(const struct zapi_nexthop *nexthops,
+			    uint16_t nexthop_num)
+{
+	uint16_t i;
+
+	if (!nexthop_num)
+		return false;
+
+	for (i = 0; i < nexthop_num; i++) {
+		switch (nexthops[i].type) {
+		case NEXTHOP_TYPE_IFINDEX:
+		case NEXTHOP_TYPE_IPV4_IFINDEX:
+		case NEXTHOP_TYPE_IPV6_IFINDEX:
+			break;
+		case NEXTHOP_TYPE_IPV4:
+		case NEXTHOP_TYPE_IPV6:
+		case NEXTHOP_TYPE_BLACKHOLE:
+			return false;
+		}
+
+		/* zebra does not resolve nexthops of protocol NHGs */
+		if (!nexthops[i].ifindex)
+			return false;
+
+		if (CHECK_FLAG(nexthops[i].flags,
+			       ZAPI_NEXTHOP_FLAG_HAS_BACKUP |
+				       ZAPI_NEXTHOP_FLAG_SEG6 |
+				       ZAPI_NEXTHOP_FLAG_SEG6LOCAL |
+				       ZAPI_NEXTHOP_FLAG_EVPN) ||
+		    nexthops[i].srte_color)
+			return false;
+	}
+
+	return true;
+}
+
+static void bgp_nhg_route_send(struct bgp_nhg_route *nhgr, int cmd)
+{
+	struct zapi_nhg api_nhg = {};
+
+	api_nhg.id = nhgr->id;
+	if (cmd == ZEBRA_NHG_ADD) {
+		api_nhg.nexthop_num = nhgr->nexthop_num;
+		memcpy(api_nhg.nexthops, nhgr->nexthops,
+		       nhgr->nexthop_num * sizeof(*nhgr->nexthops));
+	}
+
+	if (BGP_DEBUG(zebra, ZEBRA))
+		zlog_debug("%s nhg %u with %u nexthops to zebra",
+			   cmd == ZEBRA_NHG_ADD ? "Adding" : "Removing",
+			   nhgr->id, nhgr->nexthop_num);
+
+	zclient_nhg_send(zclient, cmd, &api_nhg);
+}
+
+/*
+ * Get a reference on the NHG for this nexthop set, creating it in zebra
+ * if needed.  Returns 0 if no NHG can be used.
+ */
+uint32_t bgp_nhg_route_get(const struct zapi_nexthop *nexthops,
+			   uint16_t nexthop_num)
+{
+	struct bgp_nhg_route ref = {}, *nhgr;
+
+	if (!zclient || zclient->sock < 0 || nexthop_num > MULTIPATH_NUM)
+		return 0;
+
+	ref.nexthop_num = nexthop_num;
+	ref.nexthops = (struct zapi_nexthop *)nexthops;
+
+	nhgr = bgp_nhg_route_set_find(&bgp_nhg_route_sets, &ref);
+	if (nhgr) {
+		nhgr->refcnt++;
+		return nhgr->id;
+	}
+
+	ref.id = bgp_nhg_id_alloc();
+	if (!ref.id)
+		return 0;
+
+	nhgr = XCALLOC(MTYPE_BGP_NHG_ROUTE, sizeof(*nhgr));
+	nhgr->id = ref.id;
+	nhgr->refcnt = 1;
+	nhgr->nexthop_num = nexthop_num;
+	nhgr->nexthops = XMALLOC(MTYPE_BGP_NHG_ROUTE,
+				 nexthop_num * sizeof(*nexthops));
+	memcpy(nhgr->nexthops, nexthops, nexthop_num * sizeof(*nexthops));
+
+	bgp_nhg_route_set_add(&bgp_nhg_route_sets, nhgr);
+	bgp_nhg_route_id_add(&bgp_nhg_route_ids, nhgr);
+
+	bgp_nhg_route_send(nhgr, ZEBRA_NHG_ADD);
+
+	return nhgr->id;
+}
+
+/* Drop a reference taken with bgp_nhg_route_get() */
+void bgp_nhg_route_put(uint32_t nhg_id)
+{
+	struct bgp_nhg_route ref = { .id = nhg_id }, *nhgr;
+
+	if (!nhg_id)
+		return;
+
+	nhgr = bgp_nhg_route_id_find(&bgp_nhg_route_ids, &ref);
+	if (!nhgr || --nhgr->refcnt)
+		return;
+
+	if (zclient && zclient->sock >= 0)
+		bgp_nhg_route_send(nhgr, ZEBRA_NHG_DEL);
+
+	if (!nhgr->repaired)
+		bgp_nhg_route_set_del(&bgp_nhg_route_sets, nhgr);
+	bgp_nhg_route_id_del(&bgp_nhg_route_ids, nhgr);
+	bgp_nhg_id_free(nhgr->id);
+
+	XFREE(MTYPE_BGP_NHG_ROUTE, nhgr->nexthops);
+	XFREE(MTYPE_BGP_NHG_ROUTE, nhgr);
+}
+
+static bool bgp_nhg_route_nexthop_match(const struct zapi_nexthop *api_nh,
+					vrf_id_t vrf_id,
+					const struct prefix *gate,
+					ifindex_t ifindex)
+{
+	if (api_nh->vrf_id != vrf_id)
+		return false;
+
+	if (ifindex && api_nh->ifindex != ifindex)
+		return false;
+
+	switch (api_nh->type) {
+	case NEXTHOP_TYPE_IPV4_IFINDEX:
+		return gate->family == AF_INET &&
+		       IPV4_ADDR_SAME(&api_nh->gate.ipv4, &gate->u.prefix4);
+	case NEXTHOP_TYPE_IPV6_IFINDEX:
+		return gate->family == AF_INET6 &&
+		       IPV6_ADDR_SAME(&api_nh->gate.ipv6, &gate->u.prefix6);
+	case NEXTHOP_TYPE_IFINDEX:
+	case NEXTHOP_TYPE_IPV4:
+	case NEXTHOP_TYPE_IPV6:
+	case NEXTHOP_TYPE_BLACKHOLE:
+		break;
+	}
+
+	return false;
+}
+
+/*
+ * Prefix independent convergence: a BGP nexthop (gate in vrf_id, and
+ * ifindex if set) went away.  Every shared NHG that still has other nexthops is
+ * updated in place, so zebra moves the traffic of all routes using it
+ * at once.  The routes themselves are reinstalled later by the regular
+ * best path run, which moves them to a group for their new nexthop set
+ * and releases the repaired one.
+ *
+ * Returns the number of groups updated.
+ */
+unsigned int bgp_nhg_route_repair(vrf_id_t vrf_id, const struct prefix *gate,
+				  ifindex_t ifindex)
+{
+	struct bgp_nhg_route *nhgr;
+	unsigned int repaired = 0;
+	uint16_t i, j;
+
+	frr_each (bgp_nhg_route_id, &bgp_nhg_route_ids, nhgr) {
+		for (i = 0, j = 0; i < nhgr->nexthop_num; i++) {
+			if (bgp_nhg_route_nexthop_match(&nhgr->nexthops[i],
+							vrf_id, gate, ifindex))
+				continue;
+			if (i != j)
+				nhgr->nexthops[j] = nhgr->nexthops[i];
+			j++;
+		}
+
+		if (j == nhgr->nexthop_num)
+			continue;
+
+		/*
+		 * Nothing left to fail over to, the routes have to go
+		 * through best path anyway.  Keep the group as it is.
+		 */
+		if (!j)
+			continue;
+
+		if (!nhgr->repaired) {
+			bgp_nhg_route_set_del(&bgp_nhg_route_sets, nhgr);
+			nhgr->repaired = true;
+		}
+		nhgr->nexthop_num = j;
+
+		if (BGP_DEBUG(nht, NHT))
+			zlog_debug("%s: nhg %u down to %u nexthops after %pFX(%u) failed",
+				   __func__, nhgr->id, j, gate, vrf_id);
+
+		if (zclient && zclient->sock >= 0)
+			bgp_nhg_route_send(nhgr, ZEBRA_NHG_ADD);
+
+		bgp_nhg_route_repairs++;
+		repaired++;
+	}
+
+	return repaired;
+}
+
+uint64_t bgp_nhg_route_repair_count(void)
+{
+	return bgp_nhg_route_repairs;
+}
+
+/* zebra forgets our NHGs when the session drops, send them again */
+void bgp_nhg_route_replay(void)
+{
+	struct bgp_nhg_route *nhgr;
+
+	frr_each (bgp_nhg_route_id, &bgp_nhg_route_ids, nhgr)
+		bgp_nhg_route_send(nhgr, ZEBRA_NHG_ADD);
+}
+
+size_t bgp_nhg_route_count(void)
+{
+	return bgp_nhg_route_id_count(&bgp_nhg_route_ids);
+}
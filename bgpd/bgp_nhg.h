@@ -15,4 +15,18 @@ extern void bgp_nhg_id_free(uint32_t nhg_id);
 extern void bgp_nhg_init(void);
 void bgp_nhg_finish(void);
 
+/* NHGs shared by BGP routes with the same nexthops */
+struct zapi_nexthop;
+extern bool bgp_nhg_route_eligible(const struct zapi_nexthop *nexthops,
+				   uint16_t nexthop_num);
+extern uint32_t bgp_nhg_route_get(const struct zapi_nexthop *nexthops,
+				  uint16_t nexthop_num);
+extern void bgp_nhg_route_put(uint32_t nhg_id);
+extern unsigned int bgp_nhg_route_repair(vrf_id_t vrf_id,
+					 const struct prefix *gate,
+					 ifindex_t ifindex);
+extern uint64_t bgp_nhg_route_repair_count(void);
+extern void bgp_nhg_route_replay(void);
+extern size_t bgp_nhg_route_count(void);
+
 #endif /* _BGP_NHG_H */
@@ -33,6 +33,7 @@
 #include "bgpd/bgp_rd.h"
 #include "bgpd/bgp_mplsvpn.h"
 #include "bgpd/bgp_ecommunity.h"
+#include "bgpd/bgp_nhg.h"
 
 extern struct zclient *zclient;
 
@@ -54,13 +55,14 @@ static int bgp_isvalid_nexthop_for_ebgp(struct bgp_nexthop_cache *bnc,
 	struct interface *ifp = NULL;
 	struct nexthop *nexthop;
 	struct bgp_interface *iifp;
+	struct bgp_path_info_extra_vrfleak *vrfleak;
 	struct peer *peer;
 
-	if (!path->extra || !path->extra->vrfleak ||
-	    !path->extra->vrfleak->peer_orig)
+	vrfleak = bgp_extra_vrfleak(path->extra);
+	if (!vrfleak || !vrfleak->peer_orig)
 		return false;
 
-	peer = path->extra->vrfleak->peer_orig;
+	peer = vrfleak->peer_orig;
 
 	/* only connected ebgp peers are valid */
 	if (peer->sort != BGP_PEER_EBGP || peer->ttl != BGP_DEFAULT_TTL ||
@@ -579,6 +581,29 @@ void bgp_delete_connected_nexthop(afi_t afi, struct peer *peer)
 	}
 }
 
+/*
+ * A nexthop routes were installed over is gone.  Fix up the shared
+ * NHGs first: one NHG update per group moves the traffic to the
+ * remaining nexthops, whatever the number of prefixes.  The per-prefix
+ * best path runs that follow are queued as usual and reinstall the
+ * routes in the background.
+ */
+static void bgp_nht_pic_repair(struct bgp_nexthop_cache *bnc)
+{
+	unsigned int repaired;
+
+	if (CHECK_FLAG(bnc->flags, BGP_STATIC_ROUTE) || !bgp_nhg_route_count())
+		return;
+
+	repaired = bgp_nhg_route_repair(bnc->bgp->vrf_id, &bnc->prefix,
+					bnc->ifindex_ipv6_ll);
+
+	if (repaired && BGP_DEBUG(nht, NHT))
+		zlog_debug("%s(%u): %pFX unreachable, %u nhg(s) repaired",
+			   bnc->bgp->name_pretty, bnc->bgp->vrf_id,
+			   &bnc->prefix, repaired);
+}
+
 static void bgp_process_nexthop_update(struct bgp_nexthop_cache *bnc,
 				       struct zapi_route *nhr,
 				       bool import_check)
@@ -589,6 +614,7 @@ static void bgp_process_nexthop_update(struct bgp_nexthop_cache *bnc,
 	struct nexthop *nhlist_tail = NULL;
 	int i;
 	bool evpn_resolved = false;
+	bool was_valid = CHECK_FLAG(bnc->flags, BGP_NEXTHOP_VALID);
 
 	bnc->last_update = monotime(NULL);
 	bnc->change_flags = 0;
@@ -749,6 +775,9 @@ static void bgp_process_nexthop_update(struct bgp_nexthop_cache *bnc,
 		bnc->nexthop = NULL;
 	}
 
+	if (was_valid && !CHECK_FLAG(bnc->flags, BGP_NEXTHOP_VALID))
+		bgp_nht_pic_repair(bnc);
+
 	evaluate_paths(bnc);
 }
 
@@ -819,8 +848,11 @@ static void bgp_nht_ifp_table_handle(struct bgp *bgp,
 			/* change nexthop number only for ll */
 			bnc->nexthop_num = 1;
 		} else {
+			if (CHECK_FLAG(bnc->flags, BGP_NEXTHOP_VALID)) {
+				UNSET_FLAG(bnc->flags, BGP_NEXTHOP_VALID);
+				bgp_nht_pic_repair(bnc);
+			}
 			UNSET_FLAG(bnc->flags, BGP_NEXTHOP_PEER_NOTIFIED);
-			UNSET_FLAG(bnc->flags, BGP_NEXTHOP_VALID);
 			SET_FLAG(bnc->change_flags, BGP_NEXTHOP_CHANGED);
 			bnc->nexthop_num = 0;
 		}
@@ -50,6 +50,7 @@
 #include "bgpd/bgp_keepalives.h"
 #include "bgpd/bgp_flowspec.h"
 #include "bgpd/bgp_trace.h"
+#include "bgpd/bgp_snapshot.h"
 
 DEFINE_HOOK(bgp_packet_dump,
 		(struct peer *peer, uint8_t type, bgp_size_t size,
@@ -2571,9 +2572,15 @@ static int bgp_update_receive(struct peer_connection *connection,
 				}
 			}
 
-			/* NSF delete stale route */
-			if (peer->nsf[afi][safi])
+			/* NSF delete stale route, this also drops the paths
+			 * restored from a table snapshot the peer did not
+			 * send again.
+			 */
+			if (peer->nsf[afi][safi] ||
+			    CHECK_FLAG(peer->sflags, PEER_STATUS_SNAPSHOT_WAIT))
 				bgp_clear_stale_route(peer, afi, safi);
+			if (CHECK_FLAG(peer->sflags, PEER_STATUS_SNAPSHOT_WAIT))
+				bgp_snapshot_peer_eor(peer, afi, safi);
 
 			zlog_info(
 				"%s: rcvd End-of-RIB for %s from %s in vrf %s",
@@ -4004,7 +4011,7 @@ int bgp_capability_receive(struct peer_connection *connection,
 }
 
 /**
- * Processes a peer's input buffer.
+ * Processes one packet taken off a peer's input buffer.
  *
  * This function sidesteps the event loop and directly calls bgp_event_update()
  * after processing each BGP message. This is necessary to ensure proper
@@ -4013,171 +4020,278 @@ int bgp_capability_receive(struct peer_connection *connection,
  * would not, making event flow difficult to understand. Please think twice
  * before hacking this.
  *
- * Thread type: EVENT_EVENT
- * @param thread
- * @return 0
+ * @return the result of bgp_event_update(), 0 if the FSM was not updated
  */
-void bgp_process_packet(struct event *thread)
+static int bgp_process_packet_one(struct peer_connection *connection,
+				  struct stream *pkt)
 {
-	/* Yes first of all get peer pointer. */
-	struct peer *peer;	// peer
-	struct peer_connection *connection;
-	uint32_t rpkt_quanta_old; // how many packets to read
-	int fsm_update_result;    // return code of bgp_event_update()
-	int mprc;		  // message processing return code
+	struct peer *peer = connection->peer;
+	uint8_t type = 0;
+	bgp_size_t size;
+	char notify_data_length[2];
+	int mprc; // message processing return code
 
-	connection = EVENT_ARG(thread);
-	peer = connection->peer;
-	rpkt_quanta_old = atomic_load_explicit(&peer->bgp->rpkt_quanta,
-					       memory_order_relaxed);
-	fsm_update_result = 0;
+	peer->curr = pkt;
 
-	/* Guard against scheduled events that occur after peer deletion. */
-	if (connection->status == Deleted || connection->status == Clearing)
-		return;
+	/* skip the marker and copy the packet length */
+	stream_forward_getp(peer->curr, BGP_MARKER_SIZE);
+	memcpy(notify_data_length, stream_pnt(peer->curr), 2);
 
-	unsigned int processed = 0;
+	/* read in the packet length and type */
+	size = stream_getw(peer->curr);
+	type = stream_getc(peer->curr);
 
-	while (processed < rpkt_quanta_old) {
-		uint8_t type = 0;
-		bgp_size_t size;
-		char notify_data_length[2];
+	hook_call(bgp_packet_dump, peer, type, size, peer->curr);
 
-		frr_with_mutex (&connection->io_mtx) {
-			peer->curr = stream_fifo_pop(connection->ibuf);
-		}
+	/* adjust size to exclude the marker + length + type */
+	size -= BGP_HEADER_SIZE;
 
-		if (peer->curr == NULL) // no packets to process, hmm...
-			return;
+	/* Read rest of the packet and call each sort of packet routine
+	 */
+	switch (type) {
+	case BGP_MSG_OPEN:
+		frrtrace(2, frr_bgp, open_process, peer, size);
+		atomic_fetch_add_explicit(&peer->open_in, 1,
+					  memory_order_relaxed);
+		mprc = bgp_open_receive(connection, peer, size);
+		if (mprc == BGP_Stop)
+			flog_err(
+				EC_BGP_PKT_OPEN,
+				"%s: BGP OPEN receipt failed for peer: %s",
+				__func__, peer->host);
+		break;
+	case BGP_MSG_UPDATE:
+		frrtrace(2, frr_bgp, update_process, peer, size);
+		atomic_fetch_add_explicit(&peer->update_in, 1,
+					  memory_order_relaxed);
+		peer->readtime = monotime(NULL);
+		mprc = bgp_update_receive(connection, peer, size);
+		if (mprc == BGP_Stop)
+			flog_err(
+				EC_BGP_UPDATE_RCV,
+				"%s: BGP UPDATE receipt failed for peer: %s",
+				__func__, peer->host);
+		break;
+	case BGP_MSG_NOTIFY:
+		frrtrace(2, frr_bgp, notification_process, peer, size);
+		atomic_fetch_add_explicit(&peer->notify_in, 1,
+					  memory_order_relaxed);
+		mprc = bgp_notify_receive(connection, peer, size);
+		if (mprc == BGP_Stop)
+			flog_err(
+				EC_BGP_NOTIFY_RCV,
+				"%s: BGP NOTIFY receipt failed for peer: %s",
+				__func__, peer->host);
+		break;
+	case BGP_MSG_KEEPALIVE:
+		frrtrace(2, frr_bgp, keepalive_process, peer, size);
+		peer->readtime = monotime(NULL);
+		atomic_fetch_add_explicit(&peer->keepalive_in, 1,
+					  memory_order_relaxed);
+		mprc = bgp_keepalive_receive(connection, peer, size);
+		if (mprc == BGP_Stop)
+			flog_err(
+				EC_BGP_KEEP_RCV,
+				"%s: BGP KEEPALIVE receipt failed for peer: %s",
+				__func__, peer->host);
+		break;
+	case BGP_MSG_ROUTE_REFRESH_NEW:
+	case BGP_MSG_ROUTE_REFRESH_OLD:
+		frrtrace(2, frr_bgp, refresh_process, peer, size);
+		atomic_fetch_add_explicit(&peer->refresh_in, 1,
+					  memory_order_relaxed);
+		mprc = bgp_route_refresh_receive(connection, peer, size);
+		if (mprc == BGP_Stop)
+			flog_err(
+				EC_BGP_RFSH_RCV,
+				"%s: BGP ROUTEREFRESH receipt failed for peer: %s",
+				__func__, peer->host);
+		break;
+	case BGP_MSG_CAPABILITY:
+		frrtrace(2, frr_bgp, capability_process, peer, size);
+		atomic_fetch_add_explicit(&peer->dynamic_cap_in, 1,
+					  memory_order_relaxed);
+		mprc = bgp_capability_receive(connection, peer, size);
+		if (mprc == BGP_Stop)
+			flog_err(
+				EC_BGP_CAP_RCV,
+				"%s: BGP CAPABILITY receipt failed for peer: %s",
+				__func__, peer->host);
+		break;
+	default:
+		/* Suppress uninitialized variable warning */
+		mprc = 0;
+		(void)mprc;
+		/*
+		 * The message type should have been sanitized before
+		 * we ever got here. Receipt of a message with an
+		 * invalid header at this point is indicative of a
+		 * security issue.
+		 */
+		assert (!"Message of invalid type received during input processing");
+	}
 
-		/* skip the marker and copy the packet length */
-		stream_forward_getp(peer->curr, BGP_MARKER_SIZE);
-		memcpy(notify_data_length, stream_pnt(peer->curr), 2);
+	/* delete processed packet */
+	stream_free(peer->curr);
+	peer->curr = NULL;
 
-		/* read in the packet length and type */
-		size = stream_getw(peer->curr);
-		type = stream_getc(peer->curr);
+	/* Update FSM */
+	if (mprc == BGP_PACKET_NOOP)
+		return 0;
 
-		hook_call(bgp_packet_dump, peer, type, size, peer->curr);
+	return bgp_event_update(connection, mprc);
+}
 
-		/* adjust size to exclude the marker + length + type */
-		size -= BGP_HEADER_SIZE;
+/*
+ * Input scheduling.
+ *
+ * Connections with packets waiting in their ibuf are served by a single
+ * deficit round robin over bm->input_sched rather than by an event each, so
+ * a peer sending a full table no longer holds back the keepalives and small
+ * updates of all the others.  Every turn credits a connection with its
+ * weight times read-quanta standard sized messages worth of bytes, packets
+ * are charged their actual length.  Priority connections are queued at the
+ * head when they become ready, which bounds their wait to a single turn.
+ */
+uint32_t bgp_input_weight(struct peer *peer)
+{
+	if (CHECK_FLAG(peer->flags, PEER_FLAG_INPUT_WEIGHT))
+		return peer->input_weight;
 
-		/* Read rest of the packet and call each sort of packet routine
-		 */
-		switch (type) {
-		case BGP_MSG_OPEN:
-			frrtrace(2, frr_bgp, open_process, peer, size);
-			atomic_fetch_add_explicit(&peer->open_in, 1,
-						  memory_order_relaxed);
-			mprc = bgp_open_receive(connection, peer, size);
-			if (mprc == BGP_Stop)
-				flog_err(
-					EC_BGP_PKT_OPEN,
-					"%s: BGP OPEN receipt failed for peer: %s",
-					__func__, peer->host);
-			break;
-		case BGP_MSG_UPDATE:
-			frrtrace(2, frr_bgp, update_process, peer, size);
-			atomic_fetch_add_explicit(&peer->update_in, 1,
-						  memory_order_relaxed);
-			peer->readtime = monotime(NULL);
-			mprc = bgp_update_receive(connection, peer, size);
-			if (mprc == BGP_Stop)
-				flog_err(
-					EC_BGP_UPDATE_RCV,
-					"%s: BGP UPDATE receipt failed for peer: %s",
-					__func__, peer->host);
-			break;
-		case BGP_MSG_NOTIFY:
-			frrtrace(2, frr_bgp, notification_process, peer, size);
-			atomic_fetch_add_explicit(&peer->notify_in, 1,
-						  memory_order_relaxed);
-			mprc = bgp_notify_receive(connection, peer, size);
-			if (mprc == BGP_Stop)
-				flog_err(
-					EC_BGP_NOTIFY_RCV,
-					"%s: BGP NOTIFY receipt failed for peer: %s",
-					__func__, peer->host);
-			break;
-		case BGP_MSG_KEEPALIVE:
-			frrtrace(2, frr_bgp, keepalive_process, peer, size);
-			peer->readtime = monotime(NULL);
-			atomic_fetch_add_explicit(&peer->keepalive_in, 1,
-						  memory_order_relaxed);
-			mprc = bgp_keepalive_receive(connection, peer, size);
-			if (mprc == BGP_Stop)
-				flog_err(
-					EC_BGP_KEEP_RCV,
-					"%s: BGP KEEPALIVE receipt failed for peer: %s",
-					__func__, peer->host);
-			break;
-		case BGP_MSG_ROUTE_REFRESH_NEW:
-		case BGP_MSG_ROUTE_REFRESH_OLD:
-			frrtrace(2, frr_bgp, refresh_process, peer, size);
-			atomic_fetch_add_explicit(&peer->refresh_in, 1,
-						  memory_order_relaxed);
-			mprc = bgp_route_refresh_receive(connection, peer, size);
-			if (mprc == BGP_Stop)
-				flog_err(
-					EC_BGP_RFSH_RCV,
-					"%s: BGP ROUTEREFRESH receipt failed for peer: %s",
-					__func__, peer->host);
-			break;
-		case BGP_MSG_CAPABILITY:
-			frrtrace(2, frr_bgp, capability_process, peer, size);
-			atomic_fetch_add_explicit(&peer->dynamic_cap_in, 1,
-						  memory_order_relaxed);
-			mprc = bgp_capability_receive(connection, peer, size);
-			if (mprc == BGP_Stop)
-				flog_err(
-					EC_BGP_CAP_RCV,
-					"%s: BGP CAPABILITY receipt failed for peer: %s",
-					__func__, peer->host);
-			break;
-		default:
-			/* Suppress uninitialized variable warning */
-			mprc = 0;
-			(void)mprc;
-			/*
-			 * The message type should have been sanitized before
-			 * we ever got here. Receipt of a message with an
-			 * invalid header at this point is indicative of a
-			 * security issue.
-			 */
-			assert (!"Message of invalid type received during input processing");
+	/* iBGP (route reflection) and BFD tracked sessions */
+	if (peer->sort == BGP_PEER_IBGP || peer->bfd_config)
+		return BGP_INPUT_WEIGHT_PRIORITY;
+
+	return BGP_INPUT_WEIGHT_DEFAULT;
+}
+
+void bgp_input_sched_remove(struct peer_connection *connection)
+{
+	if (bgp_input_sched_anywhere(connection))
+		bgp_input_sched_del(&bm->input_sched, connection);
+	connection->input_deficit = 0;
+}
+
+static void bgp_input_serve(struct peer_connection *connection)
+{
+	struct peer *peer = connection->peer;
+	struct stream *pkt;
+	uint32_t quanta;
+	uint64_t delay;
+	bool empty = false;
+	int fsm_update_result;
+
+	/* Guard against connections that went away while queued. */
+	if (connection->status == Deleted || connection->status == Clearing) {
+		connection->input_deficit = 0;
+		return;
+	}
+
+	delay = monotime_since(&connection->input_ready, NULL);
+	peer->inq_delay_last = delay;
+	peer->inq_delay_total += delay;
+	peer->inq_delay_count++;
+	if (delay > peer->inq_delay_max)
+		peer->inq_delay_max = delay;
+
+	quanta = atomic_load_explicit(&peer->bgp->rpkt_quanta,
+				      memory_order_relaxed);
+	connection->input_deficit += (size_t)connection->input_weight * quanta *
+				     BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE;
+
+	while (!empty) {
+		frr_with_mutex (&connection->io_mtx) {
+			pkt = stream_fifo_head(connection->ibuf);
+			if (!pkt)
+				empty = true;
+			else if (stream_get_endp(pkt) > connection->input_deficit)
+				pkt = NULL;
+			else
+				pkt = stream_fifo_pop(connection->ibuf);
 		}
 
-		/* delete processed packet */
-		stream_free(peer->curr);
-		peer->curr = NULL;
-		processed++;
+		if (!pkt)
+			break;
 
-		/* Update FSM */
-		if (mprc != BGP_PACKET_NOOP)
-			fsm_update_result = bgp_event_update(connection, mprc);
-		else
-			continue;
+		connection->input_deficit -= stream_get_endp(pkt);
+		fsm_update_result = bgp_process_packet_one(connection, pkt);
 
 		/*
 		 * If peer was deleted, do not process any more packets. This
 		 * is usually due to executing BGP_Stop or a stub deletion.
 		 */
-		if (fsm_update_result == FSM_PEER_TRANSFERRED
-		    || fsm_update_result == FSM_PEER_STOPPED)
-			break;
+		if (fsm_update_result == FSM_PEER_TRANSFERRED ||
+		    fsm_update_result == FSM_PEER_STOPPED)
+			return;
 	}
 
-	if (fsm_update_result != FSM_PEER_TRANSFERRED
-	    && fsm_update_result != FSM_PEER_STOPPED) {
-		frr_with_mutex (&connection->io_mtx) {
-			// more work to do, come back later
-			if (connection->ibuf->count > 0)
-				event_add_event(bm->master, bgp_process_packet,
-						connection, 0,
-						&connection->t_process_packet);
-		}
+	/* Idle queues do not bank credit. */
+	if (empty || !CHECK_FLAG(connection->thread_flags, PEER_THREAD_READS_ON)) {
+		connection->input_deficit = 0;
+		return;
+	}
+
+	/* more work to do, come back next round */
+	monotime(&connection->input_ready);
+	bgp_input_sched_add_tail(&bm->input_sched, connection);
+}
+
+/*
+ * Serves one round over all connections with input waiting, then yields to
+ * the event loop.
+ */
+static void bgp_process_input(struct event *thread)
+{
+	struct peer_connection *connection;
+	size_t round = bgp_input_sched_count(&bm->input_sched);
+
+	while (round-- && (connection = bgp_input_sched_pop(&bm->input_sched)))
+		bgp_input_serve(connection);
+
+	if (bgp_input_sched_count(&bm->input_sched))
+		event_add_event(bm->master, bgp_process_input, NULL, 0,
+				&bm->t_input_sched);
+}
+
+/**
+ * Queues a peer's input buffer for processing.
+ *
+ * Scheduled whenever packets have been added to connection->ibuf, the
+ * packets themselves are processed from bgp_process_input().
+ *
+ * Thread type: EVENT_EVENT
+ * @param thread
+ * @return 0
+ */
+void bgp_process_packet(struct event *thread)
+{
+	struct peer_connection *connection;
+	bool empty;
+
+	connection = EVENT_ARG(thread);
+
+	/* Guard against scheduled events that occur after peer deletion. */
+	if (connection->status == Deleted || connection->status == Clearing)
+		return;
+
+	if (bgp_input_sched_anywhere(connection))
+		return;
+
+	frr_with_mutex (&connection->io_mtx) {
+		empty = connection->ibuf->count == 0;
 	}
+	if (empty)
+		return;
+
+	connection->input_weight = bgp_input_weight(connection->peer);
+	monotime(&connection->input_ready);
+	if (connection->input_weight > BGP_INPUT_WEIGHT_DEFAULT)
+		bgp_input_sched_add_head(&bm->input_sched, connection);
+	else
+		bgp_input_sched_add_tail(&bm->input_sched, connection);
+
+	event_add_event(bm->master, bgp_process_input, NULL, 0,
+			&bm->t_input_sched);
 }
 
 /* Send EOR when routes are processed by selection deferral timer */
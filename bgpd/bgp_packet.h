@@ -71,6 +71,8 @@ extern void bgp_packet_set_size(struct stream *s);
 
 extern void bgp_generate_updgrp_packets(struct event *event);
 extern void bgp_process_packet(struct event *event);
+extern uint32_t bgp_input_weight(struct peer *peer);
+extern void bgp_input_sched_remove(struct peer_connection *connection);
 
 extern void bgp_send_delayed_eor(struct bgp *bgp);
 
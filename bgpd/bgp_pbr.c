@@ -45,120 +45,80 @@ static int bgp_pbr_match_entry_counter_unique;
 static int bgp_pbr_action_counter_unique;
 static int bgp_pbr_match_iptable_counter_unique;
 
-struct bgp_pbr_match_iptable_unique {
-	uint32_t unique;
-	struct bgp_pbr_match *bpm_found;
-};
+/*
+ * Zebra notifications refer to rules, actions, matches and match entries by
+ * their unique identifier: keep them hashed by it too.
+ */
+static uint32_t bgp_pbr_rule_unique_key(const void *arg)
+{
+	const struct bgp_pbr_rule *bpr = arg;
 
-struct bgp_pbr_match_entry_unique {
-	uint32_t unique;
-	struct bgp_pbr_match_entry *bpme_found;
-};
+	return jhash_1word(bpr->unique, 0);
+}
 
-struct bgp_pbr_action_unique {
-	uint32_t unique;
-	struct bgp_pbr_action *bpa_found;
-};
+static bool bgp_pbr_rule_unique_equal(const void *arg1, const void *arg2)
+{
+	const struct bgp_pbr_rule *r1 = arg1, *r2 = arg2;
 
-struct bgp_pbr_rule_unique {
-	uint32_t unique;
-	struct bgp_pbr_rule *bpr_found;
-};
+	return r1->unique == r2->unique;
+}
 
-static int bgp_pbr_rule_walkcb(struct hash_bucket *bucket, void *arg)
+static uint32_t bgp_pbr_action_unique_key(const void *arg)
 {
-	struct bgp_pbr_rule *bpr = (struct bgp_pbr_rule *)bucket->data;
-	struct bgp_pbr_rule_unique *bpru = (struct bgp_pbr_rule_unique *)
-		arg;
-	uint32_t unique = bpru->unique;
+	const struct bgp_pbr_action *bpa = arg;
 
-	if (bpr->unique == unique) {
-		bpru->bpr_found = bpr;
-		return HASHWALK_ABORT;
-	}
-	return HASHWALK_CONTINUE;
+	return jhash_1word(bpa->unique, 0);
 }
 
-static int bgp_pbr_action_walkcb(struct hash_bucket *bucket, void *arg)
+static bool bgp_pbr_action_unique_equal(const void *arg1, const void *arg2)
 {
-	struct bgp_pbr_action *bpa = (struct bgp_pbr_action *)bucket->data;
-	struct bgp_pbr_action_unique *bpau = (struct bgp_pbr_action_unique *)
-		arg;
-	uint32_t unique = bpau->unique;
+	const struct bgp_pbr_action *r1 = arg1, *r2 = arg2;
 
-	if (bpa->unique == unique) {
-		bpau->bpa_found = bpa;
-		return HASHWALK_ABORT;
-	}
-	return HASHWALK_CONTINUE;
+	return r1->unique == r2->unique;
 }
 
-static int bgp_pbr_match_entry_walkcb(struct hash_bucket *bucket, void *arg)
+static uint32_t bgp_pbr_match_unique_key(const void *arg)
 {
-	struct bgp_pbr_match_entry *bpme =
-		(struct bgp_pbr_match_entry *)bucket->data;
-	struct bgp_pbr_match_entry_unique *bpmeu =
-		(struct bgp_pbr_match_entry_unique *)arg;
-	uint32_t unique = bpmeu->unique;
-
-	if (bpme->unique == unique) {
-		bpmeu->bpme_found = bpme;
-		return HASHWALK_ABORT;
-	}
-	return HASHWALK_CONTINUE;
+	const struct bgp_pbr_match *bpm = arg;
+
+	return jhash_1word(bpm->unique, 0);
 }
 
-struct bgp_pbr_match_ipsetname {
-	char *ipsetname;
-	struct bgp_pbr_match *bpm_found;
-};
+static bool bgp_pbr_match_unique_equal(const void *arg1, const void *arg2)
+{
+	const struct bgp_pbr_match *r1 = arg1, *r2 = arg2;
+
+	return r1->unique == r2->unique;
+}
 
-static int bgp_pbr_match_pername_walkcb(struct hash_bucket *bucket, void *arg)
+static uint32_t bgp_pbr_match_iptable_unique_key(const void *arg)
 {
-	struct bgp_pbr_match *bpm = (struct bgp_pbr_match *)bucket->data;
-	struct bgp_pbr_match_ipsetname *bpmi =
-		(struct bgp_pbr_match_ipsetname *)arg;
-	char *ipset_name = bpmi->ipsetname;
+	const struct bgp_pbr_match *bpm = arg;
 
-	if (!strncmp(ipset_name, bpm->ipset_name,
-		     ZEBRA_IPSET_NAME_SIZE)) {
-		bpmi->bpm_found = bpm;
-		return HASHWALK_ABORT;
-	}
-	return HASHWALK_CONTINUE;
+	return jhash_1word(bpm->unique2, 0);
 }
 
-static int bgp_pbr_match_iptable_walkcb(struct hash_bucket *bucket, void *arg)
+static bool bgp_pbr_match_iptable_unique_equal(const void *arg1,
+					       const void *arg2)
 {
-	struct bgp_pbr_match *bpm = (struct bgp_pbr_match *)bucket->data;
-	struct bgp_pbr_match_iptable_unique *bpmiu =
-		(struct bgp_pbr_match_iptable_unique *)arg;
-	uint32_t unique = bpmiu->unique;
+	const struct bgp_pbr_match *r1 = arg1, *r2 = arg2;
 
-	if (bpm->unique2 == unique) {
-		bpmiu->bpm_found = bpm;
-		return HASHWALK_ABORT;
-	}
-	return HASHWALK_CONTINUE;
+	return r1->unique2 == r2->unique2;
 }
 
-struct bgp_pbr_match_unique {
-	uint32_t unique;
-	struct bgp_pbr_match *bpm_found;
-};
+static uint32_t bgp_pbr_match_entry_unique_key(const void *arg)
+{
+	const struct bgp_pbr_match_entry *bpme = arg;
+
+	return jhash_1word(bpme->unique, 0);
+}
 
-static int bgp_pbr_match_walkcb(struct hash_bucket *bucket, void *arg)
+static bool bgp_pbr_match_entry_unique_equal(const void *arg1,
+					     const void *arg2)
 {
-	struct bgp_pbr_match *bpm = (struct bgp_pbr_match *)bucket->data;
-	struct bgp_pbr_match_unique *bpmu = (struct bgp_pbr_match_unique *)
-		arg;
-	uint32_t unique = bpmu->unique;
+	const struct bgp_pbr_match_entry *r1 = arg1, *r2 = arg2;
 
-	if (bpm->unique == unique) {
-		bpmu->bpm_found = bpm;
-		return HASHWALK_ABORT;
-	}
-	return HASHWALK_CONTINUE;
+	return r1->unique == r2->unique;
 }
 
 static int snprintf_bgp_pbr_match_val(char *str, int len,
@@ -1308,42 +1268,36 @@ struct bgp_pbr_rule *bgp_pbr_rule_lookup(vrf_id_t vrf_id,
 					 uint32_t unique)
 {
 	struct bgp *bgp = bgp_lookup_by_vrf_id(vrf_id);
-	struct bgp_pbr_rule_unique bpru;
+	struct bgp_pbr_rule bpr;
 
 	if (!bgp || unique == 0)
 		return NULL;
-	bpru.unique = unique;
-	bpru.bpr_found = NULL;
-	hash_walk(bgp->pbr_rule_hash, bgp_pbr_rule_walkcb, &bpru);
-	return bpru.bpr_found;
+	bpr.unique = unique;
+	return hash_lookup(bgp->pbr_rule_unique_hash, &bpr);
 }
 
 struct bgp_pbr_action *bgp_pbr_action_rule_lookup(vrf_id_t vrf_id,
 						  uint32_t unique)
 {
 	struct bgp *bgp = bgp_lookup_by_vrf_id(vrf_id);
-	struct bgp_pbr_action_unique bpau;
+	struct bgp_pbr_action bpa;
 
 	if (!bgp || unique == 0)
 		return NULL;
-	bpau.unique = unique;
-	bpau.bpa_found = NULL;
-	hash_walk(bgp->pbr_action_hash, bgp_pbr_action_walkcb, &bpau);
-	return bpau.bpa_found;
+	bpa.unique = unique;
+	return hash_lookup(bgp->pbr_action_unique_hash, &bpa);
 }
 
 struct bgp_pbr_match *bgp_pbr_match_ipset_lookup(vrf_id_t vrf_id,
 						 uint32_t unique)
 {
 	struct bgp *bgp = bgp_lookup_by_vrf_id(vrf_id);
-	struct bgp_pbr_match_unique bpmu;
+	struct bgp_pbr_match bpm;
 
 	if (!bgp || unique == 0)
 		return NULL;
-	bpmu.unique = unique;
-	bpmu.bpm_found = NULL;
-	hash_walk(bgp->pbr_match_hash, bgp_pbr_match_walkcb, &bpmu);
-	return bpmu.bpm_found;
+	bpm.unique = unique;
+	return hash_lookup(bgp->pbr_match_unique_hash, &bpm);
 }
 
 struct bgp_pbr_match_entry *bgp_pbr_match_ipset_entry_lookup(vrf_id_t vrf_id,
@@ -1351,41 +1305,38 @@ struct bgp_pbr_match_entry *bgp_pbr_match_ipset_entry_lookup(vrf_id_t vrf_id,
 						       uint32_t unique)
 {
 	struct bgp *bgp = bgp_lookup_by_vrf_id(vrf_id);
-	struct bgp_pbr_match_entry_unique bpmeu;
-	struct bgp_pbr_match_ipsetname bpmi;
+	struct bgp_pbr_match_entry temp, *bpme;
 
 	if (!bgp || unique == 0)
 		return NULL;
-	bpmi.ipsetname = XCALLOC(MTYPE_TMP, ZEBRA_IPSET_NAME_SIZE);
-	snprintf(bpmi.ipsetname, ZEBRA_IPSET_NAME_SIZE, "%s", ipset_name);
-	bpmi.bpm_found = NULL;
-	hash_walk(bgp->pbr_match_hash, bgp_pbr_match_pername_walkcb, &bpmi);
-	XFREE(MTYPE_TMP, bpmi.ipsetname);
-	if (!bpmi.bpm_found)
+	temp.unique = unique;
+	bpme = hash_lookup(bgp->pbr_match_entry_unique_hash, &temp);
+	if (!bpme || !bpme->backpointer ||
+	    strncmp(ipset_name, bpme->backpointer->ipset_name,
+		    ZEBRA_IPSET_NAME_SIZE))
 		return NULL;
-	bpmeu.bpme_found = NULL;
-	bpmeu.unique = unique;
-	hash_walk(bpmi.bpm_found->entry_hash,
-		  bgp_pbr_match_entry_walkcb, &bpmeu);
-	return bpmeu.bpme_found;
+	return bpme;
 }
 
 struct bgp_pbr_match *bgp_pbr_match_iptable_lookup(vrf_id_t vrf_id,
 						   uint32_t unique)
 {
 	struct bgp *bgp = bgp_lookup_by_vrf_id(vrf_id);
-	struct bgp_pbr_match_iptable_unique bpmiu;
+	struct bgp_pbr_match bpm;
 
 	if (!bgp || unique == 0)
 		return NULL;
-	bpmiu.unique = unique;
-	bpmiu.bpm_found = NULL;
-	hash_walk(bgp->pbr_match_hash, bgp_pbr_match_iptable_walkcb, &bpmiu);
-	return bpmiu.bpm_found;
+	bpm.unique2 = unique;
+	return hash_lookup(bgp->pbr_match_iptable_unique_hash, &bpm);
 }
 
 void bgp_pbr_cleanup(struct bgp *bgp)
 {
+	hash_clean_and_free(&bgp->pbr_match_unique_hash, NULL);
+	hash_clean_and_free(&bgp->pbr_match_iptable_unique_hash, NULL);
+	hash_clean_and_free(&bgp->pbr_match_entry_unique_hash, NULL);
+	hash_clean_and_free(&bgp->pbr_rule_unique_hash, NULL);
+	hash_clean_and_free(&bgp->pbr_action_unique_hash, NULL);
 	hash_clean_and_free(&bgp->pbr_match_hash, bgp_pbr_match_free);
 	hash_clean_and_free(&bgp->pbr_rule_hash, bgp_pbr_rule_free);
 	hash_clean_and_free(&bgp->pbr_action_hash, bgp_pbr_action_free);
@@ -1414,6 +1365,27 @@ void bgp_pbr_init(struct bgp *bgp)
 				 bgp_pbr_rule_hash_equal,
 				 "Match Rule");
 
+	bgp->pbr_match_unique_hash =
+		hash_create_size(8, bgp_pbr_match_unique_key,
+				 bgp_pbr_match_unique_equal,
+				 "Match Hash by unique");
+	bgp->pbr_match_iptable_unique_hash =
+		hash_create_size(8, bgp_pbr_match_iptable_unique_key,
+				 bgp_pbr_match_iptable_unique_equal,
+				 "Match Hash by iptable unique");
+	bgp->pbr_match_entry_unique_hash =
+		hash_create_size(8, bgp_pbr_match_entry_unique_key,
+				 bgp_pbr_match_entry_unique_equal,
+				 "Match Hash Entry by unique");
+	bgp->pbr_rule_unique_hash =
+		hash_create_size(8, bgp_pbr_rule_unique_key,
+				 bgp_pbr_rule_unique_equal,
+				 "Match Rule by unique");
+	bgp->pbr_action_unique_hash =
+		hash_create_size(8, bgp_pbr_action_unique_key,
+				 bgp_pbr_action_unique_equal,
+				 "Match Action by unique");
+
 	bgp->bgp_pbr_cfg = XCALLOC(MTYPE_PBR, sizeof(struct bgp_pbr_config));
 	bgp->bgp_pbr_cfg->pbr_interface_any_ipv4 = true;
 }
@@ -1662,17 +1634,18 @@ static void bgp_pbr_flush_iprule(struct bgp *bgp, struct bgp_pbr_action *bpa,
 		bpr->action = NULL;
 		if (bpr->path) {
 			struct bgp_path_info *path;
-			struct bgp_path_info_extra *extra;
+			struct bgp_path_info_extra_fs *fs;
 
 			/* unlink path to bpme */
 			path = (struct bgp_path_info *)bpr->path;
-			extra = bgp_path_info_extra_get(path);
-			if (extra->flowspec && extra->flowspec->bgp_fs_iprule)
-				listnode_delete(extra->flowspec->bgp_fs_iprule, bpr);
+			fs = bgp_extra_flowspec(bgp_path_info_extra_get(path));
+			if (fs && fs->bgp_fs_iprule)
+				listnode_delete(fs->bgp_fs_iprule, bpr);
 			bpr->path = NULL;
 		}
 	}
 	hash_release(bgp->pbr_rule_hash, bpr);
+	hash_release(bgp->pbr_rule_unique_hash, bpr);
 	bgp_pbr_bpa_remove(bpa);
 }
 
@@ -1691,17 +1664,18 @@ static void bgp_pbr_flush_entry(struct bgp *bgp, struct bgp_pbr_action *bpa,
 		bpme->backpointer = NULL;
 		if (bpme->path) {
 			struct bgp_path_info *path;
-			struct bgp_path_info_extra *extra;
+			struct bgp_path_info_extra_fs *fs;
 
 			/* unlink path to bpme */
 			path = (struct bgp_path_info *)bpme->path;
-			extra = bgp_path_info_extra_get(path);
-			if (extra->flowspec && extra->flowspec->bgp_fs_pbr)
-				listnode_delete(extra->flowspec->bgp_fs_pbr, bpme);
+			fs = bgp_extra_flowspec(bgp_path_info_extra_get(path));
+			if (fs && fs->bgp_fs_pbr)
+				listnode_delete(fs->bgp_fs_pbr, bpme);
 			bpme->path = NULL;
 		}
 	}
 	hash_release(bpm->entry_hash, bpme);
+	hash_release(bgp->pbr_match_entry_unique_hash, bpme);
 	if (hashcount(bpm->entry_hash) == 0) {
 		/* delete iptable entry first */
 		/* then delete ipset match */
@@ -1717,6 +1691,8 @@ static void bgp_pbr_flush_entry(struct bgp *bgp, struct bgp_pbr_action *bpa,
 			bpm->action = NULL;
 		}
 		hash_release(bgp->pbr_match_hash, bpm);
+		hash_release(bgp->pbr_match_unique_hash, bpm);
+		hash_release(bgp->pbr_match_iptable_unique_hash, bpm);
 		/* XXX release pbr_match_action if not used
 		 * note that drop does not need to call send_pbr_action
 		 */
@@ -1729,6 +1705,10 @@ struct bgp_pbr_match_entry_remain {
 	struct bgp_pbr_match_entry *bpme_found;
 };
 
+/*
+ * The rule and match hash keys leave the action out, so the elements only
+ * differing by their action share a hash key: hash_walk_key() finds them.
+ */
 struct bgp_pbr_rule_remain {
 	struct bgp_pbr_rule *bpr_to_match;
 	struct bgp_pbr_rule *bpr_found;
@@ -1855,7 +1835,8 @@ static void bgp_pbr_policyroute_remove_from_zebra_unit(
 		 */
 		bprr.bpr_to_match = bpr;
 		bprr.bpr_found = NULL;
-		hash_walk(bgp->pbr_rule_hash, bgp_pbr_get_same_rule, &bprr);
+		hash_walk_key(bgp->pbr_rule_hash, bpr,
+			      bgp_pbr_get_same_rule, &bprr);
 		if (bprr.bpr_found) {
 			static struct bgp_pbr_rule *local_bpr;
 			static struct bgp_pbr_action *local_bpa;
@@ -1958,7 +1939,8 @@ static void bgp_pbr_policyroute_remove_from_zebra_unit(
 	 */
 	bpmer.bpme_to_match = bpme;
 	bpmer.bpme_found = NULL;
-	hash_walk(bgp->pbr_match_hash, bgp_pbr_get_remaining_entry, &bpmer);
+	hash_walk_key(bgp->pbr_match_hash, bpm,
+		      bgp_pbr_get_remaining_entry, &bpmer);
 	if (bpmer.bpme_found) {
 		static struct bgp_pbr_match *local_bpm;
 		static struct bgp_pbr_action *local_bpa;
@@ -2311,6 +2293,8 @@ static void bgp_pbr_policyroute_add_to_zebra_unit(struct bgp *bgp,
 		}
 		bpa->bgp = bgp;
 		bpa->unique = ++bgp_pbr_action_counter_unique;
+		(void)hash_get(bgp->pbr_action_unique_hash, bpa,
+			       hash_alloc_intern);
 		/* 0 value is forbidden */
 		bpa->install_in_progress = false;
 	}
@@ -2331,6 +2315,8 @@ static void bgp_pbr_policyroute_add_to_zebra_unit(struct bgp *bgp,
 			       bgp_pbr_rule_alloc_intern);
 		if (bpr->unique == 0) {
 			bpr->unique = ++bgp_pbr_action_counter_unique;
+			(void)hash_get(bgp->pbr_rule_unique_hash, bpr,
+				       hash_alloc_intern);
 			bpr->installed = false;
 			bpr->install_in_progress = false;
 			/* link bgp info to bpr */
@@ -2341,10 +2327,11 @@ static void bgp_pbr_policyroute_add_to_zebra_unit(struct bgp *bgp,
 		if (bpr_found) {
 			struct bgp_path_info_extra *extra =
 				bgp_path_info_extra_get(path);
+			struct bgp_path_info_extra_fs *fs =
+				bgp_extra_flowspec(extra);
 
-			if (extra && extra->flowspec &&
-			    listnode_lookup_nocheck(extra->flowspec->bgp_fs_iprule,
-						    bpr)) {
+			if (fs &&
+			    listnode_lookup_nocheck(fs->bgp_fs_iprule, bpr)) {
 				if (BGP_DEBUG(pbr, PBR_ERROR))
 					zlog_err("%s: entry %p/%p already installed in bgp pbr iprule",
 						 __func__, path, bpr);
@@ -2363,7 +2350,8 @@ static void bgp_pbr_policyroute_add_to_zebra_unit(struct bgp *bgp,
 		 */
 		bprr.bpr_to_match = bpr;
 		bprr.bpr_found = NULL;
-		hash_walk(bgp->pbr_rule_hash, bgp_pbr_get_same_rule, &bprr);
+		hash_walk_key(bgp->pbr_rule_hash, bpr,
+			      bgp_pbr_get_same_rule, &bprr);
 		if (bprr.bpr_found) {
 			static struct bgp_pbr_rule *local_bpr;
 			static struct bgp_pbr_action *local_bpa;
@@ -2464,6 +2452,10 @@ static void bgp_pbr_policyroute_add_to_zebra_unit(struct bgp *bgp,
 
 		/* unique2 should be updated too */
 		bpm->unique2 = ++bgp_pbr_match_iptable_counter_unique;
+		(void)hash_get(bgp->pbr_match_unique_hash, bpm,
+			       hash_alloc_intern);
+		(void)hash_get(bgp->pbr_match_iptable_unique_hash, bpm,
+			       hash_alloc_intern);
 		bpm->installed_in_iptable = false;
 		bpm->install_in_progress = false;
 		bpm->install_iptable_in_progress = false;
@@ -2489,6 +2481,8 @@ static void bgp_pbr_policyroute_add_to_zebra_unit(struct bgp *bgp,
 		bpme->unique = ++bgp_pbr_match_entry_counter_unique;
 		/* 0 value is forbidden */
 		bpme->backpointer = bpm;
+		(void)hash_get(bgp->pbr_match_entry_unique_hash, bpme,
+			       hash_alloc_intern);
 		bpme->installed = false;
 		bpme->install_in_progress = false;
 		/* link bgp info to bpme */
@@ -2498,11 +2492,10 @@ static void bgp_pbr_policyroute_add_to_zebra_unit(struct bgp *bgp,
 
 	/* already installed */
 	if (bpme_found) {
-		struct bgp_path_info_extra *extra =
-			bgp_path_info_extra_get(path);
+		struct bgp_path_info_extra_fs *fs =
+			bgp_extra_flowspec(bgp_path_info_extra_get(path));
 
-		if (extra && extra->flowspec &&
-		    listnode_lookup_nocheck(extra->flowspec->bgp_fs_pbr, bpme)) {
+		if (fs && listnode_lookup_nocheck(fs->bgp_fs_pbr, bpme)) {
 			if (BGP_DEBUG(pbr, PBR_ERROR))
 				zlog_err(
 					"%s: entry %p/%p already installed in bgp pbr",
@@ -2539,7 +2532,8 @@ static void bgp_pbr_policyroute_add_to_zebra_unit(struct bgp *bgp,
 	 */
 	bpmer.bpme_to_match = bpme;
 	bpmer.bpme_found = NULL;
-	hash_walk(bgp->pbr_match_hash, bgp_pbr_get_remaining_entry, &bpmer);
+	hash_walk_key(bgp->pbr_match_hash, bpm,
+		      bgp_pbr_get_remaining_entry, &bpmer);
 	if (bpmer.bpme_found) {
 		static struct bgp_pbr_match *local_bpm;
 		static struct bgp_pbr_action *local_bpa;
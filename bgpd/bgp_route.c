@@ -61,6 +61,7 @@
 #include "bgpd/bgp_network.h"
 #include "bgpd/bgp_trace.h"
 #include "bgpd/bgp_rpki.h"
+#include "bgpd/bgp_conditional_adv.h"
 
 #ifdef ENABLE_BGP_VNC
 #include "bgpd/rfapi/rfapi_backend.h"
@@ -162,10 +163,9 @@ DEFINE_HOOK(bgp_process,
 /** Test if path is suppressed. */
 bool bgp_path_suppressed(struct bgp_path_info *pi)
 {
-	if (pi->extra == NULL || pi->extra->aggr_suppressors == NULL)
-		return false;
+	struct list *suppressors = bgp_extra_aggr_suppressors(pi->extra);
 
-	return listcount(pi->extra->aggr_suppressors) > 0;
+	return suppressors && listcount(suppressors) > 0;
 }
 
 struct bgp_dest *bgp_afi_node_get(struct bgp_table *table, afi_t afi,
@@ -235,25 +235,66 @@ static struct bgp_path_info_extra *bgp_path_info_extra_new(void)
 	struct bgp_path_info_extra *new;
 	new = XCALLOC(MTYPE_BGP_ROUTE_EXTRA,
 		      sizeof(struct bgp_path_info_extra));
-	new->flowspec = NULL;
 	return new;
 }
 
+void bgp_path_info_extra_ext_set(struct bgp_path_info_extra *e,
+				 enum bgp_path_info_extra_ext ext, void *data)
+{
+	unsigned int count = __builtin_popcount(e->ext_present);
+	unsigned int idx =
+		__builtin_popcount(e->ext_present & ((1U << ext) - 1));
+
+	if (CHECK_FLAG(e->ext_present, 1U << ext)) {
+		if (data) {
+			e->ext[idx] = data;
+			return;
+		}
+
+		memmove(&e->ext[idx], &e->ext[idx + 1],
+			(count - idx - 1) * sizeof(e->ext[0]));
+		UNSET_FLAG(e->ext_present, 1U << ext);
+		if (!e->ext_present)
+			XFREE(MTYPE_BGP_ROUTE_EXTRA_EXT, e->ext);
+		return;
+	}
+
+	if (!data)
+		return;
+
+	e->ext = XREALLOC(MTYPE_BGP_ROUTE_EXTRA_EXT, e->ext,
+			  (count + 1) * sizeof(e->ext[0]));
+	memmove(&e->ext[idx + 1], &e->ext[idx],
+		(count - idx) * sizeof(e->ext[0]));
+	e->ext[idx] = data;
+	SET_FLAG(e->ext_present, 1U << ext);
+}
+
 void bgp_path_info_extra_free(struct bgp_path_info_extra **extra)
 {
 	struct bgp_path_info_extra *e;
+	struct bgp_damp_info *bdi;
+	struct bgp_path_info_extra_vrfleak *vrfleak;
+	struct bgp_path_info_extra_evpn *evpn;
+	struct bgp_path_info_extra_fs *flowspec;
+	struct list *aggr_suppressors;
+#ifdef ENABLE_BGP_VNC
+	struct bgp_path_info_extra_vnc *vnc;
+#endif
 
 	if (!extra || !*extra)
 		return;
 
 	e = *extra;
 
-	if (e->damp_info)
-		bgp_damp_info_free(e->damp_info, NULL, 0);
-	e->damp_info = NULL;
-	if (e->vrfleak && e->vrfleak->parent) {
+	bdi = bgp_extra_damp_info(e);
+	if (bdi)
+		bgp_damp_info_free(bdi, 0);
+
+	vrfleak = bgp_extra_vrfleak(e);
+	if (vrfleak && vrfleak->parent) {
 		struct bgp_path_info *bpi =
-			(struct bgp_path_info *)e->vrfleak->parent;
+			(struct bgp_path_info *)vrfleak->parent;
 
 		if (bpi->net) {
 			/* FIXME: since multiple e may have the same e->parent
@@ -273,37 +314,38 @@ void bgp_path_info_extra_free(struct bgp_path_info_extra **extra)
 				bpi->net = NULL;
 			bgp_path_info_unlock(bpi);
 		}
-		bgp_path_info_unlock(e->vrfleak->parent);
-		e->vrfleak->parent = NULL;
+		bgp_path_info_unlock(vrfleak->parent);
+		vrfleak->parent = NULL;
 	}
 
-	if (e->vrfleak && e->vrfleak->bgp_orig)
-		bgp_unlock(e->vrfleak->bgp_orig);
+	if (vrfleak && vrfleak->bgp_orig)
+		bgp_unlock(vrfleak->bgp_orig);
 
-	if (e->vrfleak && e->vrfleak->peer_orig)
-		peer_unlock(e->vrfleak->peer_orig);
+	if (vrfleak && vrfleak->peer_orig)
+		peer_unlock(vrfleak->peer_orig);
 
-	if (e->aggr_suppressors)
-		list_delete(&e->aggr_suppressors);
+	aggr_suppressors = bgp_extra_aggr_suppressors(e);
+	if (aggr_suppressors)
+		list_delete(&aggr_suppressors);
 
-	if (e->evpn && e->evpn->mh_info)
-		bgp_evpn_path_mh_info_free(e->evpn->mh_info);
+	evpn = bgp_extra_evpn(e);
+	if (evpn && evpn->mh_info)
+		bgp_evpn_path_mh_info_free(evpn->mh_info);
 
-	if ((*extra)->flowspec && (*extra)->flowspec->bgp_fs_iprule)
-		list_delete(&((*extra)->flowspec->bgp_fs_iprule));
-	if ((*extra)->flowspec && (*extra)->flowspec->bgp_fs_pbr)
-		list_delete(&((*extra)->flowspec->bgp_fs_pbr));
+	flowspec = bgp_extra_flowspec(e);
+	if (flowspec && flowspec->bgp_fs_iprule)
+		list_delete(&flowspec->bgp_fs_iprule);
+	if (flowspec && flowspec->bgp_fs_pbr)
+		list_delete(&flowspec->bgp_fs_pbr);
 
-	if (e->evpn)
-		XFREE(MTYPE_BGP_ROUTE_EXTRA_EVPN, e->evpn);
-	if (e->flowspec)
-		XFREE(MTYPE_BGP_ROUTE_EXTRA_FS, e->flowspec);
-	if (e->vrfleak)
-		XFREE(MTYPE_BGP_ROUTE_EXTRA_VRFLEAK, e->vrfleak);
+	XFREE(MTYPE_BGP_ROUTE_EXTRA_EVPN, evpn);
+	XFREE(MTYPE_BGP_ROUTE_EXTRA_FS, flowspec);
+	XFREE(MTYPE_BGP_ROUTE_EXTRA_VRFLEAK, vrfleak);
 #ifdef ENABLE_BGP_VNC
-	if (e->vnc)
-		XFREE(MTYPE_BGP_ROUTE_EXTRA_VNC, e->vnc);
+	vnc = bgp_extra_vnc(e);
+	XFREE(MTYPE_BGP_ROUTE_EXTRA_VNC, vnc);
 #endif
+	XFREE(MTYPE_BGP_ROUTE_EXTRA_EXT, e->ext);
 
 	if (e->labels)
 		bgp_labels_unintern(&e->labels);
@@ -318,10 +360,12 @@ struct bgp_path_info_extra *bgp_path_info_extra_get(struct bgp_path_info *pi)
 {
 	if (!pi->extra)
 		pi->extra = bgp_path_info_extra_new();
-	if (!pi->extra->evpn && pi->net && pi->net->rn->p.family == AF_EVPN)
-		pi->extra->evpn =
+	if (!bgp_extra_evpn(pi->extra) && pi->net &&
+	    pi->net->rn->p.family == AF_EVPN)
+		bgp_path_info_extra_ext_set(
+			pi->extra, BGP_PATH_EXTRA_EVPN,
 			XCALLOC(MTYPE_BGP_ROUTE_EXTRA_EVPN,
-				sizeof(struct bgp_path_info_extra_evpn));
+				sizeof(struct bgp_path_info_extra_evpn)));
 	return pi->extra;
 }
 
@@ -356,9 +400,6 @@ void bgp_path_info_free_with_caller(const char *name,
 	bgp_unlink_nexthop(path);
 	bgp_path_info_extra_free(&path->extra);
 	bgp_path_info_mpath_free(&path->mpath);
-	if (path->net)
-		bgp_addpath_free_info_data(&path->tx_addpath,
-					   &path->net->tx_addpath);
 
 	peer_unlock(path->peer); /* bgp_path_info peer reference */
 
@@ -692,14 +733,15 @@ void bgp_path_info_path_with_addpath_rx_str(struct bgp_path_info *pi, char *buf,
 struct bgp_path_info *bgp_get_imported_bpi_ultimate(struct bgp_path_info *info)
 {
 	struct bgp_path_info *bpi_ultimate;
+	struct bgp_path_info_extra_vrfleak *vrfleak;
 
 	if (info->sub_type != BGP_ROUTE_IMPORTED)
 		return info;
 
 	for (bpi_ultimate = info;
-	     bpi_ultimate->extra && bpi_ultimate->extra->vrfleak &&
-	     bpi_ultimate->extra->vrfleak->parent;
-	     bpi_ultimate = bpi_ultimate->extra->vrfleak->parent)
+	     (vrfleak = bgp_extra_vrfleak(bpi_ultimate->extra)) &&
+	     vrfleak->parent;
+	     bpi_ultimate = vrfleak->parent)
 		;
 
 	return bpi_ultimate;
@@ -1715,6 +1757,65 @@ done:
 #undef FILTER_EXIST_WARN
 }
 
+#define BGP_NLRI_PREFILTER_BATCH 64
+
+/*
+ * bgp_input_filter() for up to BGP_NLRI_PREFILTER_BATCH prefixes received
+ * with the same attributes.  The prefix-list is applied over the batch and
+ * the as-path list once for all of them.  Lists are consulted for the same
+ * prefixes bgp_input_filter() would consult them for, so the hit counts
+ * come out the same.
+ */
+static void bgp_input_filter_batch(struct peer *peer,
+				   const struct prefix *const *prefixes,
+				   size_t count, struct attr *attr, afi_t afi,
+				   safi_t safi, enum filter_type *results)
+{
+	struct bgp_filter *filter = &peer->filter[afi][safi];
+	const struct prefix *permitted[BGP_NLRI_PREFILTER_BATCH];
+	enum prefix_list_type plist_results[BGP_NLRI_PREFILTER_BATCH];
+	size_t index[BGP_NLRI_PREFILTER_BATCH];
+	size_t i, n = 0;
+
+	assert(count <= BGP_NLRI_PREFILTER_BATCH);
+
+	for (i = 0; i < count; i++) {
+		results[i] = FILTER_PERMIT;
+
+		if (DISTRIBUTE_IN_NAME(filter) &&
+		    access_list_apply(DISTRIBUTE_IN(filter), prefixes[i]) ==
+			    FILTER_DENY) {
+			results[i] = FILTER_DENY;
+			continue;
+		}
+
+		index[n] = i;
+		permitted[n++] = prefixes[i];
+	}
+
+	if (PREFIX_LIST_IN_NAME(filter) && n) {
+		prefix_list_apply_batch(PREFIX_LIST_IN(filter), permitted, n,
+					plist_results);
+		for (i = 0; i < n; i++)
+			if (plist_results[i] == PREFIX_DENY)
+				results[index[i]] = FILTER_DENY;
+	}
+
+	if (!FILTER_LIST_IN_NAME(filter))
+		return;
+
+	for (i = 0; i < count; i++)
+		if (results[i] == FILTER_PERMIT)
+			break;
+	if (i == count ||
+	    as_list_apply(FILTER_LIST_IN(filter), attr->aspath) !=
+		    AS_FILTER_DENY)
+		return;
+
+	for (; i < count; i++)
+		results[i] = FILTER_DENY;
+}
+
 static enum filter_type bgp_output_filter(struct peer *peer,
 					  const struct prefix *p,
 					  struct attr *attr, afi_t afi,
@@ -2851,7 +2952,7 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 	struct bgp_path_info *pi2;
 	int paths_eq, do_mpath;
 	bool debug, any_comparisons;
-	struct list mp_list;
+	struct bgp_mp_list mp_list;
 	char pfx_buf[PREFIX2STR_BUFFER] = {};
 	char path_buf[PATH_ADDPATH_STR_BUFFER];
 	enum bgp_path_selection_reason reason = bgp_path_selection_none;
@@ -2885,7 +2986,8 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 				continue;
 			if (pi1->peer != bgp->peer_self &&
 			    !CHECK_FLAG(pi1->peer->sflags,
-					PEER_STATUS_NSF_WAIT)) {
+					PEER_STATUS_NSF_WAIT |
+						PEER_STATUS_SNAPSHOT_WAIT)) {
 				if (!peer_established(pi1->peer->connection))
 					continue;
 			}
@@ -2898,7 +3000,8 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 					continue;
 				if (pi2->peer != bgp->peer_self &&
 				    !CHECK_FLAG(pi2->peer->sflags,
-						PEER_STATUS_NSF_WAIT) &&
+						PEER_STATUS_NSF_WAIT |
+							PEER_STATUS_SNAPSHOT_WAIT) &&
 				    !peer_established(pi2->peer->connection))
 					continue;
 
@@ -3081,7 +3184,8 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 			if (look_thru->peer &&
 			    look_thru->peer != bgp->peer_self &&
 			    !CHECK_FLAG(look_thru->peer->sflags,
-					PEER_STATUS_NSF_WAIT))
+					PEER_STATUS_NSF_WAIT |
+						PEER_STATUS_SNAPSHOT_WAIT))
 				if (!peer_established(
 					    look_thru->peer->connection)) {
 					if (debug)
@@ -3241,7 +3345,8 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 
 			if (pi->peer && pi->peer != bgp->peer_self
 			    && !CHECK_FLAG(pi->peer->sflags,
-					   PEER_STATUS_NSF_WAIT))
+					   PEER_STATUS_NSF_WAIT |
+						   PEER_STATUS_SNAPSHOT_WAIT))
 				if (!peer_established(pi->peer->connection))
 					continue;
 
@@ -3669,6 +3774,9 @@ static void bgp_process_main_one(struct bgp *bgp, struct bgp_dest *dest,
 	old_select = old_and_new.old;
 	new_select = old_and_new.new;
 
+	if (bgp->condition_filter_count)
+		bgp_conditional_adv_dest_changed(bgp, afi, safi, dest);
+
 	if (safi == SAFI_UNICAST || safi == SAFI_LABELED_UNICAST)
 		/* label unicast path :
 		 * Do we need to allocate or free labels?
@@ -3860,9 +3968,19 @@ static void bgp_process_main_one(struct bgp *bgp, struct bgp_dest *dest,
 	return;
 }
 
-/* Process the routes with the flag BGP_NODE_SELECT_DEFER set */
+/*
+ * Process the routes with the flag BGP_NODE_SELECT_DEFER set.
+ *
+ * The table is walked once in order, BGP_MAX_BEST_ROUTE_SELECT dests per
+ * event. Each run picks up at the dest the previous one stopped at instead
+ * of rescanning the already processed part of the table, and the next run
+ * is queued right away rather than after a timer, so a full table comes
+ * out of deferral as fast as the selection itself goes. The zebra installs
+ * are queued and sent in batches by bgp_handle_route_announcements_to_zebra.
+ */
 void bgp_best_path_select_defer(struct bgp *bgp, afi_t afi, safi_t safi)
 {
+	struct graceful_restart_info *gr_info = &bgp->gr_info[afi][safi];
 	struct bgp_dest *dest;
 	int cnt = 0;
 	struct afi_safi_info *thread_info;
@@ -3882,24 +4000,35 @@ void bgp_best_path_select_defer(struct bgp *bgp, afi_t afi, safi_t safi)
 			   bgp->gr_info[afi][safi].gr_deferred);
 	}
 
-	/* Process the route list */
-	for (dest = bgp_table_top(bgp->rib[afi][safi]);
-	     dest && bgp->gr_info[afi][safi].gr_deferred != 0 &&
-	     cnt < BGP_MAX_BEST_ROUTE_SELECT;
+	/* Process the route list, resuming where the last run stopped. If
+	 * that was past dests deferred since, the walk wraps around on the
+	 * next run.
+	 */
+	dest = gr_info->select_resume;
+	gr_info->select_resume = NULL;
+	if (!dest)
+		dest = bgp_table_top(bgp->rib[afi][safi]);
+
+	for (; dest && gr_info->gr_deferred != 0 &&
+	       cnt < BGP_MAX_BEST_ROUTE_SELECT;
 	     dest = bgp_route_next(dest)) {
 		if (!CHECK_FLAG(dest->flags, BGP_NODE_SELECT_DEFER))
 			continue;
 
 		UNSET_FLAG(dest->flags, BGP_NODE_SELECT_DEFER);
-		bgp->gr_info[afi][safi].gr_deferred--;
+		gr_info->gr_deferred--;
 		bgp_process_main_one(bgp, dest, afi, safi);
 		cnt++;
 	}
-	/* If iteration stopped before the entire table was traversed then the
-	 * node needs to be unlocked.
+
+	/* If iteration stopped before the entire table was traversed keep
+	 * the node locked for the next run, or unlock it if all is done.
 	 */
 	if (dest) {
-		bgp_dest_unlock_node(dest);
+		if (gr_info->gr_deferred)
+			gr_info->select_resume = dest;
+		else
+			bgp_dest_unlock_node(dest);
 		dest = NULL;
 	}
 
@@ -3933,12 +4062,9 @@ void bgp_best_path_select_defer(struct bgp *bgp, afi_t afi, safi_t safi)
 	thread_info->safi = safi;
 	thread_info->bgp = bgp;
 
-	/* If there are more routes to be processed, start the
-	 * selection timer
-	 */
-	event_add_timer(bm->master, bgp_route_select_timer_expire, thread_info,
-			BGP_ROUTE_SELECT_DELAY,
-			&bgp->gr_info[afi][safi].t_route_select);
+	/* If there are more routes to be processed, queue the next run */
+	event_add_event(bm->master, bgp_route_select_timer_expire, thread_info,
+			0, &bgp->gr_info[afi][safi].t_route_select);
 }
 
 static wq_item_status bgp_process_wq(struct work_queue *wq, void *data)
@@ -4529,14 +4655,76 @@ static bool bgp_accept_own(struct peer *peer, afi_t afi, safi_t safi,
 	return false;
 }
 
-void bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
-		struct attr *attr, afi_t afi, safi_t safi, int type,
-		int sub_type, struct prefix_rd *prd, mpls_label_t *label,
-		uint8_t num_labels, int soft_reconfig,
-		struct bgp_route_evpn *evpn)
+/*
+ * AS path loop checks done on received routes, returns why the route has to
+ * be filtered or NULL.
+ */
+static const char *bgp_update_aspath_loop(struct peer *peer, struct attr *attr,
+					  afi_t afi, safi_t safi)
 {
-	int ret;
+	struct bgp *bgp = peer->bgp;
 	int aspath_loop_count = 0;
+	int allowas_in = 0;
+
+	/* Update permitted loop count */
+	if (CHECK_FLAG(peer->af_flags[afi][safi], PEER_FLAG_ALLOWAS_IN))
+		allowas_in = peer->allowas_in[afi][safi];
+
+	/* AS path local-as loop check. */
+	if (peer->change_local_as) {
+		if (allowas_in)
+			aspath_loop_count = allowas_in;
+		else if (!CHECK_FLAG(peer->flags,
+				     PEER_FLAG_LOCAL_AS_NO_PREPEND))
+			aspath_loop_count = 1;
+
+		if (aspath_loop_check(attr->aspath, peer->change_local_as)
+		    > aspath_loop_count)
+			return "as-path contains our own AS;";
+	}
+
+	/* If the peer is configured for "allowas-in origin" and the last ASN in
+	 * the
+	 * as-path is our ASN then we do not need to call aspath_loop_check
+	 */
+	if (CHECK_FLAG(peer->af_flags[afi][safi], PEER_FLAG_ALLOWAS_IN_ORIGIN))
+		if (aspath_get_last_as(attr->aspath) == bgp->as)
+			return NULL;
+
+	/* AS path loop check. */
+	if (aspath_loop_check(attr->aspath, bgp->as) >
+	    peer->allowas_in[afi][safi])
+		return "as-path contains our own AS;";
+
+	/* If we're a CONFED we need to loop check the CONFED ID too */
+	if (CHECK_FLAG(bgp->config, BGP_CONFIG_CONFEDERATION))
+		if (aspath_loop_check_confed(attr->aspath, bgp->confed_id) >
+		    peer->allowas_in[afi][safi])
+			return "as-path contains our own confed AS;";
+
+	return NULL;
+}
+
+/*
+ * What bgp_nlri_parse_ip_batch() already found out about a route, so that
+ * bgp_update() does not run the AS path loop checks and the inbound filters
+ * a second time.  Filters count their hits, they must see a route only once.
+ */
+enum bgp_update_prefilter {
+	BGP_UPDATE_PREFILTER_NONE = 0,
+	BGP_UPDATE_PREFILTER_PERMIT,
+	BGP_UPDATE_PREFILTER_DENY,
+};
+
+static void bgp_update_main(struct peer *peer, const struct prefix *p,
+			    uint32_t addpath_id, struct attr *attr, afi_t afi,
+			    safi_t safi, int type, int sub_type,
+			    struct prefix_rd *prd, mpls_label_t *label,
+			    uint8_t num_labels, int soft_reconfig,
+			    struct bgp_route_evpn *evpn,
+			    enum bgp_update_prefilter prefilter)
+{
+	int ret;
 	struct bgp_dest *dest;
 	struct bgp *bgp;
 	struct attr new_attr = {};
@@ -4546,11 +4734,9 @@ void bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 	const char *reason;
 	char pfx_buf[BGP_PRD_PATH_STRLEN];
 	int connected = 0;
-	int do_loop_check = 1;
 	afi_t nh_afi;
 	bool force_evpn_import = false;
 	safi_t orig_safi = safi;
-	int allowas_in = 0;
 	struct bgp_labels bgp_labels = {};
 	uint8_t i;
 
@@ -4599,10 +4785,6 @@ void bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 		bgp_adj_in_set(dest, peer, attr, addpath_id, &bgp_labels);
 	}
 
-	/* Update permitted loop count */
-	if (CHECK_FLAG(peer->af_flags[afi][safi], PEER_FLAG_ALLOWAS_IN))
-		allowas_in = peer->allowas_in[afi][safi];
-
 	/* Check previously received route. */
 	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
 		if (pi->peer == peer && pi->type == type
@@ -4610,30 +4792,16 @@ void bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 		    && pi->addpath_rx_id == addpath_id)
 			break;
 
-	/* AS path local-as loop check. */
-	if (peer->change_local_as) {
-		if (allowas_in)
-			aspath_loop_count = allowas_in;
-		else if (!CHECK_FLAG(peer->flags,
-				     PEER_FLAG_LOCAL_AS_NO_PREPEND))
-			aspath_loop_count = 1;
-
-		if (aspath_loop_check(attr->aspath, peer->change_local_as)
-		    > aspath_loop_count) {
-			peer->stat_pfx_aspath_loop++;
-			reason = "as-path contains our own AS;";
-			goto filtered;
-		}
+	/* AS path loop checks, the prefilter passed the route through them. */
+	if (prefilter == BGP_UPDATE_PREFILTER_NONE)
+		reason = bgp_update_aspath_loop(peer, attr, afi, safi);
+	else
+		reason = NULL;
+	if (reason) {
+		peer->stat_pfx_aspath_loop++;
+		goto filtered;
 	}
 
-	/* If the peer is configured for "allowas-in origin" and the last ASN in
-	 * the
-	 * as-path is our ASN then we do not need to call aspath_loop_check
-	 */
-	if (CHECK_FLAG(peer->af_flags[afi][safi], PEER_FLAG_ALLOWAS_IN_ORIGIN))
-		if (aspath_get_last_as(attr->aspath) == bgp->as)
-			do_loop_check = 0;
-
 	/* When using bgp ipv4 labeled session, the local prefix is
 	 * received by a peer, and finds out that the proposed prefix
 	 * and its next-hop are the same. To avoid a route loop locally,
@@ -4654,25 +4822,6 @@ void bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 	else
 		bgp_nht_param_prefix = p;
 
-	/* AS path loop check. */
-	if (do_loop_check) {
-		if (aspath_loop_check(attr->aspath, bgp->as) >
-		    peer->allowas_in[afi][safi]) {
-			peer->stat_pfx_aspath_loop++;
-			reason = "as-path contains our own AS;";
-			goto filtered;
-		}
-	}
-
-	/* If we're a CONFED we need to loop check the CONFED ID too */
-	if (CHECK_FLAG(bgp->config, BGP_CONFIG_CONFEDERATION) && do_loop_check)
-		if (aspath_loop_check_confed(attr->aspath, bgp->confed_id) >
-		    peer->allowas_in[afi][safi]) {
-			peer->stat_pfx_aspath_loop++;
-			reason = "as-path contains our own confed AS;";
-			goto filtered;
-		}
-
 	/* Route reflector originator ID check. If ACCEPT_OWN mechanism is
 	 * enabled, then take care of that too.
 	 */
@@ -4696,8 +4845,10 @@ void bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 		goto filtered;
 	}
 
-	/* Apply incoming filter.  */
-	if (bgp_input_filter(peer, p, attr, afi, orig_safi) == FILTER_DENY) {
+	/* Apply incoming filter, unless the prefilter did.  */
+	if (prefilter == BGP_UPDATE_PREFILTER_DENY ||
+	    (prefilter == BGP_UPDATE_PREFILTER_NONE &&
+	     bgp_input_filter(peer, p, attr, afi, orig_safi) == FILTER_DENY)) {
 		peer->stat_pfx_filter++;
 		reason = "filter;";
 		goto filtered;
@@ -5132,10 +5283,11 @@ void bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 				connected = 0;
 
 			struct bgp *bgp_nexthop = bgp;
+			struct bgp_path_info_extra_vrfleak *vrfleak;
 
-			if (pi->extra && pi->extra->vrfleak &&
-			    pi->extra->vrfleak->bgp_orig)
-				bgp_nexthop = pi->extra->vrfleak->bgp_orig;
+			vrfleak = bgp_extra_vrfleak(pi->extra);
+			if (vrfleak && vrfleak->bgp_orig)
+				bgp_nexthop = vrfleak->bgp_orig;
 
 			nh_afi = BGP_ATTR_NH_AFI(afi, pi->attr);
 
@@ -5446,6 +5598,17 @@ filtered:
 	return;
 }
 
+void bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
+		struct attr *attr, afi_t afi, safi_t safi, int type,
+		int sub_type, struct prefix_rd *prd, mpls_label_t *label,
+		uint8_t num_labels, int soft_reconfig,
+		struct bgp_route_evpn *evpn)
+{
+	bgp_update_main(peer, p, addpath_id, attr, afi, safi, type, sub_type,
+			prd, label, num_labels, soft_reconfig, evpn,
+			BGP_UPDATE_PREFILTER_NONE);
+}
+
 void bgp_withdraw(struct peer *peer, const struct prefix *p,
 		  uint32_t addpath_id, afi_t afi, safi_t safi, int type,
 		  int sub_type, struct prefix_rd *prd, mpls_label_t *label,
@@ -6486,13 +6649,139 @@ bool bgp_addpath_encode_rx(struct peer *peer, afi_t afi, safi_t safi)
 
 /* Parse NLRI stream.  Withdraw NLRI is recognized by NULL attr
    value. */
+/*
+ * Checks made once per UPDATE on whether its NLRI can be prefiltered, that
+ * is dropped without going through bgp_update().  Anything that needs to see
+ * filtered routes too, or that could let them through after all, turns it
+ * off.
+ */
+static bool bgp_update_prefilter(struct peer *peer, struct attr *attr,
+				 afi_t afi, safi_t safi)
+{
+	struct bgp *bgp = peer->bgp;
+
+	/* Adj-RIB-In and BMP record routes before filtering */
+	if (CHECK_FLAG(peer->af_flags[afi][safi], PEER_FLAG_SOFT_RECONFIG) ||
+	    hook_have_hooks(bgp_process))
+		return false;
+
+	/* accept-own, and the reason counted in the peer statistics */
+	if ((attr->flag & ATTR_FLAG_BIT(BGP_ATTR_ORIGINATOR_ID)) &&
+	    IPV4_ADDR_SAME(&bgp->router_id, &attr->originator_id))
+		return false;
+	if (bgp_cluster_filter(peer, attr))
+		return false;
+
+	return true;
+}
+
+/*
+ * Drops a route bgp_update() would filter, without allocating a RIB node for
+ * it.  Routes replacing one we hold from the peer still have to go through
+ * bgp_update() to be removed, as do the ones being debugged.
+ */
+static bool bgp_update_doomed(struct peer *peer, const struct prefix *p,
+			      uint32_t addpath_id, afi_t afi, safi_t safi,
+			      bool aspath_loop)
+{
+	struct bgp_dest *dest;
+	struct bgp_path_info *pi;
+
+	if (bgp_debug_update(peer, p, NULL, 1))
+		return false;
+
+	dest = bgp_node_lookup(peer->bgp->rib[afi][safi], p);
+	if (dest) {
+		for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
+			if (pi->peer == peer && pi->type == ZEBRA_ROUTE_BGP &&
+			    pi->sub_type == BGP_ROUTE_NORMAL &&
+			    pi->addpath_rx_id == addpath_id)
+				break;
+		bgp_dest_unlock_node(dest);
+		if (pi)
+			return false;
+	}
+
+	if (aspath_loop)
+		peer->stat_pfx_aspath_loop++;
+	else
+		peer->stat_pfx_filter++;
+
+	return true;
+}
+
+/*
+ * Hands a batch of parsed NLRI to bgp_update() or bgp_withdraw().  Updates
+ * go through the AS path loop checks and the inbound filters once per batch
+ * first, so the routes they reject never get a RIB node of their own, and
+ * bgp_update() takes the verdict for the others instead of filtering again.
+ */
+static int bgp_nlri_parse_ip_batch(struct peer *peer, struct attr *attr,
+				   afi_t afi, safi_t safi,
+				   const struct prefix *prefixes,
+				   const uint32_t *addpath_ids, size_t count)
+{
+	const struct prefix *batch[BGP_NLRI_PREFILTER_BATCH];
+	enum filter_type results[BGP_NLRI_PREFILTER_BATCH];
+	enum bgp_update_prefilter verdict;
+	bool prefilter = false, aspath_loop = false;
+	size_t i;
+
+	if (attr && count && bgp_update_prefilter(peer, attr, afi, safi)) {
+		prefilter = true;
+		aspath_loop = !!bgp_update_aspath_loop(peer, attr, afi, safi);
+		if (!aspath_loop) {
+			for (i = 0; i < count; i++)
+				batch[i] = &prefixes[i];
+			bgp_input_filter_batch(peer, batch, count, attr, afi,
+					       safi, results);
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		/*
+		 * Routes looping the AS path never got to the filters, when
+		 * not dropped here bgp_update() checks them all over again.
+		 */
+		verdict = BGP_UPDATE_PREFILTER_NONE;
+		if (prefilter && !aspath_loop)
+			verdict = results[i] == FILTER_PERMIT
+					  ? BGP_UPDATE_PREFILTER_PERMIT
+					  : BGP_UPDATE_PREFILTER_DENY;
+
+		/* Normal process. */
+		if (!attr)
+			bgp_withdraw(peer, &prefixes[i], addpath_ids[i], afi,
+				     safi, ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL,
+				     NULL, NULL, 0);
+		else if (!prefilter || verdict == BGP_UPDATE_PREFILTER_PERMIT ||
+			 !bgp_update_doomed(peer, &prefixes[i], addpath_ids[i],
+					    afi, safi, aspath_loop))
+			bgp_update_main(peer, &prefixes[i], addpath_ids[i],
+					attr, afi, safi, ZEBRA_ROUTE_BGP,
+					BGP_ROUTE_NORMAL, NULL, NULL, 0, 0,
+					NULL, verdict);
+
+		/* Do not send BGP notification twice when maximum-prefix count
+		 * overflow. */
+		if (CHECK_FLAG(peer->sflags, PEER_STATUS_PREFIX_OVERFLOW))
+			return BGP_NLRI_PARSE_ERROR_PREFIX_OVERFLOW;
+	}
+
+	return BGP_NLRI_PARSE_OK;
+}
+
 int bgp_nlri_parse_ip(struct peer *peer, struct attr *attr,
 		      struct bgp_nlri *packet)
 {
 	uint8_t *pnt;
 	uint8_t *lim;
+	struct prefix prefixes[BGP_NLRI_PREFILTER_BATCH];
+	uint32_t addpath_ids[BGP_NLRI_PREFILTER_BATCH];
 	struct prefix p;
+	size_t count = 0;
 	int psize;
+	int ret;
 	afi_t afi;
 	safi_t safi;
 	bool addpath_capable;
@@ -6509,14 +6798,25 @@ int bgp_nlri_parse_ip(struct peer *peer, struct attr *attr,
 	   syntactic validity.  If the field is syntactically incorrect,
 	   then the Error Subcode is set to Invalid Network Field. */
 	for (; pnt < lim; pnt += psize) {
+		if (count == BGP_NLRI_PREFILTER_BATCH) {
+			ret = bgp_nlri_parse_ip_batch(peer, attr, afi, safi,
+						      prefixes, addpath_ids,
+						      count);
+			if (ret != BGP_NLRI_PARSE_OK)
+				return ret;
+			count = 0;
+		}
+
 		/* Clear prefix structure. */
 		memset(&p, 0, sizeof(p));
 
 		if (addpath_capable) {
 
 			/* When packet overflow occurs return immediately. */
-			if (pnt + BGP_ADDPATH_ID_LEN >= lim)
-				return BGP_NLRI_PARSE_ERROR_PACKET_OVERFLOW;
+			if (pnt + BGP_ADDPATH_ID_LEN >= lim) {
+				ret = BGP_NLRI_PARSE_ERROR_PACKET_OVERFLOW;
+				goto error;
+			}
 
 			memcpy(&addpath_id, pnt, BGP_ADDPATH_ID_LEN);
 			addpath_id = ntohl(addpath_id);
@@ -6535,7 +6835,8 @@ int bgp_nlri_parse_ip(struct peer *peer, struct attr *attr,
 				EC_BGP_UPDATE_RCV,
 				"%s [Error] Update packet error (wrong prefix length %d for afi %u)",
 				peer->host, p.prefixlen, packet->afi);
-			return BGP_NLRI_PARSE_ERROR_PREFIX_LENGTH;
+			ret = BGP_NLRI_PARSE_ERROR_PREFIX_LENGTH;
+			goto error;
 		}
 
 		/* Packet size overflow check. */
@@ -6547,7 +6848,8 @@ int bgp_nlri_parse_ip(struct peer *peer, struct attr *attr,
 				EC_BGP_UPDATE_RCV,
 				"%s [Error] Update packet error (prefix length %d overflows packet)",
 				peer->host, p.prefixlen);
-			return BGP_NLRI_PARSE_ERROR_PACKET_OVERFLOW;
+			ret = BGP_NLRI_PARSE_ERROR_PACKET_OVERFLOW;
+			goto error;
 		}
 
 		/* Defensive coding, double-check the psize fits in a struct
@@ -6557,7 +6859,8 @@ int bgp_nlri_parse_ip(struct peer *peer, struct attr *attr,
 				EC_BGP_UPDATE_RCV,
 				"%s [Error] Update packet error (prefix length %d too large for prefix storage %zu)",
 				peer->host, p.prefixlen, sizeof(p.u.val));
-			return BGP_NLRI_PARSE_ERROR_PACKET_LENGTH;
+			ret = BGP_NLRI_PARSE_ERROR_PACKET_LENGTH;
+			goto error;
 		}
 
 		/* Fetch prefix from NLRI packet. */
@@ -6603,22 +6906,15 @@ int bgp_nlri_parse_ip(struct peer *peer, struct attr *attr,
 			}
 		}
 
-		/* Normal process. */
-		if (attr)
-			bgp_update(peer, &p, addpath_id, attr, afi, safi,
-				   ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL, NULL,
-				   NULL, 0, 0, NULL);
-		else
-			bgp_withdraw(peer, &p, addpath_id, afi, safi,
-				     ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL, NULL,
-				     NULL, 0);
-
-		/* Do not send BGP notification twice when maximum-prefix count
-		 * overflow. */
-		if (CHECK_FLAG(peer->sflags, PEER_STATUS_PREFIX_OVERFLOW))
-			return BGP_NLRI_PARSE_ERROR_PREFIX_OVERFLOW;
+		prefixes[count] = p;
+		addpath_ids[count++] = addpath_id;
 	}
 
+	ret = bgp_nlri_parse_ip_batch(peer, attr, afi, safi, prefixes,
+				      addpath_ids, count);
+	if (ret != BGP_NLRI_PARSE_OK)
+		return ret;
+
 	/* Packet length consistency check. */
 	if (pnt != lim) {
 		flog_err(
@@ -6629,6 +6925,14 @@ int bgp_nlri_parse_ip(struct peer *peer, struct attr *attr,
 	}
 
 	return BGP_NLRI_PARSE_OK;
+
+error:
+	/* The routes preceding the error in the packet still apply. */
+	if (bgp_nlri_parse_ip_batch(peer, attr, afi, safi, prefixes,
+				    addpath_ids, count) != BGP_NLRI_PARSE_OK)
+		return BGP_NLRI_PARSE_ERROR_PREFIX_OVERFLOW;
+
+	return ret;
 }
 
 static void bgp_nexthop_reachability_check(afi_t afi, safi_t safi,
@@ -6701,6 +7005,7 @@ void bgp_static_update(struct bgp *bgp, const struct prefix *p,
 #endif
 	uint8_t num_labels = 0;
 	struct bgp *bgp_nexthop = bgp;
+	struct bgp_path_info_extra_vrfleak *vrfleak;
 	struct bgp_labels labels = {};
 
 	assert(bgp_static);
@@ -6866,8 +7171,9 @@ void bgp_static_update(struct bgp *bgp, const struct prefix *p,
 						&pi->extra->labels->label[0]);
 			}
 #endif
-			if (pi->extra && pi->extra->vrfleak->bgp_orig)
-				bgp_nexthop = pi->extra->vrfleak->bgp_orig;
+			vrfleak = bgp_extra_vrfleak(pi->extra);
+			if (vrfleak && vrfleak->bgp_orig)
+				bgp_nexthop = vrfleak->bgp_orig;
 
 			bgp_nexthop_reachability_check(afi, safi, pi, p, dest,
 						       bgp, bgp_nexthop);
@@ -7600,10 +7906,9 @@ static bool aggr_suppress_map_test(struct bgp *bgp,
 static bool aggr_suppress_exists(struct bgp_aggregate *aggregate,
 				 struct bgp_path_info *pi)
 {
-	if (pi->extra == NULL || pi->extra->aggr_suppressors == NULL)
-		return false;
+	struct list *suppressors = bgp_extra_aggr_suppressors(pi->extra);
 
-	return listnode_lookup(pi->extra->aggr_suppressors, aggregate) != NULL;
+	return suppressors && listnode_lookup(suppressors, aggregate) != NULL;
 }
 
 /**
@@ -7615,6 +7920,7 @@ static bool aggr_suppress_path(struct bgp_aggregate *aggregate,
 			       struct bgp_path_info *pi)
 {
 	struct bgp_path_info_extra *pie;
+	struct list *suppressors;
 
 	/* Path is already suppressed by this aggregation. */
 	if (aggr_suppress_exists(aggregate, pi))
@@ -7623,13 +7929,18 @@ static bool aggr_suppress_path(struct bgp_aggregate *aggregate,
 	pie = bgp_path_info_extra_get(pi);
 
 	/* This is the first suppression, allocate memory and list it. */
-	if (pie->aggr_suppressors == NULL)
-		pie->aggr_suppressors = list_new();
+	suppressors = bgp_extra_aggr_suppressors(pie);
+	if (suppressors == NULL) {
+		suppressors = list_new();
+		bgp_path_info_extra_ext_set(pie,
+					    BGP_PATH_EXTRA_AGGR_SUPPRESSORS,
+					    suppressors);
+	}
 
-	listnode_add(pie->aggr_suppressors, aggregate);
+	listnode_add(suppressors, aggregate);
 
 	/* Only mark for processing if suppressed. */
-	if (listcount(pie->aggr_suppressors) == 1) {
+	if (listcount(suppressors) == 1) {
 		if (BGP_DEBUG(update, UPDATE_OUT))
 			zlog_debug("aggregate-address suppressing: %pFX",
 				   bgp_dest_get_prefix(pi->net));
@@ -7649,19 +7960,25 @@ static bool aggr_suppress_path(struct bgp_aggregate *aggregate,
 static bool aggr_unsuppress_path(struct bgp_aggregate *aggregate,
 				 struct bgp_path_info *pi)
 {
+	struct list *suppressors;
+
 	/* Path wasn't suppressed. */
 	if (!aggr_suppress_exists(aggregate, pi))
 		return false;
 
-	listnode_delete(pi->extra->aggr_suppressors, aggregate);
+	suppressors = bgp_extra_aggr_suppressors(pi->extra);
+	listnode_delete(suppressors, aggregate);
 
 	/* Unsuppress and free extra memory if last item. */
-	if (listcount(pi->extra->aggr_suppressors) == 0) {
+	if (listcount(suppressors) == 0) {
 		if (BGP_DEBUG(update, UPDATE_OUT))
 			zlog_debug("aggregate-address unsuppressing: %pFX",
 				   bgp_dest_get_prefix(pi->net));
 
-		list_delete(&pi->extra->aggr_suppressors);
+		list_delete(&suppressors);
+		bgp_path_info_extra_ext_set(pi->extra,
+					    BGP_PATH_EXTRA_AGGR_SUPPRESSORS,
+					    NULL);
 		bgp_path_info_set_flag(pi->net, pi, BGP_PATH_ATTR_CHANGED);
 		return true;
 	}
@@ -8203,8 +8520,7 @@ void bgp_aggregate_delete(struct bgp *bgp, const struct prefix *p, afi_t afi,
 			 * `aggr_unsuppress_path` will fail if this particular
 			 * aggregate route was not the suppressor.
 			 */
-			if (pi->extra && pi->extra->aggr_suppressors &&
-			    listcount(pi->extra->aggr_suppressors)) {
+			if (bgp_path_suppressed(pi)) {
 				if (aggr_unsuppress_path(aggregate, pi))
 					bgp_process(bgp, dest, pi, afi, safi);
 			}
@@ -9427,6 +9743,7 @@ void route_vty_out(struct vty *vty, const struct prefix *p,
 	bool nexthop_othervrf = false;
 	vrf_id_t nexthop_vrfid = VRF_DEFAULT;
 	const char *nexthop_vrfname = VRF_DEFAULT_NAME;
+	struct bgp_path_info_extra_vrfleak *vrfleak;
 	char *nexthop_hostname =
 		bgp_nexthop_hostname(path->peer, path->nexthop);
 	char esi_buf[ESI_STR_LEN];
@@ -9451,27 +9768,26 @@ void route_vty_out(struct vty *vty, const struct prefix *p,
 	 * If vrf id of nexthop is different from that of prefix,
 	 * set up printable string to append
 	 */
-	if (path->extra && path->extra->vrfleak &&
-	    path->extra->vrfleak->bgp_orig) {
+	vrfleak = bgp_extra_vrfleak(path->extra);
+	if (vrfleak && vrfleak->bgp_orig) {
 		const char *self = "";
 
 		if (nexthop_self)
 			self = "<";
 
 		nexthop_othervrf = true;
-		nexthop_vrfid = path->extra->vrfleak->bgp_orig->vrf_id;
+		nexthop_vrfid = vrfleak->bgp_orig->vrf_id;
 
-		if (path->extra->vrfleak->bgp_orig->vrf_id == VRF_UNKNOWN)
+		if (vrfleak->bgp_orig->vrf_id == VRF_UNKNOWN)
 			snprintf(vrf_id_str, sizeof(vrf_id_str),
 				"@%s%s", VRFID_NONE_STR, self);
 		else
 			snprintf(vrf_id_str, sizeof(vrf_id_str), "@%u%s",
-				 path->extra->vrfleak->bgp_orig->vrf_id, self);
+				 vrfleak->bgp_orig->vrf_id, self);
 
-		if (path->extra->vrfleak->bgp_orig->inst_type !=
-		    BGP_INSTANCE_TYPE_DEFAULT)
+		if (vrfleak->bgp_orig->inst_type != BGP_INSTANCE_TYPE_DEFAULT)
 
-			nexthop_vrfname = path->extra->vrfleak->bgp_orig->name;
+			nexthop_vrfname = vrfleak->bgp_orig->name;
 	} else {
 		const char *self = "";
 
@@ -10304,7 +10620,7 @@ static void flap_route_vty_out(struct vty *vty, const struct prefix *p,
 	if (use_json)
 		json_path = json_object_new_object();
 
-	bdi = path->extra->damp_info;
+	bdi = bgp_extra_damp_info(path->extra);
 
 	/* short status lead text */
 	route_vty_short_status_out(vty, path, p, json_path);
@@ -10523,6 +10839,8 @@ void route_vty_out_detail(struct vty *vty, struct bgp *bgp, struct bgp_dest *bn,
 	unsigned int first_as;
 	bool nexthop_self =
 		CHECK_FLAG(path->flags, BGP_PATH_ANNC_NH_SELF) ? true : false;
+	struct bgp_path_info_extra_vrfleak *vrfleak =
+		bgp_extra_vrfleak(path->extra);
 	int i;
 	char *nexthop_hostname =
 		bgp_nexthop_hostname(path->peer, path->nexthop);
@@ -10575,12 +10893,11 @@ void route_vty_out_detail(struct vty *vty, struct bgp *bgp, struct bgp_dest *bn,
 		vty_out(vty, "\n");
 
 
-	if (path->extra && path->extra->vrfleak && path->extra->vrfleak->parent) {
+	if (vrfleak && vrfleak->parent) {
 		struct bgp_path_info *parent_ri;
 		struct bgp_dest *dest, *pdest;
 
-		parent_ri =
-			(struct bgp_path_info *)path->extra->vrfleak->parent;
+		parent_ri = (struct bgp_path_info *)vrfleak->parent;
 		dest = parent_ri->net;
 		if (dest && dest->pdest) {
 			pdest = dest->pdest;
@@ -10920,18 +11237,17 @@ void route_vty_out_detail(struct vty *vty, struct bgp *bgp, struct bgp_dest *bn,
 	/*
 	 * Note when vrfid of nexthop is different from that of prefix
 	 */
-	if (path->extra && path->extra->vrfleak &&
-	    path->extra->vrfleak->bgp_orig) {
-		vrf_id_t nexthop_vrfid = path->extra->vrfleak->bgp_orig->vrf_id;
+	if (vrfleak && vrfleak->bgp_orig) {
+		vrf_id_t nexthop_vrfid = vrfleak->bgp_orig->vrf_id;
 
 		if (json_paths) {
 			const char *vn;
 
-			if (path->extra->vrfleak->bgp_orig->inst_type ==
+			if (vrfleak->bgp_orig->inst_type ==
 			    BGP_INSTANCE_TYPE_DEFAULT)
 				vn = VRF_DEFAULT_NAME;
 			else
-				vn = path->extra->vrfleak->bgp_orig->name;
+				vn = vrfleak->bgp_orig->name;
 
 			json_object_string_add(json_path, "nhVrfName", vn);
 
@@ -11337,7 +11653,7 @@ void route_vty_out_detail(struct vty *vty, struct bgp *bgp, struct bgp_dest *bn,
 			vty_out(vty, "\n");
 	}
 
-	if (path->extra && path->extra->damp_info)
+	if (bgp_extra_damp_info(path->extra))
 		bgp_damp_info_vty(vty, bgp, path, afi, safi, json_path);
 
 	/* Remote Label */
@@ -11554,15 +11870,26 @@ static int bgp_show_community(struct vty *vty, struct bgp *bgp,
 			      const char *comstr, int exact, afi_t afi,
 			      safi_t safi, uint16_t show_flags);
 
+/* Dests looked at per step when streaming a table, see bgp_show_stream() */
+#define BGP_SHOW_STREAM_CHUNK 2000
+
+/*
+ * If resume is given the table is shown in steps: the walk starts at
+ * *resume (or the top of the table) and stops after BGP_SHOW_STREAM_CHUNK
+ * dests, leaving the locked dest to continue from in *resume and
+ * returning CMD_SUSPEND. output_cum and total_cum must be given then.
+ */
 static int bgp_show_table(struct vty *vty, struct bgp *bgp, afi_t afi, safi_t safi,
 			  struct bgp_table *table, enum bgp_show_type type,
 			  void *output_arg, const char *rd, int is_last,
 			  unsigned long *output_cum, unsigned long *total_cum,
 			  unsigned long *json_header_depth, uint16_t show_flags,
-			  enum rpki_states rpki_target_state)
+			  enum rpki_states rpki_target_state,
+			  struct bgp_dest **resume)
 {
 	struct bgp_path_info *pi;
 	struct bgp_dest *dest;
+	unsigned int visited = 0;
 	bool header = true;
 	bool json_detail_header = false;
 	int display;
@@ -11625,11 +11952,26 @@ static int bgp_show_table(struct vty *vty, struct bgp *bgp, afi_t afi, safi_t sa
 		json_detail_header = true;
 
 	/* Start processing of routes. */
-	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
+	dest = NULL;
+	if (resume) {
+		dest = *resume;
+		*resume = NULL;
+		if (*output_cum)
+			first = 0;
+	}
+	if (!dest)
+		dest = bgp_table_top(table);
+
+	for (; dest; dest = bgp_route_next(dest)) {
 		const struct prefix *dest_p = bgp_dest_get_prefix(dest);
 		enum rpki_states rpki_curr_state = RPKI_NOT_BEING_USED;
 		bool json_detail_header_used = false;
 
+		if (resume && ++visited > BGP_SHOW_STREAM_CHUNK) {
+			*resume = dest;
+			break;
+		}
+
 		pi = bgp_dest_get_bgp_path_info(dest);
 		if (pi == NULL)
 			continue;
@@ -11716,7 +12058,7 @@ static int bgp_show_table(struct vty *vty, struct bgp *bgp, afi_t afi, safi_t sa
 			    || type == bgp_show_type_flap_neighbor
 			    || type == bgp_show_type_dampend_paths
 			    || type == bgp_show_type_damp_neighbor) {
-				if (!(pi->extra && pi->extra->damp_info))
+				if (!(bgp_extra_damp_info(pi->extra)))
 					continue;
 			}
 			if (type == bgp_show_type_regexp) {
@@ -12048,6 +12390,9 @@ static int bgp_show_table(struct vty *vty, struct bgp *bgp, afi_t afi, safi_t sa
 		total_count += *total_cum;
 		*total_cum = total_count;
 	}
+	if (resume && *resume)
+		return CMD_SUSPEND;
+
 	if (use_json) {
 		if (rd) {
 			vty_out(vty, " }%s ", (is_last ? "" : ","));
@@ -12109,7 +12454,7 @@ int bgp_show_table_rd(struct vty *vty, struct bgp *bgp, afi_t afi, safi_t safi,
 			bgp_show_table(vty, bgp, afi, safi, itable, type, output_arg,
 				       rd, next == NULL, &output_cum,
 				       &total_cum, &json_header_depth,
-				       show_flags, RPKI_NOT_BEING_USED);
+				       show_flags, RPKI_NOT_BEING_USED, NULL);
 			if (next == NULL)
 				show_msg = false;
 		}
@@ -12171,7 +12516,88 @@ static int bgp_show(struct vty *vty, struct bgp *bgp, afi_t afi, safi_t safi,
 
 	return bgp_show_table(vty, bgp, afi, safi, table, type, output_arg, NULL, 1,
 			      NULL, NULL, &json_header_depth, show_flags,
-			      rpki_target_state);
+			      rpki_target_state, NULL);
+}
+
+/* State of a "show bgp" table dump that is streamed to the vty */
+struct bgp_show_stream {
+	struct bgp *bgp;
+	struct bgp_table *table;
+	afi_t afi;
+	safi_t safi;
+	enum bgp_show_type type;
+	uint16_t show_flags;
+	enum rpki_states rpki_target_state;
+
+	struct bgp_dest *dest;
+	unsigned long output_cum;
+	unsigned long total_cum;
+	unsigned long json_header_depth;
+};
+
+static int bgp_show_stream_step(struct vty *vty, void *arg)
+{
+	struct bgp_show_stream *stream = arg;
+
+	return bgp_show_table(vty, stream->bgp, stream->afi, stream->safi,
+			      stream->table, stream->type, NULL, NULL, 1,
+			      &stream->output_cum, &stream->total_cum,
+			      &stream->json_header_depth, stream->show_flags,
+			      stream->rpki_target_state, &stream->dest);
+}
+
+static void bgp_show_stream_free(void *arg)
+{
+	struct bgp_show_stream *stream = arg;
+
+	if (stream->dest)
+		bgp_dest_unlock_node(stream->dest);
+	bgp_table_unlock(stream->table);
+	bgp_unlock(stream->bgp);
+	XFREE(MTYPE_BGP_SHOW_STREAM, stream);
+}
+
+/*
+ * Same as bgp_show(), but a large table does not hold up bgpd until all of
+ * it is printed: the table is walked a chunk at a time with the event loop
+ * running in between, and only as fast as the vtysh client reads. Each
+ * prefix is still printed on its own, so memory use does not grow with the
+ * table either.
+ *
+ * The bgp instance and table are locked for the duration. Show types
+ * taking an output_arg and tables with their own show code are printed
+ * in one go.
+ */
+static int bgp_show_stream(struct vty *vty, struct bgp *bgp, afi_t afi,
+			   safi_t safi, enum bgp_show_type type,
+			   void *output_arg, uint16_t show_flags,
+			   enum rpki_states rpki_target_state)
+{
+	struct bgp_show_stream *stream;
+
+	if (bgp == NULL)
+		bgp = bgp_get_default();
+
+	if (safi == SAFI_LABELED_UNICAST)
+		safi = SAFI_UNICAST;
+
+	if (bgp == NULL || output_arg || safi == SAFI_MPLS_VPN ||
+	    safi == SAFI_EVPN || safi == SAFI_FLOWSPEC)
+		return bgp_show(vty, bgp, afi, safi, type, output_arg,
+				show_flags, rpki_target_state);
+
+	stream = XCALLOC(MTYPE_BGP_SHOW_STREAM, sizeof(*stream));
+	stream->bgp = bgp_lock(bgp);
+	stream->table = bgp->rib[afi][safi];
+	bgp_table_lock(stream->table);
+	stream->afi = afi;
+	stream->safi = safi;
+	stream->type = type;
+	stream->show_flags = show_flags;
+	stream->rpki_target_state = rpki_target_state;
+
+	return vty_stream_output(vty, bgp_show_stream_step, stream,
+				 bgp_show_stream_free);
 }
 
 static void bgp_show_all_instances_routes_vty(struct vty *vty, afi_t afi,
@@ -13336,9 +13762,9 @@ DEFPY(show_ip_bgp, show_ip_bgp_cmd,
 						  exact_match, afi, safi,
 						  show_flags);
 		else
-			return bgp_show(vty, bgp, afi, safi, sh_type,
-					output_arg, show_flags,
-					rpki_target_state);
+			return bgp_show_stream(vty, bgp, afi, safi, sh_type,
+					       output_arg, show_flags,
+					       rpki_target_state);
 	} else {
 		struct listnode *node;
 		struct bgp *abgp;
@@ -15846,6 +16272,7 @@ static int bgp_clear_damp_route(struct vty *vty, const char *view_name,
 	struct bgp_dest *rm;
 	struct bgp_path_info *pi;
 	struct bgp_path_info *pi_temp;
+	struct bgp_damp_info *bdi;
 	struct bgp *bgp;
 	struct bgp_table *table;
 
@@ -15895,10 +16322,10 @@ static int bgp_clear_damp_route(struct vty *vty, const char *view_name,
 			    || rm_p->prefixlen == match.prefixlen) {
 				pi = bgp_dest_get_bgp_path_info(rm);
 				while (pi) {
-					if (pi->extra && pi->extra->damp_info) {
+					bdi = bgp_extra_damp_info(pi->extra);
+					if (bdi) {
 						pi_temp = pi->next;
-						bgp_damp_info_free(pi->extra->damp_info,
-								   NULL, 1);
+						bgp_damp_info_free(bdi, 1);
 						pi = pi_temp;
 					} else
 						pi = pi->next;
@@ -15919,24 +16346,24 @@ static int bgp_clear_damp_route(struct vty *vty, const char *view_name,
 
 		pi = bgp_dest_get_bgp_path_info(dest);
 		while (pi) {
-			if (!(pi->extra && pi->extra->damp_info)) {
+			bdi = bgp_extra_damp_info(pi->extra);
+			if (!bdi) {
 				pi = pi->next;
 				continue;
 			}
 
 			pi_temp = pi->next;
-			struct bgp_damp_info *bdi = pi->extra->damp_info;
 
 			if (bdi->lastrecord != BGP_RECORD_UPDATE)
 				continue;
 
 			bgp_aggregate_increment(bgp,
-						bgp_dest_get_prefix(bdi->dest),
+						bgp_dest_get_prefix(dest),
 						bdi->path, bdi->afi, bdi->safi);
-			bgp_process(bgp, bdi->dest, bdi->path, bdi->afi,
+			bgp_process(bgp, dest, bdi->path, bdi->afi,
 				    bdi->safi);
 
-			bgp_damp_info_free(pi->extra->damp_info, NULL, 1);
+			bgp_damp_info_free(bdi, 1);
 			pi = pi_temp;
 		}
 
@@ -217,39 +217,96 @@ struct bgp_path_info_extra_vnc {
 };
 #endif
 
+struct bgp_damp_info;
+struct list;
+
+/* Sub-extensions of struct bgp_path_info_extra, allocated on demand. */
+enum bgp_path_info_extra_ext {
+	BGP_PATH_EXTRA_DAMP_INFO,	 /* bgp_damp_info */
+	BGP_PATH_EXTRA_AGGR_SUPPRESSORS, /* list of aggregates */
+	BGP_PATH_EXTRA_EVPN,		 /* bgp_path_info_extra_evpn */
+	BGP_PATH_EXTRA_FLOWSPEC,	 /* bgp_path_info_extra_fs */
+	BGP_PATH_EXTRA_VRFLEAK,		 /* bgp_path_info_extra_vrfleak */
+	BGP_PATH_EXTRA_VNC,		 /* bgp_path_info_extra_vnc */
+};
+
 /* Ancillary information to struct bgp_path_info,
  * used for uncommonly used data (aggregation, MPLS, etc.)
  * and lazily allocated to save memory.
+ *
+ * Only what most paths carrying an extra need (labels, the IGP metric) is
+ * held inline.  The per-feature sub-extensions are kept in ext[], which has
+ * a slot for each bit set in ext_present, in bgp_path_info_extra_ext order.
+ * Use the bgp_extra_*() accessors to get at them.
  */
 struct bgp_path_info_extra {
-	/* Pointer to dampening structure.  */
-	struct bgp_damp_info *damp_info;
-
-	/** List of aggregations that suppress this path. */
-	struct list *aggr_suppressors;
-
 	/* Nexthop reachability check.  */
 	uint32_t igpmetric;
 
+	/* Sub-extensions present in ext[] */
+	uint8_t ext_present;
+
 	/* MPLS label(s) - VNI(s) for EVPN-VxLAN  */
 	struct bgp_labels *labels;
 
 	/* timestamp of the rib installation */
 	time_t bgp_rib_uptime;
 
-	/*For EVPN*/
-	struct bgp_path_info_extra_evpn *evpn;
+	void **ext;
+};
 
-#ifdef ENABLE_BGP_VNC
-	struct bgp_path_info_extra_vnc *vnc;
-#endif
+static inline void *
+bgp_path_info_extra_ext_get(const struct bgp_path_info_extra *e,
+			    enum bgp_path_info_extra_ext ext)
+{
+	if (!e || !CHECK_FLAG(e->ext_present, 1U << ext))
+		return NULL;
 
-	/* For flowspec*/
-	struct bgp_path_info_extra_fs *flowspec;
+	return e->ext[__builtin_popcount(e->ext_present & ((1U << ext) - 1))];
+}
 
-	/* For vrf leaking*/
-	struct bgp_path_info_extra_vrfleak *vrfleak;
-};
+/* Stores data as the given sub-extension, NULL drops it. */
+extern void bgp_path_info_extra_ext_set(struct bgp_path_info_extra *e,
+					enum bgp_path_info_extra_ext ext,
+					void *data);
+
+static inline struct bgp_damp_info *
+bgp_extra_damp_info(const struct bgp_path_info_extra *e)
+{
+	return bgp_path_info_extra_ext_get(e, BGP_PATH_EXTRA_DAMP_INFO);
+}
+
+static inline struct list *
+bgp_extra_aggr_suppressors(const struct bgp_path_info_extra *e)
+{
+	return bgp_path_info_extra_ext_get(e, BGP_PATH_EXTRA_AGGR_SUPPRESSORS);
+}
+
+static inline struct bgp_path_info_extra_evpn *
+bgp_extra_evpn(const struct bgp_path_info_extra *e)
+{
+	return bgp_path_info_extra_ext_get(e, BGP_PATH_EXTRA_EVPN);
+}
+
+static inline struct bgp_path_info_extra_fs *
+bgp_extra_flowspec(const struct bgp_path_info_extra *e)
+{
+	return bgp_path_info_extra_ext_get(e, BGP_PATH_EXTRA_FLOWSPEC);
+}
+
+static inline struct bgp_path_info_extra_vrfleak *
+bgp_extra_vrfleak(const struct bgp_path_info_extra *e)
+{
+	return bgp_path_info_extra_ext_get(e, BGP_PATH_EXTRA_VRFLEAK);
+}
+
+#ifdef ENABLE_BGP_VNC
+static inline struct bgp_path_info_extra_vnc *
+bgp_extra_vnc(const struct bgp_path_info_extra *e)
+{
+	return bgp_path_info_extra_ext_get(e, BGP_PATH_EXTRA_VNC);
+}
+#endif
 
 struct bgp_mplsvpn_label_nh {
 	/* For nexthop per label linked list */
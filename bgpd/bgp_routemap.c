@@ -1303,6 +1303,7 @@ route_match_vrl_source_vrf(void *rule, const struct prefix *prefix,
 			   void *object)
 {
 	struct bgp_path_info *path;
+	struct bgp_path_info_extra_vrfleak *vrfleak;
 	char *vrf_name;
 
 	vrf_name = rule;
@@ -1311,12 +1312,11 @@ route_match_vrl_source_vrf(void *rule, const struct prefix *prefix,
 	if (strncmp(vrf_name, "n/a", VRF_NAMSIZ) == 0)
 		return RMAP_NOMATCH;
 
-	if (path->extra == NULL || path->extra->vrfleak == NULL ||
-	    path->extra->vrfleak->bgp_orig == NULL)
+	vrfleak = bgp_extra_vrfleak(path->extra);
+	if (vrfleak == NULL || vrfleak->bgp_orig == NULL)
 		return RMAP_NOMATCH;
 
-	if (strncmp(vrf_name,
-		    vrf_id_to_name(path->extra->vrfleak->bgp_orig->vrf_id),
+	if (strncmp(vrf_name, vrf_id_to_name(vrfleak->bgp_orig->vrf_id),
 		    VRF_NAMSIZ) == 0)
 		return RMAP_MATCH;
 
@@ -25,6 +25,7 @@
 #include "memory.h"
 #include "frrevent.h"
 #include "filter.h"
+#include "table.h"
 #include "lib_errors.h"
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_table.h"
@@ -51,6 +52,7 @@ DEFINE_MTYPE_STATIC(BGPD, BGP_RPKI_CACHE, "BGP RPKI Cache server");
 DEFINE_MTYPE_STATIC(BGPD, BGP_RPKI_CACHE_GROUP, "BGP RPKI Cache server group");
 DEFINE_MTYPE_STATIC(BGPD, BGP_RPKI_RTRLIB, "BGP RPKI RTRLib");
 DEFINE_MTYPE_STATIC(BGPD, BGP_RPKI_REVALIDATE, "BGP RPKI Revalidation");
+DEFINE_MTYPE_STATIC(BGPD, BGP_RPKI_VRP, "BGP RPKI local VRP");
 
 #define STR_SEPARATOR 10
 
@@ -66,6 +68,11 @@ DEFINE_MTYPE_STATIC(BGPD, BGP_RPKI_REVALIDATE, "BGP RPKI Revalidation");
 
 #define RPKI_OUTPUT_STRING "Control rpki specific settings\n"
 
+/* VRP changes read from the sync socket per callback */
+#define RPKI_SYNC_READ_MAX 1024
+/* routes revalidated per event before yielding */
+#define RPKI_REVALIDATE_SLICE 10000
+
 struct cache {
 	enum {
 		TCP,
@@ -93,6 +100,27 @@ struct rpki_for_each_record_arg {
 	enum asnotation_mode asnotation;
 };
 
+/*
+ * bgpd's own copy of the VRPs, so that origin validation from the main
+ * pthread does not need to go through rtrlib and its locks.  Kept in a
+ * route_table per AFI indexed by the VRP prefix (at its minimum length),
+ * fed from the sync socket.
+ */
+struct rpki_vrp {
+	struct rpki_vrp *next;
+
+	/* rtr_socket the VRP was learnt on, only used for comparison */
+	const void *socket;
+	as_t asn;
+	uint8_t max_len;
+};
+
+/* what rpki_update_cb_sync_rtr() sends to the main pthread */
+struct rpki_vrp_update {
+	struct pfx_record rec;
+	bool added;
+};
+
 struct rpki_vrf {
 	struct rtr_mgr_config *rtr_config;
 	struct list *cache_list;
@@ -108,6 +136,11 @@ struct rpki_vrf {
 	char *vrfname;
 	struct event *t_rpki_sync;
 
+	struct route_table *vrp_table[AFI_MAX];
+	/* prefixes covered by changed VRPs, still to be revalidated */
+	struct route_table *revalidate_table[AFI_MAX];
+	struct event *t_revalidate;
+
 	QOBJ_FIELDS;
 };
 
@@ -235,14 +268,6 @@ static void ipv6_addr_to_network_byte_order(const uint32_t *src, uint32_t *dest)
 		dest[i] = htonl(src[i]);
 }
 
-static void ipv6_addr_to_host_byte_order(const uint32_t *src, uint32_t *dest)
-{
-	int i;
-
-	for (i = 0; i < 4; i++)
-		dest[i] = ntohl(src[i]);
-}
-
 static enum route_map_cmd_result_t route_match(void *rule,
 					       const struct prefix *prefix,
 					       void *object)
@@ -543,7 +568,7 @@ inline bool is_stopping(struct rpki_vrf *rpki_vrf)
 	return rpki_vrf->rtr_is_stopping;
 }
 
-static void pfx_record_to_prefix(struct pfx_record *record,
+static void pfx_record_to_prefix(const struct pfx_record *record,
 				 struct prefix *prefix)
 {
 	prefix->prefixlen = record->min_len;
@@ -558,101 +583,321 @@ static void pfx_record_to_prefix(struct pfx_record *record,
 	}
 }
 
-struct rpki_revalidate_prefix {
-	struct bgp *bgp;
+static void rpki_vrp_update(struct rpki_vrf *rpki_vrf,
+			    const struct pfx_record *rec, bool added)
+{
+	struct route_table *table;
+	struct route_node *rn;
+	struct rpki_vrp *vrp, **vrpp;
 	struct prefix prefix;
 	afi_t afi;
-	safi_t safi;
-};
 
-static void rpki_revalidate_prefix(struct event *thread)
-{
-	struct rpki_revalidate_prefix *rrp = EVENT_ARG(thread);
-	struct bgp_dest *match, *node;
+	pfx_record_to_prefix(rec, &prefix);
+	apply_mask(&prefix);
+	afi = family2afi(prefix.family);
 
-	match = bgp_table_subtree_lookup(rrp->bgp->rib[rrp->afi][rrp->safi],
-					 &rrp->prefix);
+	if (!rpki_vrf->vrp_table[afi])
+		rpki_vrf->vrp_table[afi] = route_table_init();
+	table = rpki_vrf->vrp_table[afi];
 
-	node = match;
+	if (added)
+		rn = route_node_get(table, &prefix);
+	else
+		rn = route_node_lookup(table, &prefix);
+	if (!rn)
+		return;
+
+	for (vrpp = (struct rpki_vrp **)&rn->info; *vrpp;
+	     vrpp = &(*vrpp)->next) {
+		vrp = *vrpp;
+		if (vrp->asn == rec->asn && vrp->max_len == rec->max_len &&
+		    vrp->socket == rec->socket)
+			break;
+	}
+
+	if (added && !*vrpp) {
+		vrp = XCALLOC(MTYPE_BGP_RPKI_VRP, sizeof(*vrp));
+		vrp->socket = rec->socket;
+		vrp->asn = rec->asn;
+		vrp->max_len = rec->max_len;
+		*vrpp = vrp;
+		/* the lock from route_node_get() stays with the VRP */
+		return;
+	}
+
+	if (!added && *vrpp) {
+		vrp = *vrpp;
+		*vrpp = vrp->next;
+		XFREE(MTYPE_BGP_RPKI_VRP, vrp);
+		/* release the lock held for the VRP */
+		route_unlock_node(rn);
+	}
 
-	while (node) {
-		if (bgp_dest_has_bgp_path_info_data(node)) {
-			revalidate_bgp_node(node, rrp->afi, rrp->safi);
+	route_unlock_node(rn);
+}
+
+static void rpki_vrp_flush(struct rpki_vrf *rpki_vrf)
+{
+	struct route_node *rn;
+	struct rpki_vrp *vrp;
+	afi_t afi;
+
+	for (afi = AFI_IP; afi < AFI_MAX; afi++) {
+		if (!rpki_vrf->vrp_table[afi])
+			continue;
+
+		for (rn = route_top(rpki_vrf->vrp_table[afi]); rn;
+		     rn = route_next(rn)) {
+			while ((vrp = rn->info)) {
+				rn->info = vrp->next;
+				XFREE(MTYPE_BGP_RPKI_VRP, vrp);
+				route_unlock_node(rn);
+			}
 		}
+	}
+}
 
-		node = bgp_route_next_until(node, match);
+static void rpki_vrp_reload_cb(const struct pfx_record *record, void *data)
+{
+	rpki_vrp_update(data, record, true);
+}
+
+/* Rebuild the local VRP copy from rtrlib, after updates were lost */
+static void rpki_vrp_reload(struct rpki_vrf *rpki_vrf)
+{
+	struct rtr_mgr_group *group;
+	struct pfx_table *pfx_table;
+
+	rpki_vrp_flush(rpki_vrf);
+
+	if (!is_running(rpki_vrf))
+		return;
+
+	group = get_connected_group(rpki_vrf);
+	if (!group)
+		return;
+
+	pfx_table = group->sockets[0]->pfx_table;
+	pfx_table_for_each_ipv4_record(pfx_table, rpki_vrp_reload_cb, rpki_vrf);
+	pfx_table_for_each_ipv6_record(pfx_table, rpki_vrp_reload_cb, rpki_vrf);
+}
+
+/*
+ * RFC 6811 origin validation against the local VRP copy: every VRP
+ * covering the prefix is a candidate, one with a matching origin and
+ * a sufficient maximum length makes it valid.
+ */
+static enum pfxv_state rpki_vrp_validate(struct rpki_vrf *rpki_vrf,
+					 as_t asn, const struct prefix *prefix)
+{
+	struct route_table *table;
+	struct route_node *match, *rn;
+	struct rpki_vrp *vrp;
+	enum pfxv_state result = BGP_PFXV_STATE_NOT_FOUND;
+
+	table = rpki_vrf->vrp_table[family2afi(prefix->family)];
+	if (!table)
+		return BGP_PFXV_STATE_NOT_FOUND;
+
+	match = route_node_match(table, prefix);
+	if (!match)
+		return BGP_PFXV_STATE_NOT_FOUND;
+
+	for (rn = match; rn; rn = rn->parent) {
+		for (vrp = rn->info; vrp; vrp = vrp->next) {
+			if (vrp->asn == asn && prefix->prefixlen <= vrp->max_len) {
+				result = BGP_PFXV_STATE_VALID;
+				goto out;
+			}
+			result = BGP_PFXV_STATE_INVALID;
+		}
 	}
 
-	XFREE(MTYPE_BGP_RPKI_REVALIDATE, rrp);
+out:
+	route_unlock_node(match);
+	return result;
 }
 
-static void bgpd_sync_callback(struct event *thread)
+/*
+ * Note that routes under prefix need revalidating.  Prefixes already
+ * covered by a pending one are not added again.
+ */
+static void rpki_revalidate_add(struct rpki_vrf *rpki_vrf,
+				const struct pfx_record *rec)
 {
-	struct bgp *bgp;
-	struct listnode *node;
+	struct route_table *table;
+	struct route_node *rn;
 	struct prefix prefix;
-	struct pfx_record rec;
-	struct rpki_vrf *rpki_vrf = EVENT_ARG(thread);
-	struct vrf *vrf = NULL;
+	afi_t afi;
 
-	event_add_read(bm->master, bgpd_sync_callback, rpki_vrf,
-		       rpki_vrf->rpki_sync_socket_bgpd, NULL);
+	pfx_record_to_prefix(rec, &prefix);
+	apply_mask(&prefix);
+	afi = family2afi(prefix.family);
 
-	if (atomic_load_explicit(&rpki_vrf->rtr_update_overflow,
-				 memory_order_seq_cst)) {
-		while (read(rpki_vrf->rpki_sync_socket_bgpd, &rec,
-			    sizeof(struct pfx_record)) != -1)
-			;
+	if (!rpki_vrf->revalidate_table[afi])
+		rpki_vrf->revalidate_table[afi] = route_table_init();
+	table = rpki_vrf->revalidate_table[afi];
 
-		atomic_store_explicit(&rpki_vrf->rtr_update_overflow, 0,
-				      memory_order_seq_cst);
-		revalidate_all_routes(rpki_vrf);
+	rn = route_node_match(table, &prefix);
+	if (rn) {
+		route_unlock_node(rn);
 		return;
 	}
 
-	int retval = read(rpki_vrf->rpki_sync_socket_bgpd, &rec,
-			  sizeof(struct pfx_record));
-	if (retval != sizeof(struct pfx_record)) {
-		RPKI_DEBUG("Could not read from rpki_sync_socket_bgpd");
-		return;
+	/* the lock is kept until the prefix is revalidated */
+	rn = route_node_get(table, &prefix);
+	rn->info = rpki_vrf;
+}
+
+static void rpki_revalidate_flush(struct rpki_vrf *rpki_vrf)
+{
+	struct route_node *rn;
+	afi_t afi;
+
+	EVENT_OFF(rpki_vrf->t_revalidate);
+
+	for (afi = AFI_IP; afi < AFI_MAX; afi++) {
+		if (!rpki_vrf->revalidate_table[afi])
+			continue;
+
+		for (rn = route_top(rpki_vrf->revalidate_table[afi]); rn;
+		     rn = route_next(rn)) {
+			if (!rn->info)
+				continue;
+			rn->info = NULL;
+			route_unlock_node(rn);
+		}
 	}
-	pfx_record_to_prefix(&rec, &prefix);
+}
 
-	afi_t afi = (rec.prefix.ver == LRTR_IPV4) ? AFI_IP : AFI_IP6;
+static bool rpki_vrf_has_bgp(struct rpki_vrf *rpki_vrf, struct bgp *bgp)
+{
+	struct vrf *vrf = NULL;
 
 	if (rpki_vrf->vrfname) {
 		vrf = vrf_lookup_by_name(rpki_vrf->vrfname);
-		if (!vrf) {
-			zlog_err("%s(): vrf for rpki %s not found", __func__,
-				 rpki_vrf->vrfname);
-			return;
-		}
+		if (!vrf)
+			return false;
 	}
 
-	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp)) {
-		safi_t safi;
+	if (!vrf)
+		return bgp->vrf_id == VRF_DEFAULT;
+	return bgp->vrf_id == vrf->vrf_id;
+}
 
-		if (!vrf && bgp->vrf_id != VRF_DEFAULT)
-			continue;
-		if (vrf && bgp->vrf_id != vrf->vrf_id)
+/* Revalidate the routes under prefix, returns how many were looked at */
+static unsigned int rpki_revalidate_prefix(struct rpki_vrf *rpki_vrf,
+					   afi_t afi,
+					   const struct prefix *prefix)
+{
+	struct bgp *bgp;
+	struct listnode *node;
+	struct bgp_dest *match, *dest;
+	unsigned int count = 0;
+	safi_t safi;
+
+	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp)) {
+		if (!rpki_vrf_has_bgp(rpki_vrf, bgp))
 			continue;
 
 		for (safi = SAFI_UNICAST; safi < SAFI_MAX; safi++) {
-			struct bgp_table *table = bgp->rib[afi][safi];
-			struct rpki_revalidate_prefix *rrp;
+			if (!bgp->rib[afi][safi])
+				continue;
+
+			match = bgp_table_subtree_lookup(bgp->rib[afi][safi],
+							 prefix);
+			dest = match;
+
+			while (dest) {
+				if (bgp_dest_has_bgp_path_info_data(dest)) {
+					revalidate_bgp_node(dest, afi, safi);
+					count++;
+				}
+
+				dest = bgp_route_next_until(dest, match);
+			}
+		}
+	}
+
+	return count;
+}
+
+/*
+ * Work through the prefixes touched by VRP changes.  Each event handles
+ * pending prefixes until about RPKI_REVALIDATE_SLICE routes have been
+ * revalidated, so a burst of updates from the cache does not hold up
+ * the rest of bgpd.
+ */
+static void rpki_revalidate_pending(struct event *thread)
+{
+	struct rpki_vrf *rpki_vrf = EVENT_ARG(thread);
+	struct route_node *rn = NULL;
+	unsigned int count = 0;
+	afi_t afi;
 
-			if (!table)
+	for (afi = AFI_IP; afi < AFI_MAX; afi++) {
+		if (!rpki_vrf->revalidate_table[afi])
+			continue;
+
+		for (rn = route_top(rpki_vrf->revalidate_table[afi]);
+		     rn && count < RPKI_REVALIDATE_SLICE; rn = route_next(rn)) {
+			if (!rn->info)
 				continue;
 
-			rrp = XCALLOC(MTYPE_BGP_RPKI_REVALIDATE, sizeof(*rrp));
-			rrp->bgp = bgp;
-			rrp->prefix = prefix;
-			rrp->afi = afi;
-			rrp->safi = safi;
-			event_add_event(bm->master, rpki_revalidate_prefix, rrp,
-					0, &bgp->t_revalidate[afi][safi]);
+			rn->info = NULL;
+			route_unlock_node(rn);
+
+			count += rpki_revalidate_prefix(rpki_vrf, afi, &rn->p);
+		}
+
+		if (rn) {
+			route_unlock_node(rn);
+			event_add_event(bm->master, rpki_revalidate_pending,
+					rpki_vrf, 0, &rpki_vrf->t_revalidate);
+			return;
+		}
+	}
+}
+
+static void bgpd_sync_callback(struct event *thread)
+{
+	struct rpki_vrf *rpki_vrf = EVENT_ARG(thread);
+	struct rpki_vrp_update upd;
+	unsigned int i;
+	ssize_t retval;
+
+	event_add_read(bm->master, bgpd_sync_callback, rpki_vrf,
+		       rpki_vrf->rpki_sync_socket_bgpd, NULL);
+
+	if (atomic_load_explicit(&rpki_vrf->rtr_update_overflow,
+				 memory_order_seq_cst)) {
+		while (read(rpki_vrf->rpki_sync_socket_bgpd, &upd,
+			    sizeof(upd)) != -1)
+			;
+
+		atomic_store_explicit(&rpki_vrf->rtr_update_overflow, 0,
+				      memory_order_seq_cst);
+		rpki_revalidate_flush(rpki_vrf);
+		rpki_vrp_reload(rpki_vrf);
+		revalidate_all_routes(rpki_vrf);
+		return;
+	}
+
+	for (i = 0; i < RPKI_SYNC_READ_MAX; i++) {
+		retval = read(rpki_vrf->rpki_sync_socket_bgpd, &upd,
+			      sizeof(upd));
+		if (retval != sizeof(upd)) {
+			if (retval != -1 || !ERRNO_IO_RETRY(errno))
+				RPKI_DEBUG("Could not read from rpki_sync_socket_bgpd");
+			break;
 		}
+
+		rpki_vrp_update(rpki_vrf, &upd.rec, upd.added);
+		rpki_revalidate_add(rpki_vrf, &upd.rec);
 	}
+
+	event_add_event(bm->master, rpki_revalidate_pending, rpki_vrf, 0,
+			&rpki_vrf->t_revalidate);
 }
 
 static void revalidate_bgp_node(struct bgp_dest *bgp_dest, afi_t afi,
@@ -755,8 +1000,9 @@ static void revalidate_all_routes(struct rpki_vrf *rpki_vrf)
 
 static void rpki_update_cb_sync_rtr(struct pfx_table *p __attribute__((unused)),
 				    const struct pfx_record rec,
-				    const bool added __attribute__((unused)))
+				    const bool added)
 {
+	struct rpki_vrp_update upd = { .rec = rec, .added = added };
 	struct rpki_vrf *rpki_vrf;
 	const char *msg;
 	const struct rtr_socket *rtr = rec.socket;
@@ -786,13 +1032,12 @@ static void rpki_update_cb_sync_rtr(struct pfx_table *p __attribute__((unused)),
 				 memory_order_seq_cst))
 		return;
 
-	int retval = write(rpki_vrf->rpki_sync_socket_rtr, &rec,
-			   sizeof(struct pfx_record));
+	int retval = write(rpki_vrf->rpki_sync_socket_rtr, &upd, sizeof(upd));
 	if (retval == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
 		atomic_store_explicit(&rpki_vrf->rtr_update_overflow, 1,
 				      memory_order_seq_cst);
 
-	else if (retval != sizeof(struct pfx_record))
+	else if (retval != sizeof(upd))
 		RPKI_DEBUG("Could not write to rpki_sync_socket_rtr");
 	return;
 err:
@@ -876,6 +1121,14 @@ static int bgp_rpki_fini(void)
 		stop(rpki_vrf);
 		list_delete(&rpki_vrf->cache_list);
 
+		for (afi_t afi = AFI_IP; afi < AFI_MAX; afi++) {
+			if (rpki_vrf->vrp_table[afi])
+				route_table_finish(rpki_vrf->vrp_table[afi]);
+			if (rpki_vrf->revalidate_table[afi])
+				route_table_finish(
+					rpki_vrf->revalidate_table[afi]);
+		}
+
 		close(rpki_vrf->rpki_sync_socket_rtr);
 		close(rpki_vrf->rpki_sync_socket_bgpd);
 
@@ -990,6 +1243,8 @@ static void stop(struct rpki_vrf *rpki_vrf)
 		rtr_mgr_free(rpki_vrf->rtr_config);
 		rpki_vrf->rtr_is_running = false;
 	}
+	rpki_revalidate_flush(rpki_vrf);
+	rpki_vrp_flush(rpki_vrf);
 }
 
 static int reset(bool force, struct rpki_vrf *rpki_vrf)
@@ -1151,7 +1406,6 @@ static int rpki_validate_prefix(struct peer *peer, struct attr *attr,
 {
 	struct assegment *as_segment;
 	as_t as_number = 0;
-	struct lrtr_ip_addr ip_addr_prefix;
 	enum pfxv_state result;
 	struct bgp *bgp = peer->bgp;
 	struct vrf *vrf;
@@ -1198,26 +1452,11 @@ static int rpki_validate_prefix(struct peer *peer, struct attr *attr,
 		}
 	}
 
-	// Get the prefix in requested format
-	switch (prefix->family) {
-	case AF_INET:
-		ip_addr_prefix.ver = LRTR_IPV4;
-		ip_addr_prefix.u.addr4.addr = ntohl(prefix->u.prefix4.s_addr);
-		break;
-
-	case AF_INET6:
-		ip_addr_prefix.ver = LRTR_IPV6;
-		ipv6_addr_to_host_byte_order(prefix->u.prefix6.s6_addr32,
-					     ip_addr_prefix.u.addr6.addr);
-		break;
-
-	default:
+	if (prefix->family != AF_INET && prefix->family != AF_INET6)
 		return RPKI_NOT_BEING_USED;
-	}
 
-	// Do the actual validation
-	rtr_mgr_validate(rpki_vrf->rtr_config, as_number, &ip_addr_prefix,
-			 prefix->prefixlen, &result);
+	// Do the actual validation, against the local copy of the VRPs
+	result = rpki_vrp_validate(rpki_vrf, as_number, prefix);
 
 	// Print Debug output
 	switch (result) {
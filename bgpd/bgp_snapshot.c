@@ -0,0 +1,1255 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* BGP Adj-RIB-In snapshot for warm restart
+ *
+ * Without it a restarting bgpd has nothing to forward with until every
+ * peer has sent its full table again.  The snapshot keeps the paths the
+ * peers last sent us, after inbound policy, so that after a restart they
+ * can be selected and handed to zebra straight away.  They are restored
+ * as stale and reconciled like graceful restart does it: whatever the
+ * peer sends again replaces them, the rest is dropped on End-of-RIB or
+ * when the stalepath timer runs out.
+ */
+
+#include <zebra.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "command.h"
+#include "hook.h"
+#include "jhash.h"
+#include "json.h"
+#include "libfrr.h"
+#include "memory.h"
+#include "monotime.h"
+#include "network.h"
+#include "sockunion.h"
+#include "stream.h"
+#include "typesafe.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_community.h"
+#include "bgpd/bgp_debug.h"
+#include "bgpd/bgp_ecommunity.h"
+#include "bgpd/bgp_lcommunity.h"
+#include "bgpd/bgp_memory.h"
+#include "bgpd/bgp_mplsvpn.h"
+#include "bgpd/bgp_nht.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_table.h"
+#include "bgpd/bgp_vty.h"
+#include "bgpd/bgp_snapshot.h"
+
+#include "bgpd/bgp_snapshot_clippy.c"
+
+/* Output is buffered in chunks of this size */
+#define BGP_SNAPSHOT_BUFSIZE (256 * 1024)
+
+/* Fixed part of an attribute record */
+#define SNAPSHOT_ATTR_FIXED_SIZE 119
+
+/* Variable length parts present in an attribute record */
+#define SNAPSHOT_ATTR_ASPATH (1 << 0)
+#define SNAPSHOT_ATTR_COMMUNITY (1 << 1)
+#define SNAPSHOT_ATTR_ECOMMUNITY (1 << 2)
+#define SNAPSHOT_ATTR_LCOMMUNITY (1 << 3)
+#define SNAPSHOT_ATTR_CLUSTER (1 << 4)
+
+/* Attributes carried by the snapshot; everything else is specific to the
+ * address families that are not saved.
+ */
+#define SNAPSHOT_ATTR_FLAGS                                                    \
+	(ATTR_FLAG_BIT(BGP_ATTR_ORIGIN) | ATTR_FLAG_BIT(BGP_ATTR_AS_PATH) |    \
+	 ATTR_FLAG_BIT(BGP_ATTR_NEXT_HOP) |                                    \
+	 ATTR_FLAG_BIT(BGP_ATTR_MULTI_EXIT_DISC) |                             \
+	 ATTR_FLAG_BIT(BGP_ATTR_LOCAL_PREF) |                                  \
+	 ATTR_FLAG_BIT(BGP_ATTR_ATOMIC_AGGREGATE) |                            \
+	 ATTR_FLAG_BIT(BGP_ATTR_AGGREGATOR) |                                  \
+	 ATTR_FLAG_BIT(BGP_ATTR_COMMUNITIES) |                                 \
+	 ATTR_FLAG_BIT(BGP_ATTR_ORIGINATOR_ID) |                               \
+	 ATTR_FLAG_BIT(BGP_ATTR_CLUSTER_LIST) |                                \
+	 ATTR_FLAG_BIT(BGP_ATTR_MP_REACH_NLRI) |                               \
+	 ATTR_FLAG_BIT(BGP_ATTR_EXT_COMMUNITIES) |                             \
+	 ATTR_FLAG_BIT(BGP_ATTR_AIGP) |                                        \
+	 ATTR_FLAG_BIT(BGP_ATTR_LARGE_COMMUNITIES) |                           \
+	 ATTR_FLAG_BIT(BGP_ATTR_OTC))
+
+/* Flags only valid together with their attribute pointer */
+#define SNAPSHOT_ATTR_FLAGS_PTR                                                \
+	(ATTR_FLAG_BIT(BGP_ATTR_COMMUNITIES) |                                 \
+	 ATTR_FLAG_BIT(BGP_ATTR_EXT_COMMUNITIES) |                             \
+	 ATTR_FLAG_BIT(BGP_ATTR_LARGE_COMMUNITIES) |                           \
+	 ATTR_FLAG_BIT(BGP_ATTR_CLUSTER_LIST))
+
+static struct bgp_snapshot_config {
+	char *filename;
+	uint32_t interval;
+	struct event *t_write;
+
+	/* The snapshot is read back once, when the startup config is in */
+	bool restore_pending;
+	bool config_read;
+
+	bool written;
+	bool restored;
+	struct bgp_snapshot_stats last_write;
+	struct bgp_snapshot_stats last_restore;
+} snapshot;
+
+/*
+ * Writing
+ */
+
+/* peer and attribute pointers to their record number */
+PREDECL_HASH(snapshot_index);
+
+struct snapshot_index_entry {
+	struct snapshot_index_item item;
+	const void *ptr;
+	uint32_t index;
+};
+
+static int snapshot_index_cmp(const struct snapshot_index_entry *a,
+			      const struct snapshot_index_entry *b)
+{
+	return numcmp((uintptr_t)a->ptr, (uintptr_t)b->ptr);
+}
+
+static uint32_t snapshot_index_hash(const struct snapshot_index_entry *e)
+{
+	uintptr_t ptr = (uintptr_t)e->ptr;
+
+	return jhash(&ptr, sizeof(ptr), 0x5a9b0c1d);
+}
+
+DECLARE_HASH(snapshot_index, struct snapshot_index_entry, item,
+	     snapshot_index_cmp, snapshot_index_hash);
+
+struct snapshot_writer {
+	int fd;
+	int err;
+	struct stream *s;
+	struct snapshot_index_head index;
+	struct bgp_snapshot_stats *stats;
+};
+
+static struct snapshot_index_entry *
+snapshot_index_lookup(struct snapshot_writer *w, const void *ptr)
+{
+	struct snapshot_index_entry ref = { .ptr = ptr };
+
+	return snapshot_index_find(&w->index, &ref);
+}
+
+static struct snapshot_index_entry *
+snapshot_index_new(struct snapshot_writer *w, const void *ptr, uint32_t index)
+{
+	struct snapshot_index_entry *e;
+
+	e = XCALLOC(MTYPE_BGP_SNAPSHOT, sizeof(*e));
+	e->ptr = ptr;
+	e->index = index;
+	snapshot_index_add(&w->index, e);
+	return e;
+}
+
+static void snapshot_flush(struct snapshot_writer *w)
+{
+	const uint8_t *pnt = STREAM_DATA(w->s);
+	size_t len = stream_get_endp(w->s);
+	ssize_t n;
+
+	w->stats->bytes += len;
+	while (len && !w->err) {
+		n = write(w->fd, pnt, len);
+		if (n < 0) {
+			if (!ERRNO_IO_RETRY(errno))
+				w->err = errno;
+			continue;
+		}
+		pnt += n;
+		len -= n;
+	}
+	stream_reset(w->s);
+}
+
+/* Start a record of at most len bytes, returns where its payload starts */
+static size_t snapshot_rec_start(struct snapshot_writer *w, uint8_t type,
+				 size_t len)
+{
+	size_t need = BGP_SNAPSHOT_REC_HEADER_SIZE + len;
+
+	if (STREAM_WRITEABLE(w->s) < need) {
+		snapshot_flush(w);
+		if (STREAM_SIZE(w->s) < need)
+			stream_resize_inplace(&w->s, need);
+	}
+
+	stream_putc(w->s, type);
+	stream_putl(w->s, 0);
+	return stream_get_endp(w->s);
+}
+
+static void snapshot_rec_end(struct snapshot_writer *w, size_t start)
+{
+	stream_putl_at(w->s, start - 4, stream_get_endp(w->s) - start);
+}
+
+static void snapshot_put_string(struct stream *s, const char *str)
+{
+	size_t len = str ? strlen(str) : 0;
+
+	stream_putc(s, len);
+	stream_put(s, str, len);
+}
+
+static size_t snapshot_attr_size(const struct attr *attr)
+{
+	struct community *comm = bgp_attr_get_community(attr);
+	struct ecommunity *ecomm = bgp_attr_get_ecommunity(attr);
+	struct lcommunity *lcomm = bgp_attr_get_lcommunity(attr);
+	struct cluster_list *cluster = bgp_attr_get_cluster(attr);
+	size_t size = SNAPSHOT_ATTR_FIXED_SIZE;
+
+	/* overlong segments are split by aspath_put() */
+	if (attr->aspath)
+		size += 5 + 2 * aspath_size(attr->aspath);
+	if (comm)
+		size += 4 + comm->size * COMMUNITY_SIZE;
+	if (ecomm)
+		size += 5 + ecomm->size * ecomm->unit_size;
+	if (lcomm)
+		size += 4 + lcomm->size * LCOMMUNITY_SIZE;
+	if (cluster)
+		size += 4 + cluster->length;
+
+	return size;
+}
+
+void bgp_snapshot_attr_encode(struct stream *s, const struct attr *attr)
+{
+	struct community *comm = bgp_attr_get_community(attr);
+	struct ecommunity *ecomm = bgp_attr_get_ecommunity(attr);
+	struct lcommunity *lcomm = bgp_attr_get_lcommunity(attr);
+	struct cluster_list *cluster = bgp_attr_get_cluster(attr);
+	uint8_t present = 0;
+	size_t lenp;
+
+	if (ecomm && ecomm->unit_size != ECOMMUNITY_SIZE)
+		ecomm = NULL;
+
+	stream_putq(s, attr->flag & SNAPSHOT_ATTR_FLAGS);
+	stream_putc(s, attr->origin);
+	stream_putc(s, attr->nh_flags);
+	stream_putc(s, attr->mp_nexthop_len);
+	stream_putc(s, attr->distance);
+	stream_putc(s, attr->nh_type);
+	stream_putc(s, attr->bh_type);
+	stream_put_in_addr(s, &attr->nexthop);
+	stream_put_in_addr(s, &attr->mp_nexthop_global_in);
+	stream_put(s, &attr->mp_nexthop_global, IPV6_MAX_BYTELEN);
+	stream_put(s, &attr->mp_nexthop_local, IPV6_MAX_BYTELEN);
+	stream_putl(s, attr->nh_ifindex);
+	stream_putl(s, attr->nh_lla_ifindex);
+	stream_putl(s, attr->med);
+	stream_putl(s, attr->local_pref);
+	stream_putl(s, attr->weight);
+	stream_putl(s, attr->tag);
+	stream_put_in_addr(s, &attr->originator_id);
+	stream_putl(s, attr->aggregator_as);
+	stream_put_in_addr(s, &attr->aggregator_addr);
+	stream_putl(s, attr->otc);
+	stream_putl(s, attr->rmap_table_id);
+	stream_putl(s, attr->srte_color);
+	stream_putq(s, attr->aigp_metric);
+	stream_putq(s, attr->link_bw);
+
+	if (attr->aspath)
+		SET_FLAG(present, SNAPSHOT_ATTR_ASPATH);
+	if (comm)
+		SET_FLAG(present, SNAPSHOT_ATTR_COMMUNITY);
+	if (ecomm)
+		SET_FLAG(present, SNAPSHOT_ATTR_ECOMMUNITY);
+	if (lcomm)
+		SET_FLAG(present, SNAPSHOT_ATTR_LCOMMUNITY);
+	if (cluster)
+		SET_FLAG(present, SNAPSHOT_ATTR_CLUSTER);
+	stream_putc(s, present);
+
+	if (attr->aspath) {
+		stream_putc(s, attr->aspath->asnotation);
+		lenp = stream_get_endp(s);
+		stream_putl(s, 0);
+		stream_putl_at(s, lenp, aspath_put(s, attr->aspath, 1));
+	}
+	if (comm) {
+		stream_putl(s, comm->size * COMMUNITY_SIZE);
+		stream_put(s, comm->val, comm->size * COMMUNITY_SIZE);
+	}
+	if (ecomm) {
+		stream_putc(s, ecomm->disable_ieee_floating);
+		stream_putl(s, ecomm->size * ECOMMUNITY_SIZE);
+		stream_put(s, ecomm->val, ecomm->size * ECOMMUNITY_SIZE);
+	}
+	if (lcomm) {
+		stream_putl(s, lcomm->size * LCOMMUNITY_SIZE);
+		stream_put(s, lcomm->val, lcomm->size * LCOMMUNITY_SIZE);
+	}
+	if (cluster) {
+		stream_putl(s, cluster->length);
+		stream_put(s, cluster->list, cluster->length);
+	}
+}
+
+static void snapshot_write_peer(struct snapshot_writer *w, struct peer *peer)
+{
+	union sockunion *su = &peer->connection->su;
+	size_t start;
+
+	if (!CHECK_FLAG(peer->flags, PEER_FLAG_CONFIG_NODE) ||
+	    peer_dynamic_neighbor(peer))
+		return;
+	if (!peer->conf_if && su->sa.sa_family != AF_INET &&
+	    su->sa.sa_family != AF_INET6)
+		return;
+
+	start = snapshot_rec_start(w, BGP_SNAPSHOT_REC_PEER,
+				   3 + 2 * UINT8_MAX + IPV6_MAX_BYTELEN);
+	snapshot_put_string(w->s, peer->bgp->name);
+	snapshot_put_string(w->s, peer->conf_if);
+	switch (su->sa.sa_family) {
+	case AF_INET:
+		stream_putc(w->s, AF_INET);
+		stream_put_in_addr(w->s, &su->sin.sin_addr);
+		break;
+	case AF_INET6:
+		stream_putc(w->s, AF_INET6);
+		stream_put(w->s, &su->sin6.sin6_addr, IPV6_MAX_BYTELEN);
+		break;
+	default:
+		stream_putc(w->s, AF_UNSPEC);
+		break;
+	}
+	snapshot_rec_end(w, start);
+
+	snapshot_index_new(w, peer, w->stats->peers++);
+}
+
+static void snapshot_write_table(struct snapshot_writer *w, struct bgp *bgp,
+				 afi_t afi)
+{
+	struct snapshot_index_entry *pe, *ae;
+	struct bgp_path_info *pi;
+	struct bgp_dest *dest;
+	const struct prefix *p;
+	size_t start;
+
+	for (dest = bgp_table_top(bgp->rib[afi][SAFI_UNICAST]); dest;
+	     dest = bgp_route_next(dest)) {
+		p = bgp_dest_get_prefix(dest);
+
+		for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
+			if (pi->type != ZEBRA_ROUTE_BGP ||
+			    pi->sub_type != BGP_ROUTE_NORMAL)
+				continue;
+			if (CHECK_FLAG(pi->flags, BGP_PATH_REMOVED |
+							  BGP_PATH_HISTORY |
+							  BGP_PATH_DAMPED))
+				continue;
+
+			pe = snapshot_index_lookup(w, pi->peer);
+			if (!pe)
+				continue;
+
+			ae = snapshot_index_lookup(w, pi->attr);
+			if (!ae) {
+				start = snapshot_rec_start(
+					w, BGP_SNAPSHOT_REC_ATTR,
+					snapshot_attr_size(pi->attr));
+				bgp_snapshot_attr_encode(w->s, pi->attr);
+				snapshot_rec_end(w, start);
+
+				ae = snapshot_index_new(w, pi->attr,
+							w->stats->attrs++);
+			}
+
+			start = snapshot_rec_start(w, BGP_SNAPSHOT_REC_PATH,
+						   14 + IPV6_MAX_BYTELEN);
+			stream_putl(w->s, pe->index);
+			stream_putl(w->s, ae->index);
+			stream_putl(w->s, pi->addpath_rx_id);
+			stream_putc(w->s, afi);
+			stream_putc(w->s, p->prefixlen);
+			stream_put(w->s, &p->u.prefix, PSIZE(p->prefixlen));
+			snapshot_rec_end(w, start);
+
+			w->stats->paths++;
+		}
+	}
+}
+
+int bgp_snapshot_write(const char *filename, struct bgp_snapshot_stats *stats)
+{
+	struct snapshot_writer w = {};
+	struct snapshot_index_entry *e;
+	char tmpname[MAXPATHLEN];
+	struct listnode *node, *pnode;
+	struct timeval start;
+	struct bgp *bgp;
+	struct peer *peer;
+	size_t rec;
+	afi_t afi;
+
+	memset(stats, 0, sizeof(*stats));
+	monotime(&start);
+
+	snprintf(tmpname, sizeof(tmpname), "%s.tmp", filename);
+	w.fd = open(tmpname, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (w.fd < 0) {
+		zlog_warn("%s: could not open %s: %s", __func__, tmpname,
+			  safe_strerror(errno));
+		return -1;
+	}
+
+	w.s = stream_new(BGP_SNAPSHOT_BUFSIZE);
+	w.stats = stats;
+	snapshot_index_init(&w.index);
+
+	stats->time = time(NULL);
+	stream_putl(w.s, BGP_SNAPSHOT_MAGIC);
+	stream_putw(w.s, BGP_SNAPSHOT_VERSION);
+	stream_putw(w.s, 0);
+	stream_putq(w.s, stats->time);
+
+	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp))
+		for (ALL_LIST_ELEMENTS_RO(bgp->peer, pnode, peer))
+			snapshot_write_peer(&w, peer);
+
+	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp))
+		for (afi = AFI_IP; afi <= AFI_IP6; afi++)
+			snapshot_write_table(&w, bgp, afi);
+
+	rec = snapshot_rec_start(&w, BGP_SNAPSHOT_REC_END, 12);
+	stream_putl(w.s, stats->peers);
+	stream_putl(w.s, stats->attrs);
+	stream_putl(w.s, stats->paths);
+	snapshot_rec_end(&w, rec);
+	snapshot_flush(&w);
+
+	if (!w.err && fsync(w.fd) < 0)
+		w.err = errno;
+	if (close(w.fd) < 0 && !w.err)
+		w.err = errno;
+	if (!w.err && rename(tmpname, filename) < 0)
+		w.err = errno;
+
+	if (w.err) {
+		zlog_warn("%s: could not write %s: %s", __func__, filename,
+			  safe_strerror(w.err));
+		unlink(tmpname);
+	}
+
+	while ((e = snapshot_index_pop(&w.index)))
+		XFREE(MTYPE_BGP_SNAPSHOT, e);
+	snapshot_index_fini(&w.index);
+	stream_free(w.s);
+
+	stats->usec = monotime_since(&start, NULL);
+	return w.err ? -1 : 0;
+}
+
+/*
+ * Reading
+ */
+
+struct snapshot_reader {
+	const uint8_t *pnt;
+	const uint8_t *end;
+	bool error;
+};
+
+static const uint8_t *sr_get(struct snapshot_reader *r, size_t len)
+{
+	const uint8_t *pnt = r->pnt;
+
+	if (r->error || (size_t)(r->end - r->pnt) < len) {
+		r->error = true;
+		return NULL;
+	}
+	r->pnt += len;
+	return pnt;
+}
+
+static void sr_copy(struct snapshot_reader *r, void *dst, size_t len)
+{
+	const uint8_t *pnt = sr_get(r, len);
+
+	if (pnt)
+		memcpy(dst, pnt, len);
+	else
+		memset(dst, 0, len);
+}
+
+static uint8_t sr_getc(struct snapshot_reader *r)
+{
+	const uint8_t *pnt = sr_get(r, 1);
+
+	return pnt ? *pnt : 0;
+}
+
+static uint16_t sr_getw(struct snapshot_reader *r)
+{
+	uint16_t val;
+
+	sr_copy(r, &val, sizeof(val));
+	return ntohs(val);
+}
+
+static uint32_t sr_getl(struct snapshot_reader *r)
+{
+	uint32_t val;
+
+	sr_copy(r, &val, sizeof(val));
+	return ntohl(val);
+}
+
+static uint64_t sr_getq(struct snapshot_reader *r)
+{
+	uint64_t val;
+
+	val = (uint64_t)sr_getl(r) << 32;
+	val |= sr_getl(r);
+	return val;
+}
+
+static void sr_get_string(struct snapshot_reader *r, char *buf, size_t size)
+{
+	uint8_t len = sr_getc(r);
+
+	assert(size > UINT8_MAX);
+	sr_copy(r, buf, len);
+	buf[len] = '\0';
+}
+
+static struct aspath *snapshot_aspath_parse(const uint8_t *data, size_t len,
+					    enum asnotation_mode asnotation)
+{
+	struct aspath *aspath;
+	struct stream *s;
+
+	if (!len)
+		return aspath_empty(asnotation);
+
+	s = stream_new(len);
+	stream_put(s, data, len);
+	aspath = aspath_parse(s, len, 1, asnotation);
+	stream_free(s);
+
+	return aspath;
+}
+
+bool bgp_snapshot_attr_decode(const uint8_t *pnt, size_t len,
+			      struct attr *attr)
+{
+	struct snapshot_reader r = { .pnt = pnt, .end = pnt + len };
+	enum asnotation_mode asnotation;
+	const uint8_t *data;
+	bool ieee_floating;
+	uint8_t present;
+	uint32_t size;
+
+	memset(attr, 0, sizeof(*attr));
+	attr->label_index = BGP_INVALID_LABEL_INDEX;
+	attr->label = MPLS_INVALID_LABEL;
+
+	attr->flag = sr_getq(&r) & SNAPSHOT_ATTR_FLAGS;
+	UNSET_FLAG(attr->flag, SNAPSHOT_ATTR_FLAGS_PTR);
+	attr->origin = sr_getc(&r);
+	attr->nh_flags = sr_getc(&r);
+	attr->mp_nexthop_len = sr_getc(&r);
+	attr->distance = sr_getc(&r);
+	attr->nh_type = sr_getc(&r);
+	attr->bh_type = sr_getc(&r);
+	sr_copy(&r, &attr->nexthop, IPV4_MAX_BYTELEN);
+	sr_copy(&r, &attr->mp_nexthop_global_in, IPV4_MAX_BYTELEN);
+	sr_copy(&r, &attr->mp_nexthop_global, IPV6_MAX_BYTELEN);
+	sr_copy(&r, &attr->mp_nexthop_local, IPV6_MAX_BYTELEN);
+	attr->nh_ifindex = sr_getl(&r);
+	attr->nh_lla_ifindex = sr_getl(&r);
+	attr->med = sr_getl(&r);
+	attr->local_pref = sr_getl(&r);
+	attr->weight = sr_getl(&r);
+	attr->tag = sr_getl(&r);
+	sr_copy(&r, &attr->originator_id, IPV4_MAX_BYTELEN);
+	attr->aggregator_as = sr_getl(&r);
+	sr_copy(&r, &attr->aggregator_addr, IPV4_MAX_BYTELEN);
+	attr->otc = sr_getl(&r);
+	attr->rmap_table_id = sr_getl(&r);
+	attr->srte_color = sr_getl(&r);
+	attr->aigp_metric = sr_getq(&r);
+	attr->link_bw = sr_getq(&r);
+	present = sr_getc(&r);
+
+	if (r.error)
+		return false;
+
+	if (CHECK_FLAG(present, SNAPSHOT_ATTR_ASPATH)) {
+		asnotation = sr_getc(&r);
+		size = sr_getl(&r);
+		data = sr_get(&r, size);
+		if (!data || asnotation > ASNOTATION_UNDEFINED)
+			goto fail;
+		attr->aspath = snapshot_aspath_parse(data, size, asnotation);
+		if (!attr->aspath)
+			goto fail;
+	}
+	if (CHECK_FLAG(present, SNAPSHOT_ATTR_COMMUNITY)) {
+		size = sr_getl(&r);
+		data = sr_get(&r, size);
+		if (!data || !size || size > UINT16_MAX)
+			goto fail;
+		bgp_attr_set_community(attr,
+				       community_parse((uint32_t *)data, size));
+		if (!bgp_attr_get_community(attr))
+			goto fail;
+	}
+	if (CHECK_FLAG(present, SNAPSHOT_ATTR_ECOMMUNITY)) {
+		ieee_floating = !!sr_getc(&r);
+		size = sr_getl(&r);
+		data = sr_get(&r, size);
+		if (!data || !size || size > UINT16_MAX)
+			goto fail;
+		bgp_attr_set_ecommunity(attr,
+					ecommunity_parse((uint8_t *)data, size,
+							 ieee_floating));
+		if (!bgp_attr_get_ecommunity(attr))
+			goto fail;
+	}
+	if (CHECK_FLAG(present, SNAPSHOT_ATTR_LCOMMUNITY)) {
+		size = sr_getl(&r);
+		data = sr_get(&r, size);
+		if (!data || !size || size > UINT16_MAX)
+			goto fail;
+		bgp_attr_set_lcommunity(
+			attr, lcommunity_parse((uint8_t *)data, size));
+		if (!bgp_attr_get_lcommunity(attr))
+			goto fail;
+	}
+	if (CHECK_FLAG(present, SNAPSHOT_ATTR_CLUSTER)) {
+		size = sr_getl(&r);
+		data = sr_get(&r, size);
+		if (!data || !size || size % IPV4_MAX_BYTELEN ||
+		    size > UINT16_MAX)
+			goto fail;
+		bgp_attr_set_cluster(attr,
+				     cluster_parse((struct in_addr *)data,
+						   size));
+	}
+
+	if (r.pnt != r.end)
+		goto fail;
+
+	return true;
+
+fail:
+	bgp_attr_unintern_sub(attr);
+	return false;
+}
+
+/* Walk the records once without looking at them, so a damaged file is
+ * refused before anything was installed from it.
+ */
+static bool snapshot_check(const uint8_t *pnt, size_t len,
+			   struct bgp_snapshot_stats *stats)
+{
+	struct snapshot_reader r = { .pnt = pnt, .end = pnt + len };
+	struct snapshot_reader end;
+	const uint8_t *payload;
+	uint32_t peers = 0, attrs = 0, paths = 0;
+	uint32_t rlen;
+	uint8_t type;
+
+	if (sr_getl(&r) != BGP_SNAPSHOT_MAGIC ||
+	    sr_getw(&r) != BGP_SNAPSHOT_VERSION)
+		return false;
+	sr_getw(&r);
+	stats->time = sr_getq(&r);
+
+	while (!r.error) {
+		type = sr_getc(&r);
+		rlen = sr_getl(&r);
+		payload = sr_get(&r, rlen);
+		if (!payload)
+			return false;
+
+		switch (type) {
+		case BGP_SNAPSHOT_REC_PEER:
+			peers++;
+			break;
+		case BGP_SNAPSHOT_REC_ATTR:
+			attrs++;
+			break;
+		case BGP_SNAPSHOT_REC_PATH:
+			paths++;
+			break;
+		case BGP_SNAPSHOT_REC_END:
+			end.pnt = payload;
+			end.end = payload + rlen;
+			end.error = false;
+			stats->peers = sr_getl(&end);
+			stats->attrs = sr_getl(&end);
+			stats->paths = sr_getl(&end);
+			return r.pnt == r.end && !end.error &&
+			       stats->peers == peers && stats->attrs == attrs &&
+			       stats->paths == paths;
+		default:
+			/* not ours to interpret, newer writers may add some */
+			break;
+		}
+	}
+
+	return false;
+}
+
+static struct peer *snapshot_read_peer(const uint8_t *pnt, size_t len)
+{
+	struct snapshot_reader r = { .pnt = pnt, .end = pnt + len };
+	char name[UINT8_MAX + 1], conf_if[UINT8_MAX + 1];
+	union sockunion su = {};
+	struct peer *peer;
+	struct bgp *bgp;
+
+	sr_get_string(&r, name, sizeof(name));
+	sr_get_string(&r, conf_if, sizeof(conf_if));
+	su.sa.sa_family = sr_getc(&r);
+	switch (su.sa.sa_family) {
+	case AF_INET:
+		sr_copy(&r, &su.sin.sin_addr, IPV4_MAX_BYTELEN);
+		break;
+	case AF_INET6:
+		sr_copy(&r, &su.sin6.sin6_addr, IPV6_MAX_BYTELEN);
+		break;
+	default:
+		break;
+	}
+	if (r.error)
+		return NULL;
+
+	bgp = name[0] ? bgp_lookup_by_name(name) : bgp_get_default();
+	if (!bgp || CHECK_FLAG(bgp->flags, BGP_FLAG_SHUTDOWN))
+		return NULL;
+
+	if (conf_if[0])
+		peer = peer_lookup_by_conf_if(bgp, conf_if);
+	else if (su.sa.sa_family == AF_INET || su.sa.sa_family == AF_INET6)
+		peer = peer_lookup(bgp, &su);
+	else
+		peer = NULL;
+
+	/* a session that is already up sends us the real thing */
+	if (!peer || CHECK_FLAG(peer->flags, PEER_FLAG_SHUTDOWN) ||
+	    peer_established(peer->connection))
+		return NULL;
+
+	return peer;
+}
+
+/* Install one restored path, like bgp_update() does for a new path. */
+static bool snapshot_path_restore(struct peer *peer, afi_t afi,
+				  const struct prefix *p, uint32_t addpath_id,
+				  struct attr *attr)
+{
+	struct bgp *bgp = peer->bgp;
+	safi_t safi = SAFI_UNICAST;
+	struct bgp_path_info *pi, *new;
+	struct bgp_dest *dest;
+	struct attr attr_tmp;
+	int connected;
+
+	dest = bgp_afi_node_get(bgp->rib[afi][safi], afi, safi, p, NULL);
+
+	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
+		if (pi->peer == peer && pi->type == ZEBRA_ROUTE_BGP &&
+		    pi->sub_type == BGP_ROUTE_NORMAL &&
+		    pi->addpath_rx_id == addpath_id)
+			break;
+	if (pi) {
+		bgp_dest_unlock_node(dest);
+		return false;
+	}
+
+	attr_tmp = *attr;
+	new = info_make(ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL, 0, peer,
+			bgp_attr_intern(&attr_tmp), dest);
+	new->addpath_rx_id = addpath_id;
+	bgp_path_info_set_flag(dest, new, BGP_PATH_STALE);
+
+	if (peer->sort == BGP_PEER_EBGP && peer->ttl == BGP_DEFAULT_TTL &&
+	    !CHECK_FLAG(peer->flags, PEER_FLAG_DISABLE_CONNECTED_CHECK) &&
+	    !CHECK_FLAG(bgp->flags, BGP_FLAG_DISABLE_NH_CONNECTED_CHK))
+		connected = 1;
+	else
+		connected = 0;
+
+	if (bgp_find_or_add_nexthop(bgp, bgp, BGP_ATTR_NH_AFI(afi, new->attr),
+				    safi, new, NULL, connected,
+				    CHECK_FLAG(peer->af_flags[afi][safi],
+					       PEER_FLAG_REFLECTOR_CLIENT)
+					    ? NULL
+					    : p))
+		bgp_path_info_set_flag(dest, new, BGP_PATH_VALID);
+	else
+		bgp_path_info_unset_flag(dest, new, BGP_PATH_VALID);
+
+	bgp_aggregate_increment(bgp, p, new, afi, safi);
+	bgp_path_info_add(dest, new);
+	bgp_dest_unlock_node(dest);
+
+	bgp_process(bgp, dest, new, afi, safi);
+
+	if (bgp->inst_type == BGP_INSTANCE_TYPE_VRF ||
+	    bgp->inst_type == BGP_INSTANCE_TYPE_DEFAULT)
+		vpn_leak_from_vrf_update(bgp_get_default(), bgp, new);
+
+	return true;
+}
+
+static void snapshot_read_path(const uint8_t *pnt, size_t len,
+			       struct peer **peers, uint32_t npeers,
+			       struct attr **attrs, uint32_t nattrs,
+			       struct bgp_snapshot_stats *stats)
+{
+	struct snapshot_reader r = { .pnt = pnt, .end = pnt + len };
+	uint32_t peer_idx, attr_idx, addpath_id;
+	struct prefix p = {};
+	struct peer *peer;
+	afi_t afi;
+
+	peer_idx = sr_getl(&r);
+	attr_idx = sr_getl(&r);
+	addpath_id = sr_getl(&r);
+	afi = sr_getc(&r);
+	p.prefixlen = sr_getc(&r);
+
+	if (r.error || peer_idx >= npeers || attr_idx >= nattrs ||
+	    !peers[peer_idx] || !attrs[attr_idx])
+		return;
+	if (afi != AFI_IP && afi != AFI_IP6)
+		return;
+
+	p.family = afi2family(afi);
+	if (p.prefixlen > prefix_blen(&p) * 8)
+		return;
+	sr_copy(&r, &p.u.prefix, PSIZE(p.prefixlen));
+	if (r.error)
+		return;
+	apply_mask(&p);
+
+	peer = peers[peer_idx];
+	if (!peer->afc[afi][SAFI_UNICAST])
+		return;
+
+	if (snapshot_path_restore(peer, afi, &p, addpath_id, attrs[attr_idx])) {
+		if (!CHECK_FLAG(peer->sflags, PEER_STATUS_SNAPSHOT_WAIT)) {
+			SET_FLAG(peer->sflags, PEER_STATUS_SNAPSHOT_WAIT);
+			stats->peers++;
+		}
+		peer->snapshot_wait[afi] = true;
+		stats->paths++;
+	}
+}
+
+static void bgp_snapshot_stale_timer_expire(struct event *thread)
+{
+	struct peer *peer = EVENT_ARG(thread);
+	afi_t afi;
+
+	if (bgp_debug_neighbor_events(peer))
+		zlog_debug("%pBP snapshot stalepath timer expired", peer);
+
+	UNSET_FLAG(peer->sflags, PEER_STATUS_SNAPSHOT_WAIT);
+	memset(peer->snapshot_wait, 0, sizeof(peer->snapshot_wait));
+
+	/* paths kept for a restarting peer are graceful restart's business */
+	for (afi = AFI_IP; afi <= AFI_IP6; afi++)
+		if (!CHECK_FLAG(peer->sflags, PEER_STATUS_NSF_WAIT) ||
+		    !peer->nsf[afi][SAFI_UNICAST])
+			bgp_clear_stale_route(peer, afi, SAFI_UNICAST);
+}
+
+/*
+ * The caller has dropped the stale paths of afi/safi.  Once every address
+ * family we restored paths for is through, the stalepath timer has nothing
+ * left to do.
+ */
+void bgp_snapshot_peer_eor(struct peer *peer, afi_t afi, safi_t safi)
+{
+	if (safi != SAFI_UNICAST || !peer->snapshot_wait[afi])
+		return;
+
+	peer->snapshot_wait[afi] = false;
+	for (afi = AFI_IP; afi < AFI_MAX; afi++)
+		if (peer->snapshot_wait[afi])
+			return;
+
+	if (bgp_debug_neighbor_events(peer))
+		zlog_debug("%pBP End-of-RIB received for all restored address families",
+			   peer);
+
+	EVENT_OFF(peer->t_snapshot_stale);
+	UNSET_FLAG(peer->sflags, PEER_STATUS_SNAPSHOT_WAIT);
+}
+
+void bgp_snapshot_peer_stop(struct peer *peer)
+{
+	afi_t afi;
+
+	EVENT_OFF(peer->t_snapshot_stale);
+	UNSET_FLAG(peer->sflags, PEER_STATUS_SNAPSHOT_WAIT);
+	memset(peer->snapshot_wait, 0, sizeof(peer->snapshot_wait));
+
+	for (afi = AFI_IP; afi <= AFI_IP6; afi++)
+		bgp_clear_stale_route(peer, afi, SAFI_UNICAST);
+}
+
+
+int bgp_snapshot_restore(const char *filename, struct bgp_snapshot_stats *stats)
+{
+	struct bgp_snapshot_stats counts = {};
+	struct snapshot_reader r;
+	struct listnode *node, *pnode;
+	struct peer **peers;
+	struct attr **attrs;
+	uint32_t npeers = 0, nattrs = 0, i;
+	struct timeval start;
+	const uint8_t *payload;
+	struct attr attr;
+	struct stat st;
+	struct bgp *bgp;
+	struct peer *peer;
+	uint8_t *map;
+	uint32_t rlen;
+	uint8_t type;
+	int fd;
+
+	memset(stats, 0, sizeof(*stats));
+	monotime(&start);
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		if (errno != ENOENT)
+			zlog_warn("%s: could not open %s: %s", __func__,
+				  filename, safe_strerror(errno));
+		return -1;
+	}
+	if (fstat(fd, &st) < 0 || st.st_size < BGP_SNAPSHOT_HEADER_SIZE) {
+		zlog_warn("%s: %s is not a BGP snapshot", __func__, filename);
+		close(fd);
+		return -1;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		zlog_warn("%s: could not map %s: %s", __func__, filename,
+			  safe_strerror(errno));
+		return -1;
+	}
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+	if (!snapshot_check(map, st.st_size, &counts)) {
+		zlog_warn("%s: %s is damaged or from an incompatible version, ignoring it",
+			  __func__, filename);
+		munmap(map, st.st_size);
+		return -1;
+	}
+	stats->time = counts.time;
+	stats->bytes = st.st_size;
+
+	/* records are known to be complete from here on */
+	r.pnt = map + BGP_SNAPSHOT_HEADER_SIZE;
+	r.end = map + st.st_size;
+	r.error = false;
+
+	peers = XCALLOC(MTYPE_BGP_SNAPSHOT,
+			(counts.peers + 1) * sizeof(*peers));
+	attrs = XCALLOC(MTYPE_BGP_SNAPSHOT,
+			(counts.attrs + 1) * sizeof(*attrs));
+
+	for (;;) {
+		type = sr_getc(&r);
+		rlen = sr_getl(&r);
+		payload = sr_get(&r, rlen);
+		if (type == BGP_SNAPSHOT_REC_END)
+			break;
+
+		switch (type) {
+		case BGP_SNAPSHOT_REC_PEER:
+			peers[npeers++] = snapshot_read_peer(payload, rlen);
+			break;
+		case BGP_SNAPSHOT_REC_ATTR:
+			if (bgp_snapshot_attr_decode(payload, rlen, &attr)) {
+				attrs[nattrs] = bgp_attr_intern(&attr);
+				bgp_attr_unintern_sub(&attr);
+			}
+			nattrs++;
+			break;
+		case BGP_SNAPSHOT_REC_PATH:
+			snapshot_read_path(payload, rlen, peers, npeers, attrs,
+					   nattrs, stats);
+			break;
+		default:
+			break;
+		}
+	}
+
+	for (i = 0; i < nattrs; i++)
+		if (attrs[i]) {
+			stats->attrs++;
+			bgp_attr_unintern(&attrs[i]);
+		}
+	XFREE(MTYPE_BGP_SNAPSHOT, attrs);
+	XFREE(MTYPE_BGP_SNAPSHOT, peers);
+	munmap(map, st.st_size);
+
+	/* whatever the peers do not send again before End-of-RIB or the
+	 * stalepath time is gone
+	 */
+	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp))
+		for (ALL_LIST_ELEMENTS_RO(bgp->peer, pnode, peer)) {
+			if (!CHECK_FLAG(peer->sflags,
+					PEER_STATUS_SNAPSHOT_WAIT))
+				continue;
+			EVENT_OFF(peer->t_snapshot_stale);
+			event_add_timer(bm->master,
+					bgp_snapshot_stale_timer_expire, peer,
+					bgp->stalepath_time,
+					&peer->t_snapshot_stale);
+		}
+
+	stats->usec = monotime_since(&start, NULL);
+	zlog_info("Restored %u paths of %u peers from BGP snapshot %s in %lld msec",
+		  stats->paths, stats->peers, filename,
+		  (long long)stats->usec / 1000);
+	return 0;
+}
+
+static void bgp_snapshot_timer(struct event *thread);
+
+static void bgp_snapshot_timer_start(void)
+{
+	EVENT_OFF(snapshot.t_write);
+	event_add_timer(bm->master, bgp_snapshot_timer, NULL,
+			snapshot.interval, &snapshot.t_write);
+}
+
+static void bgp_snapshot_timer(struct event *thread)
+{
+	if (bm->terminating)
+		return;
+
+	if (bgp_snapshot_write(snapshot.filename, &snapshot.last_write) == 0)
+		snapshot.written = true;
+
+	bgp_snapshot_timer_start();
+}
+
+/* Runs once the startup configuration is in, so the peers the snapshot
+ * refers to exist.
+ */
+static void bgp_snapshot_startup_done(void)
+{
+	if (!snapshot.restore_pending || !listcount(bm->bgp))
+		return;
+
+	snapshot.restore_pending = false;
+	if (!snapshot.filename)
+		return;
+
+	if (bgp_snapshot_restore(snapshot.filename, &snapshot.last_restore) ==
+	    0)
+		snapshot.restored = true;
+	bgp_snapshot_timer_start();
+}
+
+static int bgp_snapshot_config_end(struct bgp *bgp)
+{
+	bgp_snapshot_startup_done();
+	return 0;
+}
+
+static int bgp_snapshot_config_post(struct event_loop *tm)
+{
+	snapshot.config_read = true;
+
+	/* integrated config arrives later, through bgp_config_end */
+	if (!bgp_config_inprocess())
+		bgp_snapshot_startup_done();
+	return 0;
+}
+
+void bgp_snapshot_terminate(void)
+{
+	/* a snapshot not yet restored must not be overwritten by a table
+	 * that never had the chance to fill up
+	 */
+	if (!snapshot.filename || snapshot.restore_pending)
+		return;
+
+	EVENT_OFF(snapshot.t_write);
+	if (bgp_snapshot_write(snapshot.filename, &snapshot.last_write) == 0)
+		snapshot.written = true;
+}
+
+DEFPY (bgp_snapshot,
+       bgp_snapshot_cmd,
+       "bgp snapshot FILENAME$filename [interval (60-86400)$interval]",
+       BGP_STR
+       "Save the Adj-RIB-In for a warm restart\n"
+       "Snapshot file\n"
+       "Interval between snapshots\n"
+       "Interval in seconds\n")
+{
+	uint32_t secs = interval_str ? interval : BGP_SNAPSHOT_INTERVAL_DEFAULT;
+
+	if (snapshot.filename && strmatch(snapshot.filename, filename) &&
+	    snapshot.interval == secs)
+		return CMD_SUCCESS;
+
+	XFREE(MTYPE_BGP_SNAPSHOT, snapshot.filename);
+	snapshot.filename = XSTRDUP(MTYPE_BGP_SNAPSHOT, filename);
+	snapshot.interval = secs;
+
+	/* configured at runtime, there is nothing to restore */
+	if (snapshot.restore_pending && snapshot.config_read &&
+	    !bgp_config_inprocess())
+		snapshot.restore_pending = false;
+
+	if (!snapshot.restore_pending)
+		bgp_snapshot_timer_start();
+
+	return CMD_SUCCESS;
+}
+
+DEFPY (no_bgp_snapshot,
+       no_bgp_snapshot_cmd,
+       "no bgp snapshot [FILENAME [interval (60-86400)]]",
+       NO_STR
+       BGP_STR
+       "Save the Adj-RIB-In for a warm restart\n"
+       "Snapshot file\n"
+       "Interval between snapshots\n"
+       "Interval in seconds\n")
+{
+	EVENT_OFF(snapshot.t_write);
+	XFREE(MTYPE_BGP_SNAPSHOT, snapshot.filename);
+	snapshot.interval = BGP_SNAPSHOT_INTERVAL_DEFAULT;
+
+	return CMD_SUCCESS;
+}
+
+static void snapshot_stats_vty(struct vty *vty, json_object *json,
+			       const char *what,
+			       const struct bgp_snapshot_stats *stats)
+{
+	json_object *json_stats;
+
+	if (json) {
+		json_stats = json_object_new_object();
+		json_object_int_add(json_stats, "time", stats->time);
+		json_object_int_add(json_stats, "secondsAgo",
+				    time(NULL) - stats->time);
+		json_object_int_add(json_stats, "peers", stats->peers);
+		json_object_int_add(json_stats, "attributes", stats->attrs);
+		json_object_int_add(json_stats, "paths", stats->paths);
+		json_object_int_add(json_stats, "bytes", stats->bytes);
+		json_object_int_add(json_stats, "msec", stats->usec / 1000);
+		json_object_object_add(json, what, json_stats);
+		return;
+	}
+
+	vty_out(vty,
+		"  Last %s: %lld seconds ago, %u peers, %u attributes, %u paths, %zu bytes, %lld msec\n",
+		what, (long long)(time(NULL) - stats->time), stats->peers,
+		stats->attrs, stats->paths, stats->bytes,
+		(long long)stats->usec / 1000);
+}
+
+DEFPY (show_bgp_snapshot,
+       show_bgp_snapshot_cmd,
+       "show bgp snapshot [json$uj]",
+       SHOW_STR
+       BGP_STR
+       "Adj-RIB-In snapshot for warm restart\n"
+       JSON_STR)
+{
+	json_object *json = NULL;
+
+	if (uj) {
+		json = json_object_new_object();
+		if (snapshot.filename) {
+			json_object_string_add(json, "file",
+					       snapshot.filename);
+			json_object_int_add(json, "interval",
+					    snapshot.interval);
+			if (event_is_scheduled(snapshot.t_write))
+				json_object_int_add(json, "nextWriteSeconds",
+						    event_timer_remain_second(
+							    snapshot.t_write));
+		}
+	} else if (snapshot.filename) {
+		vty_out(vty, "BGP snapshot %s, every %u seconds\n",
+			snapshot.filename, snapshot.interval);
+		if (event_is_scheduled(snapshot.t_write))
+			vty_out(vty, "  Next write in %lu seconds\n",
+				event_timer_remain_second(snapshot.t_write));
+	} else {
+		vty_out(vty, "BGP snapshot is not configured\n");
+	}
+
+	if (snapshot.written)
+		snapshot_stats_vty(vty, json, "write", &snapshot.last_write);
+	if (snapshot.restored)
+		snapshot_stats_vty(vty, json, "restore",
+				   &snapshot.last_restore);
+
+	if (uj)
+		vty_json(vty, json);
+
+	return CMD_SUCCESS;
+}
+
+void bgp_snapshot_config_write(struct vty *vty)
+{
+	if (!snapshot.filename)
+		return;
+
+	vty_out(vty, "bgp snapshot %s", snapshot.filename);
+	if (snapshot.interval != BGP_SNAPSHOT_INTERVAL_DEFAULT)
+		vty_out(vty, " interval %u", snapshot.interval);
+	vty_out(vty, "\n");
+}
+
+void bgp_snapshot_init(void)
+{
+	snapshot.interval = BGP_SNAPSHOT_INTERVAL_DEFAULT;
+	snapshot.restore_pending = true;
+
+	install_element(CONFIG_NODE, &bgp_snapshot_cmd);
+	install_element(CONFIG_NODE, &no_bgp_snapshot_cmd);
+	install_element(VIEW_NODE, &show_bgp_snapshot_cmd);
+
+	hook_register(bgp_config_end, bgp_snapshot_config_end);
+	hook_register(frr_config_post, bgp_snapshot_config_post);
+}
+
+void bgp_snapshot_finish(void)
+{
+	EVENT_OFF(snapshot.t_write);
+	XFREE(MTYPE_BGP_SNAPSHOT, snapshot.filename);
+
+	hook_unregister(bgp_config_end, bgp_snapshot_config_end);
+	hook_unregister(frr_config_post, bgp_snapshot_config_post);
+}
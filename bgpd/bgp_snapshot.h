@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* BGP Adj-RIB-In snapshot for warm restart
+ *
+ * The post-policy paths learned from peers, together with the attributes
+ * they reference, are periodically written to a compact binary file.  At
+ * startup the file is mapped back in and its paths are installed as stale
+ * so best-path selection and FIB programming can start before the peers
+ * have resent their tables.
+ */
+
+#ifndef _FRR_BGP_SNAPSHOT_H
+#define _FRR_BGP_SNAPSHOT_H
+
+#include "stream.h"
+#include "vty.h"
+
+#include "bgpd/bgp_attr.h"
+
+#define BGP_SNAPSHOT_MAGIC 0x46425253 /* "FBRS" */
+#define BGP_SNAPSHOT_VERSION 1
+
+#define BGP_SNAPSHOT_INTERVAL_DEFAULT 300
+
+/*
+ * File layout, all integers in network byte order:
+ *
+ *   header:  magic (4), version (2), reserved (2), unix time written (8)
+ *   records: type (1), payload length (4), payload
+ *
+ * Attribute and peer records are numbered in the order they appear and
+ * are always written before the first path record referencing them.  The
+ * file ends with a BGP_SNAPSHOT_REC_END record carrying the record counts;
+ * a file without it is rejected as truncated.
+ */
+#define BGP_SNAPSHOT_HEADER_SIZE 16
+#define BGP_SNAPSHOT_REC_HEADER_SIZE 5
+
+enum bgp_snapshot_rec_type {
+	BGP_SNAPSHOT_REC_PEER = 1,
+	BGP_SNAPSHOT_REC_ATTR = 2,
+	BGP_SNAPSHOT_REC_PATH = 3,
+	BGP_SNAPSHOT_REC_END = 255,
+};
+
+struct bgp_snapshot_stats {
+	/* wall clock time the snapshot was taken */
+	time_t time;
+
+	uint32_t peers;
+	uint32_t attrs;
+	uint32_t paths;
+	size_t bytes;
+
+	/* how long the write or the restore took */
+	int64_t usec;
+};
+
+extern void bgp_snapshot_init(void);
+extern void bgp_snapshot_finish(void);
+extern void bgp_snapshot_terminate(void);
+extern void bgp_snapshot_config_write(struct vty *vty);
+
+/* Write the Adj-RIB-In of all instances to filename.  0 on success. */
+extern int bgp_snapshot_write(const char *filename,
+			      struct bgp_snapshot_stats *stats);
+
+/* Install the paths of filename as stale paths of configured peers. */
+extern int bgp_snapshot_restore(const char *filename,
+				struct bgp_snapshot_stats *stats);
+
+/* Attribute record payload, exposed for the unit tests. */
+extern void bgp_snapshot_attr_encode(struct stream *s, const struct attr *attr);
+extern bool bgp_snapshot_attr_decode(const uint8_t *pnt, size_t len,
+				     struct attr *attr);
+
+/* Drop the restored paths of a peer that is going away. */
+extern void bgp_snapshot_peer_stop(struct peer *peer);
+
+/* End-of-RIB received from a peer holding restored paths. */
+extern void bgp_snapshot_peer_eor(struct peer *peer, afi_t afi, safi_t safi);
+
+#endif /* _FRR_BGP_SNAPSHOT_H */
@@ -15,7 +15,7 @@
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_table.h"
-#include "bgp_addpath.h"
+#include "bgpd/bgp_nhg.h"
 #include "bgp_trace.h"
 
 void bgp_table_lock(struct bgp_table *rt)
@@ -82,12 +82,7 @@ inline struct bgp_dest *bgp_dest_unlock_node(struct bgp_dest *dest)
 	struct route_node *rn = bgp_dest_to_rnode(dest);
 
 	if (rn->lock == 1) {
-		struct bgp_table *rt = bgp_dest_table(dest);
-		if (rt->bgp) {
-			bgp_addpath_free_node_data(&rt->bgp->tx_addpath,
-						   &dest->tx_addpath, rt->afi,
-						   rt->safi);
-		}
+		bgp_nhg_route_put(dest->za_nhg_id);
 		XFREE(MTYPE_BGP_NODE, dest);
 		dest = NULL;
 		rn->info = NULL;
@@ -104,15 +99,9 @@ static void bgp_node_destroy(route_table_delegate_t *delegate,
 							struct route_table *table, struct route_node *node)
 {
 	struct bgp_dest *dest;
-	struct bgp_table *rt;
 	dest = bgp_dest_from_rnode(node);
-	rt = table->info;
 	if (dest) {
-		if (rt->bgp) {
-			bgp_addpath_free_node_data(&rt->bgp->tx_addpath,
-										&dest->tx_addpath,
-										rt->afi, rt->safi);
-		}
+		bgp_nhg_route_put(dest->za_nhg_id);
 		XFREE(MTYPE_BGP_NODE, dest);
 		node->info = NULL;
 	}
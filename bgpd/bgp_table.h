@@ -80,6 +80,8 @@ struct bgp_dest {
 	struct bgp_path_info *za_bgp_pi;
 	struct bgpevpn *za_vpn;
 	bool za_is_sync;
+	/* Shared NHG the route was last installed with, if any */
+	uint32_t za_nhg_id;
 
 	uint64_t version;
 
@@ -99,8 +101,6 @@ struct bgp_dest {
 #define BGP_NODE_SCHEDULE_FOR_INSTALL	(1 << 10)
 #define BGP_NODE_SCHEDULE_FOR_DELETE	(1 << 11)
 
-	struct bgp_addpath_node_data tx_addpath;
-
 	enum bgp_path_selection_reason reason;
 };
 
@@ -39,6 +39,7 @@
 #include "bgpd/bgp_packet.h"
 #include "bgpd/bgp_updgrp.h"
 #include "bgpd/bgp_route.h"
+#include "bgpd/bgp_label.h"
 #include "bgpd/bgp_filter.h"
 #include "bgpd/bgp_io.h"
 
@@ -159,8 +160,6 @@ static void conf_copy(struct peer *dst, struct peer *src, afi_t afi,
 
 	memcpy(&(dst->nexthop), &(src->nexthop), sizeof(struct bgp_nexthop));
 
-	dst->group = src->group;
-
 	if (src->default_rmap[afi][safi].name) {
 		dst->default_rmap[afi][safi].name =
 			XSTRDUP(MTYPE_ROUTE_MAP_NAME,
@@ -287,33 +286,61 @@ static void *updgrp_hash_alloc(void *p)
 	return updgrp;
 }
 
+/*
+ * Configuration flags that cannot change what is sent to this peer are left
+ * out of the update-group match, so that e.g. remove-private-AS on an IBGP
+ * neighbor or local-as modifiers without local-as do not split the group.
+ */
+static uint64_t updgrp_peer_flags(const struct peer *peer)
+{
+	if (!peer->change_local_as)
+		return 0;
+
+	return peer->flags & PEER_UPDGRP_FLAGS;
+}
+
+static uint64_t updgrp_peer_af_flags(const struct peer *peer,
+				     enum bgp_peer_sort sort, afi_t afi,
+				     safi_t safi)
+{
+	uint64_t flags = peer->af_flags[afi][safi] & PEER_UPDGRP_AF_FLAGS;
+
+	if (sort != BGP_PEER_EBGP)
+		UNSET_FLAG(flags, PEER_UPDGRP_AF_EBGP_FLAGS);
+
+	return flags;
+}
+
 /**
  * The hash value for a peer is computed from the following variables:
  * v = f(
  *       1. IBGP (1) or EBGP (2)
- *       2. FLAGS based on configuration:
+ *       2. FLAGS based on configuration (only with local-as):
  *             LOCAL_AS_NO_PREPEND
  *             LOCAL_AS_REPLACE_AS
  *       3. AF_FLAGS based on configuration:
- *             Refer to definition in bgp_updgrp.h
+ *             Refer to definition in bgp_updgrp.h, EBGP-only
+ *             flags are ignored for other peer types
  *       4. (AF-independent) Capability flags:
  *             AS4_RCV capability
  *       5. (AF-dependent) Capability flags:
  *             ORF_PREFIX_SM_RCV (peer can send prefix ORF)
  *       6. MRAI
- *       7. peer-group name
- *       8. Outbound route-map name (neighbor route-map <> out)
- *       9. Outbound distribute-list name (neighbor distribute-list <> out)
- *       10. Outbound prefix-list name (neighbor prefix-list <> out)
- *       11. Outbound as-list name (neighbor filter-list <> out)
- *       12. Unsuppress map name (neighbor unsuppress-map <>)
- *       13. default rmap name (neighbor default-originate route-map <>)
- *       14. encoding both global and link-local nexthop?
- *       15. If peer is configured to be a lonesoul, peer ip address
- *       16. Local-as should match, if configured.
- *       17. maximum-prefix-out
- *       18. Local-role should also match, if configured.
- *       19. Add-Path best selected paths count should match as well
+ *       7. Outbound route-map name (neighbor route-map <> out)
+ *       8. Outbound distribute-list name (neighbor distribute-list <> out)
+ *       9. Outbound prefix-list name (neighbor prefix-list <> out)
+ *       10. Outbound as-list name (neighbor filter-list <> out)
+ *       11. Unsuppress map name (neighbor unsuppress-map <>)
+ *       12. default rmap name (neighbor default-originate route-map <>)
+ *       13. encoding both global and link-local nexthop?
+ *       14. If peer is configured to be a lonesoul, peer ip address
+ *       15. Local-as should match, if configured.
+ *       16. maximum-prefix-out
+ *       17. Local-role should also match, if configured.
+ *       18. Add-Path best selected paths count should match as well
+ *
+ * The peer-group itself is not part of the key, peers of different groups
+ * (or none) with the same effective outbound policy share an update-group.
  *      )
  */
 static unsigned int updgrp_hash_key_make(const void *p)
@@ -321,6 +348,7 @@ static unsigned int updgrp_hash_key_make(const void *p)
 	const struct update_group *updgrp;
 	const struct peer *peer;
 	const struct bgp_filter *filter;
+	enum bgp_peer_sort sort;
 	uint64_t flags;
 	uint32_t key;
 	afi_t afi;
@@ -338,7 +366,6 @@ static unsigned int updgrp_hash_key_make(const void *p)
 	peer = updgrp->conf;
 	afi = updgrp->afi;
 	safi = updgrp->safi;
-	flags = peer->af_flags[afi][safi];
 	filter = &peer->filter[afi][safi];
 
 	key = 0;
@@ -348,10 +375,13 @@ static unsigned int updgrp_hash_key_make(const void *p)
 	 * we need to call the peer_sort() here also to properly create
 	 * separate subgroups.
 	 */
-	key = jhash_1word(peer_sort((struct peer *)peer), key);
+	sort = peer_sort((struct peer *)peer);
+	flags = updgrp_peer_af_flags(peer, sort, afi, safi);
+
+	key = jhash_1word(sort, key);
 	key = jhash_1word(peer->sub_sort, key); /* OAD */
-	key = jhash_1word((peer->flags & PEER_UPDGRP_FLAGS), key);
-	key = jhash_1word((flags & PEER_UPDGRP_AF_FLAGS), key);
+	key = jhash_1word(updgrp_peer_flags(peer), key);
+	key = jhash_1word(flags, key);
 	key = jhash_1word((uint32_t)peer->addpath_type[afi][safi], key);
 	key = jhash_1word(peer->addpath_best_selected[afi][safi], key);
 	key = jhash_1word(peer->addpath_paths_limit[afi][safi].receive, key);
@@ -370,11 +400,6 @@ static unsigned int updgrp_hash_key_make(const void *p)
 				   CHECK_FLAG(peer->flags,
 					      PEER_FLAG_AS_LOOP_DETECTION),
 				   key);
-	if (peer->group)
-		key = jhash_1word(jhash(peer->group->name,
-					strlen(peer->group->name), SEED1),
-				  key);
-
 	if (filter->map[RMAP_OUT].name)
 		key = jhash_1word(jhash(filter->map[RMAP_OUT].name,
 					strlen(filter->map[RMAP_OUT].name),
@@ -462,8 +487,7 @@ static unsigned int updgrp_hash_key_make(const void *p)
 	if (bgp_debug_neighbor_events(peer)) {
 		zlog_debug("%pBP Update Group Hash: sort: %d sub_sort: %d UpdGrpFlags: %ju UpdGrpAFFlags: %ju",
 			   peer, peer->sort, peer->sub_sort,
-			   (intmax_t)CHECK_FLAG(peer->flags, PEER_UPDGRP_FLAGS),
-			   (intmax_t)CHECK_FLAG(flags, PEER_UPDGRP_AF_FLAGS));
+			   (intmax_t)updgrp_peer_flags(peer), (intmax_t)flags);
 		zlog_debug("%pBP Update Group Hash: addpath: %u UpdGrpCapFlag: %ju UpdGrpCapAFFlag: %u route_adv: %u change local as: %u, as_path_loop_detection: %d",
 			   peer, (uint32_t)peer->addpath_type[afi][safi],
 			   (intmax_t)CHECK_FLAG(peer->cap,
@@ -477,9 +501,8 @@ static unsigned int updgrp_hash_key_make(const void *p)
 			   peer, peer->addpath_paths_limit[afi][safi].send,
 			   peer->addpath_paths_limit[afi][safi].receive);
 		zlog_debug(
-			"%pBP Update Group Hash: max packet size: %u pmax_out: %u Peer Group: %s rmap out: %s",
+			"%pBP Update Group Hash: max packet size: %u pmax_out: %u rmap out: %s",
 			peer, peer->max_packet_size, peer->pmax_out[afi][safi],
-			peer->group ? peer->group->name : "(NONE)",
 			ROUTE_MAP_OUT_NAME(filter) ? ROUTE_MAP_OUT_NAME(filter)
 						   : "(NONE)");
 		zlog_debug(
@@ -548,8 +571,6 @@ static bool updgrp_hash_cmp(const void *p1, const void *p2)
 	pe2 = grp2->conf;
 	afi = grp1->afi;
 	safi = grp1->safi;
-	flags1 = pe1->af_flags[afi][safi];
-	flags2 = pe2->af_flags[afi][safi];
 	fl1 = &pe1->filter[afi][safi];
 	fl2 = &pe2->filter[afi][safi];
 
@@ -557,20 +578,21 @@ static bool updgrp_hash_cmp(const void *p1, const void *p2)
 	if (pe1->sort != pe2->sort)
 		return false;
 
-	/* check peer flags */
-	if ((pe1->flags & PEER_UPDGRP_FLAGS)
-	    != (pe2->flags & PEER_UPDGRP_FLAGS))
-		return false;
-
 	/* If there is 'local-as' configured, it should match. */
 	if (pe1->change_local_as != pe2->change_local_as)
 		return false;
 
+	/* check peer flags */
+	if (updgrp_peer_flags(pe1) != updgrp_peer_flags(pe2))
+		return false;
+
 	if (pe1->pmax_out[afi][safi] != pe2->pmax_out[afi][safi])
 		return false;
 
 	/* flags like route reflector client */
-	if ((flags1 & PEER_UPDGRP_AF_FLAGS) != (flags2 & PEER_UPDGRP_AF_FLAGS))
+	flags1 = updgrp_peer_af_flags(pe1, pe1->sort, afi, safi);
+	flags2 = updgrp_peer_af_flags(pe2, pe2->sort, afi, safi);
+	if (flags1 != flags2)
 		return false;
 
 	if (pe1->addpath_type[afi][safi] != pe2->addpath_type[afi][safi])
@@ -587,9 +609,6 @@ static bool updgrp_hash_cmp(const void *p1, const void *p2)
 	if (pe1->v_routeadv != pe2->v_routeadv)
 		return false;
 
-	if (pe1->group != pe2->group)
-		return false;
-
 	/* Roles can affect filtering */
 	if (pe1->local_role != pe2->local_role)
 		return false;
@@ -862,6 +881,8 @@ static int update_group_show_walkcb(struct update_group *updgrp, void *arg)
 			json_object_int_add(json_subgrp_event,
 					    "mergeCheckEvents",
 					    subgrp->merge_checks_triggered);
+			json_object_int_add(json_subgrp_event, "adjSyncEvents",
+					    subgrp->adj_sync_events);
 			json_object_object_add(json_subgrp, "statistics",
 					       json_subgrp_event);
 			json_object_int_add(json_subgrp, "coalesceTime",
@@ -905,6 +926,8 @@ static int update_group_show_walkcb(struct update_group *updgrp, void *arg)
 				subgrp->peer_refreshes_combined);
 			vty_out(vty, "    Merge checks triggered: %u\n",
 				subgrp->merge_checks_triggered);
+			vty_out(vty, "    Adj-out syncs: %u\n",
+				subgrp->adj_sync_events);
 			vty_out(vty, "    Coalesce Time: %u%s\n",
 				(UPDGRP_INST(subgrp->update_group))
 					->coalesce_time,
@@ -1504,6 +1527,8 @@ static void update_subgroup_copy_adj_out(struct update_subgroup *source,
 					      aout->addpath_tx_id);
 		aout_copy->attr =
 			aout->attr ? bgp_attr_intern(aout->attr) : NULL;
+		aout_copy->attr_hash = aout->attr_hash;
+		aout_copy->labels = bgp_labels_intern(aout->labels);
 	}
 
 	dest->scount = source->scount;
@@ -1625,6 +1650,18 @@ static int updgrp_route_map_update(struct update_group *updgrp,
 	return changed;
 }
 
+static void updwalk_subgrp_add(struct update_subgroup ***subgrps,
+			       size_t *count, size_t *size,
+			       struct update_subgroup *subgrp)
+{
+	if (*count == *size) {
+		*size = *size ? *size * 2 : 16;
+		*subgrps = XREALLOC(MTYPE_TMP, *subgrps,
+				    *size * sizeof(**subgrps));
+	}
+	(*subgrps)[(*count)++] = subgrp;
+}
+
 /*
  * hash iteration callback function to process a policy change for an
  * update group. Check if the changed policy matches the updgrp's
@@ -1685,6 +1722,11 @@ static int updgrp_policy_update_walkcb(struct update_group *updgrp, void *arg)
 		return UPDWALK_CONTINUE;
 	}
 
+	/*
+	 * The refresh itself is done after the walk, so that all subgroups
+	 * of an AFI/SAFI affected by the change share one table walk, see
+	 * update_group_policy_refresh().
+	 */
 	UPDGRP_FOREACH_SUBGRP (updgrp, subgrp) {
 		/* Avoid supressing duplicate routes later
 		 * when processing in subgroup_announce_table().
@@ -1697,7 +1739,8 @@ static int updgrp_policy_update_walkcb(struct update_group *updgrp, void *arg)
 					"u%" PRIu64 ":s%" PRIu64" announcing routes upon policy %s (type %d) change",
 					updgrp->id, subgrp->id,
 					ctx->policy_name, ctx->policy_type);
-			subgroup_announce_route(subgrp);
+			updwalk_subgrp_add(&ctx->refresh, &ctx->refresh_count,
+					   &ctx->refresh_size, subgrp);
 		}
 		if (def_changed) {
 			if (bgp_debug_update(NULL, NULL, updgrp, 0))
@@ -1705,28 +1748,52 @@ static int updgrp_policy_update_walkcb(struct update_group *updgrp, void *arg)
 					"u%" PRIu64 ":s%" PRIu64" announcing default upon default routemap %s change",
 					updgrp->id, subgrp->id,
 					ctx->policy_name);
-			if (route_map_lookup_by_name(ctx->policy_name)) {
-				/*
-				 * When there is change in routemap, this flow
-				 * is triggered. the routemap is still present
-				 * in lib, hence its a update flow. The flag
-				 * needs to be unset.
-				 */
-				UNSET_FLAG(subgrp->sflags,
-					   SUBGRP_STATUS_DEFAULT_ORIGINATE);
-				subgroup_default_originate(subgrp, false);
-			} else {
-				/*
-				 * This is a explicit withdraw, since the
-				 * routemap is not present in routemap lib. need
-				 * to pass `true` for withdraw arg.
-				 */
-				subgroup_default_originate(subgrp, true);
-			}
+			updwalk_subgrp_add(&ctx->def_refresh,
+					   &ctx->def_refresh_count,
+					   &ctx->def_refresh_size, subgrp);
+		} else if (!changed)
+			update_subgroup_set_needs_refresh(subgrp, 0);
+	}
+	return UPDWALK_CONTINUE;
+}
+
+/*
+ * Carry out the refreshes collected by updgrp_policy_update_walkcb().
+ */
+static void update_group_policy_refresh(struct updwalk_context *ctx)
+{
+	struct update_subgroup *subgrp;
+	size_t i;
+
+	if (ctx->refresh_count)
+		subgroups_announce_route(ctx->refresh, ctx->refresh_count);
+
+	for (i = 0; i < ctx->def_refresh_count; i++) {
+		subgrp = ctx->def_refresh[i];
+
+		if (route_map_lookup_by_name(ctx->policy_name)) {
+			/*
+			 * When there is change in routemap, this flow
+			 * is triggered. the routemap is still present
+			 * in lib, hence its a update flow. The flag
+			 * needs to be unset.
+			 */
+			UNSET_FLAG(subgrp->sflags,
+				   SUBGRP_STATUS_DEFAULT_ORIGINATE);
+			subgroup_default_originate(subgrp, false);
+		} else {
+			/*
+			 * This is a explicit withdraw, since the
+			 * routemap is not present in routemap lib. need
+			 * to pass `true` for withdraw arg.
+			 */
+			subgroup_default_originate(subgrp, true);
 		}
 		update_subgroup_set_needs_refresh(subgrp, 0);
 	}
-	return UPDWALK_CONTINUE;
+
+	XFREE(MTYPE_TMP, ctx->refresh);
+	XFREE(MTYPE_TMP, ctx->def_refresh);
 }
 
 static int update_group_walkcb(struct hash_bucket *bucket, void *arg)
@@ -1770,6 +1837,76 @@ void update_group_policy_update(struct bgp *bgp, enum bgp_policy_type ptype,
 	ctx.flags = 0;
 
 	update_group_walk(bgp, updgrp_policy_update_walkcb, &ctx);
+	update_group_policy_refresh(&ctx);
+}
+
+/*
+ * update_subgroup_announced
+ *
+ * Returns true if the subgroup is done with its initial announcement,
+ * i.e. its adj-out reflects the whole table and not just the part that
+ * was walked so far.
+ */
+static bool update_subgroup_announced(struct update_subgroup *subgrp)
+{
+	struct peer_af *paf;
+
+	if (subgrp->t_coalesce || subgrp->v_coalesce)
+		return false;
+
+	SUBGRP_FOREACH_PEER (subgrp, paf)
+		if (paf->t_announce_route)
+			return false;
+
+	return true;
+}
+
+/*
+ * update_subgroup_sync_from_sibling
+ *
+ * A subgroup that just moved into an update group carries an adj-out
+ * computed under its old policy. If another subgroup of the new update
+ * group is fully caught up, its adj-out is exactly what the new policy
+ * produces for the current table, so only the difference between the two
+ * needs to be advertised instead of re-running the outbound policy over
+ * the whole table.
+ *
+ * Returns true if the adj-out was synced, false if a refresh is needed.
+ */
+static bool update_subgroup_sync_from_sibling(struct update_subgroup *subgrp)
+{
+	struct update_subgroup *target;
+
+	UNSET_FLAG(subgrp->sflags, SUBGRP_STATUS_ADJ_SYNCED);
+
+	if (CHECK_FLAG(subgrp->sflags, SUBGRP_STATUS_DEFAULT_ORIGINATE))
+		return false;
+
+	UPDGRP_FOREACH_SUBGRP (subgrp->update_group, target) {
+		if (target == subgrp)
+			continue;
+
+		if (CHECK_FLAG(target->sflags,
+			       SUBGRP_STATUS_DEFAULT_ORIGINATE))
+			continue;
+
+		if (update_subgroup_ready_for_merge(target) &&
+		    update_subgroup_announced(target))
+			break;
+	}
+
+	if (!target || !subgroup_sync_adj_out(subgrp, target))
+		return false;
+
+	if (BGP_DEBUG(update_groups, UPDATE_GROUPS))
+		zlog_debug("u%" PRIu64 ":s%" PRIu64
+			   " adj-out synced from u%" PRIu64 ":s%" PRIu64,
+			   subgrp->update_group->id, subgrp->id,
+			   target->update_group->id, target->id);
+
+	SET_FLAG(subgrp->sflags, SUBGRP_STATUS_ADJ_SYNCED);
+	SUBGRP_INCR_STAT(subgrp, adj_sync_events);
+	return true;
 }
 
 /*
@@ -1821,10 +1958,12 @@ void update_subgroup_split_peer(struct peer_af *paf,
 		 * The state of the subgroup (adj_out, advs, packet queue etc)
 		 * is consistent internally, but may not be identical to other
 		 * subgroups in the new update group even if the version number
-		 * matches up. Make sure a full refresh is done before the
-		 * subgroup is merged with another.
+		 * matches up. Bring it in line with a caught up sibling, or
+		 * make sure a full refresh is done before the subgroup is
+		 * merged with another.
 		 */
-		update_subgroup_set_needs_refresh(subgrp, 1);
+		if (!update_subgroup_sync_from_sibling(subgrp))
+			update_subgroup_set_needs_refresh(subgrp, 1);
 
 		SUBGRP_INCR_STAT(subgrp, updgrp_switch_events);
 		return;
@@ -1855,9 +1994,10 @@ void update_subgroup_split_peer(struct peer_af *paf,
 
 	/*
 	 * Since queued advs were left behind, this new subgroup needs a
-	 * refresh.
+	 * refresh, unless it can be synced from a sibling.
 	 */
-	update_subgroup_set_needs_refresh(subgrp, 1);
+	if (!update_subgroup_sync_from_sibling(subgrp))
+		update_subgroup_set_needs_refresh(subgrp, 1);
 
 	/*
 	 * Remove peer from old subgroup, and add it to the new one.
@@ -1948,6 +2088,8 @@ void update_group_show_stats(struct bgp *bgp, struct vty *vty)
 		bgp->update_group_stats.peer_refreshes_combined);
 	vty_out(vty, "Merge checks triggered: %u\n",
 		bgp->update_group_stats.merge_checks_triggered);
+	vty_out(vty, "Adj-out syncs: %u\n",
+		bgp->update_group_stats.adj_sync_events);
 }
 
 /*
@@ -51,6 +51,13 @@
 	 PEER_FLAG_REMOVE_PRIVATE_AS_REPLACE |                                 \
 	 PEER_FLAG_REMOVE_PRIVATE_AS_ALL_REPLACE | PEER_FLAG_AS_OVERRIDE)
 
+/* The subset of PEER_UPDGRP_AF_FLAGS that only has an effect on EBGP peers */
+#define PEER_UPDGRP_AF_EBGP_FLAGS                                              \
+	(PEER_FLAG_AS_PATH_UNCHANGED | PEER_FLAG_MED_UNCHANGED |               \
+	 PEER_FLAG_REMOVE_PRIVATE_AS | PEER_FLAG_REMOVE_PRIVATE_AS_ALL |       \
+	 PEER_FLAG_REMOVE_PRIVATE_AS_REPLACE |                                 \
+	 PEER_FLAG_REMOVE_PRIVATE_AS_ALL_REPLACE | PEER_FLAG_AS_OVERRIDE)
+
 #define PEER_UPDGRP_CAP_FLAGS (PEER_CAP_AS4_RCV)
 
 #define PEER_UPDGRP_AF_CAP_FLAGS                                               \
@@ -91,6 +98,26 @@ struct bpacket {
 	unsigned int ver;
 };
 
+/*
+ * Plain (unicast/multicast) NLRI of an UPDATE under construction, queued
+ * up so that they can be encoded in one go once the packet is known to
+ * have room for them.
+ */
+#define BPACKET_NLRI_BATCH_MAX 128
+
+struct bpacket_nlri_batch {
+	bool addpath_capable;
+	uint16_t count;
+
+	/* encoded length of the queued NLRI */
+	size_t len;
+
+	struct {
+		const struct prefix *p;
+		uint32_t addpath_tx_id;
+	} nlri[BPACKET_NLRI_BATCH_MAX];
+};
+
 struct bpacket_queue {
 	TAILQ_HEAD(pkt_queue, bpacket) pkts;
 
@@ -126,6 +153,7 @@ struct update_group {
 	uint32_t adj_count;
 	uint32_t split_events;
 	uint32_t merge_checks_triggered;
+	uint32_t adj_sync_events;
 
 	uint32_t subgrps_created;
 	uint32_t subgrps_deleted;
@@ -231,6 +259,12 @@ struct update_subgroup {
 	uint32_t split_events;
 	uint32_t merge_checks_triggered;
 
+	/*
+	 * Bumped up when the adj-out was brought in line with a sibling
+	 * subgroup instead of doing a full refresh.
+	 */
+	uint32_t adj_sync_events;
+
 	uint64_t id;
 
 	uint16_t sflags;
@@ -244,6 +278,8 @@ struct update_subgroup {
  * not during the update workflow.
  */
 #define SUBGRP_STATUS_PEER_DEFAULT_ORIGINATED (1 << 3)
+/* adj-out copied from a sibling, a non-forced refresh has nothing to do */
+#define SUBGRP_STATUS_ADJ_SYNCED (1 << 4)
 
 	uint16_t flags;
 #define SUBGRP_FLAG_NEEDS_REFRESH (1 << 0)
@@ -290,6 +326,13 @@ struct updwalk_context {
 	bool uj;
 	json_object *json_updategrps;
 
+	/* subgroups to refresh once a policy change walk is done */
+	struct update_subgroup **refresh;
+	size_t refresh_count, refresh_size;
+	/* ... and those that need default-originate redone after that */
+	struct update_subgroup **def_refresh;
+	size_t def_refresh_count, def_refresh_size;
+
 #define UPDWALK_FLAGS_ADVQUEUE   (1 << 0)
 #define UPDWALK_FLAGS_ADVERTISED (1 << 1)
 };
@@ -399,6 +442,13 @@ extern void bpacket_queue_show_vty(struct bpacket_queue *q, struct vty *vty);
 bool subgroup_packets_to_build(struct update_subgroup *subgrp);
 extern struct bpacket *subgroup_update_packet(struct update_subgroup *s);
 extern struct bpacket *subgroup_withdraw_packet(struct update_subgroup *s);
+extern void bpacket_nlri_batch_init(struct bpacket_nlri_batch *batch,
+				    bool addpath_capable);
+extern bool bpacket_nlri_batch_add(struct bpacket_nlri_batch *batch,
+				   const struct prefix *p,
+				   uint32_t addpath_tx_id);
+extern size_t bpacket_nlri_batch_flush(struct bpacket_nlri_batch *batch,
+				       struct stream *s);
 extern struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 						struct peer_af *paf);
 extern void bpacket_attr_vec_arr_reset(struct bpacket_attr_vec_arr *vecarr);
@@ -423,6 +473,8 @@ extern void update_group_show_packet_queue(struct bgp *bgp, afi_t afi,
 					   safi_t safi, struct vty *vty,
 					   uint64_t id);
 extern void subgroup_announce_route(struct update_subgroup *subgrp);
+extern void subgroups_announce_route(struct update_subgroup **subgrps,
+				     size_t count);
 extern void subgroup_announce_all(struct update_subgroup *subgrp);
 
 extern void subgroup_default_originate(struct update_subgroup *subgrp,
@@ -431,6 +483,8 @@ extern void group_announce_route(struct bgp *bgp, afi_t afi, safi_t safi,
 				 struct bgp_dest *dest,
 				 struct bgp_path_info *pi);
 extern void subgroup_clear_table(struct update_subgroup *subgrp);
+extern bool subgroup_sync_adj_out(struct update_subgroup *subgrp,
+				  struct update_subgroup *from);
 extern void update_group_announce(struct bgp *bgp);
 extern void update_group_announce_rrclients(struct bgp *bgp);
 extern void peer_af_announce_route(struct peer_af *paf, int combine);
@@ -740,32 +740,11 @@ void subgroup_clear_table(struct update_subgroup *subgrp)
 		bgp_adj_out_remove_subgroup(aout->dest, aout, subgrp);
 }
 
-/*
- * subgroup_announce_table
- */
-void subgroup_announce_table(struct update_subgroup *subgrp,
-			     struct bgp_table *table)
+static void subgroup_announce_table_start(struct update_subgroup *subgrp)
 {
-	struct bgp_dest *dest;
-	struct bgp_path_info *ri;
-	struct peer *peer;
-	afi_t afi;
-	safi_t safi;
-	safi_t safi_rib;
-	bool addpath_capable;
-
-	peer = SUBGRP_PEER(subgrp);
-	afi = SUBGRP_AFI(subgrp);
-	safi = SUBGRP_SAFI(subgrp);
-	addpath_capable = bgp_addpath_encode_tx(peer, afi, safi);
-
-	if (safi == SAFI_LABELED_UNICAST)
-		safi_rib = SAFI_UNICAST;
-	else
-		safi_rib = safi;
-
-	if (!table)
-		table = peer->bgp->rib[afi][safi_rib];
+	struct peer *peer = SUBGRP_PEER(subgrp);
+	afi_t afi = SUBGRP_AFI(subgrp);
+	safi_t safi = SUBGRP_SAFI(subgrp);
 
 	if (safi != SAFI_MPLS_VPN && safi != SAFI_ENCAP && safi != SAFI_EVPN
 	    && CHECK_FLAG(peer->af_flags[afi][safi],
@@ -774,37 +753,48 @@ void subgroup_announce_table(struct update_subgroup *subgrp,
 
 	subgrp->pscount = 0;
 	SET_FLAG(subgrp->sflags, SUBGRP_STATUS_TABLE_REPARSING);
+}
 
-	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
-
-		if (addpath_capable)
-			subgrp_announce_addpath_best_selected(dest, subgrp);
+static void subgroup_announce_dest(struct update_subgroup *subgrp,
+				   struct bgp_dest *dest, safi_t safi_rib,
+				   bool addpath_capable)
+{
+	struct bgp_path_info *ri;
+	struct peer *peer = SUBGRP_PEER(subgrp);
+	afi_t afi = SUBGRP_AFI(subgrp);
+	safi_t safi = SUBGRP_SAFI(subgrp);
 
-		for (ri = bgp_dest_get_bgp_path_info(dest); ri; ri = ri->next) {
+	if (addpath_capable)
+		subgrp_announce_addpath_best_selected(dest, subgrp);
 
-			if (!bgp_check_selected(ri, peer, addpath_capable, afi,
-						safi_rib))
-				continue;
+	for (ri = bgp_dest_get_bgp_path_info(dest); ri; ri = ri->next) {
 
-			/* If default originate is enabled for
-			 * the peer, do not send explicit
-			 * withdraw. This will prevent deletion
-			 * of default route advertised through
-			 * default originate
-			 */
-			if (CHECK_FLAG(peer->af_flags[afi][safi],
-				       PEER_FLAG_DEFAULT_ORIGINATE) &&
-			    is_default_prefix(bgp_dest_get_prefix(dest)))
-				break;
+		if (!bgp_check_selected(ri, peer, addpath_capable, afi,
+					safi_rib))
+			continue;
 
-			if (CHECK_FLAG(ri->flags, BGP_PATH_SELECTED))
-				subgroup_process_announce_selected(
-					subgrp, ri, dest, afi, safi_rib,
-					bgp_addpath_id_for_peer(
-						peer, afi, safi_rib,
-						&ri->tx_addpath));
-		}
+		/* If default originate is enabled for
+		 * the peer, do not send explicit
+		 * withdraw. This will prevent deletion
+		 * of default route advertised through
+		 * default originate
+		 */
+		if (CHECK_FLAG(peer->af_flags[afi][safi],
+			       PEER_FLAG_DEFAULT_ORIGINATE) &&
+		    is_default_prefix(bgp_dest_get_prefix(dest)))
+			break;
+
+		if (CHECK_FLAG(ri->flags, BGP_PATH_SELECTED))
+			subgroup_process_announce_selected(
+				subgrp, ri, dest, afi, safi_rib,
+				bgp_addpath_id_for_peer(peer, afi, safi_rib,
+							&ri->tx_addpath));
 	}
+}
+
+static void subgroup_announce_table_end(struct update_subgroup *subgrp,
+					struct bgp_table *table)
+{
 	UNSET_FLAG(subgrp->sflags, SUBGRP_STATUS_TABLE_REPARSING);
 
 	/*
@@ -823,43 +813,264 @@ void subgroup_announce_table(struct update_subgroup *subgrp,
 	update_subgroup_trigger_merge_check(subgrp, 0);
 }
 
+static inline safi_t subgroup_rib_safi(struct update_subgroup *subgrp)
+{
+	if (SUBGRP_SAFI(subgrp) == SAFI_LABELED_UNICAST)
+		return SAFI_UNICAST;
+
+	return SUBGRP_SAFI(subgrp);
+}
+
 /*
- * subgroup_announce_route
+ * The path an adj-out entry of a settled subgroup was built from.
+ */
+static struct bgp_path_info *adj_out_path(struct update_subgroup *subgrp,
+					  struct bgp_adj_out *adj,
+					  bool addpath_capable)
+{
+	struct bgp_path_info *pi;
+	struct peer *peer = SUBGRP_PEER(subgrp);
+	afi_t afi = SUBGRP_AFI(subgrp);
+	safi_t safi = subgroup_rib_safi(subgrp);
+
+	for (pi = bgp_dest_get_bgp_path_info(adj->dest); pi; pi = pi->next)
+		if (bgp_check_selected(pi, peer, addpath_capable, afi, safi) &&
+		    bgp_addpath_id_for_peer(peer, afi, safi, &pi->tx_addpath) ==
+			    adj->addpath_tx_id)
+			return pi;
+
+	return NULL;
+}
+
+/*
+ * subgroup_sync_adj_out
  *
- * Refresh all routes out to a subgroup.
+ * Bring the adj-out of a subgroup in line with that of another subgroup
+ * of the same update group, which must not have anything pending. Both
+ * share the outbound policy, so the adj-out of 'from' is what a full
+ * refresh of 'subgrp' would end up with; only the differences are
+ * advertised or withdrawn, without running the policy again.
+ *
+ * Returns false, with the adj-out of 'subgrp' left alone, if an entry
+ * could not be matched to its path any more; the subgroup needs a full
+ * refresh then.
  */
-void subgroup_announce_route(struct update_subgroup *subgrp)
+bool subgroup_sync_adj_out(struct update_subgroup *subgrp,
+			   struct update_subgroup *from)
+{
+	struct bgp_adj_out *aout, *taout, *ours;
+	struct bgp_path_info *pi;
+	bool addpath_capable;
+
+	addpath_capable = bgp_addpath_encode_tx(SUBGRP_PEER(subgrp),
+						SUBGRP_AFI(subgrp),
+						SUBGRP_SAFI(subgrp));
+
+	/* make sure every entry can be synced before changing anything */
+	SUBGRP_FOREACH_ADJ (from, aout) {
+		if (!aout->attr)
+			return false;
+
+		ours = adj_lookup(aout->dest, subgrp, aout->addpath_tx_id);
+		if (ours && !ours->adv && ours->attr == aout->attr &&
+		    ours->labels == aout->labels)
+			continue;
+
+		if (!adj_out_path(from, aout, addpath_capable))
+			return false;
+	}
+
+	SUBGRP_FOREACH_ADJ_SAFE (subgrp, aout, taout)
+		if (!adj_lookup(aout->dest, from, aout->addpath_tx_id))
+			bgp_adj_out_unset_subgroup(aout->dest, subgrp, 1,
+						   aout->addpath_tx_id);
+
+	SUBGRP_FOREACH_ADJ (from, aout) {
+		ours = adj_lookup(aout->dest, subgrp, aout->addpath_tx_id);
+		if (ours && !ours->adv && ours->attr == aout->attr &&
+		    ours->labels == aout->labels)
+			continue;
+
+		pi = adj_out_path(from, aout, addpath_capable);
+		bgp_adj_out_set_subgroup(aout->dest, subgrp, aout->attr, pi);
+	}
+
+	subgrp->version = from->version;
+	return true;
+}
+
+/*
+ * subgroup_announce_table
+ */
+void subgroup_announce_table(struct update_subgroup *subgrp,
+			     struct bgp_table *table)
 {
 	struct bgp_dest *dest;
-	struct bgp_table *table;
-	struct peer *onlypeer;
+	struct peer *peer;
+	safi_t safi_rib;
+	bool addpath_capable;
 
-	if (update_subgroup_needs_refresh(subgrp)) {
-		update_subgroup_set_needs_refresh(subgrp, 0);
+	peer = SUBGRP_PEER(subgrp);
+	safi_rib = subgroup_rib_safi(subgrp);
+	addpath_capable = bgp_addpath_encode_tx(peer, SUBGRP_AFI(subgrp),
+						SUBGRP_SAFI(subgrp));
+
+	if (!table)
+		table = peer->bgp->rib[SUBGRP_AFI(subgrp)][safi_rib];
+
+	subgroup_announce_table_start(subgrp);
+
+	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest))
+		subgroup_announce_dest(subgrp, dest, safi_rib, addpath_capable);
+
+	subgroup_announce_table_end(subgrp, table);
+}
+
+/*
+ * subgroup_announce_table_batch
+ *
+ * Same as subgroup_announce_table() for count subgroups of the same
+ * AFI/SAFI and instance, walking the table only once.  Each node is
+ * handed to all subgroups before moving on to the next one.
+ */
+static void subgroup_announce_table_batch(struct update_subgroup **subgrps,
+					  size_t count, struct bgp_table *table)
+{
+	struct bgp_dest *dest;
+	safi_t safi_rib;
+	bool *addpath_capable;
+	size_t i;
+
+	if (count == 1) {
+		subgroup_announce_table(subgrps[0], table);
+		return;
 	}
 
-	/*
-	 * First update is deferred until ORF or ROUTE-REFRESH is received
-	 */
+	safi_rib = subgroup_rib_safi(subgrps[0]);
+	if (!table)
+		table = SUBGRP_INST(subgrps[0])
+				->rib[SUBGRP_AFI(subgrps[0])][safi_rib];
+
+	addpath_capable = XCALLOC(MTYPE_TMP, count * sizeof(*addpath_capable));
+
+	for (i = 0; i < count; i++) {
+		addpath_capable[i] =
+			bgp_addpath_encode_tx(SUBGRP_PEER(subgrps[i]),
+					      SUBGRP_AFI(subgrps[i]),
+					      SUBGRP_SAFI(subgrps[i]));
+		subgroup_announce_table_start(subgrps[i]);
+	}
+
+	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest))
+		for (i = 0; i < count; i++)
+			subgroup_announce_dest(subgrps[i], dest, safi_rib,
+					       addpath_capable[i]);
+
+	for (i = 0; i < count; i++)
+		subgroup_announce_table_end(subgrps[i], table);
+
+	XFREE(MTYPE_TMP, addpath_capable);
+}
+
+/*
+ * Whether the first update to the subgroup is deferred until ORF or
+ * ROUTE-REFRESH is received.
+ */
+static bool subgroup_announce_deferred(struct update_subgroup *subgrp)
+{
+	struct peer *onlypeer;
+
 	onlypeer = ((SUBGRP_PCOUNT(subgrp) == 1) ? (SUBGRP_PFIRST(subgrp))->peer
 						 : NULL);
-	if (onlypeer && CHECK_FLAG(onlypeer->af_sflags[SUBGRP_AFI(subgrp)]
-						      [SUBGRP_SAFI(subgrp)],
-				   PEER_STATUS_ORF_WAIT_REFRESH))
-		return;
+	return onlypeer && CHECK_FLAG(onlypeer->af_sflags[SUBGRP_AFI(subgrp)]
+							 [SUBGRP_SAFI(subgrp)],
+				      PEER_STATUS_ORF_WAIT_REFRESH);
+}
+
+static void subgroup_announce_route_batch(struct update_subgroup **subgrps,
+					  size_t count)
+{
+	struct bgp_dest *dest;
+	struct bgp_table *table;
+	safi_t safi = SUBGRP_SAFI(subgrps[0]);
 
-	if (SUBGRP_SAFI(subgrp) != SAFI_MPLS_VPN
-	    && SUBGRP_SAFI(subgrp) != SAFI_ENCAP
-	    && SUBGRP_SAFI(subgrp) != SAFI_EVPN)
-		subgroup_announce_table(subgrp, NULL);
+	if (safi != SAFI_MPLS_VPN && safi != SAFI_ENCAP && safi != SAFI_EVPN)
+		subgroup_announce_table_batch(subgrps, count, NULL);
 	else
-		for (dest = bgp_table_top(update_subgroup_rib(subgrp)); dest;
-		     dest = bgp_route_next(dest)) {
+		for (dest = bgp_table_top(update_subgroup_rib(subgrps[0]));
+		     dest; dest = bgp_route_next(dest)) {
 			table = bgp_dest_get_bgp_table_info(dest);
 			if (!table)
 				continue;
-			subgroup_announce_table(subgrp, table);
+			subgroup_announce_table_batch(subgrps, count, table);
+		}
+}
+
+/*
+ * subgroup_announce_route
+ *
+ * Refresh all routes out to a subgroup.
+ */
+void subgroup_announce_route(struct update_subgroup *subgrp)
+{
+	/*
+	 * The adj-out was just synced from a sibling subgroup, walking the
+	 * table would only find what is already there.
+	 */
+	if (CHECK_FLAG(subgrp->sflags, SUBGRP_STATUS_ADJ_SYNCED)) {
+		UNSET_FLAG(subgrp->sflags, SUBGRP_STATUS_ADJ_SYNCED);
+		if (!update_subgroup_needs_refresh(subgrp) &&
+		    !CHECK_FLAG(subgrp->sflags, SUBGRP_STATUS_FORCE_UPDATES))
+			return;
+	}
+
+	if (update_subgroup_needs_refresh(subgrp)) {
+		update_subgroup_set_needs_refresh(subgrp, 0);
+	}
+
+	if (subgroup_announce_deferred(subgrp))
+		return;
+
+	subgroup_announce_route_batch(&subgrp, 1);
+}
+
+/*
+ * subgroups_announce_route
+ *
+ * Refresh all routes out to several subgroups of one instance, e.g. after
+ * a policy change.  Subgroups of the same AFI/SAFI share a single walk of
+ * the table instead of walking it once each.  The array is reordered.
+ */
+void subgroups_announce_route(struct update_subgroup **subgrps, size_t count)
+{
+	struct update_subgroup *tmp;
+	size_t i, j, k, n;
+
+	/* drop the deferred ones */
+	for (i = 0, n = 0; i < count; i++) {
+		UNSET_FLAG(subgrps[i]->sflags, SUBGRP_STATUS_ADJ_SYNCED);
+		if (update_subgroup_needs_refresh(subgrps[i]))
+			update_subgroup_set_needs_refresh(subgrps[i], 0);
+
+		if (!subgroup_announce_deferred(subgrps[i]))
+			subgrps[n++] = subgrps[i];
+	}
+
+	/* group by AFI/SAFI, then hand each group to one table walk */
+	for (i = 0; i < n; i = j) {
+		j = i + 1;
+		for (k = i + 1; k < n; k++) {
+			if (SUBGRP_AFI(subgrps[k]) != SUBGRP_AFI(subgrps[i]) ||
+			    SUBGRP_SAFI(subgrps[k]) != SUBGRP_SAFI(subgrps[i]))
+				continue;
+
+			tmp = subgrps[j];
+			subgrps[j++] = subgrps[k];
+			subgrps[k] = tmp;
 		}
+
+		subgroup_announce_route_batch(&subgrps[i], j - i);
+	}
 }
 
 void subgroup_default_originate(struct update_subgroup *subgrp, bool withdraw)
@@ -636,6 +636,87 @@ bool subgroup_packets_to_build(struct update_subgroup *subgrp)
 	return false;
 }
 
+void bpacket_nlri_batch_init(struct bpacket_nlri_batch *batch,
+			     bool addpath_capable)
+{
+	batch->addpath_capable = addpath_capable;
+	batch->count = 0;
+	batch->len = 0;
+}
+
+/*
+ * Queue a prefix for encoding. Returns true once the batch is full and
+ * has to be flushed before anything else is added; adding to a full
+ * batch is a bug.
+ */
+bool bpacket_nlri_batch_add(struct bpacket_nlri_batch *batch,
+			    const struct prefix *p, uint32_t addpath_tx_id)
+{
+	assert(batch->count < BPACKET_NLRI_BATCH_MAX);
+
+	batch->nlri[batch->count].p = p;
+	batch->nlri[batch->count].addpath_tx_id = addpath_tx_id;
+	batch->count++;
+
+	batch->len += BGP_NLRI_LENGTH + PSIZE(p->prefixlen);
+	if (batch->addpath_capable)
+		batch->len += BGP_ADDPATH_ID_LEN;
+
+	return batch->count == BPACKET_NLRI_BATCH_MAX;
+}
+
+/*
+ * Encode the queued NLRI into 's' and empty the batch. The space is
+ * checked once for the whole batch; if it does not fit, nothing is
+ * written and the batch is left as is.
+ *
+ * Returns the number of bytes written.
+ */
+size_t bpacket_nlri_batch_flush(struct bpacket_nlri_batch *batch,
+				struct stream *s)
+{
+	const struct prefix *p;
+	size_t len = batch->len;
+	uint32_t addpath_tx_id;
+	uint8_t *pnt;
+	uint8_t psize;
+	uint16_t i;
+
+	if (!batch->count || STREAM_WRITEABLE(s) < len)
+		return 0;
+
+	pnt = STREAM_DATA(s) + stream_get_endp(s);
+
+	if (batch->addpath_capable) {
+		for (i = 0; i < batch->count; i++) {
+			p = batch->nlri[i].p;
+			psize = PSIZE(p->prefixlen);
+			addpath_tx_id = htonl(batch->nlri[i].addpath_tx_id);
+
+			memcpy(pnt, &addpath_tx_id, BGP_ADDPATH_ID_LEN);
+			pnt += BGP_ADDPATH_ID_LEN;
+			*pnt++ = p->prefixlen;
+			memcpy(pnt, &p->u.prefix, psize);
+			pnt += psize;
+		}
+	} else {
+		for (i = 0; i < batch->count; i++) {
+			p = batch->nlri[i].p;
+			psize = PSIZE(p->prefixlen);
+
+			*pnt++ = p->prefixlen;
+			memcpy(pnt, &p->u.prefix, psize);
+			pnt += psize;
+		}
+	}
+
+	stream_forward_endp(s, len);
+	batch->count = 0;
+	batch->len = 0;
+
+	return len;
+}
+
 /* Make BGP update packet.  */
 struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 {
@@ -644,7 +725,10 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 	struct peer *peer;
 	struct stream *s;
 	struct stream *snlri;
+	struct stream *snlri_bulk = NULL;
 	struct stream *packet;
+	struct bpacket_nlri_batch nlri_batch;
+	size_t flushed;
 	struct bgp_adj_out *adj;
 	struct bgp_advertise *adv;
 	struct bgp_dest *dest = NULL;
@@ -666,6 +750,7 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 	struct prefix_rd *prd = NULL;
 	mpls_label_t label = MPLS_INVALID_LABEL, *label_pnt = NULL;
 	uint8_t num_labels = 0;
+	bool bulk_nlri;
 
 	if (!subgrp)
 		return NULL;
@@ -686,6 +771,13 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 	addpath_capable = bgp_addpath_encode_tx(peer, afi, safi);
 	addpath_overhead = addpath_capable ? BGP_ADDPATH_ID_LEN : 0;
 
+	/*
+	 * Plain prefixes, inline or in MP_REACH_NLRI, are batched and
+	 * encoded in bulk, everything else is encoded one by one.
+	 */
+	bulk_nlri = (safi == SAFI_UNICAST || safi == SAFI_MULTICAST);
+	bpacket_nlri_batch_init(&nlri_batch, addpath_capable);
+
 	adv = bgp_adv_fifo_first(&subgrp->sync->update);
 	while (adv) {
 		const struct prefix *dest_p;
@@ -698,7 +790,8 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 		path = adv->pathi;
 
 		space_remaining = STREAM_CONCAT_REMAIN(s, snlri, STREAM_SIZE(s))
-				  - BGP_MAX_PACKET_SIZE_OVERFLOW;
+				  - BGP_MAX_PACKET_SIZE_OVERFLOW
+				  - nlri_batch.len;
 		space_needed =
 			BGP_NLRI_LENGTH + addpath_overhead
 			+ bgp_packet_mpattr_prefix_size(afi, safi, dest_p);
@@ -775,10 +868,19 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 		}
 
 		if ((afi == AFI_IP && safi == SAFI_UNICAST)
-		    && !peer_cap_enhe(peer, afi, safi))
-			stream_put_prefix_addpath(s, dest_p, addpath_capable,
-						  addpath_tx_id);
-		else {
+		    && !peer_cap_enhe(peer, afi, safi)) {
+			snlri_bulk = s;
+			/*
+			 * The space check above accounts for the queued
+			 * NLRI, so a full batch always fits.
+			 */
+			if (bpacket_nlri_batch_add(&nlri_batch, dest_p,
+						   addpath_tx_id)) {
+				flushed = bpacket_nlri_batch_flush(&nlri_batch,
+								   s);
+				assert(flushed);
+			}
+		} else {
 			/* Encode the prefix in MP_REACH_NLRI attribute */
 			if (dest->pdest)
 				prd = (struct prefix_rd *)bgp_dest_get_prefix(
@@ -825,10 +927,21 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 					snlri, peer, afi, safi, &vecarr,
 					adv->baa->attr);
 
-			bgp_packet_mpattr_prefix(snlri, afi, safi, dest_p, prd,
-						 label_pnt, num_labels,
-						 addpath_capable, addpath_tx_id,
-						 adv->baa->attr);
+			if (bulk_nlri) {
+				snlri_bulk = snlri;
+				if (bpacket_nlri_batch_add(&nlri_batch, dest_p,
+							   addpath_tx_id)) {
+					flushed = bpacket_nlri_batch_flush(
+						&nlri_batch, snlri);
+					assert(flushed);
+				}
+			} else
+				bgp_packet_mpattr_prefix(snlri, afi, safi,
+							 dest_p, prd,
+							 label_pnt, num_labels,
+							 addpath_capable,
+							 addpath_tx_id,
+							 adv->baa->attr);
 		}
 
 		num_pfx++;
@@ -869,16 +982,26 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 				   pfx_buf);
 		}
 
-		/* Synchnorize attribute.  */
-		if (adj->attr)
-			bgp_attr_unintern(&adj->attr);
-		else
-			subgrp->scount++;
+		/*
+		 * Synchnorize attribute. A re-advertisement with the same
+		 * attribute, e.g. on route refresh, keeps its reference.
+		 */
+		if (adj->attr != adv->baa->attr) {
+			if (adj->attr)
+				bgp_attr_unintern(&adj->attr);
+			else
+				subgrp->scount++;
 
-		adj->attr = bgp_attr_intern(adv->baa->attr);
+			adj->attr = bgp_attr_intern(adv->baa->attr);
+		}
 		adv = bgp_advertise_clean_subgroup(subgrp, adj);
 	}
 
+	if (nlri_batch.count) {
+		flushed = bpacket_nlri_batch_flush(&nlri_batch, snlri_bulk);
+		assert(flushed);
+	}
+
 	if (!stream_empty(s)) {
 		if (!stream_empty(snlri)) {
 			bgp_packet_mpattr_end(snlri, mpattrlen_pos);
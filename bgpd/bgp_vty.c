@@ -65,6 +65,7 @@
 #include "bgpd/bgp_mac.h"
 #include "bgpd/bgp_flowspec.h"
 #include "bgpd/bgp_conditional_adv.h"
+#include "bgpd/bgp_snapshot.h"
 #ifdef ENABLE_BGP_VNC
 #include "bgpd/rfapi/bgp_rfapi_cfg.h"
 #endif
@@ -2023,6 +2024,23 @@ DEFPY (no_bgp_send_extra_data,
 	return CMD_SUCCESS;
 }
 
+DEFPY (no_bgp_zebra_nexthop_groups,
+       no_bgp_zebra_nexthop_groups_cmd,
+       "[no] bgp zebra nexthop-groups",
+       NO_STR
+       BGP_STR
+       "Zebra route installation\n"
+       "Install routes with shared nexthop groups\n")
+{
+	/* Applies to routes sent from now on */
+	if (no)
+		UNSET_FLAG(bm->flags, BM_FLAG_ZEBRA_NHG);
+	else
+		SET_FLAG(bm->flags, BM_FLAG_ZEBRA_NHG);
+
+	return CMD_SUCCESS;
+}
+
 DEFUN (bgp_confederation_identifier,
        bgp_confederation_identifier_cmd,
        "bgp confederation identifier ASNUM",
@@ -7994,6 +8012,55 @@ DEFUN (no_neighbor_advertise_interval,
 	return peer_advertise_interval_vty(vty, argv[idx_peer]->arg, NULL, 0);
 }
 
+static int peer_input_weight_vty(struct vty *vty, const char *ip_str,
+				 const char *weight_str, int set)
+{
+	int ret;
+	struct peer *peer;
+	uint32_t weight = 0;
+
+	peer = peer_and_group_lookup_vty(vty, ip_str);
+	if (!peer)
+		return CMD_WARNING_CONFIG_FAILED;
+
+	if (weight_str)
+		weight = strtoul(weight_str, NULL, 10);
+
+	if (set)
+		ret = peer_input_weight_set(peer, weight);
+	else
+		ret = peer_input_weight_unset(peer);
+
+	return bgp_vty_return(vty, ret);
+}
+
+DEFUN (neighbor_input_weight,
+       neighbor_input_weight_cmd,
+       "neighbor <A.B.C.D|X:X::X:X|WORD> input-weight (1-64)",
+       NEIGHBOR_STR
+       NEIGHBOR_ADDR_STR2
+       "Share of received message processing given to this neighbor\n"
+       "Weight relative to other neighbors\n")
+{
+	int idx_peer = 1;
+	int idx_number = 3;
+	return peer_input_weight_vty(vty, argv[idx_peer]->arg,
+				     argv[idx_number]->arg, 1);
+}
+
+DEFUN (no_neighbor_input_weight,
+       no_neighbor_input_weight_cmd,
+       "no neighbor <A.B.C.D|X:X::X:X|WORD> input-weight [(1-64)]",
+       NO_STR
+       NEIGHBOR_STR
+       NEIGHBOR_ADDR_STR2
+       "Share of received message processing given to this neighbor\n"
+       "Weight relative to other neighbors\n")
+{
+	int idx_peer = 2;
+	return peer_input_weight_vty(vty, argv[idx_peer]->arg, NULL, 0);
+}
+
 
 /* Time to wait before processing route-map updates */
 DEFUN (bgp_set_route_map_delay_timer,
@@ -11508,6 +11575,19 @@ DEFUN (show_bgp_mac_hash,
 	return CMD_SUCCESS;
 }
 
+DEFUN (show_bgp_zebra_route_install,
+       show_bgp_zebra_route_install_cmd,
+       "show bgp zebra route-install",
+       SHOW_STR
+       BGP_STR
+       "Zebra information\n"
+       "Route install queue\n")
+{
+	bgp_zebra_announce_show(vty);
+
+	return CMD_SUCCESS;
+}
+
 static void show_tip_entry(struct hash_bucket *bucket, void *args)
 {
 	struct vty *vty = (struct vty *)args;
@@ -11569,6 +11649,7 @@ DEFUN (show_bgp_memory,
 {
 	char memstrbuf[MTYPE_MEMSTR_LEN];
 	unsigned long count;
+	size_t damp_mem;
 
 	/* RIB related usage stats */
 	count = mtype_stats_alloc(MTYPE_BGP_NODE);
@@ -11636,11 +11717,10 @@ DEFUN (show_bgp_memory,
 			mtype_memstr(memstrbuf, sizeof(memstrbuf),
 				     count * sizeof(struct bgp_nexthop_cache)));
 
-	if ((count = mtype_stats_alloc(MTYPE_BGP_DAMP_INFO)))
+	if ((count = bgp_damp_info_count(&damp_mem)))
 		vty_out(vty, "%ld Dampening entries, using %s of memory\n",
 			count,
-			mtype_memstr(memstrbuf, sizeof(memstrbuf),
-				     count * sizeof(struct bgp_damp_info)));
+			mtype_memstr(memstrbuf, sizeof(memstrbuf), damp_mem));
 
 	/* Attributes */
 	count = attr_count();
@@ -15478,6 +15558,16 @@ static void bgp_show_peer(struct vty *vty, struct peer *p, bool use_json,
 				    (unsigned long)inq_count);
 		json_object_int_add(json_stat, "depthOutq",
 				    (unsigned long)outq_count);
+		json_object_int_add(json_stat, "inqWeight",
+				    bgp_input_weight(p));
+		json_object_int_add(json_stat, "inqDelayLastUsec",
+				    p->inq_delay_last);
+		json_object_int_add(json_stat, "inqDelayAvgUsec",
+				    p->inq_delay_count ? p->inq_delay_total /
+								 p->inq_delay_count
+						       : 0);
+		json_object_int_add(json_stat, "inqDelayMaxUsec",
+				    p->inq_delay_max);
 		json_object_int_add(json_stat, "opensSent",
 				    atomic_load_explicit(&p->open_out,
 							 memory_order_relaxed));
@@ -15554,6 +15644,14 @@ static void bgp_show_peer(struct vty *vty, struct peer *p, bool use_json,
 		/* Packet counts. */
 		vty_out(vty, "  Message statistics:\n");
 		vty_out(vty, "    Inq depth is %zu\n", inq_count);
+		vty_out(vty,
+			"    Inq weight is %u, scheduling delay last %" PRIu64
+			" avg %" PRIu64 " max %" PRIu64 " usec\n",
+			bgp_input_weight(p), p->inq_delay_last,
+			p->inq_delay_count ? p->inq_delay_total /
+						     p->inq_delay_count
+					   : 0,
+			p->inq_delay_max);
 		vty_out(vty, "    Outq depth is %zu\n", outq_count);
 		vty_out(vty, "                         Sent       Rcvd\n");
 		vty_out(vty, "    Opens:         %10zu %10zu\n", open_out,
@@ -18800,6 +18898,11 @@ static void bgp_config_write_peer_global(struct vty *vty, struct bgp *bgp,
 		vty_out(vty, " neighbor %s advertisement-interval %u\n", addr,
 			peer->routeadv);
 
+	/* input-weight */
+	if (peergroup_flag_check(peer, PEER_FLAG_INPUT_WEIGHT))
+		vty_out(vty, " neighbor %s input-weight %u\n", addr,
+			peer->input_weight);
+
 	/* timers */
 	if (peergroup_flag_check(peer, PEER_FLAG_TIMER))
 		vty_out(vty, " neighbor %s timers %u %u\n", addr,
@@ -19399,6 +19502,8 @@ int bgp_config_write(struct vty *vty)
 		vty_out(vty, "bgp graceful-restart rib-stale-time %u\n",
 			bm->rib_stale_time);
 
+	bgp_snapshot_config_write(vty);
+
 	if (CHECK_FLAG(bm->flags, BM_FLAG_GRACEFUL_SHUTDOWN))
 		vty_out(vty, "bgp graceful-shutdown\n");
 
@@ -19409,6 +19514,9 @@ int bgp_config_write(struct vty *vty)
 	if (CHECK_FLAG(bm->flags, BM_FLAG_SEND_EXTRA_DATA_TO_ZEBRA))
 		vty_out(vty, "bgp send-extra-data zebra\n");
 
+	if (CHECK_FLAG(bm->flags, BM_FLAG_ZEBRA_NHG))
+		vty_out(vty, "bgp zebra nexthop-groups\n");
+
 	/* DSCP value for outgoing packets in BGP connections */
 	if (bm->ip_tos != IPTOS_PREC_INTERNETCONTROL)
 		vty_out(vty, "bgp session-dscp %u\n", bm->ip_tos >> 2);
@@ -20423,6 +20531,7 @@ void bgp_vty_init(void)
 	install_element(CONFIG_NODE, &no_bgp_norib_cmd);
 
 	install_element(CONFIG_NODE, &no_bgp_send_extra_data_cmd);
+	install_element(CONFIG_NODE, &no_bgp_zebra_nexthop_groups_cmd);
 
 	/* "bgp confederation" commands. */
 	install_element(BGP_NODE, &bgp_confederation_identifier_cmd);
@@ -21442,6 +21551,10 @@ void bgp_vty_init(void)
 	install_element(BGP_NODE, &neighbor_advertise_interval_cmd);
 	install_element(BGP_NODE, &no_neighbor_advertise_interval_cmd);
 
+	/* "neighbor input-weight" commands. */
+	install_element(BGP_NODE, &neighbor_input_weight_cmd);
+	install_element(BGP_NODE, &no_neighbor_input_weight_cmd);
+
 	/* "neighbor interface" commands. */
 	install_element(BGP_NODE, &neighbor_interface_cmd);
 	install_element(BGP_NODE, &no_neighbor_interface_cmd);
@@ -21879,6 +21992,7 @@ void bgp_vty_init(void)
 	install_element(VIEW_NODE, &show_bgp_martian_nexthop_db_cmd);
 
 	install_element(VIEW_NODE, &show_bgp_mac_hash_cmd);
+	install_element(VIEW_NODE, &show_bgp_zebra_route_install_cmd);
 
 	/* "show [ip] bgp views" commands. */
 	install_element(VIEW_NODE, &show_bgp_views_cmd);
@@ -54,6 +54,7 @@
 #include "bgpd/bgp_trace.h"
 #include "bgpd/bgp_community.h"
 #include "bgpd/bgp_lcommunity.h"
+#include "bgpd/bgp_nhg.h"
 
 /* All information about zebra. */
 struct zclient *zclient = NULL;
@@ -1250,6 +1251,7 @@ static void bgp_zebra_announce_parse_nexthop(
 	uint8_t num_labels = 0;
 	mpls_label_t nh_label;
 	int nh_othervrf = 0;
+	struct bgp_path_info_extra_vrfleak *vrfleak;
 	bool nh_updated = false;
 	bool do_wt_ecmp;
 	uint32_t ttl = 0;
@@ -1263,8 +1265,8 @@ static void bgp_zebra_announce_parse_nexthop(
 	/*
 	 * vrf leaking support (will have only one nexthop)
 	 */
-	if (info->extra && info->extra->vrfleak &&
-	    info->extra->vrfleak->bgp_orig)
+	vrfleak = bgp_extra_vrfleak(info->extra);
+	if (vrfleak && vrfleak->bgp_orig)
 		nh_othervrf = 1;
 
 	/* EVPN MAC-IP routes are installed with a L3 NHG id */
@@ -1531,6 +1533,8 @@ bgp_zebra_announce_actual(struct bgp_dest *dest, struct bgp_path_info *info,
 	uint32_t metric;
 	route_tag_t tag;
 	uint32_t nhg_id = 0;
+	uint32_t route_nhg_id = 0;
+	enum zclient_send_status status;
 	struct bgp_table *table = bgp_dest_table(dest);
 	const struct prefix *p = bgp_dest_get_prefix(dest);
 
@@ -1649,7 +1653,32 @@ bgp_zebra_announce_actual(struct bgp_dest *dest, struct bgp_path_info *info,
 			   __func__, p, (allow_recursion ? "" : "NOT "));
 	}
 
-	return zclient_route_send(ZEBRA_ROUTE_ADD, zclient, &api);
+	/*
+	 * Routes resolving over the same set of nexthops share one NHG,
+	 * zebra then only has to look the group up for each of them.
+	 */
+	if (CHECK_FLAG(bm->flags, BM_FLAG_ZEBRA_NHG) && !nhg_id &&
+	    info->sub_type != BGP_ROUTE_AGGREGATE &&
+	    bgp_nhg_route_eligible(api.nexthops, api.nexthop_num))
+		route_nhg_id = bgp_nhg_route_get(api.nexthops, api.nexthop_num);
+
+	if (route_nhg_id) {
+		if (bgp_debug_zebra(p))
+			zlog_debug("%s: %pFX: using nhg %u", __func__, p,
+				   route_nhg_id);
+		zapi_route_set_nhg_id(&api, &route_nhg_id);
+	}
+
+	status = zclient_route_send(ZEBRA_ROUTE_ADD, zclient, &api);
+
+	if (status == ZCLIENT_SEND_FAILURE) {
+		bgp_nhg_route_put(route_nhg_id);
+	} else {
+		bgp_nhg_route_put(dest->za_nhg_id);
+		dest->za_nhg_id = route_nhg_id;
+	}
+
+	return status;
 }
 
 
@@ -1709,6 +1738,7 @@ enum zclient_send_status bgp_zebra_withdraw_actual(struct bgp_dest *dest,
 {
 	struct zapi_route api;
 	struct peer *peer;
+	enum zclient_send_status status;
 	struct bgp_table *table = bgp_dest_table(dest);
 	const struct prefix *p = bgp_dest_get_prefix(dest);
 
@@ -1734,7 +1764,12 @@ enum zclient_send_status bgp_zebra_withdraw_actual(struct bgp_dest *dest,
 		zlog_debug("Tx route delete %s (table id %u) %pFX",
 			   bgp->name_pretty, api.tableid, &api.prefix);
 
-	return zclient_route_send(ZEBRA_ROUTE_DELETE, zclient, &api);
+	status = zclient_route_send(ZEBRA_ROUTE_DELETE, zclient, &api);
+
+	bgp_nhg_route_put(dest->za_nhg_id);
+	dest->za_nhg_id = 0;
+
+	return status;
 }
 
 /*
@@ -1751,6 +1786,74 @@ enum zclient_send_status bgp_zebra_withdraw_actual(struct bgp_dest *dest,
  * continue processing items on list.
  */
 #define ZEBRA_ANNOUNCEMENTS_LIMIT 1000
+
+/*
+ * Install queue statistics.  Latency is sampled on one dest at a time,
+ * from the moment it is queued until it has been handed to zclient.
+ */
+static struct {
+	size_t queue_max;
+	uint64_t sent;
+
+	struct bgp_dest *sample_dest;
+	struct timeval sample_start;
+
+	uint64_t latency_last;
+	uint64_t latency_max;
+	uint64_t latency_total;
+	uint64_t latency_cnt;
+} bgp_zebra_announce_stats;
+
+static void bgp_zebra_announce_sample(struct bgp_dest *dest)
+{
+	uint64_t latency;
+
+	if (dest != bgp_zebra_announce_stats.sample_dest)
+		return;
+
+	latency = monotime_since(&bgp_zebra_announce_stats.sample_start, NULL);
+	bgp_zebra_announce_stats.sample_dest = NULL;
+	bgp_zebra_announce_stats.latency_last = latency;
+	bgp_zebra_announce_stats.latency_total += latency;
+	bgp_zebra_announce_stats.latency_cnt++;
+	if (latency > bgp_zebra_announce_stats.latency_max)
+		bgp_zebra_announce_stats.latency_max = latency;
+}
+
+/* Take a dest off the install queue without sending it */
+void bgp_zebra_announce_del(struct bgp_dest *dest)
+{
+	zebra_announce_del(&bm->zebra_announce_head, dest);
+
+	if (dest == bgp_zebra_announce_stats.sample_dest)
+		bgp_zebra_announce_stats.sample_dest = NULL;
+}
+
+void bgp_zebra_announce_show(struct vty *vty)
+{
+	uint64_t avg = 0;
+
+	if (bgp_zebra_announce_stats.latency_cnt)
+		avg = bgp_zebra_announce_stats.latency_total /
+		      bgp_zebra_announce_stats.latency_cnt;
+
+	vty_out(vty, "Route install queue:\n");
+	vty_out(vty, "  Queued: %zu (max %zu)\n",
+		zebra_announce_count(&bm->zebra_announce_head),
+		bgp_zebra_announce_stats.queue_max);
+	vty_out(vty, "  Sent: %" PRIu64 "\n", bgp_zebra_announce_stats.sent);
+	vty_out(vty,
+		"  Latency (usec): last %" PRIu64 " avg %" PRIu64
+		" max %" PRIu64 " (%" PRIu64 " samples)\n",
+		bgp_zebra_announce_stats.latency_last, avg,
+		bgp_zebra_announce_stats.latency_max,
+		bgp_zebra_announce_stats.latency_cnt);
+	vty_out(vty, "  Nexthop groups: %s, %zu in use, %" PRIu64 " repaired\n",
+		CHECK_FLAG(bm->flags, BM_FLAG_ZEBRA_NHG) ? "enabled"
+							 : "disabled",
+		bgp_nhg_route_count(), bgp_nhg_route_repair_count());
+}
+
 static void bgp_handle_route_announcements_to_zebra(struct event *e)
 {
 	bool is_evpn = false;
@@ -1769,6 +1872,9 @@ static void bgp_handle_route_announcements_to_zebra(struct event *e)
 		if (!dest)
 			break;
 
+		bgp_zebra_announce_sample(dest);
+		bgp_zebra_announce_stats.sent++;
+
 		table = bgp_dest_table(dest);
 		install = CHECK_FLAG(dest->flags, BGP_NODE_SCHEDULE_FOR_INSTALL);
 		if (table->afi == AFI_L2VPN && table->safi == SAFI_EVPN) {
@@ -1913,6 +2019,13 @@ void bgp_zebra_route_install(struct bgp_dest *dest, struct bgp_path_info *info,
 	if (!CHECK_FLAG(dest->flags, BGP_NODE_SCHEDULE_FOR_INSTALL) &&
 	    !CHECK_FLAG(dest->flags, BGP_NODE_SCHEDULE_FOR_DELETE)) {
 		zebra_announce_add_tail(&bm->zebra_announce_head, dest);
+		bgp_zebra_announce_stats.queue_max =
+			MAX(bgp_zebra_announce_stats.queue_max,
+			    zebra_announce_count(&bm->zebra_announce_head));
+		if (!bgp_zebra_announce_stats.sample_dest) {
+			bgp_zebra_announce_stats.sample_dest = dest;
+			monotime(&bgp_zebra_announce_stats.sample_start);
+		}
 		/*
 		 * If neither flag is set and za_bgp_pi is not set then it is a bug
 		 */
@@ -2577,6 +2690,7 @@ static int rule_notify_owner(ZAPI_CALLBACK_ARGS)
 		} else {
 			struct bgp_path_info *path;
 			struct bgp_path_info_extra *extra;
+			struct bgp_path_info_extra_fs *fs;
 
 			bgp_pbr->installed = true;
 			bgp_pbr->install_in_progress = false;
@@ -2584,14 +2698,14 @@ static int rule_notify_owner(ZAPI_CALLBACK_ARGS)
 			/* link bgp_info to bgp_pbr */
 			path = (struct bgp_path_info *)bgp_pbr->path;
 			extra = bgp_path_info_extra_get(path);
-			if (!extra->flowspec) {
-				extra->flowspec =
-					XCALLOC(MTYPE_BGP_ROUTE_EXTRA_FS,
-						sizeof(struct bgp_path_info_extra_fs));
-				extra->flowspec->bgp_fs_iprule = NULL;
-				extra->flowspec->bgp_fs_pbr = NULL;
+			fs = bgp_extra_flowspec(extra);
+			if (!fs) {
+				fs = XCALLOC(MTYPE_BGP_ROUTE_EXTRA_FS,
+					     sizeof(*fs));
+				bgp_path_info_extra_ext_set(
+					extra, BGP_PATH_EXTRA_FLOWSPEC, fs);
 			}
-			listnode_add_force(&extra->flowspec->bgp_fs_iprule, bgp_pbr);
+			listnode_add_force(&fs->bgp_fs_iprule, bgp_pbr);
 		}
 		if (BGP_DEBUG(zebra, ZEBRA))
 			zlog_debug("%s: Received RULE_INSTALLED", __func__);
@@ -2684,6 +2798,7 @@ static int ipset_entry_notify_owner(ZAPI_CALLBACK_ARGS)
 		{
 		struct bgp_path_info *path;
 		struct bgp_path_info_extra *extra;
+		struct bgp_path_info_extra_fs *fs;
 
 		bgp_pbime->installed = true;
 		bgp_pbime->install_in_progress = false;
@@ -2693,14 +2808,15 @@ static int ipset_entry_notify_owner(ZAPI_CALLBACK_ARGS)
 		/* link bgp_path_info to bpme */
 		path = (struct bgp_path_info *)bgp_pbime->path;
 		extra = bgp_path_info_extra_get(path);
-		if (!extra->flowspec) {
-			extra->flowspec =
-				XCALLOC(MTYPE_BGP_ROUTE_EXTRA_FS,
-					sizeof(struct bgp_path_info_extra_fs));
-			extra->flowspec->bgp_fs_iprule = NULL;
-			extra->flowspec->bgp_fs_pbr = NULL;
+		fs = bgp_extra_flowspec(extra);
+		if (!fs) {
+			fs = XCALLOC(MTYPE_BGP_ROUTE_EXTRA_FS,
+				     sizeof(struct bgp_path_info_extra_fs));
+			bgp_path_info_extra_ext_set(extra,
+						    BGP_PATH_EXTRA_FLOWSPEC,
+						    fs);
 		}
-		listnode_add_force(&extra->flowspec->bgp_fs_pbr, bgp_pbime);
+		listnode_add_force(&fs->bgp_fs_pbr, bgp_pbime);
 		}
 		break;
 	case ZAPI_IPSET_ENTRY_FAIL_REMOVE:
@@ -3006,6 +3122,9 @@ static void bgp_zebra_connected(struct zclient *zclient)
 	/* Send the client registration */
 	bfd_client_sendmsg(zclient, ZEBRA_BFD_CLIENT_REGISTER, VRF_DEFAULT);
 
+	/* Routes still reference our NHGs, zebra needs them back first */
+	bgp_nhg_route_replay();
+
 	/* At this point, we may or may not have BGP instances configured, but
 	 * we're only interested in the default VRF (others wouldn't have learnt
 	 * the VRF from Zebra yet.)
@@ -3949,8 +4068,81 @@ void bgp_zebra_init(struct event_loop *master, unsigned short instance)
 				&bm->t_bgp_start_label_manager);
 }
 
+/*
+ * ipset entry additions are coalesced into one ZEBRA_IPSET_ENTRY_ADD, which
+ * zebra reads as a list, rather than sent as a message per flowspec entry.
+ * The batch goes out at the end of the current event, when it is full, or
+ * before any other PBR message so that zebra still sees them in order.
+ */
+#define BGP_PBR_IPSET_ENTRY_ENC_MAX                                            \
+	(4 + ZEBRA_IPSET_NAME_SIZE + 2 * (2 + sizeof(struct in6_addr)) + 4 * 2 + 1)
+
+static struct stream *pbr_ipset_entry_batch;
+static uint32_t pbr_ipset_entry_batch_count;
+static struct event *t_pbr_ipset_entry_batch;
+
+static void bgp_send_pbr_ipset_entry_batch(void)
+{
+	struct stream *s;
+
+	EVENT_OFF(t_pbr_ipset_entry_batch);
+	if (!pbr_ipset_entry_batch_count)
+		return;
+
+	s = zclient->obuf;
+	stream_reset(s);
+	stream_put(s, STREAM_DATA(pbr_ipset_entry_batch),
+		   stream_get_endp(pbr_ipset_entry_batch));
+	stream_putl_at(s, ZEBRA_HEADER_SIZE, pbr_ipset_entry_batch_count);
+	stream_putw_at(s, 0, stream_get_endp(s));
+
+	if (BGP_DEBUG(zebra, ZEBRA))
+		zlog_debug("%s: %u ipset entries", __func__,
+			   pbr_ipset_entry_batch_count);
+
+	stream_reset(pbr_ipset_entry_batch);
+	pbr_ipset_entry_batch_count = 0;
+
+	zclient_send_message(zclient);
+}
+
+static void bgp_send_pbr_ipset_entry_batch_event(struct event *thread)
+{
+	bgp_send_pbr_ipset_entry_batch();
+}
+
+static void bgp_queue_pbr_ipset_entry(struct bgp_pbr_match_entry *pbrime)
+{
+	struct stream *s;
+
+	if (!pbr_ipset_entry_batch)
+		pbr_ipset_entry_batch = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	s = pbr_ipset_entry_batch;
+
+	if (pbr_ipset_entry_batch_count &&
+	    STREAM_WRITEABLE(s) < BGP_PBR_IPSET_ENTRY_ENC_MAX)
+		bgp_send_pbr_ipset_entry_batch();
+
+	if (!pbr_ipset_entry_batch_count) {
+		zclient_create_header(s, ZEBRA_IPSET_ENTRY_ADD, VRF_DEFAULT);
+		stream_putl(s, 0); /* number of entries, set when sent */
+		event_add_event(bm->master,
+				bgp_send_pbr_ipset_entry_batch_event, NULL, 0,
+				&t_pbr_ipset_entry_batch);
+	}
+
+	bgp_encode_pbr_ipset_entry_match(s, pbrime);
+	pbr_ipset_entry_batch_count++;
+	pbrime->install_in_progress = true;
+}
+
 void bgp_zebra_destroy(void)
 {
+	EVENT_OFF(t_pbr_ipset_entry_batch);
+	pbr_ipset_entry_batch_count = 0;
+	stream_free(pbr_ipset_entry_batch);
+	pbr_ipset_entry_batch = NULL;
+
 	if (zclient == NULL)
 		return;
 	zclient_stop(zclient);
@@ -3979,6 +4171,7 @@ void bgp_send_pbr_rule_action(struct bgp_pbr_action *pbra,
 		return;
 	if (pbr && pbr->install_in_progress)
 		return;
+	bgp_send_pbr_ipset_entry_batch();
 	if (BGP_DEBUG(zebra, ZEBRA)) {
 		if (pbr)
 			zlog_debug("%s: table %d (ip rule) %d", __func__,
@@ -4011,6 +4204,7 @@ void bgp_send_pbr_ipset_match(struct bgp_pbr_match *pbrim, bool install)
 
 	if (pbrim->install_in_progress)
 		return;
+	bgp_send_pbr_ipset_entry_batch();
 	if (BGP_DEBUG(zebra, ZEBRA))
 		zlog_debug("%s: name %s type %d %d, ID %u", __func__,
 			   pbrim->ipset_name, pbrim->type, install,
@@ -4043,21 +4237,23 @@ void bgp_send_pbr_ipset_entry_match(struct bgp_pbr_match_entry *pbrime,
 		zlog_debug("%s: name %s %d %d, ID %u", __func__,
 			   pbrime->backpointer->ipset_name, pbrime->unique,
 			   install, pbrime->unique);
+	if (install) {
+		bgp_queue_pbr_ipset_entry(pbrime);
+		return;
+	}
+
+	bgp_send_pbr_ipset_entry_batch();
 	s = zclient->obuf;
 	stream_reset(s);
 
-	zclient_create_header(s,
-			      install ? ZEBRA_IPSET_ENTRY_ADD :
-			      ZEBRA_IPSET_ENTRY_DELETE,
-			      VRF_DEFAULT);
+	zclient_create_header(s, ZEBRA_IPSET_ENTRY_DELETE, VRF_DEFAULT);
 
 	stream_putl(s, 1); /* send one pbr action */
 
 	bgp_encode_pbr_ipset_entry_match(s, pbrime);
 
 	stream_putw_at(s, 0, stream_get_endp(s));
-	if ((zclient_send_message(zclient) != ZCLIENT_SEND_FAILURE) && install)
-		pbrime->install_in_progress = true;
+	zclient_send_message(zclient);
 }
 
 static void bgp_encode_pbr_interface_list(struct bgp *bgp, struct stream *s,
@@ -4111,6 +4307,7 @@ void bgp_send_pbr_iptable(struct bgp_pbr_action *pba,
 
 	if (pbm->install_iptable_in_progress)
 		return;
+	bgp_send_pbr_ipset_entry_batch();
 	if (BGP_DEBUG(zebra, ZEBRA))
 		zlog_debug("%s: name %s type %d mark %d %d, ID %u", __func__,
 			   pbm->ipset_name, pbm->type, pba->fwmark, install,
@@ -10,10 +10,10 @@
 
 /* Macro to update bgp_original based on bpg_path_info */
 #define BGP_ORIGINAL_UPDATE(_bgp_orig, _mpinfo, _bgp)                          \
-	((_mpinfo->extra && _mpinfo->extra->vrfleak &&                        \
-	  _mpinfo->extra->vrfleak->bgp_orig &&                                \
+	((bgp_extra_vrfleak(_mpinfo->extra) &&                                 \
+	  bgp_extra_vrfleak(_mpinfo->extra)->bgp_orig &&                       \
 	  _mpinfo->sub_type == BGP_ROUTE_IMPORTED)                             \
-		 ? (_bgp_orig = _mpinfo->extra->vrfleak->bgp_orig)            \
+		 ? (_bgp_orig = bgp_extra_vrfleak(_mpinfo->extra)->bgp_orig)   \
 		 : (_bgp_orig = _bgp))
 
 /* Default weight for next hop, if doing weighted ECMP. */
@@ -33,6 +33,8 @@ extern void bgp_zebra_route_install(struct bgp_dest *dest,
 				    bool install, struct bgpevpn *vpn,
 				    bool is_sync);
 extern void bgp_zebra_announce_table(struct bgp *bgp, afi_t afi, safi_t safi);
+extern void bgp_zebra_announce_del(struct bgp_dest *dest);
+extern void bgp_zebra_announce_show(struct vty *vty);
 
 /* Announce routes of any bgp subtype of a table to zebra */
 extern void bgp_zebra_announce_table_all_subtypes(struct bgp *bgp, afi_t afi,
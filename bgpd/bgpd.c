@@ -78,6 +78,7 @@
 #include "bgpd/bgp_evpn_private.h"
 #include "bgpd/bgp_evpn_mh.h"
 #include "bgpd/bgp_mac.h"
+#include "bgpd/bgp_snapshot.h"
 #include "bgp_trace.h"
 
 DEFINE_MTYPE_STATIC(BGPD, PEER_TX_SHUTDOWN_MSG, "Peer shutdown message (TX)");
@@ -1648,6 +1649,7 @@ void peer_xfer_config(struct peer *peer_dst, struct peer *peer_src)
 	peer_dst->port = peer_src->port;
 	/* copy tcp_mss value */
 	peer_dst->tcp_mss = peer_src->tcp_mss;
+	peer_dst->input_weight = peer_src->input_weight;
 	(void)peer_sort(peer_dst);
 	peer_dst->sub_sort = peer_src->sub_sort;
 	peer_dst->rmap_type = peer_src->rmap_type;
@@ -2730,6 +2732,11 @@ int peer_delete(struct peer *peer)
 	if (CHECK_FLAG(peer->sflags, PEER_STATUS_NSF_WAIT))
 		peer_nsf_stop(peer);
 
+	if (CHECK_FLAG(peer->sflags, PEER_STATUS_SNAPSHOT_WAIT))
+		bgp_snapshot_peer_stop(peer);
+
+	bgp_conditional_adv_index_reset(bgp);
+
 	SET_FLAG(peer->flags, PEER_FLAG_DELETE);
 
 	/* Remove BFD settings. */
@@ -2968,6 +2975,10 @@ static void peer_group2peer_config_copy(struct peer_group *group,
 			peer->v_delayopen = peer->bgp->default_delayopen;
 	}
 
+	/* input-weight apply */
+	if (!CHECK_FLAG(peer->flags_override, PEER_FLAG_INPUT_WEIGHT))
+		PEER_ATTR_INHERIT(peer, group, input_weight);
+
 	/* advertisement-interval apply */
 	if (!CHECK_FLAG(peer->flags_override, PEER_FLAG_ROUTEADV)) {
 		PEER_ATTR_INHERIT(peer, group, routeadv);
@@ -3503,6 +3514,7 @@ static struct bgp *bgp_create(as_t *as, const char *name,
 		bgp->gr_info[afi][safi].eor_received = 0;
 		bgp->gr_info[afi][safi].t_select_deferral = NULL;
 		bgp->gr_info[afi][safi].t_route_select = NULL;
+		bgp->gr_info[afi][safi].select_resume = NULL;
 		bgp->gr_info[afi][safi].gr_deferred = 0;
 	}
 
@@ -3958,7 +3970,7 @@ int bgp_delete(struct bgp *bgp)
 		dest_next = zebra_announce_next(&bm->zebra_announce_head, dest);
 		dest_table = bgp_dest_table(dest);
 		if (dest_table->bgp == bgp) {
-			zebra_announce_del(&bm->zebra_announce_head, dest);
+			bgp_zebra_announce_del(dest);
 			bgp_path_info_unlock(dest->za_bgp_pi);
 			bgp_dest_unlock_node(dest);
 		}
@@ -3981,10 +3993,8 @@ int bgp_delete(struct bgp *bgp)
 
 	hook_call(bgp_inst_delete, bgp);
 
-	FOREACH_AFI_SAFI (afi, safi)
-		EVENT_OFF(bgp->t_revalidate[afi][safi]);
-
 	EVENT_OFF(bgp->t_condition_check);
+	bgp_conditional_adv_index_reset(bgp);
 	EVENT_OFF(bgp->t_startup);
 	EVENT_OFF(bgp->t_maxmed_onstartup);
 	EVENT_OFF(bgp->t_update_delay);
@@ -4015,6 +4025,11 @@ int bgp_delete(struct bgp *bgp)
 			XFREE(MTYPE_TMP, info);
 		}
 		EVENT_OFF(gr_info->t_route_select);
+
+		if (gr_info->select_resume) {
+			bgp_dest_unlock_node(gr_info->select_resume);
+			gr_info->select_resume = NULL;
+		}
 	}
 
 	/* Delete route flap dampening configuration */
@@ -4130,6 +4145,7 @@ int bgp_delete(struct bgp *bgp)
 	 * routes to be processed still referencing the struct bgp.
 	 */
 	listnode_delete(bm->bgp, bgp);
+	vpn_import_index_invalidate();
 
 	/* Free interfaces in this instance. */
 	bgp_if_finish(bgp);
@@ -4708,6 +4724,7 @@ static const struct peer_flag_action peer_flag_action_list[] = {
 	{PEER_FLAG_CAPABILITY_FQDN, 0, peer_change_none},
 	{PEER_FLAG_AS_LOOP_DETECTION, 0, peer_change_none},
 	{PEER_FLAG_EXTENDED_LINK_BANDWIDTH, 0, peer_change_none},
+	{PEER_FLAG_INPUT_WEIGHT, 0, peer_change_none},
 	{PEER_FLAG_LONESOUL, 0, peer_change_reset_out},
 	{0, 0, 0}};
 
@@ -6018,6 +6035,74 @@ void peer_tcp_mss_unset(struct peer *peer)
 	bgp_tcp_mss_set(peer);
 }
 
+/* Set the input scheduling weight, picked up the next time the peer's
+ * input queue is scheduled.
+ */
+int peer_input_weight_set(struct peer *peer, uint32_t weight)
+{
+	struct peer *member;
+	struct listnode *node, *nnode;
+
+	if (weight < 1 || weight > BGP_INPUT_WEIGHT_MAX)
+		return BGP_ERR_INVALID_VALUE;
+
+	/* Set flag and configuration on peer. */
+	peer_flag_set(peer, PEER_FLAG_INPUT_WEIGHT);
+	peer->input_weight = weight;
+
+	/* Skip peer-group mechanics for regular peers. */
+	if (!CHECK_FLAG(peer->sflags, PEER_STATUS_GROUP))
+		return 0;
+
+	/*
+	 * Set flag and configuration on all peer-group members, unless they are
+	 * explicitly overriding peer-group configuration.
+	 */
+	for (ALL_LIST_ELEMENTS(peer->group->peer, node, nnode, member)) {
+		if (CHECK_FLAG(member->flags_override, PEER_FLAG_INPUT_WEIGHT))
+			continue;
+
+		SET_FLAG(member->flags, PEER_FLAG_INPUT_WEIGHT);
+		member->input_weight = weight;
+	}
+
+	return 0;
+}
+
+int peer_input_weight_unset(struct peer *peer)
+{
+	struct peer *member;
+	struct listnode *node, *nnode;
+
+	/* Inherit configuration from peer-group if peer is member. */
+	if (peer_group_active(peer)) {
+		peer_flag_inherit(peer, PEER_FLAG_INPUT_WEIGHT);
+		PEER_ATTR_INHERIT(peer, peer->group, input_weight);
+	} else {
+		/* Otherwise remove flag and configuration from peer. */
+		peer_flag_unset(peer, PEER_FLAG_INPUT_WEIGHT);
+		peer->input_weight = 0;
+	}
+
+	/* Skip peer-group mechanics for regular peers. */
+	if (!CHECK_FLAG(peer->sflags, PEER_STATUS_GROUP))
+		return 0;
+
+	/*
+	 * Remove flag and configuration from all peer-group members, unless
+	 * they are explicitly overriding peer-group configuration.
+	 */
+	for (ALL_LIST_ELEMENTS(peer->group->peer, node, nnode, member)) {
+		if (CHECK_FLAG(member->flags_override, PEER_FLAG_INPUT_WEIGHT))
+			continue;
+
+		UNSET_FLAG(member->flags, PEER_FLAG_INPUT_WEIGHT);
+		member->input_weight = 0;
+	}
+
+	return 0;
+}
+
 /*
  * Helper function that is called after the name of the policy
  * being used by a peer has changed (AF specific). Automatically
@@ -8432,6 +8517,7 @@ void bgp_master_init(struct event_loop *master, const int buffer_size,
 	bm = &bgp_master;
 
 	zebra_announce_init(&bm->zebra_announce_head);
+	bgp_input_sched_init(&bm->input_sched);
 	bm->bgp = list_new();
 	bm->listen_sockets = list_new();
 	bm->port = BGP_PORT_DEFAULT;
@@ -8625,6 +8711,7 @@ void bgp_init(unsigned short instance)
 	bgp_debug_init();
 	bgp_community_alias_init();
 	bgp_dump_init();
+	bgp_snapshot_init();
 	bgp_route_init();
 	bgp_route_map_init();
 	bgp_scan_vty_init();
@@ -8707,6 +8794,7 @@ void bgp_terminate(void)
 	EVENT_OFF(bm->t_bgp_sync_label_manager);
 	EVENT_OFF(bm->t_bgp_start_label_manager);
 	EVENT_OFF(bm->t_bgp_zebra_route);
+	EVENT_OFF(bm->t_input_sched);
 
 	bgp_mac_finish();
 }
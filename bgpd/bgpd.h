@@ -19,6 +19,7 @@
 #include "asn.h"
 
 PREDECL_LIST(zebra_announce);
+PREDECL_DLIST(bgp_input_sched);
 
 /* For union sockunion.  */
 #include "queue.h"
@@ -172,6 +173,7 @@ struct bgp_master {
 #define BM_FLAG_GR_PRESERVE_FWD		 (1 << 5)
 #define BM_FLAG_GRACEFUL_RESTART	 (1 << 6)
 #define BM_FLAG_GR_COMPLETE		 (1 << 7)
+#define BM_FLAG_ZEBRA_NHG		 (1 << 8)
 
 #define BM_FLAG_GR_CONFIGURED (BM_FLAG_GR_RESTARTER | BM_FLAG_GR_DISABLED)
 
@@ -203,6 +205,10 @@ struct bgp_master {
 	/* To preserve ordering of installations into zebra across all Vrfs */
 	struct zebra_announce_head zebra_announce_head;
 
+	/* Connections with input waiting, served by bgp_process_input() */
+	struct bgp_input_sched_head input_sched;
+	struct event *t_input_sched;
+
 	QOBJ_FIELDS;
 };
 DECLARE_QOBJ_TYPE(bgp_master);
@@ -312,6 +318,8 @@ struct graceful_restart_info {
 	uint32_t gr_deferred;
 	/* Best route select */
 	struct event *t_route_select;
+	/* Locked dest the next deferred selection pass resumes from */
+	struct bgp_dest *select_resume;
 	/* AFI, SAFI enabled */
 	bool af_enabled;
 	/* Route update completed */
@@ -421,6 +429,7 @@ struct bgp {
 		uint32_t peer_refreshes_combined;
 		uint32_t adj_count;
 		uint32_t merge_checks_triggered;
+		uint32_t adj_sync_events;
 
 		uint32_t updgrps_created;
 		uint32_t updgrps_deleted;
@@ -475,7 +484,6 @@ struct bgp {
 	/* BGP update delay on startup */
 	struct event *t_update_delay;
 	struct event *t_establish_wait;
-	struct event *t_revalidate[AFI_MAX][SAFI_MAX];
 
 	uint8_t update_delay_over;
 	uint8_t main_zebra_update_hold;
@@ -650,6 +658,15 @@ struct bgp {
 	struct hash *pbr_rule_hash;
 	struct hash *pbr_action_hash;
 
+	/* The same elements by the unique identifiers zebra notifications
+	 * refer to them with.
+	 */
+	struct hash *pbr_match_unique_hash;
+	struct hash *pbr_match_iptable_unique_hash;
+	struct hash *pbr_match_entry_unique_hash;
+	struct hash *pbr_rule_unique_hash;
+	struct hash *pbr_action_unique_hash;
+
 	/* timer to re-evaluate neighbor default-originate route-maps */
 	struct event *t_rmap_def_originate_eval;
 	uint16_t rmap_def_originate_eval_timer;
@@ -685,7 +702,6 @@ struct bgp {
 	/* BGP Long-lived Graceful Restart */
 	uint32_t llgr_stale_time;
 
-#define BGP_ROUTE_SELECT_DELAY 1
 #define BGP_MAX_BEST_ROUTE_SELECT 10000
 	/* Maximum-paths configuration */
 	struct bgp_maxpaths_cfg {
@@ -832,6 +848,10 @@ struct bgp {
 	uint32_t condition_check_period;
 	uint32_t condition_filter_count;
 	struct event *t_condition_check;
+	/* Peers with an advertise-map, grouped by condition-map; NULL until
+	 * needed after a change to the configuration or the peers.
+	 */
+	struct list *condition_index;
 
 	/* BGP VPN SRv6 backend */
 	bool srv6_enabled;
@@ -1004,6 +1024,12 @@ struct bgp_filter {
 		struct route_map *cmap;
 
 		enum update_type update_type;
+
+		/* Route that made the condition-map match in the last scan;
+		 * until it changes, the condition can't become false.
+		 */
+		bool cmatch;
+		struct prefix cprefix;
 	} advmap;
 };
 
@@ -1221,10 +1247,18 @@ struct peer_connection {
 	struct event *t_process_packet;
 	struct event *t_process_packet_error;
 
+	/* Deficit round robin state for the input scheduler */
+	struct bgp_input_sched_item input_sched_item;
+	uint32_t input_weight;
+	size_t input_deficit;
+	struct timeval input_ready;
+
 	union sockunion su;
 #define BGP_CONNECTION_SU_UNSPEC(connection)                                   \
 	(connection->su.sa.sa_family == AF_UNSPEC)
 };
+DECLARE_DLIST(bgp_input_sched, struct peer_connection, input_sched_item);
+
 extern struct peer_connection *bgp_peer_connection_new(struct peer *peer);
 extern void bgp_peer_connection_free(struct peer_connection **connection);
 extern void bgp_peer_connection_buffers_free(struct peer_connection *connection);
@@ -1284,6 +1318,8 @@ struct peer {
 
 	/* Peer index, used for dumping TABLE_DUMP_V2 format */
 	uint16_t table_dump_index;
+	/* Routes dump the index above was assigned in */
+	uint32_t table_dump_gen;
 
 	/* Peer information */
 
@@ -1507,6 +1543,7 @@ struct peer {
 #define PEER_FLAG_CAPABILITY_FQDN (1ULL << 37)  /* fqdn capability */
 #define PEER_FLAG_AS_LOOP_DETECTION (1ULL << 38) /* as path loop detection */
 #define PEER_FLAG_EXTENDED_LINK_BANDWIDTH (1ULL << 39)
+#define PEER_FLAG_INPUT_WEIGHT (1ULL << 40) /* input-weight */
 
 	/*
 	 *GR-Disabled mode means unset PEER_FLAG_GRACEFUL_RESTART
@@ -1529,6 +1566,8 @@ struct peer {
 
 	/* NSF mode (graceful restart) */
 	uint8_t nsf[AFI_MAX][SAFI_MAX];
+	/* unicast paths restored from a table snapshot, until End-of-RIB */
+	bool snapshot_wait[AFI_MAX];
 	/* EOR Send time */
 	time_t eor_stime[AFI_MAX][SAFI_MAX];
 	/* Last update packet sent time */
@@ -1603,6 +1642,8 @@ struct peer {
 #define PEER_STATUS_NSF_WAIT          (1U << 6) /* wait comeback peer */
 /* received extended format encoding for OPEN message */
 #define PEER_STATUS_EXT_OPT_PARAMS_LENGTH (1U << 7)
+/* holding stale paths restored from a table snapshot */
+#define PEER_STATUS_SNAPSHOT_WAIT     (1U << 8)
 
 	/* Peer status af flags (reset in bgp_stop) */
 	uint16_t af_sflags[AFI_MAX][SAFI_MAX];
@@ -1643,6 +1684,7 @@ struct peer {
 	struct event *t_llgr_stale[AFI_MAX][SAFI_MAX];
 	struct event *t_revalidate_all[AFI_MAX][SAFI_MAX];
 	struct event *t_refresh_stalepath;
+	struct event *t_snapshot_stale;
 
 	/* Thread flags. */
 	_Atomic uint32_t thread_flags;
@@ -1701,6 +1743,12 @@ struct peer {
 	uint64_t stat_pfx_loc_rib; /* RFC7854 : Number of routes in Loc-RIB */
 	uint64_t stat_pfx_adj_rib_in; /* RFC7854 : Number of routes in Adj-RIBs-In */
 
+	/* Time the input queue waited for its scheduling turn, in usec */
+	uint64_t inq_delay_last;
+	uint64_t inq_delay_max;
+	uint64_t inq_delay_total;
+	uint64_t inq_delay_count;
+
 	/* BGP state count */
 	uint32_t established; /* Established */
 	uint32_t dropped;     /* Dropped */
@@ -1874,6 +1922,12 @@ struct peer {
 	/* set TCP max segment size */
 	uint32_t tcp_mss;
 
+	/* Input scheduling weight, see bgp_input_weight() */
+	uint32_t input_weight;
+#define BGP_INPUT_WEIGHT_DEFAULT 1
+#define BGP_INPUT_WEIGHT_PRIORITY 4
+#define BGP_INPUT_WEIGHT_MAX 64
+
 	/* Long-lived Graceful Restart */
 	struct llgr_info llgr[AFI_MAX][SAFI_MAX];
 
@@ -2843,6 +2897,8 @@ void peer_nsf_stop(struct peer *peer);
 
 void peer_tcp_mss_set(struct peer *peer, uint32_t tcp_mss);
 void peer_tcp_mss_unset(struct peer *peer);
+extern int peer_input_weight_set(struct peer *peer, uint32_t weight);
+extern int peer_input_weight_unset(struct peer *peer);
 
 extern void bgp_recalculate_afi_safi_bestpaths(struct bgp *bgp, afi_t afi,
 					       safi_t safi);
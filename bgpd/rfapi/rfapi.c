@@ -369,7 +369,7 @@ void del_vnc_route(struct rfapi_descriptor *rfd,
 		vnc_zlog_debug_verbose(
 			"%s: trying bpi=%p, bpi->peer=%p, bpi->type=%d, bpi->sub_type=%d, bpi->extra->vnc.export.rfapi_handle=%p, local_pref=%" PRIu64,
 			__func__, bpi, bpi->peer, bpi->type, bpi->sub_type,
-			(bpi->extra ? bpi->extra->vnc->vnc.export.rfapi_handle
+			(bpi->extra ? bgp_extra_vnc(bpi->extra)->vnc.export.rfapi_handle
 				    : NULL),
 			CHECK_FLAG(bpi->attr->flag,
 				   ATTR_FLAG_BIT(BGP_ATTR_LOCAL_PREF)
@@ -377,8 +377,10 @@ void del_vnc_route(struct rfapi_descriptor *rfd,
 					   : 0));
 
 		if (bpi->peer == peer && bpi->type == type &&
-		    bpi->sub_type == sub_type && bpi->extra &&
-		    bpi->extra->vnc->vnc.export.rfapi_handle == (void *)rfd) {
+		    bpi->sub_type == sub_type &&
+		    bgp_extra_vnc(bpi->extra) &&
+		    bgp_extra_vnc(bpi->extra)->vnc.export.rfapi_handle ==
+			    (void *)rfd) {
 			vnc_zlog_debug_verbose("%s: matched it", __func__);
 
 			break;
@@ -391,8 +393,8 @@ void del_vnc_route(struct rfapi_descriptor *rfd,
 		 * route. Leave the route itself in place.
 		 * TBD add return code reporting of success/failure
 		 */
-		if (!bpi || !bpi->extra ||
-		    !bpi->extra->vnc->vnc.export.local_nexthops) {
+		if (!bpi || !bgp_extra_vnc(bpi->extra) ||
+		    !bgp_extra_vnc(bpi->extra)->vnc.export.local_nexthops) {
 			/*
 			 * no local nexthops
 			 */
@@ -408,7 +410,7 @@ void del_vnc_route(struct rfapi_descriptor *rfd,
 		struct listnode *node;
 		struct rfapi_nexthop *pLnh = NULL;
 
-		for (ALL_LIST_ELEMENTS_RO(bpi->extra->vnc->vnc.export
+		for (ALL_LIST_ELEMENTS_RO(bgp_extra_vnc(bpi->extra)->vnc.export
 						  .local_nexthops,
 					  node, pLnh)) {
 			if (prefix_same(&pLnh->addr, &lnh->addr)) {
@@ -417,7 +419,7 @@ void del_vnc_route(struct rfapi_descriptor *rfd,
 		}
 
 		if (pLnh) {
-			listnode_delete(bpi->extra->vnc->vnc.export.local_nexthops,
+			listnode_delete(bgp_extra_vnc(bpi->extra)->vnc.export.local_nexthops,
 					pLnh);
 
 			/* silly rabbit, listnode_delete doesn't invoke
@@ -458,8 +460,9 @@ void del_vnc_route(struct rfapi_descriptor *rfd,
 		/*
 		 * Delete local_nexthops list
 		 */
-		if (bpi->extra && bpi->extra->vnc->vnc.export.local_nexthops)
-			list_delete(&bpi->extra->vnc->vnc.export.local_nexthops);
+		if (bgp_extra_vnc(bpi->extra) &&
+		    bgp_extra_vnc(bpi->extra)->vnc.export.local_nexthops)
+			list_delete(&bgp_extra_vnc(bpi->extra)->vnc.export.local_nexthops);
 
 		bgp_aggregate_decrement(bgp, p, bpi, afi, safi);
 		bgp_path_info_delete(bn, bpi);
@@ -904,8 +907,10 @@ void add_vnc_route(struct rfapi_descriptor *rfd, /* cookie, VPN UN addr, peer */
 		/* probably only need to check
 		 * bpi->extra->vnc->vnc.export.rfapi_handle */
 		if (bpi->peer == rfd->peer && bpi->type == type &&
-		    bpi->sub_type == sub_type && bpi->extra &&
-		    bpi->extra->vnc->vnc.export.rfapi_handle == (void *)rfd) {
+		    bpi->sub_type == sub_type &&
+		    bgp_extra_vnc(bpi->extra) &&
+		    bgp_extra_vnc(bpi->extra)->vnc.export.rfapi_handle ==
+			    (void *)rfd) {
 			break;
 		}
 	}
@@ -917,11 +922,11 @@ void add_vnc_route(struct rfapi_descriptor *rfd, /* cookie, VPN UN addr, peer */
 		 * what is advertised via BGP
 		 */
 		if (lnh) {
-			if (!bpi->extra->vnc->vnc.export.local_nexthops) {
+			if (!bgp_extra_vnc(bpi->extra)->vnc.export.local_nexthops) {
 				/* TBD make arrangements to free when needed */
-				bpi->extra->vnc->vnc.export.local_nexthops =
+				bgp_extra_vnc(bpi->extra)->vnc.export.local_nexthops =
 					list_new();
-				bpi->extra->vnc->vnc.export.local_nexthops->del =
+				bgp_extra_vnc(bpi->extra)->vnc.export.local_nexthops->del =
 					rfapi_nexthop_free;
 			}
 
@@ -931,7 +936,7 @@ void add_vnc_route(struct rfapi_descriptor *rfd, /* cookie, VPN UN addr, peer */
 			struct listnode *node;
 			struct rfapi_nexthop *pLnh = NULL;
 
-			for (ALL_LIST_ELEMENTS_RO(bpi->extra->vnc->vnc.export
+			for (ALL_LIST_ELEMENTS_RO(bgp_extra_vnc(bpi->extra)->vnc.export
 							  .local_nexthops,
 						  node, pLnh)) {
 				if (prefix_same(&pLnh->addr, &lnh->addr)) {
@@ -944,7 +949,7 @@ void add_vnc_route(struct rfapi_descriptor *rfd, /* cookie, VPN UN addr, peer */
 			 */
 			if (!pLnh) {
 				pLnh = rfapi_nexthop_new(lnh);
-				listnode_add(bpi->extra->vnc->vnc.export
+				listnode_add(bgp_extra_vnc(bpi->extra)->vnc.export
 						     .local_nexthops,
 					     pLnh);
 			}
@@ -1018,9 +1023,11 @@ void add_vnc_route(struct rfapi_descriptor *rfd, /* cookie, VPN UN addr, peer */
 
 	/* save backref to rfapi handle */
 	bgp_path_info_extra_get(new);
-	new->extra->vnc = XCALLOC(MTYPE_BGP_ROUTE_EXTRA_VNC,
-				  sizeof(struct bgp_path_info_extra_vnc));
-	new->extra->vnc->vnc.export.rfapi_handle = (void *)rfd;
+	bgp_path_info_extra_ext_set(
+		new->extra, BGP_PATH_EXTRA_VNC,
+		XCALLOC(MTYPE_BGP_ROUTE_EXTRA_VNC,
+			sizeof(struct bgp_path_info_extra_vnc)));
+	bgp_extra_vnc(new->extra)->vnc.export.rfapi_handle = (void *)rfd;
 
 	encode_label(label_val, &bgp_labels.label[0]);
 	bgp_labels.num_labels = 1;
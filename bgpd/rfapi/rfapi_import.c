@@ -397,22 +397,22 @@ int rfapiGetUnAddrOfVpnBi(struct bgp_path_info *bpi, struct prefix *p)
 	 * advertisement
 	 */
 	if (bpi->extra) {
-		switch (bpi->extra->vnc->vnc.import.un_family) {
+		switch (bgp_extra_vnc(bpi->extra)->vnc.import.un_family) {
 		case AF_INET:
 			if (p) {
 				p->family =
-					bpi->extra->vnc->vnc.import.un_family;
+					bgp_extra_vnc(bpi->extra)->vnc.import.un_family;
 				p->u.prefix4 =
-					bpi->extra->vnc->vnc.import.un.addr4;
+					bgp_extra_vnc(bpi->extra)->vnc.import.un.addr4;
 				p->prefixlen = IPV4_MAX_BITLEN;
 			}
 			return 0;
 		case AF_INET6:
 			if (p) {
 				p->family =
-					bpi->extra->vnc->vnc.import.un_family;
+					bgp_extra_vnc(bpi->extra)->vnc.import.un_family;
 				p->u.prefix6 =
-					bpi->extra->vnc->vnc.import.un.addr6;
+					bgp_extra_vnc(bpi->extra)->vnc.import.un.addr6;
 				p->prefixlen = IPV6_MAX_BITLEN;
 			}
 			return 0;
@@ -449,11 +449,14 @@ static struct bgp_path_info *rfapiBgpInfoCreate(struct attr *attr,
 	new->attr = bgp_attr_intern(attr);
 
 	bgp_path_info_extra_get(new);
-	new->extra->vnc = XCALLOC(MTYPE_BGP_ROUTE_EXTRA_VNC,
-				  sizeof(struct bgp_path_info_extra_vnc));
+	bgp_path_info_extra_ext_set(
+		new->extra, BGP_PATH_EXTRA_VNC,
+		XCALLOC(MTYPE_BGP_ROUTE_EXTRA_VNC,
+			sizeof(struct bgp_path_info_extra_vnc)));
 	if (prd) {
-		new->extra->vnc->vnc.import.rd = *prd;
-		new->extra->vnc->vnc.import.create_time = monotime(NULL);
+		bgp_extra_vnc(new->extra)->vnc.import.rd = *prd;
+		bgp_extra_vnc(new->extra)->vnc.import.create_time =
+			monotime(NULL);
 	}
 	if (label && *label != MPLS_INVALID_LABEL) {
 		encode_label(*label, &bgp_labels.label[0]);
@@ -822,12 +825,12 @@ static void rfapiBgpInfoChainFree(struct bgp_path_info *bpi)
 		 * the timer and delete immediately
 		 */
 		if (CHECK_FLAG(bpi->flags, BGP_PATH_REMOVED) &&
-		    bpi->extra->vnc->vnc.import.timer) {
+		    bgp_extra_vnc(bpi->extra)->vnc.import.timer) {
 			struct rfapi_withdraw *wcb =
-				EVENT_ARG(bpi->extra->vnc->vnc.import.timer);
+				EVENT_ARG(bgp_extra_vnc(bpi->extra)->vnc.import.timer);
 
 			XFREE(MTYPE_RFAPI_WITHDRAW, wcb);
-			EVENT_OFF(bpi->extra->vnc->vnc.import.timer);
+			EVENT_OFF(bgp_extra_vnc(bpi->extra)->vnc.import.timer);
 		}
 
 		next = bpi->next;
@@ -1115,15 +1118,16 @@ static int rfapiVpnBiSamePtUn(struct bgp_path_info *bpi1,
 	 */
 	if (rfapiGetVncTunnelUnAddr(bpi1->attr, &pfx_un1)) {
 		if (bpi1->extra) {
-			pfx_un1.family = bpi1->extra->vnc->vnc.import.un_family;
-			switch (bpi1->extra->vnc->vnc.import.un_family) {
+			pfx_un1.family =
+				bgp_extra_vnc(bpi1->extra)->vnc.import.un_family;
+			switch (bgp_extra_vnc(bpi1->extra)->vnc.import.un_family) {
 			case AF_INET:
 				pfx_un1.u.prefix4 =
-					bpi1->extra->vnc->vnc.import.un.addr4;
+					bgp_extra_vnc(bpi1->extra)->vnc.import.un.addr4;
 				break;
 			case AF_INET6:
 				pfx_un1.u.prefix6 =
-					bpi1->extra->vnc->vnc.import.un.addr6;
+					bgp_extra_vnc(bpi1->extra)->vnc.import.un.addr6;
 				break;
 			default:
 				pfx_un1.family = AF_UNSPEC;
@@ -1134,15 +1138,16 @@ static int rfapiVpnBiSamePtUn(struct bgp_path_info *bpi1,
 
 	if (rfapiGetVncTunnelUnAddr(bpi2->attr, &pfx_un2)) {
 		if (bpi2->extra) {
-			pfx_un2.family = bpi2->extra->vnc->vnc.import.un_family;
-			switch (bpi2->extra->vnc->vnc.import.un_family) {
+			pfx_un2.family =
+				bgp_extra_vnc(bpi2->extra)->vnc.import.un_family;
+			switch (bgp_extra_vnc(bpi2->extra)->vnc.import.un_family) {
 			case AF_INET:
 				pfx_un2.u.prefix4 =
-					bpi2->extra->vnc->vnc.import.un.addr4;
+					bgp_extra_vnc(bpi2->extra)->vnc.import.un.addr4;
 				break;
 			case AF_INET6:
 				pfx_un2.u.prefix6 =
-					bpi2->extra->vnc->vnc.import.un.addr6;
+					bgp_extra_vnc(bpi2->extra)->vnc.import.un.addr6;
 				break;
 			default:
 				pfx_un2.family = AF_UNSPEC;
@@ -1247,7 +1252,8 @@ rfapiRouteInfo2NextHopEntry(struct rfapi_ip_prefix *rprefix,
 
 	new->prefix = *rprefix;
 
-	if (bpi->extra && decode_rd_type(bpi->extra->vnc->vnc.import.rd.val) ==
+	if (bpi->extra &&
+	    decode_rd_type(bgp_extra_vnc(bpi->extra)->vnc.import.rd.val) ==
 				  RD_TYPE_VNC_ETH) {
 		/* ethernet */
 
@@ -1268,7 +1274,7 @@ rfapiRouteInfo2NextHopEntry(struct rfapi_ip_prefix *rprefix,
 
 		/* local_nve_id comes from lower byte of RD type */
 		vo->v.l2addr.local_nve_id =
-			bpi->extra->vnc->vnc.import.rd.val[1];
+			bgp_extra_vnc(bpi->extra)->vnc.import.rd.val[1];
 
 		/* label comes from MP_REACH_NLRI label */
 		vo->v.l2addr.label =
@@ -1282,8 +1288,8 @@ rfapiRouteInfo2NextHopEntry(struct rfapi_ip_prefix *rprefix,
 		 * If there is an auxiliary prefix (i.e., host IP address),
 		 * use it as the nexthop prefix instead of the query prefix
 		 */
-		if (bpi->extra->vnc->vnc.import.aux_prefix.family) {
-			rfapiQprefix2Rprefix(&bpi->extra->vnc->vnc.import
+		if (bgp_extra_vnc(bpi->extra)->vnc.import.aux_prefix.family) {
+			rfapiQprefix2Rprefix(&bgp_extra_vnc(bpi->extra)->vnc.import
 						      .aux_prefix,
 					     &new->prefix);
 		}
@@ -1386,15 +1392,15 @@ rfapiRouteInfo2NextHopEntry(struct rfapi_ip_prefix *rprefix,
 		 * use cached UN address from ENCAP route
 		 */
 		new->un_address.addr_family =
-			bpi->extra->vnc->vnc.import.un_family;
+			bgp_extra_vnc(bpi->extra)->vnc.import.un_family;
 		switch (new->un_address.addr_family) {
 		case AF_INET:
 			new->un_address.addr.v4 =
-				bpi->extra->vnc->vnc.import.un.addr4;
+				bgp_extra_vnc(bpi->extra)->vnc.import.un.addr4;
 			break;
 		case AF_INET6:
 			new->un_address.addr.v6 =
-				bpi->extra->vnc->vnc.import.un.addr6;
+				bgp_extra_vnc(bpi->extra)->vnc.import.un.addr6;
 			break;
 		default:
 			zlog_warn("%s: invalid UN addr family (%d) for bpi %p",
@@ -1521,7 +1527,8 @@ static int rfapiNhlAddNodeRoutes(
 		if (is_l2) {
 			/* L2 routes: semantic nexthop in aux_prefix; VN addr
 			 * ain't it */
-			pfx_vn = bpi->extra->vnc->vnc.import.aux_prefix;
+			pfx_vn =
+				bgp_extra_vnc(bpi->extra)->vnc.import.aux_prefix;
 		} else {
 			rfapiNexthop2Prefix(bpi->attr, &pfx_vn);
 		}
@@ -1995,9 +2002,9 @@ static int rfapi_bi_peer_rd_cmp(const void *b1, const void *b2)
 	/*
 	 * compare RDs
 	 */
-	return vnc_prefix_cmp((const struct prefix *)&bpi1->extra->vnc->vnc
+	return vnc_prefix_cmp((const struct prefix *)&bgp_extra_vnc(bpi1->extra)->vnc
 				      .import.rd,
-			      (const struct prefix *)&bpi2->extra->vnc->vnc
+			      (const struct prefix *)&bgp_extra_vnc(bpi2->extra)->vnc
 				      .import.rd);
 }
 
@@ -2023,8 +2030,8 @@ static int rfapi_bi_peer_rd_aux_cmp(const void *b1, const void *b2)
 	/*
 	 * compare RDs
 	 */
-	rc = vnc_prefix_cmp((struct prefix *)&bpi1->extra->vnc->vnc.import.rd,
-			    (struct prefix *)&bpi2->extra->vnc->vnc.import.rd);
+	rc = vnc_prefix_cmp((struct prefix *)&bgp_extra_vnc(bpi1->extra)->vnc.import.rd,
+			    (struct prefix *)&bgp_extra_vnc(bpi2->extra)->vnc.import.rd);
 	if (rc) {
 		return rc;
 	}
@@ -2041,18 +2048,22 @@ static int rfapi_bi_peer_rd_aux_cmp(const void *b1, const void *b2)
 	 * because there is no guarantee of the order the test key and
 	 * the real key will be passed)
 	 */
-	if ((bpi1->extra->vnc->vnc.import.aux_prefix.family == AF_ETHERNET &&
-	     (bpi1->extra->vnc->vnc.import.aux_prefix.prefixlen == 1)) ||
-	    (bpi2->extra->vnc->vnc.import.aux_prefix.family == AF_ETHERNET &&
-	     (bpi2->extra->vnc->vnc.import.aux_prefix.prefixlen == 1))) {
+	if ((bgp_extra_vnc(bpi1->extra)->vnc.import.aux_prefix.family ==
+	     AF_ETHERNET &&
+	     (bgp_extra_vnc(bpi1->extra)->vnc.import.aux_prefix.prefixlen ==
+	      1)) ||
+	    (bgp_extra_vnc(bpi2->extra)->vnc.import.aux_prefix.family ==
+	     AF_ETHERNET &&
+	     (bgp_extra_vnc(bpi2->extra)->vnc.import.aux_prefix.prefixlen ==
+	      1))) {
 		/*
 		 * wildcard aux address specified
 		 */
 		return 0;
 	}
 
-	return vnc_prefix_cmp(&bpi1->extra->vnc->vnc.import.aux_prefix,
-			      &bpi2->extra->vnc->vnc.import.aux_prefix);
+	return vnc_prefix_cmp(&bgp_extra_vnc(bpi1->extra)->vnc.import.aux_prefix,
+			      &bgp_extra_vnc(bpi2->extra)->vnc.import.aux_prefix);
 }
 
 
@@ -2070,7 +2081,8 @@ static void rfapiItBiIndexAdd(struct agg_node *rn, /* Import table VPN node */
 	assert(bpi->extra);
 
 	vnc_zlog_debug_verbose("%s: bpi %p, peer %p, rd %pRDP", __func__, bpi,
-			       bpi->peer, &bpi->extra->vnc->vnc.import.rd);
+			       bpi->peer,
+				       &bgp_extra_vnc(bpi->extra)->vnc.import.rd);
 
 	sl = RFAPI_RDINDEX_W_ALLOC(rn);
 	if (!sl) {
@@ -2107,10 +2119,11 @@ static void rfapiItBiIndexDump(struct agg_node *rn)
 		char buf[RD_ADDRSTRLEN];
 		char buf_aux_pfx[PREFIX_STRLEN];
 
-		prefix_rd2str(&k->extra->vnc->vnc.import.rd, buf, sizeof(buf),
+		prefix_rd2str(&bgp_extra_vnc(k->extra)->vnc.import.rd, buf,
+			      sizeof(buf),
 			      bgp_get_asnotation(k->peer ? k->peer->bgp : NULL));
-		if (k->extra->vnc->vnc.import.aux_prefix.family) {
-			prefix2str(&k->extra->vnc->vnc.import.aux_prefix,
+		if (bgp_extra_vnc(k->extra)->vnc.import.aux_prefix.family) {
+			prefix2str(&bgp_extra_vnc(k->extra)->vnc.import.aux_prefix,
 				   buf_aux_pfx, sizeof(buf_aux_pfx));
 		} else
 			strlcpy(buf_aux_pfx, "(none)", sizeof(buf_aux_pfx));
@@ -2129,6 +2142,7 @@ static struct bgp_path_info *rfapiItBiIndexSearch(
 	int rc;
 	struct bgp_path_info bpi_fake = {0};
 	struct bgp_path_info_extra bpi_extra = {0};
+	void *bpi_extra_ext[1];
 	struct bgp_path_info_extra_vnc bpi_extra_vnc = { 0 };
 	struct bgp_path_info *bpi_result;
 
@@ -2164,13 +2178,13 @@ static struct bgp_path_info *rfapiItBiIndexSearch(
 #ifdef DEBUG_BI_SEARCH
 			vnc_zlog_debug_verbose("%s: bpi has prd=%pRDP, peer=%p",
 					       __func__,
-					       &bpi_result->extra->vnc->vnc
+					       &bgp_extra_vnc(bpi_result->extra)->vnc
 							.import.rd,
 					       bpi_result->peer);
 #endif
 			if (peer == bpi_result->peer &&
-			    !prefix_cmp((struct prefix *)&bpi_result->extra->vnc
-						->vnc.import.rd,
+			    !prefix_cmp((struct prefix *)&bgp_extra_vnc(
+						bpi_result->extra)->vnc.import.rd,
 					(struct prefix *)prd)) {
 #ifdef DEBUG_BI_SEARCH
 				vnc_zlog_debug_verbose(
@@ -2179,7 +2193,7 @@ static struct bgp_path_info *rfapiItBiIndexSearch(
 #endif
 				if (!aux_prefix ||
 				    !prefix_cmp(aux_prefix,
-						&bpi_result->extra->vnc->vnc
+						&bgp_extra_vnc(bpi_result->extra)->vnc
 							 .import.aux_prefix)) {
 #ifdef DEBUG_BI_SEARCH
 					vnc_zlog_debug_verbose("%s: match",
@@ -2193,15 +2207,21 @@ static struct bgp_path_info *rfapiItBiIndexSearch(
 	}
 
 	bpi_fake.peer = peer;
+	/* stack-backed VNC slot, no need to free it afterwards */
+	bpi_extra_ext[0] = &bpi_extra_vnc;
+	bpi_extra.ext = bpi_extra_ext;
+	bpi_extra.ext_present = 1U << BGP_PATH_EXTRA_VNC;
 	bpi_fake.extra = &bpi_extra;
-	bpi_fake.extra->vnc = &bpi_extra_vnc;
-	bpi_fake.extra->vnc->vnc.import.rd = *prd;
+	bgp_extra_vnc(bpi_fake.extra)->vnc.import.rd = *prd;
 	if (aux_prefix) {
-		bpi_fake.extra->vnc->vnc.import.aux_prefix = *aux_prefix;
+		bgp_extra_vnc(bpi_fake.extra)->vnc.import.aux_prefix =
+			*aux_prefix;
 	} else {
 		/* wildcard */
-		bpi_fake.extra->vnc->vnc.import.aux_prefix.family = AF_ETHERNET;
-		bpi_fake.extra->vnc->vnc.import.aux_prefix.prefixlen = 1;
+		bgp_extra_vnc(bpi_fake.extra)->vnc.import.aux_prefix.family =
+			AF_ETHERNET;
+		bgp_extra_vnc(bpi_fake.extra)->vnc.import.aux_prefix.prefixlen =
+			1;
 	}
 
 	rc = skiplist_search(sl, (void *)&bpi_fake, (void *)&bpi_result);
@@ -2227,7 +2247,8 @@ static void rfapiItBiIndexDel(struct agg_node *rn, /* Import table VPN node */
 	int rc;
 
 	vnc_zlog_debug_verbose("%s: bpi %p, peer %p, rd %pRDP", __func__, bpi,
-			       bpi->peer, &bpi->extra->vnc->vnc.import.rd);
+			       bpi->peer,
+				       &bgp_extra_vnc(bpi->extra)->vnc.import.rd);
 
 	sl = RFAPI_RDINDEX(rn);
 	assert(sl);
@@ -2275,7 +2296,7 @@ rfapiMonitorEncapAdd(struct rfapi_import_table *import_table,
 	RFAPI_MONITOR_ENCAP_W_ALLOC(rn) = m;
 
 	/* for easy lookup when deleting vpn route */
-	vpn_bpi->extra->vnc->vnc.import.hme = m;
+	bgp_extra_vnc(vpn_bpi->extra)->vnc.import.hme = m;
 
 	vnc_zlog_debug_verbose("%s: it=%p, vpn_bpi=%p, afi=%d, encap rn=%p, setting vpn_bpi->extra->vnc->vnc.import.hme=%p",
 			       __func__, import_table, vpn_bpi, afi, rn, m);
@@ -2292,7 +2313,7 @@ static void rfapiMonitorEncapDelete(struct bgp_path_info *vpn_bpi)
 	vnc_zlog_debug_verbose("%s: vpn_bpi=%p", __func__, vpn_bpi);
 	if (vpn_bpi->extra) {
 		struct rfapi_monitor_encap *hme =
-			vpn_bpi->extra->vnc->vnc.import.hme;
+			bgp_extra_vnc(vpn_bpi->extra)->vnc.import.hme;
 
 		if (hme) {
 
@@ -2316,7 +2337,7 @@ static void rfapiMonitorEncapDelete(struct bgp_path_info *vpn_bpi)
 
 			agg_unlock_node(hme->rn); /* decr ref count */
 			XFREE(MTYPE_RFAPI_MONITOR_ENCAP, hme);
-			vpn_bpi->extra->vnc->vnc.import.hme = NULL;
+			bgp_extra_vnc(vpn_bpi->extra)->vnc.import.hme = NULL;
 		}
 	}
 }
@@ -2555,21 +2576,21 @@ static void rfapiCopyUnEncap2VPN(struct bgp_path_info *encap_bpi,
 		vnc_zlog_debug_verbose("%s: vpn_bpi->extra=%p", __func__,
 				       vpn_bpi->extra);
 
-		vpn_bpi->extra->vnc->vnc.import.un_family = AF_INET;
-		vpn_bpi->extra->vnc->vnc.import.un.addr4 =
+		bgp_extra_vnc(vpn_bpi->extra)->vnc.import.un_family = AF_INET;
+		bgp_extra_vnc(vpn_bpi->extra)->vnc.import.un.addr4 =
 			encap_bpi->attr->mp_nexthop_global_in;
 		break;
 
 	case AF_INET6:
-		vpn_bpi->extra->vnc->vnc.import.un_family = AF_INET6;
-		vpn_bpi->extra->vnc->vnc.import.un.addr6 =
+		bgp_extra_vnc(vpn_bpi->extra)->vnc.import.un_family = AF_INET6;
+		bgp_extra_vnc(vpn_bpi->extra)->vnc.import.un.addr6 =
 			encap_bpi->attr->mp_nexthop_global;
 		break;
 
 	default:
 		zlog_warn("%s: invalid encap nexthop length: %d", __func__,
 			  encap_bpi->attr->mp_nexthop_len);
-		vpn_bpi->extra->vnc->vnc.import.un_family = AF_UNSPEC;
+		bgp_extra_vnc(vpn_bpi->extra)->vnc.import.un_family = AF_UNSPEC;
 		break;
 	}
 }
@@ -2594,9 +2615,9 @@ rfapiWithdrawEncapUpdateCachedUn(struct rfapi_import_table *import_table,
 				__func__);
 			return 1;
 		}
-		vpn_bpi->extra->vnc->vnc.import.un_family = AF_UNSPEC;
-		memset(&vpn_bpi->extra->vnc->vnc.import.un, 0,
-		       sizeof(vpn_bpi->extra->vnc->vnc.import.un));
+		bgp_extra_vnc(vpn_bpi->extra)->vnc.import.un_family = AF_UNSPEC;
+		memset(&bgp_extra_vnc(vpn_bpi->extra)->vnc.import.un, 0,
+		       sizeof(bgp_extra_vnc(vpn_bpi->extra)->vnc.import.un));
 		if (CHECK_FLAG(vpn_bpi->flags, BGP_PATH_VALID)) {
 			if (rfapiGetVncTunnelUnAddr(vpn_bpi->attr, NULL)) {
 				UNSET_FLAG(vpn_bpi->flags, BGP_PATH_VALID);
@@ -2767,9 +2788,9 @@ rfapiBiStartWithdrawTimer(struct rfapi_import_table *import_table,
 	assert(bpi->extra);
 	if (lifetime > UINT32_MAX / 1001) {
 		/* sub-optimal case, but will probably never happen */
-		bpi->extra->vnc->vnc.import.timer = NULL;
+		bgp_extra_vnc(bpi->extra)->vnc.import.timer = NULL;
 		event_add_timer(bm->master, timer_service_func, wcb, lifetime,
-				&bpi->extra->vnc->vnc.import.timer);
+				&bgp_extra_vnc(bpi->extra)->vnc.import.timer);
 	} else {
 		static uint32_t jitter;
 		uint32_t lifetime_msec;
@@ -2783,10 +2804,10 @@ rfapiBiStartWithdrawTimer(struct rfapi_import_table *import_table,
 
 		lifetime_msec = (lifetime * 1000) + jitter;
 
-		bpi->extra->vnc->vnc.import.timer = NULL;
+		bgp_extra_vnc(bpi->extra)->vnc.import.timer = NULL;
 		event_add_timer_msec(bm->master, timer_service_func, wcb,
 				     lifetime_msec,
-				     &bpi->extra->vnc->vnc.import.timer);
+				     &bgp_extra_vnc(bpi->extra)->vnc.import.timer);
 	}
 
 	/* re-sort route list (BGP_PATH_REMOVED routes are last) */
@@ -3006,7 +3027,7 @@ static void rfapiBgpInfoFilteredImportEncap(
 						       __func__);
 				continue;
 			}
-			if (prefix_cmp((struct prefix *)&bpi->extra->vnc->vnc
+			if (prefix_cmp((struct prefix *)&bgp_extra_vnc(bpi->extra)->vnc
 					       .import.rd,
 				       (struct prefix *)prd)) {
 				vnc_zlog_debug_verbose("%s: prd does not match",
@@ -3053,12 +3074,12 @@ static void rfapiBgpInfoFilteredImportEncap(
 				 * timer.
 				 */
 				if (CHECK_FLAG(bpi->flags, BGP_PATH_REMOVED) &&
-				    bpi->extra->vnc->vnc.import.timer) {
+				    bgp_extra_vnc(bpi->extra)->vnc.import.timer) {
 					struct rfapi_withdraw *wcb = EVENT_ARG(
-						bpi->extra->vnc->vnc.import.timer);
+						bgp_extra_vnc(bpi->extra)->vnc.import.timer);
 
 					XFREE(MTYPE_RFAPI_WITHDRAW, wcb);
-					EVENT_OFF(bpi->extra->vnc->vnc.import
+					EVENT_OFF(bgp_extra_vnc(bpi->extra)->vnc.import
 							  .timer);
 				}
 
@@ -3145,12 +3166,12 @@ static void rfapiBgpInfoFilteredImportEncap(
 		vnc_zlog_debug_verbose(
 			"%s: removing holddown bpi matching NVE of new route",
 			__func__);
-		if (bpi->extra->vnc->vnc.import.timer) {
+		if (bgp_extra_vnc(bpi->extra)->vnc.import.timer) {
 			struct rfapi_withdraw *wcb =
-				EVENT_ARG(bpi->extra->vnc->vnc.import.timer);
+				EVENT_ARG(bgp_extra_vnc(bpi->extra)->vnc.import.timer);
 
 			XFREE(MTYPE_RFAPI_WITHDRAW, wcb);
-			EVENT_OFF(bpi->extra->vnc->vnc.import.timer);
+			EVENT_OFF(bgp_extra_vnc(bpi->extra)->vnc.import.timer);
 		}
 		rfapiExpireEncapNow(import_table, rn, bpi);
 	}
@@ -3506,12 +3527,12 @@ void rfapiBgpInfoFilteredImportVPN(
 				 * timer.
 				 */
 				if (CHECK_FLAG(bpi->flags, BGP_PATH_REMOVED) &&
-				    bpi->extra->vnc->vnc.import.timer) {
+				    bgp_extra_vnc(bpi->extra)->vnc.import.timer) {
 					struct rfapi_withdraw *wcb = EVENT_ARG(
-						bpi->extra->vnc->vnc.import.timer);
+						bgp_extra_vnc(bpi->extra)->vnc.import.timer);
 
 					XFREE(MTYPE_RFAPI_WITHDRAW, wcb);
-					EVENT_OFF(bpi->extra->vnc->vnc.import
+					EVENT_OFF(bgp_extra_vnc(bpi->extra)->vnc.import
 							  .timer);
 
 					import_table->holddown_count[afi] -= 1;
@@ -3585,7 +3606,8 @@ void rfapiBgpInfoFilteredImportVPN(
 		/* Not a big deal, just means VPN route got here first */
 		vnc_zlog_debug_verbose("%s: no encap route for vn addr %pFX",
 				       __func__, &vn_prefix);
-		info_new->extra->vnc->vnc.import.un_family = AF_UNSPEC;
+		bgp_extra_vnc(info_new->extra)->vnc.import.un_family =
+			AF_UNSPEC;
 	}
 
 	if (rn) {
@@ -3607,7 +3629,8 @@ void rfapiBgpInfoFilteredImportVPN(
 
 		vnc_zlog_debug_verbose("%s: setting BPI's aux_prefix",
 				       __func__);
-		info_new->extra->vnc->vnc.import.aux_prefix = *aux_prefix;
+		bgp_extra_vnc(info_new->extra)->vnc.import.aux_prefix =
+			*aux_prefix;
 	}
 
 	vnc_zlog_debug_verbose("%s: inserting bpi %p at prefix %pRN #%d",
@@ -3725,12 +3748,12 @@ void rfapiBgpInfoFilteredImportVPN(
 		vnc_zlog_debug_verbose(
 			"%s: removing holddown bpi matching NVE of new route",
 			__func__);
-		if (bpi->extra->vnc->vnc.import.timer) {
+		if (bgp_extra_vnc(bpi->extra)->vnc.import.timer) {
 			struct rfapi_withdraw *wcb =
-				EVENT_ARG(bpi->extra->vnc->vnc.import.timer);
+				EVENT_ARG(bgp_extra_vnc(bpi->extra)->vnc.import.timer);
 
 			XFREE(MTYPE_RFAPI_WITHDRAW, wcb);
-			EVENT_OFF(bpi->extra->vnc->vnc.import.timer);
+			EVENT_OFF(bgp_extra_vnc(bpi->extra)->vnc.import.timer);
 		}
 		rfapiExpireVpnNow(import_table, rn, bpi, 0);
 	}
@@ -4463,9 +4486,9 @@ static void rfapiDeleteRemotePrefixesIt(
 				if (CHECK_FLAG(bpi->flags, BGP_PATH_REMOVED)) {
 					if (!delete_holddown)
 						continue;
-					if (bpi->extra->vnc->vnc.import.timer) {
+					if (bgp_extra_vnc(bpi->extra)->vnc.import.timer) {
 						struct rfapi_withdraw *wcb = EVENT_ARG(
-							bpi->extra->vnc->vnc
+							bgp_extra_vnc(bpi->extra)->vnc
 								.import.timer);
 
 						wcb->import_table
@@ -4476,7 +4499,7 @@ static void rfapiDeleteRemotePrefixesIt(
 							afi, 1);
 						XFREE(MTYPE_RFAPI_WITHDRAW,
 						      wcb);
-						EVENT_OFF(bpi->extra->vnc->vnc
+						EVENT_OFF(bgp_extra_vnc(bpi->extra)->vnc
 								  .import.timer);
 					}
 				} else {
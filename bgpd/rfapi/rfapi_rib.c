@@ -663,7 +663,8 @@ static void rfapiRibBi2Ri(struct bgp_path_info *bpi, struct rfapi_info *ri,
 	/*
 	 * VN options
 	 */
-	if (bpi->extra && decode_rd_type(bpi->extra->vnc->vnc.import.rd.val) ==
+	if (bpi->extra &&
+	    decode_rd_type(bgp_extra_vnc(bpi->extra)->vnc.import.rd.val) ==
 				  RD_TYPE_VNC_ETH) {
 		/* ethernet route */
 
@@ -678,7 +679,8 @@ static void rfapiRibBi2Ri(struct bgp_path_info *bpi, struct rfapi_info *ri,
 		/* copy from RD already stored in bpi, so we don't need it_node
 		 */
 		memcpy(&vo->v.l2addr.macaddr,
-		       bpi->extra->vnc->vnc.import.rd.val + 2, ETH_ALEN);
+		       bgp_extra_vnc(bpi->extra)->vnc.import.rd.val + 2,
+			       ETH_ALEN);
 
 		(void)rfapiEcommunityGetLNI(bgp_attr_get_ecommunity(bpi->attr),
 					    &vo->v.l2addr.logical_net_id);
@@ -688,7 +690,7 @@ static void rfapiRibBi2Ri(struct bgp_path_info *bpi, struct rfapi_info *ri,
 
 		/* local_nve_id comes from RD */
 		vo->v.l2addr.local_nve_id =
-			bpi->extra->vnc->vnc.import.rd.val[1];
+			bgp_extra_vnc(bpi->extra)->vnc.import.rd.val[1];
 
 		/* label comes from MP_REACH_NLRI label */
 		vo->v.l2addr.label =
@@ -704,8 +706,10 @@ static void rfapiRibBi2Ri(struct bgp_path_info *bpi, struct rfapi_info *ri,
 	/*
 	 * If there is an auxiliary IP address (L2 can have it), copy it
 	 */
-	if (bpi->extra && bpi->extra->vnc->vnc.import.aux_prefix.family) {
-		ri->rk.aux_prefix = bpi->extra->vnc->vnc.import.aux_prefix;
+	if (bgp_extra_vnc(bpi->extra) &&
+	    bgp_extra_vnc(bpi->extra)->vnc.import.aux_prefix.family) {
+		ri->rk.aux_prefix =
+			bgp_extra_vnc(bpi->extra)->vnc.import.aux_prefix;
 	}
 }
 
@@ -749,13 +753,14 @@ int rfapiRibPreloadBi(
 
 	memset((void *)&rk, 0, sizeof(rk));
 	rk.vn = *pfx_vn;
-	rk.rd = bpi->extra->vnc->vnc.import.rd;
+	rk.rd = bgp_extra_vnc(bpi->extra)->vnc.import.rd;
 
 	/*
 	 * If there is an auxiliary IP address (L2 can have it), copy it
 	 */
-	if (bpi->extra->vnc->vnc.import.aux_prefix.family) {
-		rk.aux_prefix = bpi->extra->vnc->vnc.import.aux_prefix;
+	if (bgp_extra_vnc(bpi->extra)->vnc.import.aux_prefix.family) {
+		rk.aux_prefix =
+			bgp_extra_vnc(bpi->extra)->vnc.import.aux_prefix;
 	}
 
 	/*
@@ -1632,13 +1637,13 @@ void rfapiRibUpdatePendingNode(
 
 		ri = rfapi_info_new();
 		ri->rk.vn = pfx_nh;
-		ri->rk.rd = bpi->extra->vnc->vnc.import.rd;
+		ri->rk.rd = bgp_extra_vnc(bpi->extra)->vnc.import.rd;
 		/*
 		 * If there is an auxiliary IP address (L2 can have it), copy it
 		 */
-		if (bpi->extra->vnc->vnc.import.aux_prefix.family) {
+		if (bgp_extra_vnc(bpi->extra)->vnc.import.aux_prefix.family) {
 			ri->rk.aux_prefix =
-				bpi->extra->vnc->vnc.import.aux_prefix;
+				bgp_extra_vnc(bpi->extra)->vnc.import.aux_prefix;
 		}
 
 		if (rfapiGetUnAddrOfVpnBi(bpi, &ri->un)) {
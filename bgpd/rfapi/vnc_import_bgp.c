@@ -1699,7 +1699,7 @@ static void vnc_import_bgp_exterior_add_route_it(
 				have_usable_route = 1;
 
 				if (bpi_interior->extra)
-					prd = &bpi_interior->extra->vnc->vnc
+					prd = &bgp_extra_vnc(bpi_interior->extra)->vnc
 						       .import.rd;
 				else
 					prd = NULL;
@@ -1873,7 +1873,7 @@ void vnc_import_bgp_exterior_del_route(
 				have_usable_route = 1;
 
 				if (bpi_interior->extra)
-					prd = &bpi_interior->extra->vnc->vnc
+					prd = &bgp_extra_vnc(bpi_interior->extra)->vnc
 						       .import.rd;
 				else
 					prd = NULL;
@@ -2026,7 +2026,7 @@ void vnc_import_bgp_exterior_add_route_interior(
 			assert(pfx_exterior);
 
 			if (bpi_interior->extra)
-				prd = &bpi_interior->extra->vnc->vnc.import.rd;
+				prd = &bgp_extra_vnc(bpi_interior->extra)->vnc.import.rd;
 			else
 				prd = NULL;
 
@@ -2142,7 +2142,7 @@ void vnc_import_bgp_exterior_add_route_interior(
 				 */
 				for (bpi = par->info; bpi; bpi = bpi->next) {
 					if (bpi->extra)
-						prd = &bpi->extra->vnc->vnc
+						prd = &bgp_extra_vnc(bpi->extra)->vnc
 							       .import.rd;
 					else
 						prd = NULL;
@@ -2169,7 +2169,7 @@ void vnc_import_bgp_exterior_add_route_interior(
 				 * the new interior route at longer prefix.
 				 */
 				if (bpi_interior->extra)
-					prd = &bpi_interior->extra->vnc->vnc
+					prd = &bgp_extra_vnc(bpi_interior->extra)->vnc
 						       .import.rd;
 				else
 					prd = NULL;
@@ -2293,7 +2293,7 @@ void vnc_import_bgp_exterior_add_route_interior(
 			 * new interior route at the longer prefix.
 			 */
 			if (bpi_interior->extra)
-				prd = &bpi_interior->extra->vnc->vnc.import.rd;
+				prd = &bgp_extra_vnc(bpi_interior->extra)->vnc.import.rd;
 			else
 				prd = NULL;
 
@@ -2405,7 +2405,7 @@ void vnc_import_bgp_exterior_del_route_interior(
 		uint32_t label;
 
 		if (bpi_interior->extra)
-			prd = &bpi_interior->extra->vnc->vnc.import.rd;
+			prd = &bgp_extra_vnc(bpi_interior->extra)->vnc.import.rd;
 		else
 			prd = NULL;
 
@@ -2487,7 +2487,7 @@ void vnc_import_bgp_exterior_del_route_interior(
 					continue;
 
 				if (bpi->extra)
-					prd = &bpi->extra->vnc->vnc.import.rd;
+					prd = &bgp_extra_vnc(bpi->extra)->vnc.import.rd;
 				else
 					prd = NULL;
 
@@ -2844,13 +2844,13 @@ void vnc_import_bgp_redist_disable(struct bgp *bgp, afi_t afi)
 
 				assert(bpi->extra);
 
-				rfd = bpi->extra->vnc->vnc.export.rfapi_handle;
+				rfd = bgp_extra_vnc(bpi->extra)->vnc.export.rfapi_handle;
 
 				vnc_zlog_debug_verbose(
 					"%s: deleting bpi=%p, bpi->peer=%p, bpi->type=%d, bpi->sub_type=%d, bpi->extra->vnc->vnc.export.rfapi_handle=%p [passing rfd=%p]",
 					__func__, bpi, bpi->peer, bpi->type,
 					bpi->sub_type,
-					(bpi->extra ? bpi->extra->vnc->vnc
+					(bpi->extra ? bgp_extra_vnc(bpi->extra)->vnc
 							      .export.rfapi_handle
 						    : NULL),
 					rfd);
@@ -274,6 +274,24 @@ void hash_walk(struct hash *hash, int (*func)(struct hash_bucket *, void *),
 	}
 }
 
+void hash_walk_key(struct hash *hash, void *data,
+		   int (*func)(struct hash_bucket *, void *), void *arg)
+{
+	unsigned int key;
+	struct hash_bucket *hb;
+	struct hash_bucket *hbnext;
+
+	key = (*hash->hash_key)(data);
+	for (hb = hash->index[key & (hash->size - 1)]; hb; hb = hbnext) {
+		/* func may release hb, see hash_walk() */
+		hbnext = hb->next;
+		if (hb->key != key)
+			continue;
+		if ((*func)(hb, arg) == HASHWALK_ABORT)
+			return;
+	}
+}
+
 void hash_clean(struct hash *hash, void (*free_func)(void *))
 {
 	unsigned int i;
@@ -278,6 +278,29 @@ extern void hash_iterate(struct hash *hash,
 extern void hash_walk(struct hash *hash,
 		      int (*func)(struct hash_bucket *, void *), void *arg);
 
+/*
+ * Same as hash_walk(), but only visit the elements whose hash key is the
+ * one 'data' hashes to, i.e. the candidates hash_lookup() would compare
+ * 'data' against.  Useful when the hash key only covers part of what the
+ * caller wants to match on.
+ *
+ * hash
+ *    hash table to operate on
+ *
+ * data
+ *    element to compute the hash key from
+ *
+ * func
+ *    function to call with each data item. If this function returns
+ *    HASHWALK_ABORT then the iteration stops.
+ *
+ * arg
+ *    arbitrary argument passed as the second parameter in each call to 'func'
+ */
+extern void hash_walk_key(struct hash *hash, void *data,
+			  int (*func)(struct hash_bucket *, void *),
+			  void *arg);
+
 /*
  * Remove all elements from a hash table.
  *
@@ -286,14 +286,11 @@ int64_t prefix_new_seq_get(struct prefix_list *plist)
 {
 	int64_t maxseq;
 	int64_t newseq;
-	struct prefix_list_entry *pentry;
-
-	maxseq = 0;
 
-	for (pentry = plist->head; pentry; pentry = pentry->next) {
-		if (maxseq < pentry->seq)
-			maxseq = pentry->seq;
-	}
+	/* entries are kept sorted by sequence number */
+	maxseq = plist->tail ? plist->tail->seq : 0;
+	if (maxseq < 0)
+		maxseq = 0;
 
 	newseq = ((maxseq / 5) * 5) + 5;
 
@@ -735,74 +732,87 @@ static const char *prefix_list_type_str(struct prefix_list_entry *pentry)
 	}
 }
 
+/* ge/le part of the match, the prefix itself must already be known to
+ * cover p.
+ */
+static inline bool prefix_list_entry_len_match(const struct prefix_list_entry *pentry,
+					       const struct prefix *p,
+					       bool address_mode)
+{
+	if (address_mode)
+		return true;
+
+	/* In case of le nor ge is specified, exact match is performed. */
+	if (!pentry->le && !pentry->ge)
+		return pentry->prefix.prefixlen == p->prefixlen;
+
+	if (pentry->le && p->prefixlen > pentry->le)
+		return false;
+	if (pentry->ge && p->prefixlen < pentry->ge)
+		return false;
+	return true;
+}
+
 static int prefix_list_entry_match(struct prefix_list_entry *pentry,
 				   const struct prefix *p, bool address_mode)
 {
-	int ret;
-
 	if (pentry->prefix.family != p->family)
 		return 0;
 
-	ret = prefix_match(&pentry->prefix, p);
-	if (!ret)
+	if (!prefix_match(&pentry->prefix, p))
 		return 0;
 
-	if (address_mode)
-		return 1;
+	return prefix_list_entry_len_match(pentry, p, address_mode);
+}
 
-	/* In case of le nor ge is specified, exact match is performed. */
-	if (!pentry->le && !pentry->ge) {
-		if (pentry->prefix.prefixlen != p->prefixlen)
-			return 0;
-	} else {
-		if (pentry->le)
-			if (p->prefixlen > pentry->le)
-				return 0;
+/*
+ * Entries on an up_chain have all their prefix bits consumed by the trie
+ * path that led to them (previous levels through next_table, the last byte
+ * through trie_walk_affected's range install), so only the length needs
+ * checking.  final_chain entries extend past the last trie level and need
+ * the full prefix comparison.
+ */
+static inline bool prefix_list_up_chain_match(const struct prefix_list_entry *pentry,
+					      const struct prefix *p,
+					      bool address_mode)
+{
+	if (pentry->prefix.family != p->family)
+		return false;
+	if (pentry->prefix.prefixlen > p->prefixlen)
+		return false;
 
-		if (pentry->ge)
-			if (p->prefixlen < pentry->ge)
-				return 0;
-	}
-	return 1;
+	return prefix_list_entry_len_match(pentry, p, address_mode);
 }
 
-enum prefix_list_type prefix_list_apply_ext(
-	struct prefix_list *plist,
-	const struct prefix_list_entry **which,
-	union prefixconstptr object,
-	bool address_mode)
+/*
+ * Single trie descent resolving the first matching (lowest seq) entry for p.
+ * Does not touch hit counters, callers do that.
+ */
+static struct prefix_list_entry *
+prefix_list_trie_lookup(const struct prefix_list *plist, const struct prefix *p,
+			bool address_mode)
 {
 	struct prefix_list_entry *pentry, *pbest = NULL;
-
-	const struct prefix *p = object.p;
+	const struct prefix_list_entry *first = plist->head;
 	const uint8_t *byte = p->u.val;
-	size_t depth;
+	size_t depth = plist->master->trie_depth;
 	size_t validbits = p->prefixlen;
-	struct pltrie_table *table;
-
-	if (plist == NULL) {
-		if (which)
-			*which = NULL;
-		return PREFIX_DENY;
-	}
+	const struct pltrie_table *table = plist->trie;
 
-	if (plist->count == 0) {
-		if (which)
-			*which = NULL;
-		return PREFIX_PERMIT;
-	}
-
-	depth = plist->master->trie_depth;
-	table = plist->trie;
 	while (1) {
 		for (pentry = table->entries[*byte].up_chain; pentry;
 		     pentry = pentry->next_best) {
 			if (pbest && pbest->seq < pentry->seq)
 				continue;
-			if (prefix_list_entry_match(pentry, p, address_mode))
+			if (prefix_list_up_chain_match(pentry, p,
+						       address_mode))
 				pbest = pentry;
 		}
 
+		/* nothing can beat the lowest sequence number in the list */
+		if (pbest == first)
+			break;
+
 		if (validbits <= PLC_BITS)
 			break;
 		validbits -= PLC_BITS;
@@ -826,13 +836,34 @@ enum prefix_list_type prefix_list_apply_ext(
 		break;
 	}
 
-	if (which) {
-		if (pbest)
-			*which = pbest;
-		else
+	return pbest;
+}
+
+enum prefix_list_type prefix_list_apply_ext(
+	struct prefix_list *plist,
+	const struct prefix_list_entry **which,
+	union prefixconstptr object,
+	bool address_mode)
+{
+	struct prefix_list_entry *pbest;
+
+	if (plist == NULL) {
+		if (which)
+			*which = NULL;
+		return PREFIX_DENY;
+	}
+
+	if (plist->count == 0) {
+		if (which)
 			*which = NULL;
+		return PREFIX_PERMIT;
 	}
 
+	pbest = prefix_list_trie_lookup(plist, object.p, address_mode);
+
+	if (which)
+		*which = pbest;
+
 	if (pbest == NULL)
 		return PREFIX_DENY;
 
@@ -840,6 +871,32 @@ enum prefix_list_type prefix_list_apply_ext(
 	return pbest->type;
 }
 
+void prefix_list_apply_batch(struct prefix_list *plist,
+			     const struct prefix *const *prefixes, size_t count,
+			     enum prefix_list_type *results)
+{
+	struct prefix_list_entry *pbest;
+	size_t i;
+
+	if (plist == NULL || plist->count == 0) {
+		enum prefix_list_type res = plist ? PREFIX_PERMIT
+						  : PREFIX_DENY;
+
+		for (i = 0; i < count; i++)
+			results[i] = res;
+		return;
+	}
+
+	for (i = 0; i < count; i++) {
+		pbest = prefix_list_trie_lookup(plist, prefixes[i], false);
+		if (pbest) {
+			pbest->hitcnt++;
+			results[i] = pbest->type;
+		} else
+			results[i] = PREFIX_DENY;
+	}
+}
+
 static void __attribute__((unused)) prefix_list_print(struct prefix_list *plist)
 {
 	struct prefix_list_entry *pentry;
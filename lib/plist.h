@@ -62,6 +62,18 @@ prefix_list_apply_ext(struct prefix_list *plist,
 #define prefix_list_apply(A, B) \
 	prefix_list_apply_ext((A), NULL, (B), false)
 
+/*
+ * prefix_list_apply_batch
+ *
+ * Same as prefix_list_apply() on each of count prefixes, with the result
+ * for prefixes[i] stored in results[i].  The list checks are done once for
+ * the whole batch.
+ */
+extern void prefix_list_apply_batch(struct prefix_list *plist,
+				    const struct prefix *const *prefixes,
+				    size_t count,
+				    enum prefix_list_type *results);
+
 extern struct prefix_list *prefix_bgp_orf_lookup(afi_t, const char *);
 extern struct stream *prefix_bgp_orf_entry(struct stream *,
 					   struct prefix_list *, uint8_t,
@@ -1920,6 +1920,69 @@ route_map_get_index(struct route_map *map, const struct prefix *prefix,
 	return best_index;
 }
 
+/*
+ * Whether a route for the prefix can match an entry of the route-map at all,
+ * going by the prefix-lists the entries match on.  This uses the same LPM
+ * trees as route_map_get_index(): entries without a prefix-list sit on the
+ * default route, so may return true for a prefix that the map then denies,
+ * but never returns false for one it would permit.
+ */
+bool route_map_prefix_may_match(struct route_map *map,
+				const struct prefix *prefix)
+{
+	struct route_table *table;
+	struct route_node *rn;
+
+	if (map->optimization_disabled)
+		return true;
+
+	if (prefix->family == AF_INET)
+		table = map->ipv4_prefix_table;
+	else if (prefix->family == AF_INET6)
+		table = map->ipv6_prefix_table;
+	else
+		return true;
+
+	rn = route_node_match(table, prefix);
+	if (!rn)
+		return false;
+
+	route_unlock_node(rn);
+	return true;
+}
+
+/*
+ * Whether route_map_prefix_may_match() can tell prefixes of the family
+ * apart.  It can't if an entry sits on the default route, for lack of a
+ * prefix-list match or because its prefix-list covers everything.
+ */
+bool route_map_prefix_indexed(struct route_map *map, int family)
+{
+	struct route_table *table;
+	struct route_node *rn;
+	struct prefix p;
+
+	if (map->optimization_disabled)
+		return false;
+
+	if (family == AF_INET)
+		table = map->ipv4_prefix_table;
+	else if (family == AF_INET6)
+		table = map->ipv6_prefix_table;
+	else
+		return false;
+
+	memset(&p, 0, sizeof(p));
+	p.family = family;
+
+	rn = route_node_lookup(table, &p);
+	if (!rn)
+		return true;
+
+	route_unlock_node(rn);
+	return false;
+}
+
 static int route_map_candidate_list_cmp(struct route_map_index *idx1,
 					struct route_map_index *idx2)
 {
@@ -492,6 +492,10 @@ extern route_map_result_t route_map_apply_ext(struct route_map *map,
 #define route_map_apply(map, prefix, object)                                   \
 	route_map_apply_ext(map, prefix, object, object, NULL)
 
+extern bool route_map_prefix_may_match(struct route_map *map,
+				       const struct prefix *prefix);
+extern bool route_map_prefix_indexed(struct route_map *map, int family);
+
 extern void route_map_add_hook(void (*func)(const char *));
 extern void route_map_delete_hook(void (*func)(const char *));
 
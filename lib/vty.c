@@ -67,7 +67,8 @@ enum vty_event {
 #ifdef VTYSH
 	VTYSH_SERV,
 	VTYSH_READ,
-	VTYSH_WRITE
+	VTYSH_WRITE,
+	VTYSH_STREAM
 #endif /* VTYSH */
 };
 
@@ -94,6 +95,7 @@ DECLARE_DLIST(vtyservs, struct vty_serv, itm);
 static void vty_event_serv(enum vty_event event, struct vty_serv *);
 static void vty_event(enum vty_event, struct vty *);
 static int vtysh_flush(struct vty *vty);
+static void vty_stream_release(struct vty *vty);
 
 /* Extern host structure from command.c */
 extern struct host host;
@@ -2253,11 +2255,40 @@ static int vtysh_flush(struct vty *vty)
 		return -1;
 	case BUFFER_EMPTY:
 		vty->vty_buf_size_accumulated = 0;
+		/* client caught up, produce the next part of the output */
+		if (vty->stream_step)
+			vty_event(VTYSH_STREAM, vty);
 		break;
 	}
 	return 0;
 }
 
+static void vtysh_stream(struct event *thread)
+{
+	struct vty *vty = EVENT_ARG(thread);
+	uint8_t header[4] = {0, 0, 0, 0};
+	int ret;
+
+	ret = vty->stream_step(vty, vty->stream_arg);
+	if (ret == CMD_SUSPEND) {
+		/* rescheduled from vtysh_flush once the buffer is drained */
+		vtysh_flush(vty);
+		return;
+	}
+
+	vty_stream_release(vty);
+
+	header[3] = ret;
+	buffer_put(vty->obuf, header, 4);
+	if (!vty->t_write && (vtysh_flush(vty) < 0))
+		return;
+
+	if (vty->status == VTY_CLOSE)
+		vty_close(vty);
+	else
+		vty_event(VTYSH_READ, vty);
+}
+
 void vty_pass_fd(struct vty *vty, int fd)
 {
 	if (vty->pass_fd != -1)
@@ -2433,6 +2464,12 @@ static void vtysh_read(struct event *thread)
 					vty->pass_fd = -1;
 				}
 
+				/* output is streamed, the result is sent
+				 * and reading resumed from vtysh_stream.
+				 */
+				if (vty->stream_step)
+					return;
+
 				/* hack for asynchronous "write integrated"
 				 * - other commands in "buf" will be ditched
 				 * - input during pending config-write is
@@ -2511,6 +2548,38 @@ static void vty_error_delete(void *arg)
 	XFREE(MTYPE_TMP, ve);
 }
 
+static void vty_stream_release(struct vty *vty)
+{
+	EVENT_OFF(vty->t_stream);
+	if (vty->stream_free)
+		vty->stream_free(vty->stream_arg);
+	vty->stream_step = NULL;
+	vty->stream_free = NULL;
+	vty->stream_arg = NULL;
+}
+
+int vty_stream_output(struct vty *vty, int (*step)(struct vty *vty, void *arg),
+		      void *arg, void (*free_arg)(void *arg))
+{
+	int ret;
+
+#ifdef VTYSH
+	if (vty->type == VTY_SHELL_SERV && !vty->filter && !vty->stream_step) {
+		vty->stream_step = step;
+		vty->stream_free = free_arg;
+		vty->stream_arg = arg;
+		vty_event(VTYSH_STREAM, vty);
+		return CMD_SUSPEND;
+	}
+#endif /* VTYSH */
+
+	while ((ret = step(vty, arg)) == CMD_SUSPEND)
+		;
+	free_arg(arg);
+
+	return ret;
+}
+
 /* Close vty interface.  Warning: call this only from functions that
    will be careful not to access the vty afterwards (since it has
    now been freed).  This is safest from top-level functions (called
@@ -2540,6 +2609,8 @@ void vty_close(struct vty *vty)
 		vty->mgmt_session_id = 0;
 	}
 
+	vty_stream_release(vty);
+
 	/* Cancel threads.*/
 	EVENT_OFF(vty->t_read);
 	EVENT_OFF(vty->t_write);
@@ -3055,6 +3126,7 @@ static void vty_event_serv(enum vty_event event, struct vty_serv *vty_serv)
 	case VTY_TIMEOUT_RESET:
 	case VTYSH_READ:
 	case VTYSH_WRITE:
+	case VTYSH_STREAM:
 		assert(!"vty_event_serv() called incorrectly");
 	}
 }
@@ -3071,6 +3143,10 @@ static void vty_event(enum vty_event event, struct vty *vty)
 		event_add_write(vty_master, vtysh_write, vty, vty->wfd,
 				&vty->t_write);
 		break;
+	case VTYSH_STREAM:
+		event_add_event(vty_master, vtysh_stream, vty, 0,
+				&vty->t_stream);
+		break;
 #endif /* VTYSH */
 	case VTY_READ:
 		event_add_read(vty_master, vty_read, vty, vty->fd,
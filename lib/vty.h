@@ -237,6 +237,14 @@ struct vty {
 	bool mgmt_locked_candidate_ds;
 	bool mgmt_locked_running_ds;
 	uint64_t vty_buf_size_accumulated;
+
+	/* Output of a command produced over several events, see
+	 * vty_stream_output().
+	 */
+	int (*stream_step)(struct vty *vty, void *arg);
+	void (*stream_free)(void *arg);
+	void *stream_arg;
+	struct event *t_stream;
 };
 
 static inline void vty_push_context(struct vty *vty, int node, uint64_t id)
@@ -388,6 +396,20 @@ extern int vty_json_no_pretty(struct vty *vty, struct json_object *json);
 void vty_json_key(struct vty *vty, const char *key, bool *first_key);
 void vty_json_close(struct vty *vty, bool first_key);
 extern void vty_json_empty(struct vty *vty, struct json_object *json);
+
+/*
+ * Produce the output of a long running command in steps, with the event
+ * loop running in between.  step is called until it returns anything but
+ * CMD_SUSPEND, and is only called again once the vtysh client has read
+ * what is buffered.  arg is released with free_arg when done or when the
+ * vty is closed.  Returns what the command handler should return.
+ *
+ * Other vty types, and vtys with an output filter, run all steps at once.
+ */
+extern int vty_stream_output(struct vty *vty,
+			     int (*step)(struct vty *vty, void *arg),
+			     void *arg, void (*free_arg)(void *arg));
+
 /* post fd to be passed to the vtysh client
  * fd is owned by the VTY code after this and will be closed when done
  */
@@ -0,0 +1,222 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * BGP route flap dampening flap-storm benchmark
+ *
+ * Flaps a large number of routes through bgp_damp_withdraw() and
+ * bgp_damp_update() and checks the fixed point decay against the
+ * floating point reference.
+ */
+
+#include <zebra.h>
+#include <math.h>
+
+#include "qobj.h"
+#include "vty.h"
+#include "privs.h"
+#include "memory.h"
+#include "monotime.h"
+#include "zclient.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_table.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_damp.h"
+#include "bgpd/bgp_network.h"
+
+#define TEST_ROUTES 20000
+#define TEST_FLAPS 32
+
+/* need these to link in libbgp */
+struct event_loop *master = NULL;
+extern struct zclient *zclient;
+struct zebra_privs_t bgpd_privs = {
+	.user = NULL,
+	.group = NULL,
+	.vty_group = NULL,
+};
+
+static struct bgp *bgp;
+static struct peer peer;
+static struct bgp_table *table;
+static struct bgp_dest *dests[TEST_ROUTES];
+static struct bgp_path_info paths[TEST_ROUTES];
+
+static void setup(void)
+{
+	struct prefix p;
+	uint32_t n;
+
+	bgp = XCALLOC(MTYPE_BGP, sizeof(struct bgp));
+	peer.bgp = bgp;
+	table = bgp_table_init(bgp, AFI_IP, SAFI_UNICAST);
+
+	bgp_damp_enable(bgp, AFI_IP, SAFI_UNICAST, DEFAULT_HALF_LIFE * 60,
+			DEFAULT_REUSE, DEFAULT_SUPPRESS,
+			DEFAULT_HALF_LIFE * 60 * 4);
+
+	for (n = 0; n < TEST_ROUTES; n++) {
+		memset(&p, 0, sizeof(p));
+		p.family = AF_INET;
+		p.prefixlen = 32;
+		p.u.prefix4.s_addr = htonl(0x0a000000 + n);
+
+		dests[n] = bgp_node_get(table, &p);
+		paths[n].type = ZEBRA_ROUTE_BGP;
+		paths[n].sub_type = BGP_ROUTE_NORMAL;
+		paths[n].peer = &peer;
+		paths[n].net = dests[n];
+		bgp_dest_set_bgp_path_info(dests[n], &paths[n]);
+	}
+}
+
+static void teardown(void)
+{
+	uint32_t n;
+
+	for (n = 0; n < TEST_ROUTES; n++) {
+		bgp_path_info_extra_free(&paths[n].extra);
+		bgp_dest_set_bgp_path_info(dests[n], NULL);
+		bgp_dest_unlock_node(dests[n]);
+	}
+	bgp_table_finish(&table);
+
+	bgp_damp_disable(bgp, AFI_IP, SAFI_UNICAST);
+	XFREE(MTYPE_BGP, bgp);
+}
+
+static void test_decay(void)
+{
+	struct bgp_damp_config *bdc = &bgp->damp[AFI_IP][SAFI_UNICAST];
+	const int penalty = 12000;
+	double expect;
+	time_t t;
+	bool ok = true;
+
+	for (t = 0; t <= bdc->max_suppress_time + DELTA_T; t++) {
+		if (t / DELTA_T >= bdc->decay_array_size)
+			expect = 0;
+		else
+			expect = penalty * pow(0.5, (double)(t / DELTA_T) *
+							    DELTA_T /
+							    bdc->half_life);
+
+		if (fabs(bgp_damp_decay(t, penalty, bdc) - expect) > 2.0) {
+			printf("decay %lld: %d, expected %f\n", (long long)t,
+			       bgp_damp_decay(t, penalty, bdc), expect);
+			ok = false;
+		}
+	}
+
+	printf("fixed point decay: %s\n", ok ? "OK" : "failed");
+}
+
+static void test_flap_storm(void)
+{
+	struct bgp_damp_config *bdc = &bgp->damp[AFI_IP][SAFI_UNICAST];
+	struct timeval start;
+	int64_t usec;
+	size_t memory;
+	bool ok = true;
+	uint32_t n, flap;
+
+	monotime(&start);
+	for (flap = 0; flap < TEST_FLAPS; flap++)
+		for (n = 0; n < TEST_ROUTES; n++) {
+			bgp_damp_withdraw(&paths[n], dests[n], AFI_IP,
+					  SAFI_UNICAST, 0);
+			bgp_damp_update(&paths[n], dests[n], AFI_IP,
+					SAFI_UNICAST);
+		}
+	usec = monotime_since(&start, NULL);
+
+	for (n = 0; n < TEST_ROUTES; n++) {
+		struct bgp_damp_info *bdi =
+			bgp_extra_damp_info(paths[n].extra);
+
+		if (!bdi || !CHECK_FLAG(paths[n].flags, BGP_PATH_DAMPED) ||
+		    bdi->penalty != bdc->ceiling || bdi->flap != TEST_FLAPS) {
+			ok = false;
+			break;
+		}
+	}
+
+	if (bgp_damp_info_count(&memory) != TEST_ROUTES)
+		ok = false;
+
+	printf("%u routes x %u flaps: %lld usec, %zu bytes of damping info\n",
+	       TEST_ROUTES, TEST_FLAPS, (long long)usec, memory);
+	printf("flap storm: %s\n", ok ? "OK" : "failed");
+}
+/*
+ * With a high reuse-limit and a large ceiling to reuse-limit ratio the
+ * reuse index scale is well below 1.0, check the fixed point index still
+ * follows the floating point one.
+ */
+static void test_reuse_scale(void)
+{
+	struct bgp_damp_config *bdc = &bgp->damp[AFI_IP6][SAFI_UNICAST];
+	unsigned int penalty;
+	double expect;
+	uint64_t i;
+	bool ok;
+
+	bgp_damp_enable(bgp, AFI_IP6, SAFI_UNICAST, 20 * 60, 20000, 20000,
+			240 * 60);
+
+	ok = bdc->reuse_index_scale != 0;
+	for (penalty = bdc->reuse_limit + 1; ok && penalty < bdc->ceiling;
+	     penalty += bdc->reuse_limit / 7) {
+		expect = ((double)penalty / bdc->reuse_limit - 1.0) *
+			 bdc->scale_factor;
+		i = ((uint64_t)(penalty - bdc->reuse_limit) *
+		     bdc->reuse_index_scale) >>
+		    BGP_DAMP_REUSE_SHIFT;
+		if (fabs(i - expect) > 1.0) {
+			printf("penalty %u: index %" PRIu64 ", expected %f\n",
+			       penalty, i, expect);
+			ok = false;
+		}
+	}
+
+	bgp_damp_disable(bgp, AFI_IP6, SAFI_UNICAST);
+	printf("reuse index scale: %s\n", ok ? "OK" : "failed");
+}
+
+static void test_release(void)
+{
+	size_t memory;
+	uint32_t n;
+	bool ok;
+
+	for (n = 0; n < TEST_ROUTES; n++)
+		bgp_damp_info_free(bgp_extra_damp_info(paths[n].extra), 0);
+
+	ok = bgp_damp_info_count(&memory) == 0 && memory == 0;
+	for (n = 0; n < TEST_ROUTES; n++)
+		if (CHECK_FLAG(paths[n].flags,
+			       BGP_PATH_DAMPED | BGP_PATH_HISTORY))
+			ok = false;
+
+	printf("damping info release: %s\n", ok ? "OK" : "failed");
+}
+
+int main(void)
+{
+	qobj_init();
+	master = event_master_create(NULL);
+	zclient = zclient_new(master, &zclient_options_default, NULL, 0);
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE, list_new());
+	vrf_init(NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+
+	setup();
+	test_decay();
+	test_reuse_scale();
+	test_flap_storm();
+	test_release();
+	teardown();
+
+	zclient_free(zclient);
+	event_master_free(master);
+	return 0;
+}
@@ -0,0 +1,11 @@
+import frrtest
+
+
+class TestDamp(frrtest.TestMultiOut):
+    program = "./test_damp"
+
+
+TestDamp.okfail("fixed point decay")
+TestDamp.okfail("reuse index scale")
+TestDamp.okfail("flap storm")
+TestDamp.okfail("damping info release")
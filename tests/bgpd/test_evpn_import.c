@@ -0,0 +1,277 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * BGP EVPN import RT index scale test
+ *
+ * Brings up 4k VNIs against 100k type-2 routes through the import RT
+ * index and checks the candidates each VNI gets against a full table walk.
+ */
+
+#include <zebra.h>
+
+#include "qobj.h"
+#include "vty.h"
+#include "privs.h"
+#include "memory.h"
+#include "monotime.h"
+#include "zclient.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_table.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_ecommunity.h"
+#include "bgpd/bgp_evpn.h"
+#include "bgpd/bgp_evpn_private.h"
+#include "bgpd/bgp_network.h"
+
+#define TEST_VNIS 4096
+#define TEST_MACS_PER_VNI 25
+#define TEST_ROUTES (TEST_VNIS * TEST_MACS_PER_VNI)
+#define TEST_WALK_SAMPLE 16
+
+/* need these to link in libbgp */
+struct event_loop *master = NULL;
+extern struct zclient *zclient;
+struct zebra_privs_t bgpd_privs = {
+	.user = NULL,
+	.group = NULL,
+	.vty_group = NULL,
+};
+
+static struct bgp *bgp;
+static struct bgp_table *table;
+static struct bgp_dest *dests[TEST_ROUTES];
+
+/*
+ * Routes of even MACs carry RT 65000:<vni>, the odd ones RT 65001:<vni>.
+ * The latter only match the VNI through the masked (auto RT) key.
+ */
+static struct attr attrs[TEST_VNIS][2];
+static struct ecommunity *ecoms[TEST_VNIS][2];
+
+static void vni_keys(uint32_t vni, struct ecommunity_val keys[2])
+{
+	memcpy(&keys[0], ecoms[vni][0]->val, ECOMMUNITY_SIZE);
+	memcpy(&keys[1], ecoms[vni][0]->val, ECOMMUNITY_SIZE);
+	/* global-admin masked, as with an automatically derived RT */
+	keys[1].val[0] = 0;
+	keys[1].val[2] = keys[1].val[3] = 0;
+}
+
+static void setup(void)
+{
+	struct prefix_evpn p;
+	struct ethaddr mac = {};
+	struct ipaddr ip = {};
+	struct bgp_path_info *pi;
+	char buf[32];
+	uint32_t vni, i, n;
+	int as;
+
+	bgp = XCALLOC(MTYPE_BGP, sizeof(struct bgp));
+	bgp_evpn_init(bgp);
+	table = bgp_table_init(bgp, AFI_L2VPN, SAFI_EVPN);
+
+	for (vni = 0; vni < TEST_VNIS; vni++)
+		for (as = 0; as < 2; as++) {
+			snprintf(buf, sizeof(buf), "%u:%u", 65000 + as,
+				 vni + 1);
+			ecoms[vni][as] = ecommunity_str2com(
+				buf, ECOMMUNITY_ROUTE_TARGET, 0);
+			bgp_attr_set_ecommunity(&attrs[vni][as],
+						ecoms[vni][as]);
+		}
+
+	for (n = 0; n < TEST_ROUTES; n++) {
+		vni = n / TEST_MACS_PER_VNI;
+		i = n % TEST_MACS_PER_VNI;
+
+		mac.octet[0] = 0x02;
+		mac.octet[2] = (n >> 24) & 0xff;
+		mac.octet[3] = (n >> 16) & 0xff;
+		mac.octet[4] = (n >> 8) & 0xff;
+		mac.octet[5] = n & 0xff;
+		build_evpn_type2_prefix(&p, &mac, &ip);
+
+		dests[n] = bgp_node_get(table, (struct prefix *)&p);
+		pi = XCALLOC(MTYPE_BGP_ROUTE, sizeof(struct bgp_path_info));
+		pi->type = ZEBRA_ROUTE_BGP;
+		pi->sub_type = BGP_ROUTE_NORMAL;
+		pi->attr = &attrs[vni][i % 2];
+		pi->net = dests[n];
+		bgp_dest_set_bgp_path_info(dests[n], pi);
+	}
+}
+
+static void teardown(void)
+{
+	struct bgp_path_info *pi;
+	uint32_t vni, n;
+	int as;
+
+	bgp_evpn_rt_index_flush(bgp, true);
+
+	for (n = 0; n < TEST_ROUTES; n++) {
+		pi = bgp_dest_get_bgp_path_info(dests[n]);
+		bgp_dest_set_bgp_path_info(dests[n], NULL);
+		XFREE(MTYPE_BGP_ROUTE, pi);
+		bgp_dest_unlock_node(dests[n]);
+	}
+	bgp_table_finish(&table);
+
+	for (vni = 0; vni < TEST_VNIS; vni++)
+		for (as = 0; as < 2; as++)
+			ecommunity_free(&ecoms[vni][as]);
+
+	bgp_evpn_cleanup(bgp);
+	XFREE(MTYPE_BGP, bgp);
+}
+
+static bool path_matches(struct bgp_path_info *pi, uint32_t vni)
+{
+	return pi->attr == &attrs[vni][0] || pi->attr == &attrs[vni][1];
+}
+
+static size_t walk_count(uint32_t vni)
+{
+	struct bgp_dest *dest;
+	struct bgp_path_info *pi;
+	size_t count = 0;
+
+	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest))
+		for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
+			if (path_matches(pi, vni))
+				count++;
+
+	return count;
+}
+
+static size_t index_count(uint32_t vni)
+{
+	struct ecommunity_val keys[2];
+	struct bgp_dest **found;
+	struct bgp_path_info *pi;
+	size_t count, matching = 0, i;
+
+	vni_keys(vni, keys);
+	count = bgp_evpn_rt_index_collect(bgp, keys, 2, &found);
+	for (i = 0; i < count; i++) {
+		pi = bgp_dest_get_bgp_path_info(found[i]);
+		if (pi && path_matches(pi, vni))
+			matching++;
+	}
+	bgp_evpn_rt_index_release(found, count);
+
+	return matching == count ? count : 0;
+}
+
+static void test_bringup(void)
+{
+	struct timeval start;
+	int64_t index_usec, walk_usec;
+	bool ok = true;
+	uint32_t vni, n;
+
+	monotime(&start);
+	for (n = 0; n < TEST_ROUTES; n++)
+		bgp_evpn_rt_index_add(bgp,
+				      bgp_dest_get_bgp_path_info(dests[n]));
+	printf("index %u routes: %lld usec\n", TEST_ROUTES,
+	       (long long)monotime_since(&start, NULL));
+
+	monotime(&start);
+	for (vni = 0; vni < TEST_VNIS; vni++)
+		if (index_count(vni) != TEST_MACS_PER_VNI)
+			ok = false;
+	index_usec = monotime_since(&start, NULL);
+
+	monotime(&start);
+	for (n = 0; n < TEST_WALK_SAMPLE; n++) {
+		vni = n * (TEST_VNIS / TEST_WALK_SAMPLE);
+		if (walk_count(vni) != TEST_MACS_PER_VNI)
+			ok = false;
+	}
+	walk_usec = monotime_since(&start, NULL) * TEST_VNIS / TEST_WALK_SAMPLE;
+
+	printf("bring-up %u VNIs / %u MACs: %lld usec indexed, %lld usec walking (estimated)\n",
+	       TEST_VNIS, TEST_ROUTES, (long long)index_usec,
+	       (long long)walk_usec);
+	printf("evpn rt index bring-up: %s\n", ok ? "OK" : "failed");
+}
+
+static void test_withdraw(void)
+{
+	uint32_t vni = 7, n;
+	bool ok;
+
+	for (n = vni * TEST_MACS_PER_VNI; n < (vni + 1) * TEST_MACS_PER_VNI;
+	     n++)
+		bgp_evpn_rt_index_del(bgp,
+				      bgp_dest_get_bgp_path_info(dests[n]));
+	ok = index_count(vni) == 0 &&
+	     index_count(vni + 1) == TEST_MACS_PER_VNI;
+
+	for (n = vni * TEST_MACS_PER_VNI; n < (vni + 1) * TEST_MACS_PER_VNI;
+	     n++)
+		bgp_evpn_rt_index_add(bgp,
+				      bgp_dest_get_bgp_path_info(dests[n]));
+	ok = ok && index_count(vni) == TEST_MACS_PER_VNI;
+
+	printf("evpn rt index withdraw: %s\n", ok ? "OK" : "failed");
+}
+
+static void test_stale(void)
+{
+	struct bgp_path_info *pi;
+	uint32_t n = 9 * TEST_MACS_PER_VNI;
+	bool ok;
+
+	/* RTs change under the index, the old VNI has to prune it */
+	pi = bgp_dest_get_bgp_path_info(dests[n]);
+	pi->attr = &attrs[10][0];
+	ok = index_count(9) == TEST_MACS_PER_VNI - 1;
+
+	bgp_evpn_rt_index_add(bgp, pi);
+	ok = ok && index_count(10) == TEST_MACS_PER_VNI + 1;
+
+	bgp_evpn_rt_index_del(bgp, pi);
+	pi->attr = &attrs[9][0];
+	bgp_evpn_rt_index_add(bgp, pi);
+	ok = ok && index_count(9) == TEST_MACS_PER_VNI &&
+	     index_count(10) == TEST_MACS_PER_VNI;
+
+	printf("evpn rt index stale prune: %s\n", ok ? "OK" : "failed");
+}
+
+static void test_flush(void)
+{
+	bool ok;
+
+	/* 65000:<vni>, 65001:<vni> and the masked key both of them share */
+	ok = bgp_evpn_rt_index_count(bgp) == TEST_VNIS * 3;
+	bgp_evpn_rt_index_flush(bgp, true);
+	ok = ok && bgp_evpn_rt_index_count(bgp) == 0 && index_count(0) == 0;
+
+	printf("evpn rt index flush: %s\n", ok ? "OK" : "failed");
+}
+
+int main(void)
+{
+	qobj_init();
+	master = event_master_create(NULL);
+	zclient = zclient_new(master, &zclient_options_default, NULL, 0);
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE, list_new());
+	vrf_init(NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+
+	setup();
+	test_bringup();
+	test_withdraw();
+	test_stale();
+	test_flush();
+	teardown();
+
+	zclient_free(zclient);
+	event_master_free(master);
+	return 0;
+}
@@ -0,0 +1,11 @@
+import frrtest
+
+
+class TestEvpnImport(frrtest.TestMultiOut):
+    program = "./test_evpn_import"
+
+
+TestEvpnImport.okfail("evpn rt index bring-up")
+TestEvpnImport.okfail("evpn rt index withdraw")
+TestEvpnImport.okfail("evpn rt index stale prune")
+TestEvpnImport.okfail("evpn rt index flush")
@@ -0,0 +1,189 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * BGP inbound filter test
+ *
+ * Feeds UPDATE NLRI through bgp_nlri_parse_ip() to a peer with an inbound
+ * prefix-list and checks that every prefix is counted exactly once in the
+ * prefix-list hit counts, whether it is accepted, dropped before
+ * bgp_update() or withdrawn from the RIB by the filter.
+ */
+
+#include <zebra.h>
+
+#include "qobj.h"
+#include "vty.h"
+#include "stream.h"
+#include "privs.h"
+#include "memory.h"
+#include "filter.h"
+#include "lib/plist.h"
+#include "lib/plist_int.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_network.h"
+#include "bgpd/bgp_label.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct event_loop *master = NULL;
+
+static struct bgp *bgp;
+static as_t asn = 100;
+static struct peer *peer;
+static struct prefix_list *plist;
+
+/* add an entry to the inbound prefix-list */
+static struct prefix_list_entry *test_entry(int64_t seq,
+					    enum prefix_list_type type,
+					    const char *prefix, int ge, int le)
+{
+	struct prefix_list_entry *ple = prefix_list_entry_new();
+
+	ple->pl = plist;
+	ple->seq = seq;
+	ple->type = type;
+	str2prefix(prefix, &ple->prefix);
+	ple->ge = ge;
+	ple->le = le;
+	prefix_list_entry_update_finish(ple);
+
+	return ple;
+}
+
+/* receive an UPDATE announcing the given prefixes */
+static void test_update(const char *const *prefixes)
+{
+	uint8_t buf[BGP_MAX_PACKET_SIZE];
+	struct bgp_nlri nlri = {
+		.afi = AFI_IP,
+		.safi = SAFI_UNICAST,
+		.nlri = buf,
+	};
+	struct attr attr = {};
+	struct prefix p;
+	int psize;
+
+	for (; *prefixes; prefixes++) {
+		str2prefix(*prefixes, &p);
+		psize = PSIZE(p.prefixlen);
+		buf[nlri.length++] = p.prefixlen;
+		memcpy(&buf[nlri.length], &p.u.prefix4, psize);
+		nlri.length += psize;
+	}
+
+	attr.flag = ATTR_FLAG_BIT(BGP_ATTR_ORIGIN) |
+		    ATTR_FLAG_BIT(BGP_ATTR_AS_PATH) |
+		    ATTR_FLAG_BIT(BGP_ATTR_NEXT_HOP);
+	attr.origin = BGP_ORIGIN_IGP;
+	attr.nexthop.s_addr = htonl(0xc0000201);
+	attr.label_index = BGP_INVALID_LABEL_INDEX;
+	attr.label = MPLS_INVALID_LABEL;
+	/* interned, the way the UPDATE parser hands it over */
+	attr.aspath = aspath_intern(
+		aspath_str2aspath("65001 65002", ASNOTATION_PLAIN));
+
+	if (bgp_nlri_parse_ip(peer, &attr, &nlri) != BGP_NLRI_PARSE_OK)
+		printf("NLRI parse failed\n");
+
+	aspath_unintern(&attr.aspath);
+}
+
+/* whether we hold a route for the prefix from the peer */
+static bool test_route(const char *prefix)
+{
+	struct bgp_path_info *pi = NULL;
+	struct bgp_dest *dest;
+	struct prefix p;
+
+	str2prefix(prefix, &p);
+	dest = bgp_node_lookup(bgp->rib[AFI_IP][SAFI_UNICAST], &p);
+	if (!dest)
+		return false;
+
+	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
+		if (pi->peer == peer &&
+		    !CHECK_FLAG(pi->flags, BGP_PATH_REMOVED))
+			break;
+	bgp_dest_unlock_node(dest);
+
+	return pi != NULL;
+}
+
+static void test_hits(void)
+{
+	static const char *const accepted[] = {
+		"10.1.0.0/16", "10.2.0.0/16", "10.3.3.0/24", NULL,
+	};
+	static const char *const denied[] = {
+		"10.4.4.128/25", "172.16.0.0/12", NULL,
+	};
+	static const char *const replaced[] = { "10.1.0.0/16", NULL };
+	struct prefix_list_entry *deny_long, *permit, *deny_held;
+	bool ok;
+
+	deny_long = test_entry(5, PREFIX_DENY, "10.0.0.0/8", 25, 0);
+	permit = test_entry(10, PREFIX_PERMIT, "10.0.0.0/8", 0, 24);
+
+	/* accepted routes hit their entry once, in the batch only */
+	test_update(accepted);
+	ok = permit->hitcnt == 3 && deny_long->hitcnt == 0 &&
+	     peer->stat_pfx_filter == 0 && test_route("10.1.0.0/16") &&
+	     test_route("10.2.0.0/16") && test_route("10.3.3.0/24");
+	printf("accepted update: %s\n", ok ? "OK" : "failed");
+
+	/* routes dropped before bgp_update() */
+	test_update(denied);
+	ok = deny_long->hitcnt == 1 && permit->hitcnt == 3 &&
+	     peer->stat_pfx_filter == 2 && !test_route("10.4.4.128/25") &&
+	     !test_route("172.16.0.0/12");
+	printf("denied update: %s\n", ok ? "OK" : "failed");
+
+	/* a route we hold now denied has to go through bgp_update() */
+	deny_held = test_entry(1, PREFIX_DENY, "10.1.0.0/16", 0, 0);
+	test_update(replaced);
+	ok = deny_held->hitcnt == 1 && permit->hitcnt == 3 &&
+	     peer->stat_pfx_filter == 3 && !test_route("10.1.0.0/16") &&
+	     test_route("10.2.0.0/16");
+	printf("denied replacement: %s\n", ok ? "OK" : "failed");
+}
+
+int main(void)
+{
+	int i, j;
+
+	qobj_init();
+	cmd_init(0);
+	prefix_list_init();
+	master = event_master_create("test input filter");
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE, list_new());
+	vrf_init(NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_attr_init();
+	bgp_labels_init();
+
+	if (bgp_get(&bgp, &asn, NULL, BGP_INSTANCE_TYPE_DEFAULT, NULL,
+		    ASNOTATION_PLAIN) < 0)
+		return -1;
+
+	peer = peer_create_accept(bgp);
+	peer->host = (char *)"foo";
+	peer->as = 65001;
+	peer_sort(peer);
+
+	for (i = AFI_IP; i < AFI_MAX; i++)
+		for (j = SAFI_UNICAST; j < SAFI_MAX; j++) {
+			peer->afc[i][j] = 1;
+			peer->afc_adv[i][j] = 1;
+		}
+
+	plist = prefix_list_get(AFI_IP, 0, "in");
+	peer_prefix_list_set(peer, AFI_IP, SAFI_UNICAST, FILTER_IN, "in");
+	peer->connection->status = Established;
+
+	test_hits();
+
+	return 0;
+}
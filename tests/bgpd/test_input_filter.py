@@ -0,0 +1,10 @@
+import frrtest
+
+
+class TestInputFilter(frrtest.TestMultiOut):
+    program = "./test_input_filter"
+
+
+TestInputFilter.okfail("accepted update")
+TestInputFilter.okfail("denied update")
+TestInputFilter.okfail("denied replacement")
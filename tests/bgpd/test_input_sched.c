@@ -0,0 +1,196 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * BGP input scheduler test
+ *
+ * Fills the input queues of a few established peers with keepalives and
+ * checks that one round of the deficit round robin serves each of them in
+ * proportion to its input weight, that priority peers are queued first and
+ * that all queues drain without banking credit once they are empty.
+ */
+
+#include <zebra.h>
+
+#include "qobj.h"
+#include "vty.h"
+#include "privs.h"
+#include "memory.h"
+#include "stream.h"
+#include "frrevent.h"
+#include "zclient.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_network.h"
+#include "bgpd/bgp_packet.h"
+
+/* need these to link in libbgp */
+struct event_loop *master = NULL;
+extern struct zclient *zclient;
+struct zebra_privs_t bgpd_privs = {
+	.user = NULL,
+	.group = NULL,
+	.vty_group = NULL,
+};
+
+#define TEST_PACKETS 20000
+
+static struct bgp *bgp;
+static as_t asn = 100;
+
+struct test_peer {
+	const char *host;
+	enum bgp_peer_sort sort;
+	uint32_t weight; /* configured, 0 for none */
+	uint32_t expect; /* effective weight */
+	struct peer *peer;
+};
+
+static struct test_peer test_peers[] = {
+	{ "default", BGP_PEER_EBGP, 0, BGP_INPUT_WEIGHT_DEFAULT },
+	{ "configured", BGP_PEER_EBGP, 3, 3 },
+	{ "ibgp", BGP_PEER_IBGP, 0, BGP_INPUT_WEIGHT_PRIORITY },
+};
+
+static void test_peer_make(struct test_peer *tp)
+{
+	struct peer_connection *connection;
+	struct stream *s;
+	int i;
+
+	tp->peer = peer_create_accept(bgp);
+	tp->peer->host = (char *)tp->host;
+	tp->peer->sort = tp->sort;
+	if (tp->weight)
+		peer_input_weight_set(tp->peer, tp->weight);
+
+	connection = tp->peer->connection;
+	connection->status = Established;
+	SET_FLAG(connection->thread_flags, PEER_THREAD_READS_ON);
+
+	for (i = 0; i < TEST_PACKETS; i++) {
+		s = stream_new(BGP_HEADER_SIZE);
+		memset(STREAM_DATA(s), 0xff, BGP_MARKER_SIZE);
+		stream_forward_endp(s, BGP_MARKER_SIZE);
+		stream_putw(s, BGP_HEADER_SIZE);
+		stream_putc(s, BGP_MSG_KEEPALIVE);
+		stream_fifo_push(connection->ibuf, s);
+	}
+}
+
+/* run the event loop until one input round was served */
+static void test_round(void)
+{
+	struct event thread;
+	bool round;
+
+	while (bm->t_input_sched && event_fetch(master, &thread)) {
+		/* fetching the round clears its reference */
+		round = !bm->t_input_sched;
+		event_call(&thread);
+		if (round)
+			break;
+	}
+}
+
+static void test_sched(void)
+{
+	struct test_peer *tp;
+	struct peer *idle;
+	struct peer_connection *connection;
+	struct event thread = {};
+	uint32_t quanta, expected;
+	unsigned int rounds = 0;
+	bool ok = true;
+	size_t i;
+
+	quanta = atomic_load_explicit(&bgp->rpkt_quanta, memory_order_relaxed);
+
+	for (i = 0; i < array_size(test_peers); i++) {
+		tp = &test_peers[i];
+		test_peer_make(tp);
+		if (bgp_input_weight(tp->peer) != tp->expect)
+			ok = false;
+	}
+
+	printf("input weight: %s\n", ok ? "OK" : "failed");
+
+	for (i = 0; i < array_size(test_peers); i++) {
+		thread.arg = test_peers[i].peer->connection;
+		bgp_process_packet(&thread);
+	}
+
+	/* a peer with nothing to read is not queued at all */
+	idle = peer_create_accept(bgp);
+	idle->host = (char *)"idle";
+	idle->connection->status = Established;
+	thread.arg = idle->connection;
+	bgp_process_packet(&thread);
+
+	ok = bgp_input_sched_count(&bm->input_sched) ==
+		     array_size(test_peers) &&
+	     !bgp_input_sched_anywhere(idle->connection) &&
+	     bgp_input_sched_first(&bm->input_sched) ==
+		     test_peers[2].peer->connection;
+
+	/*
+	 * One round credits every peer with weight times read-quanta standard
+	 * sized messages worth of bytes and none gets to empty its queue.
+	 */
+	test_round();
+	for (i = 0; i < array_size(test_peers); i++) {
+		tp = &test_peers[i];
+		expected = tp->expect * quanta *
+			   BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE /
+			   BGP_HEADER_SIZE;
+		if (tp->peer->keepalive_in != expected) {
+			printf("%s: %u keepalives in the first round, expected %u\n",
+			       tp->host, tp->peer->keepalive_in, expected);
+			ok = false;
+		}
+	}
+
+	printf("weighted round: %s\n", ok ? "OK" : "failed");
+
+	ok = true;
+	while (bm->t_input_sched && rounds++ < TEST_PACKETS)
+		test_round();
+
+	for (i = 0; i < array_size(test_peers); i++) {
+		tp = &test_peers[i];
+		connection = tp->peer->connection;
+		if (tp->peer->keepalive_in != TEST_PACKETS ||
+		    connection->ibuf->count || connection->input_deficit ||
+		    bgp_input_sched_anywhere(connection))
+			ok = false;
+	}
+	if (bgp_input_sched_count(&bm->input_sched))
+		ok = false;
+
+	printf("drained queues: %s\n", ok ? "OK" : "failed");
+
+	for (i = 0; i < array_size(test_peers); i++)
+		UNSET_FLAG(test_peers[i].peer->connection->thread_flags,
+			   PEER_THREAD_READS_ON);
+}
+
+int main(void)
+{
+	qobj_init();
+	master = event_master_create(NULL);
+	zclient = zclient_new(master, &zclient_options_default, NULL, 0);
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE, list_new());
+	vrf_init(NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_attr_init();
+
+	if (bgp_get(&bgp, &asn, NULL, BGP_INSTANCE_TYPE_DEFAULT, NULL,
+		    ASNOTATION_PLAIN) < 0)
+		return -1;
+
+	test_sched();
+
+	bgp_attr_finish();
+	zclient_free(zclient);
+	event_master_free(master);
+	return 0;
+}
@@ -0,0 +1,10 @@
+import frrtest
+
+
+class TestInputSched(frrtest.TestMultiOut):
+    program = "./test_input_sched"
+
+
+TestInputSched.okfail("input weight")
+TestInputSched.okfail("weighted round")
+TestInputSched.okfail("drained queues")
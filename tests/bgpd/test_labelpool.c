@@ -0,0 +1,250 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * BGP label pool batch allocation test
+ *
+ * Feeds label chunks to the pool by hand, the way zebra would, and checks
+ * that bgp_lp_get_batch() hands out unique labels from them, answers
+ * repeated requests with the label already assigned and falls back to the
+ * slow path once the pool is empty.  Also reports the allocation rate of
+ * the batch call against one bgp_lp_get() per label.
+ */
+
+#include <zebra.h>
+
+#include "qobj.h"
+#include "vty.h"
+#include "privs.h"
+#include "memory.h"
+#include "bitfield.h"
+#include "frrevent.h"
+#include "workqueue.h"
+#include "zclient.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_network.h"
+#include "bgpd/bgp_labelpool.h"
+
+/* need these to link in libbgp */
+struct event_loop *master = NULL;
+extern struct zclient *zclient;
+struct zebra_privs_t bgpd_privs = {
+	.user = NULL,
+	.group = NULL,
+	.vty_group = NULL,
+};
+
+#define TEST_LABEL_FIRST MPLS_LABEL_UNRESERVED_MIN
+#define TEST_LABELS 1024
+#define TEST_BENCH_LABELS 100000
+
+struct test_slot {
+	mpls_label_t label;
+	unsigned int callbacks;
+};
+
+static struct test_slot *slots;
+static void **labelids;
+static unsigned int callbacks;
+
+static int test_cb(mpls_label_t label, void *labelid, bool allocated)
+{
+	struct test_slot *slot = labelid;
+
+	slot->label = allocated ? label : MPLS_LABEL_NONE;
+	slot->callbacks++;
+	callbacks++;
+	return 0;
+}
+
+/* run the event loop until 'expected' callbacks were delivered */
+static void test_drain(unsigned int expected)
+{
+	struct labelpool *pool = &bm->labelpool;
+	struct event thread;
+
+	while (callbacks < expected &&
+	       (!work_queue_empty(pool->callback_q) ||
+		bm->t_bgp_sync_label_manager) &&
+	       event_fetch(master, &thread))
+		event_call(&thread);
+}
+
+/* hand a chunk to the pool as if zebra answered a request for it */
+static void test_chunk(uint32_t first, uint32_t count)
+{
+	bm->labelpool.pending_count += count;
+	bgp_lp_event_chunk(first, first + count - 1);
+}
+
+static void test_reset(unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		slots[i].label = MPLS_LABEL_NONE;
+		slots[i].callbacks = 0;
+		labelids[i] = &slots[i];
+	}
+	callbacks = 0;
+}
+
+static void test_release(unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++)
+		bgp_lp_release(LP_TYPE_VRF, &slots[i], slots[i].label);
+}
+
+/*
+ * Check that slots [from, from + count) each got exactly one label from
+ * [first, first + count) and that no label was handed out twice.
+ */
+static bool test_check(unsigned int from, unsigned int count, uint32_t first)
+{
+	bitfield_t seen;
+	unsigned int i;
+	bool ok = true;
+
+	bf_init(seen, count);
+	for (i = from; i < from + count; i++) {
+		uint32_t label = slots[i].label;
+
+		if (slots[i].callbacks != 1 || label == MPLS_LABEL_NONE ||
+		    label < first || label >= first + count ||
+		    bf_test_index(seen, label - first)) {
+			ok = false;
+			break;
+		}
+		bf_set_bit(seen, label - first);
+	}
+	bf_free(seen);
+
+	return ok;
+}
+
+static void test_batch(void)
+{
+	mpls_label_t labels[TEST_LABELS];
+	unsigned int i;
+	bool ok;
+
+	test_reset(TEST_LABELS);
+	test_chunk(TEST_LABEL_FIRST, TEST_LABELS);
+	bgp_lp_get_batch(LP_TYPE_VRF, labelids, TEST_LABELS, test_cb);
+	test_drain(TEST_LABELS);
+
+	ok = callbacks == TEST_LABELS &&
+	     test_check(0, TEST_LABELS, TEST_LABEL_FIRST);
+	printf("batch allocation: %s\n", ok ? "OK" : "failed");
+
+	/* asking again must return the labels already assigned */
+	for (i = 0; i < TEST_LABELS; i++) {
+		labels[i] = slots[i].label;
+		slots[i].callbacks = 0;
+	}
+	callbacks = 0;
+	bgp_lp_get_batch(LP_TYPE_VRF, labelids, TEST_LABELS, test_cb);
+	test_drain(TEST_LABELS);
+
+	ok = callbacks == TEST_LABELS;
+	for (i = 0; ok && i < TEST_LABELS; i++)
+		if (slots[i].callbacks != 1 || slots[i].label != labels[i])
+			ok = false;
+	printf("duplicate requests: %s\n", ok ? "OK" : "failed");
+
+	test_release(TEST_LABELS);
+}
+
+static void test_exhausted(void)
+{
+	uint32_t first = TEST_LABEL_FIRST + TEST_LABELS;
+	unsigned int half = TEST_LABELS / 2;
+	bool ok;
+
+	/* ask for half as many labels again as the pool holds */
+	test_reset(TEST_LABELS + half);
+	test_chunk(first, TEST_LABELS);
+	bgp_lp_get_batch(LP_TYPE_VRF, labelids, TEST_LABELS + half, test_cb);
+	test_drain(TEST_LABELS);
+
+	ok = callbacks == TEST_LABELS &&
+	     test_check(0, TEST_LABELS, first) &&
+	     slots[TEST_LABELS].callbacks == 0;
+
+	/* the rest waits for the next chunk */
+	first += TEST_LABELS;
+	test_chunk(first, half);
+	test_drain(TEST_LABELS + half);
+
+	ok = ok && callbacks == TEST_LABELS + half &&
+	     test_check(TEST_LABELS, half, first);
+	printf("exhausted pool: %s\n", ok ? "OK" : "failed");
+
+	test_release(TEST_LABELS + half);
+}
+
+static void test_bench(void)
+{
+	uint32_t first = TEST_LABEL_FIRST + 2 * TEST_LABELS;
+	struct timeval start, stop;
+	unsigned long usec_single, usec_batch;
+	unsigned int i;
+	bool ok;
+
+	/* released labels give a chunk back once all of it is free */
+	test_chunk(first, TEST_BENCH_LABELS);
+	test_reset(TEST_BENCH_LABELS);
+	monotime(&start);
+	for (i = 0; i < TEST_BENCH_LABELS; i++)
+		bgp_lp_get(LP_TYPE_VRF, labelids[i], test_cb);
+	monotime(&stop);
+	usec_single = timeval_elapsed(stop, start);
+	test_drain(TEST_BENCH_LABELS);
+	ok = callbacks == TEST_BENCH_LABELS;
+	test_release(TEST_BENCH_LABELS);
+
+	test_chunk(first, TEST_BENCH_LABELS);
+	test_reset(TEST_BENCH_LABELS);
+	monotime(&start);
+	bgp_lp_get_batch(LP_TYPE_VRF, labelids, TEST_BENCH_LABELS, test_cb);
+	monotime(&stop);
+	usec_batch = timeval_elapsed(stop, start);
+	test_drain(TEST_BENCH_LABELS);
+	ok = ok && callbacks == TEST_BENCH_LABELS &&
+	     test_check(0, TEST_BENCH_LABELS, first);
+	test_release(TEST_BENCH_LABELS);
+
+	printf("batch benchmark: %s\n", ok ? "OK" : "failed");
+	printf("  %d labels: per-label %lu.%06lus, batch %lu.%06lus (%lu labels/s)\n",
+	       TEST_BENCH_LABELS, usec_single / 1000000, usec_single % 1000000,
+	       usec_batch / 1000000, usec_batch % 1000000,
+	       usec_batch ? (unsigned long)TEST_BENCH_LABELS * 1000000 /
+				    usec_batch
+			  : 0);
+}
+
+int main(void)
+{
+	qobj_init();
+	master = event_master_create(NULL);
+	zclient = zclient_new(master, &zclient_options_default, NULL, 0);
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE, list_new());
+	vrf_init(NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+
+	slots = XCALLOC(MTYPE_TMP, TEST_BENCH_LABELS * sizeof(*slots));
+	labelids = XCALLOC(MTYPE_TMP, TEST_BENCH_LABELS * sizeof(*labelids));
+
+	test_batch();
+	test_exhausted();
+	test_bench();
+
+	EVENT_OFF(bm->t_bgp_sync_label_manager);
+	bgp_lp_finish();
+	XFREE(MTYPE_TMP, labelids);
+	XFREE(MTYPE_TMP, slots);
+	zclient_free(zclient);
+	event_master_free(master);
+	return 0;
+}
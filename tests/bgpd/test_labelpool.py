@@ -0,0 +1,11 @@
+import frrtest
+
+
+class TestLabelpool(frrtest.TestMultiOut):
+    program = "./test_labelpool"
+
+
+TestLabelpool.okfail("batch allocation")
+TestLabelpool.okfail("duplicate requests")
+TestLabelpool.okfail("exhausted pool")
+TestLabelpool.okfail("batch benchmark")
@@ -227,13 +227,12 @@ static int setup_bgp_mp_list(testcase_t *t)
 
 static int run_bgp_mp_list(testcase_t *t)
 {
-	struct list mp_list;
-	struct listnode *mp_node;
+	struct bgp_mp_list mp_list;
 	struct bgp_path_info *info;
 	int i;
 	int test_result = TEST_PASSED;
 	bgp_mp_list_init(&mp_list);
-	EXPECT_TRUE(listcount(&mp_list) == 0, test_result);
+	EXPECT_TRUE(mp_list.count == 0, test_result);
 
 	bgp_mp_list_add(&mp_list, &test_mp_list_info[1]);
 	bgp_mp_list_add(&mp_list, &test_mp_list_info[4]);
@@ -241,15 +240,16 @@ static int run_bgp_mp_list(testcase_t *t)
 	bgp_mp_list_add(&mp_list, &test_mp_list_info[3]);
 	bgp_mp_list_add(&mp_list, &test_mp_list_info[0]);
 
-	for (i = 0, mp_node = mp_list.head; i < test_mp_list_info_count;
-	     i++, mp_node = listnextnode(mp_node)) {
-		info = listgetdata(mp_node);
+	EXPECT_TRUE(mp_list.count == (uint32_t)test_mp_list_info_count,
+		    test_result);
+	for (i = 0; i < test_mp_list_info_count; i++) {
+		info = mp_list.paths[i];
 		info->lock++;
 		EXPECT_TRUE(info == &test_mp_list_info[i], test_result);
 	}
 
 	bgp_mp_list_clear(&mp_list);
-	EXPECT_TRUE(listcount(&mp_list) == 0, test_result);
+	EXPECT_TRUE(mp_list.count == 0, test_result);
 
 	return test_result;
 }
@@ -271,6 +271,49 @@ testcase_t test_bgp_mp_list = {
 	.cleanup = cleanup_bgp_mp_list,
 };
 
+/*=========================================================
+ * Testcase for bgp_mp_list growing past its inline storage
+ */
+#define TEST_MP_LIST_SPILL (2 * BGP_MP_LIST_INLINE + 1)
+
+struct peer test_mp_spill_peer = {.local_as = 1, .as = 2};
+struct attr test_mp_spill_attr[TEST_MP_LIST_SPILL];
+struct bgp_path_info test_mp_spill_info[TEST_MP_LIST_SPILL];
+
+static int run_bgp_mp_list_spill(testcase_t *t)
+{
+	struct bgp_mp_list mp_list;
+	int i;
+	int test_result = TEST_PASSED;
+
+	for (i = 0; i < TEST_MP_LIST_SPILL; i++) {
+		test_mp_spill_attr[i].nexthop.s_addr = htonl(0x0a000001 + i);
+		test_mp_spill_info[i].peer = &test_mp_spill_peer;
+		test_mp_spill_info[i].attr = &test_mp_spill_attr[i];
+	}
+
+	bgp_mp_list_init(&mp_list);
+	for (i = TEST_MP_LIST_SPILL - 1; i >= 0; i--)
+		bgp_mp_list_add(&mp_list, &test_mp_spill_info[i]);
+
+	EXPECT_TRUE(mp_list.count == TEST_MP_LIST_SPILL, test_result);
+	EXPECT_TRUE(mp_list.paths != mp_list.inline_paths, test_result);
+	for (i = 0; i < TEST_MP_LIST_SPILL; i++)
+		EXPECT_TRUE(mp_list.paths[i] == &test_mp_spill_info[i],
+			    test_result);
+
+	bgp_mp_list_clear(&mp_list);
+	EXPECT_TRUE(mp_list.count == 0, test_result);
+	EXPECT_TRUE(mp_list.paths == mp_list.inline_paths, test_result);
+
+	return test_result;
+}
+
+testcase_t test_bgp_mp_list_spill = {
+	.desc = "Test bgp_mp_list spill",
+	.run = run_bgp_mp_list_spill,
+};
+
 /*=========================================================
  * Testcase for bgp_path_info_mpath_update
  */
@@ -307,7 +350,7 @@ static int setup_bgp_path_info_mpath_update(testcase_t *t)
 static int run_bgp_path_info_mpath_update(testcase_t *t)
 {
 	struct bgp_path_info *new_best, *old_best, *mpath;
-	struct list mp_list;
+	struct bgp_mp_list mp_list;
 	struct bgp_maxpaths_cfg mp_cfg = {3, 3};
 
 	int test_result = TEST_PASSED;
@@ -368,7 +411,7 @@ testcase_t test_bgp_path_info_mpath_update = {
  */
 testcase_t *all_tests[] = {
 	&test_bgp_cfg_maximum_paths, &test_bgp_mp_list,
-	&test_bgp_path_info_mpath_update,
+	&test_bgp_mp_list_spill, &test_bgp_path_info_mpath_update,
 };
 
 int all_tests_count = array_size(all_tests);
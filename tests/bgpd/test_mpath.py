@@ -7,4 +7,5 @@ class TestMpath(frrtest.TestMultiOut):
 
 TestMpath.okfail("bgp maximum-paths config")
 TestMpath.okfail("bgp_mp_list")
+TestMpath.okfail("bgp_mp_list spill")
 TestMpath.okfail("bgp_path_info_mpath_update")
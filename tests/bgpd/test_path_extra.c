@@ -0,0 +1,179 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * BGP path extra sub-extension test
+ *
+ * Checks the tagged sub-extension slots of bgp_path_info_extra and reports
+ * what a VPNv4-sized table of labelled paths costs in ancillary memory.
+ */
+
+#include <zebra.h>
+
+#include "qobj.h"
+#include "vty.h"
+#include "privs.h"
+#include "memory.h"
+#include "monotime.h"
+#include "zclient.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_table.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_label.h"
+#include "bgpd/bgp_mplsvpn.h"
+#include "bgpd/bgp_memory.h"
+#include "bgpd/bgp_network.h"
+
+#define TEST_PATHS (2 * 1000 * 1000)
+#define TEST_LABELS 1024
+/* one path in TEST_LEAK_RATIO is also leaked into a VRF */
+#define TEST_LEAK_RATIO 16
+
+/* need these to link in libbgp */
+struct event_loop *master = NULL;
+extern struct zclient *zclient;
+struct zebra_privs_t bgpd_privs = {
+	.user = NULL,
+	.group = NULL,
+	.vty_group = NULL,
+};
+
+static struct bgp_path_info_extra **extras;
+
+static void test_slots(void)
+{
+	static const enum bgp_path_info_extra_ext order[] = {
+		BGP_PATH_EXTRA_VRFLEAK,
+		BGP_PATH_EXTRA_DAMP_INFO,
+		BGP_PATH_EXTRA_FLOWSPEC,
+		BGP_PATH_EXTRA_AGGR_SUPPRESSORS,
+		BGP_PATH_EXTRA_EVPN,
+	};
+	struct bgp_path_info pi = {};
+	struct bgp_path_info_extra *e;
+	int data[array_size(order)];
+	bool ok = true;
+	size_t i, j;
+
+	e = bgp_path_info_extra_get(&pi);
+	if (e->ext_present || e->ext || bgp_extra_vrfleak(e) ||
+	    bgp_extra_vrfleak(NULL))
+		ok = false;
+
+	for (i = 0; i < array_size(order); i++) {
+		bgp_path_info_extra_ext_set(e, order[i], &data[i]);
+		for (j = 0; j <= i; j++)
+			if (bgp_path_info_extra_ext_get(e, order[j]) != &data[j])
+				ok = false;
+	}
+
+	/* replace in place */
+	bgp_path_info_extra_ext_set(e, BGP_PATH_EXTRA_FLOWSPEC, &data[0]);
+	if (bgp_path_info_extra_ext_get(e, BGP_PATH_EXTRA_FLOWSPEC) != &data[0])
+		ok = false;
+	bgp_path_info_extra_ext_set(e, BGP_PATH_EXTRA_FLOWSPEC, &data[2]);
+
+	/* drop from the middle, the others have to stay where they were */
+	bgp_path_info_extra_ext_set(e, BGP_PATH_EXTRA_EVPN, NULL);
+	bgp_path_info_extra_ext_set(e, BGP_PATH_EXTRA_DAMP_INFO, NULL);
+	if (bgp_extra_evpn(e) || bgp_extra_damp_info(e) ||
+	    bgp_path_info_extra_ext_get(e, BGP_PATH_EXTRA_VRFLEAK) != &data[0] ||
+	    bgp_path_info_extra_ext_get(e, BGP_PATH_EXTRA_FLOWSPEC) != &data[2] ||
+	    bgp_path_info_extra_ext_get(e, BGP_PATH_EXTRA_AGGR_SUPPRESSORS) !=
+		    &data[3])
+		ok = false;
+
+	/* dropping something absent is a no-op */
+	bgp_path_info_extra_ext_set(e, BGP_PATH_EXTRA_EVPN, NULL);
+
+	for (i = 0; i < array_size(order); i++)
+		bgp_path_info_extra_ext_set(e, order[i], NULL);
+	if (e->ext_present || e->ext)
+		ok = false;
+
+	bgp_path_info_extra_free(&pi.extra);
+
+	printf("extra sub-extension slots: %s\n", ok ? "OK" : "failed");
+}
+
+static void test_vpn_table(void)
+{
+	struct bgp_path_info pi = {};
+	struct bgp_labels labels = {};
+	struct timeval start;
+	size_t extra_bytes, ext_bytes, leak_bytes;
+	int64_t usec;
+	bool ok = true;
+	uint32_t n;
+
+	extras = XCALLOC(MTYPE_TMP, TEST_PATHS * sizeof(extras[0]));
+
+	monotime(&start);
+	for (n = 0; n < TEST_PATHS; n++) {
+		pi.extra = NULL;
+		bgp_path_info_extra_get(&pi);
+
+		labels.num_labels = 1;
+		encode_label(16 + n % TEST_LABELS, &labels.label[0]);
+		pi.extra->labels = bgp_labels_intern(&labels);
+
+		if (n % TEST_LEAK_RATIO == 0)
+			bgp_path_info_extra_ext_set(
+				pi.extra, BGP_PATH_EXTRA_VRFLEAK,
+				XCALLOC(MTYPE_BGP_ROUTE_EXTRA_VRFLEAK,
+					sizeof(struct bgp_path_info_extra_vrfleak)));
+
+		extras[n] = pi.extra;
+	}
+	usec = monotime_since(&start, NULL);
+
+	for (n = 0; n < TEST_PATHS; n++)
+		if (!extras[n]->labels ||
+		    !!bgp_extra_vrfleak(extras[n]) !=
+			    (n % TEST_LEAK_RATIO == 0) ||
+		    bgp_extra_evpn(extras[n]) || bgp_extra_damp_info(extras[n])) {
+			ok = false;
+			break;
+		}
+
+	extra_bytes = mtype_stats_alloc(MTYPE_BGP_ROUTE_EXTRA) *
+		      sizeof(struct bgp_path_info_extra);
+	ext_bytes = mtype_stats_alloc(MTYPE_BGP_ROUTE_EXTRA_EXT) *
+		    sizeof(void *);
+	leak_bytes = mtype_stats_alloc(MTYPE_BGP_ROUTE_EXTRA_VRFLEAK) *
+		     sizeof(struct bgp_path_info_extra_vrfleak);
+
+	printf("%u labelled paths: %lld usec, %zu bytes extra + %zu bytes slots + %zu bytes vrfleak\n",
+	       TEST_PATHS, (long long)usec, extra_bytes, ext_bytes, leak_bytes);
+	printf("%zu bytes of ancillary info per path\n",
+	       (extra_bytes + ext_bytes + leak_bytes) / TEST_PATHS);
+
+	for (n = 0; n < TEST_PATHS; n++)
+		bgp_path_info_extra_free(&extras[n]);
+	XFREE(MTYPE_TMP, extras);
+
+	if (mtype_stats_alloc(MTYPE_BGP_ROUTE_EXTRA) ||
+	    mtype_stats_alloc(MTYPE_BGP_ROUTE_EXTRA_EXT) ||
+	    mtype_stats_alloc(MTYPE_BGP_ROUTE_EXTRA_VRFLEAK))
+		ok = false;
+
+	printf("vpn table ancillary info: %s\n", ok ? "OK" : "failed");
+}
+
+int main(void)
+{
+	qobj_init();
+	master = event_master_create(NULL);
+	zclient = zclient_new(master, &zclient_options_default, NULL, 0);
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE, list_new());
+	vrf_init(NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_labels_init();
+
+	test_slots();
+	test_vpn_table();
+
+	bgp_labels_finish();
+	zclient_free(zclient);
+	event_master_free(master);
+	return 0;
+}
@@ -0,0 +1,9 @@
+import frrtest
+
+
+class TestPathExtra(frrtest.TestMultiOut):
+    program = "./test_path_extra"
+
+
+TestPathExtra.okfail("extra sub-extension slots")
+TestPathExtra.okfail("vpn table ancillary info")
@@ -206,6 +206,7 @@ static struct test_peer_family test_default_families[] = {
 };
 
 TEST_ATTR_HANDLER_DECL(advertisement_interval, v_routeadv, 10, 20);
+TEST_ATTR_HANDLER_DECL(input_weight, input_weight, 10, 20);
 TEST_STR_ATTR_HANDLER_DECL(password, password, "FRR-Peer", "FRR-Group");
 TEST_ATTR_HANDLER_DECL(local_as, change_local_as, 1, 2);
 TEST_ATTR_HANDLER_DECL(timers_1, keepalive, 10, 20);
@@ -291,6 +292,14 @@ static struct test_peer_attr test_peer_attrs[] = {
 		.o.invert_peer = true,
 		.o.invert_group = true,
 	},
+	{
+		.cmd = "input-weight",
+		.peer_cmd = "input-weight 10",
+		.group_cmd = "input-weight 20",
+		.u.flag = PEER_FLAG_INPUT_WEIGHT,
+		.type = PEER_AT_GLOBAL_FLAG,
+		.handlers[0] = TEST_HANDLER(input_weight),
+	},
 	{
 		.cmd = "local-as",
 		.peer_cmd = "local-as 1",
@@ -0,0 +1,381 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * BGP Adj-RIB-In snapshot test
+ *
+ * Round-trips an attribute through the snapshot record encoding, checks
+ * that truncated or damaged snapshot files are refused as a whole, that the
+ * paths of a configured peer come back stale and that End-of-RIB from the
+ * peer drops the ones it did not send again.
+ */
+
+#include <zebra.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "qobj.h"
+#include "vty.h"
+#include "privs.h"
+#include "memory.h"
+#include "stream.h"
+#include "zclient.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_community.h"
+#include "bgpd/bgp_ecommunity.h"
+#include "bgpd/bgp_lcommunity.h"
+#include "bgpd/bgp_memory.h"
+#include "bgpd/bgp_network.h"
+#include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_snapshot.h"
+
+/* need these to link in libbgp */
+struct event_loop *master = NULL;
+extern struct zclient *zclient;
+struct zebra_privs_t bgpd_privs = {
+	.user = NULL,
+	.group = NULL,
+	.vty_group = NULL,
+};
+
+static struct bgp *bgp;
+static as_t asn = 100;
+
+static struct attr *test_attr_make(void)
+{
+	struct attr attr = {};
+	struct attr *interned;
+
+	attr.flag = ATTR_FLAG_BIT(BGP_ATTR_ORIGIN) |
+		    ATTR_FLAG_BIT(BGP_ATTR_AS_PATH) |
+		    ATTR_FLAG_BIT(BGP_ATTR_NEXT_HOP) |
+		    ATTR_FLAG_BIT(BGP_ATTR_MULTI_EXIT_DISC) |
+		    ATTR_FLAG_BIT(BGP_ATTR_LOCAL_PREF);
+	attr.origin = BGP_ORIGIN_IGP;
+	attr.nexthop.s_addr = htonl(0xc0000201);
+	attr.med = 100;
+	attr.local_pref = 200;
+	attr.weight = 32768;
+	attr.label_index = BGP_INVALID_LABEL_INDEX;
+	attr.label = MPLS_INVALID_LABEL;
+	attr.aspath = aspath_str2aspath("65001 65002 {65003,65004}",
+					ASNOTATION_PLAIN);
+	bgp_attr_set_community(&attr, community_str2com("65000:1 no-export"));
+	bgp_attr_set_ecommunity(&attr,
+				ecommunity_str2com("65000:100",
+						   ECOMMUNITY_ROUTE_TARGET, 0));
+	bgp_attr_set_lcommunity(&attr, lcommunity_str2com("65000:1:2"));
+
+	interned = bgp_attr_intern(&attr);
+	bgp_attr_unintern_sub(&attr);
+	return interned;
+}
+
+static void test_attr(void)
+{
+	struct stream *s = stream_new(4096);
+	struct attr *orig, *restored;
+	struct attr attr;
+	bool ok = true;
+	size_t len, i;
+
+	orig = test_attr_make();
+	bgp_snapshot_attr_encode(s, orig);
+	len = stream_get_endp(s);
+
+	if (bgp_snapshot_attr_decode(STREAM_DATA(s), len, &attr)) {
+		restored = bgp_attr_intern(&attr);
+		bgp_attr_unintern_sub(&attr);
+		if (restored != orig)
+			ok = false;
+		bgp_attr_unintern(&restored);
+	} else
+		ok = false;
+
+	printf("snapshot attribute round trip: %s\n", ok ? "OK" : "failed");
+
+	ok = true;
+	for (i = 0; i < len; i++)
+		if (bgp_snapshot_attr_decode(STREAM_DATA(s), i, &attr)) {
+			printf("attribute truncated to %zu bytes accepted\n", i);
+			bgp_attr_unintern_sub(&attr);
+			ok = false;
+		}
+
+	printf("snapshot attribute truncation: %s\n", ok ? "OK" : "failed");
+
+	bgp_attr_unintern(&orig);
+	stream_free(s);
+}
+
+static void test_file(void)
+{
+	char filename[] = "/tmp/test_snapshot.XXXXXX";
+	struct bgp_snapshot_stats stats;
+	uint8_t garbage = 0xff;
+	struct stat st;
+	bool ok = true;
+	int fd;
+
+	fd = mkstemp(filename);
+	if (fd < 0) {
+		printf("mkstemp: %s\n", safe_strerror(errno));
+		return;
+	}
+	close(fd);
+
+	if (bgp_snapshot_write(filename, &stats) ||
+	    stat(filename, &st) < 0 || (size_t)st.st_size != stats.bytes ||
+	    mtype_stats_alloc(MTYPE_BGP_SNAPSHOT))
+		ok = false;
+	if (bgp_snapshot_restore(filename, &stats) || stats.paths)
+		ok = false;
+
+	printf("snapshot file round trip: %s\n", ok ? "OK" : "failed");
+
+	ok = true;
+	if (truncate(filename, st.st_size - 1) < 0 ||
+	    !bgp_snapshot_restore(filename, &stats))
+		ok = false;
+
+	if (bgp_snapshot_write(filename, &stats))
+		ok = false;
+	fd = open(filename, O_WRONLY);
+	if (fd < 0 || pwrite(fd, &garbage, 1, 0) != 1 ||
+	    !bgp_snapshot_restore(filename, &stats))
+		ok = false;
+	if (fd >= 0)
+		close(fd);
+
+	printf("snapshot damaged file: %s\n", ok ? "OK" : "failed");
+
+	unlink(filename);
+}
+
+static const char *const test_prefixes[] = {
+	"198.51.100.0/24",
+	"203.0.113.0/24",
+	"192.0.2.128/25",
+};
+
+/* announce a prefix from the peer, as received in an UPDATE */
+static void test_announce(struct peer *peer, const char *prefix)
+{
+	struct attr attr = {};
+	struct prefix p;
+
+	str2prefix(prefix, &p);
+	attr.flag = ATTR_FLAG_BIT(BGP_ATTR_ORIGIN) |
+		    ATTR_FLAG_BIT(BGP_ATTR_AS_PATH) |
+		    ATTR_FLAG_BIT(BGP_ATTR_NEXT_HOP) |
+		    ATTR_FLAG_BIT(BGP_ATTR_LOCAL_PREF);
+	attr.origin = BGP_ORIGIN_IGP;
+	attr.nexthop.s_addr = htonl(0xc0000201);
+	attr.local_pref = 200;
+	attr.label_index = BGP_INVALID_LABEL_INDEX;
+	attr.label = MPLS_INVALID_LABEL;
+	attr.aspath = aspath_intern(aspath_empty(ASNOTATION_PLAIN));
+
+	bgp_update(peer, &p, 0, &attr, AFI_IP, SAFI_UNICAST, ZEBRA_ROUTE_BGP,
+		   BGP_ROUTE_NORMAL, NULL, NULL, 0, 0, NULL);
+
+	aspath_unintern(&attr.aspath);
+}
+
+/* the path we hold for a prefix from the peer, if any */
+static struct bgp_path_info *test_path(struct peer *peer, const char *prefix)
+{
+	struct bgp_path_info *pi;
+	struct bgp_dest *dest;
+	struct prefix p;
+
+	str2prefix(prefix, &p);
+	dest = bgp_node_lookup(bgp->rib[AFI_IP][SAFI_UNICAST], &p);
+	if (!dest)
+		return NULL;
+
+	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
+		if (pi->peer == peer &&
+		    !CHECK_FLAG(pi->flags, BGP_PATH_REMOVED))
+			break;
+	bgp_dest_unlock_node(dest);
+
+	return pi;
+}
+
+/* drop the peer's paths from the RIB, as a restart of bgpd would */
+static void test_forget(struct peer *peer)
+{
+	struct bgp_path_info *pi;
+	struct bgp_dest *dest;
+	struct prefix p;
+	size_t i;
+
+	for (i = 0; i < array_size(test_prefixes); i++) {
+		pi = test_path(peer, test_prefixes[i]);
+		if (!pi)
+			continue;
+
+		str2prefix(test_prefixes[i], &p);
+		dest = bgp_node_lookup(bgp->rib[AFI_IP][SAFI_UNICAST], &p);
+		bgp_path_info_reap(dest, pi);
+		bgp_dest_unlock_node(dest);
+	}
+}
+
+/* receive an IPv4 unicast End-of-RIB, an UPDATE without anything in it */
+static void test_eor_receive(struct peer *peer)
+{
+	struct peer_connection *connection = peer->connection;
+	struct event thread = { .arg = connection };
+	struct stream *s = stream_new(BGP_HEADER_SIZE + 4);
+
+	memset(STREAM_DATA(s), 0xff, BGP_MARKER_SIZE);
+	stream_forward_endp(s, BGP_MARKER_SIZE);
+	stream_putw(s, BGP_HEADER_SIZE + 4);
+	stream_putc(s, BGP_MSG_UPDATE);
+	stream_putw(s, 0); /* withdrawn routes length */
+	stream_putw(s, 0); /* path attributes length */
+	stream_fifo_push(connection->ibuf, s);
+
+	bgp_process_packet(&thread);
+	while (bm->t_input_sched && event_fetch(master, &thread))
+		event_call(&thread);
+}
+
+static void test_restore(void)
+{
+	char filename[] = "/tmp/test_snapshot.XXXXXX";
+	struct bgp_snapshot_stats stats;
+	struct bgp_path_info *pi;
+	union sockunion su;
+	struct peer *peer;
+	bool ok = true;
+	size_t i;
+	int fd;
+
+	fd = mkstemp(filename);
+	if (fd < 0) {
+		printf("mkstemp: %s\n", safe_strerror(errno));
+		return;
+	}
+	close(fd);
+
+	/* a configured iBGP peer we hold a few paths from */
+	str2sockunion("192.0.2.2", &su);
+	peer = peer_create(&su, NULL, bgp, bgp->as, bgp->as, AS_SPECIFIED,
+			   NULL, true, NULL);
+	EVENT_OFF(peer->connection->t_start);
+	peer->afc[AFI_IP][SAFI_UNICAST] = 1;
+
+	for (i = 0; i < array_size(test_prefixes); i++)
+		test_announce(peer, test_prefixes[i]);
+
+	if (bgp_snapshot_write(filename, &stats) || stats.peers != 1 ||
+	    stats.paths != array_size(test_prefixes))
+		ok = false;
+
+	/* back from a restart, the paths come from the snapshot */
+	test_forget(peer);
+	if (test_path(peer, test_prefixes[0]))
+		ok = false;
+
+	if (bgp_snapshot_restore(filename, &stats) || stats.peers != 1 ||
+	    stats.paths != array_size(test_prefixes))
+		ok = false;
+	for (i = 0; i < array_size(test_prefixes); i++) {
+		pi = test_path(peer, test_prefixes[i]);
+		if (!pi || !CHECK_FLAG(pi->flags, BGP_PATH_STALE))
+			ok = false;
+	}
+	if (!CHECK_FLAG(peer->sflags, PEER_STATUS_SNAPSHOT_WAIT) ||
+	    !peer->snapshot_wait[AFI_IP] || !peer->t_snapshot_stale)
+		ok = false;
+
+	printf("snapshot restore: %s\n", ok ? "OK" : "failed");
+
+	/*
+	 * The session comes up and the peer sends all but the last prefix
+	 * again before its End-of-RIB.
+	 */
+	ok = true;
+	peer->connection->status = Established;
+	for (i = 0; i < array_size(test_prefixes) - 1; i++)
+		test_announce(peer, test_prefixes[i]);
+	test_eor_receive(peer);
+
+	for (i = 0; i < array_size(test_prefixes) - 1; i++) {
+		pi = test_path(peer, test_prefixes[i]);
+		if (!pi || CHECK_FLAG(pi->flags, BGP_PATH_STALE))
+			ok = false;
+	}
+	if (test_path(peer, test_prefixes[i]))
+		ok = false;
+	if (CHECK_FLAG(peer->sflags, PEER_STATUS_SNAPSHOT_WAIT) ||
+	    peer->snapshot_wait[AFI_IP] || peer->t_snapshot_stale)
+		ok = false;
+
+	printf("snapshot restore End-of-RIB: %s\n", ok ? "OK" : "failed");
+
+	peer->connection->status = Idle;
+	unlink(filename);
+}
+
+static void test_stale_timer_expire(struct event *thread)
+{
+}
+
+static void test_eor(void)
+{
+	struct peer *peer = XCALLOC(MTYPE_TMP, sizeof(*peer));
+	bool ok = true;
+
+	SET_FLAG(peer->sflags, PEER_STATUS_SNAPSHOT_WAIT);
+	peer->snapshot_wait[AFI_IP] = true;
+	peer->snapshot_wait[AFI_IP6] = true;
+	event_add_timer(master, test_stale_timer_expire, peer, 360,
+			&peer->t_snapshot_stale);
+
+	bgp_snapshot_peer_eor(peer, AFI_IP, SAFI_UNICAST);
+	bgp_snapshot_peer_eor(peer, AFI_IP6, SAFI_MULTICAST);
+	if (!CHECK_FLAG(peer->sflags, PEER_STATUS_SNAPSHOT_WAIT) ||
+	    !peer->t_snapshot_stale || peer->snapshot_wait[AFI_IP])
+		ok = false;
+
+	bgp_snapshot_peer_eor(peer, AFI_IP6, SAFI_UNICAST);
+	if (CHECK_FLAG(peer->sflags, PEER_STATUS_SNAPSHOT_WAIT) ||
+	    peer->t_snapshot_stale || peer->snapshot_wait[AFI_IP6])
+		ok = false;
+
+	printf("snapshot End-of-RIB: %s\n", ok ? "OK" : "failed");
+
+	EVENT_OFF(peer->t_snapshot_stale);
+	XFREE(MTYPE_TMP, peer);
+}
+
+int main(void)
+{
+	qobj_init();
+	master = event_master_create(NULL);
+	zclient = zclient_new(master, &zclient_options_default, NULL, 0);
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE, list_new());
+	vrf_init(NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_attr_init();
+
+	if (bgp_get(&bgp, &asn, NULL, BGP_INSTANCE_TYPE_DEFAULT, NULL,
+		    ASNOTATION_PLAIN) < 0)
+		return -1;
+
+	test_attr();
+	test_file();
+	test_restore();
+	test_eor();
+
+	bgp_attr_finish();
+	zclient_free(zclient);
+	event_master_free(master);
+	return 0;
+}
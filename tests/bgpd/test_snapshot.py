@@ -0,0 +1,14 @@
+import frrtest
+
+
+class TestSnapshot(frrtest.TestMultiOut):
+    program = "./test_snapshot"
+
+
+TestSnapshot.okfail("snapshot attribute round trip")
+TestSnapshot.okfail("snapshot attribute truncation")
+TestSnapshot.okfail("snapshot file round trip")
+TestSnapshot.okfail("snapshot damaged file")
+TestSnapshot.okfail("snapshot restore")
+TestSnapshot.okfail("snapshot restore End-of-RIB")
+TestSnapshot.okfail("snapshot End-of-RIB")
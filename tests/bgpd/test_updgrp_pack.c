@@ -0,0 +1,245 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * BGP update-group NLRI packing test
+ *
+ * Checks that bulk encoded NLRI are byte for byte what the per-prefix
+ * encoder produces, for standard and extended message sized packets, and
+ * reports the packing throughput of both.
+ */
+
+#include <zebra.h>
+
+#include "qobj.h"
+#include "vty.h"
+#include "privs.h"
+#include "memory.h"
+#include "stream.h"
+#include "prefix.h"
+#include "network.h"
+#include "frrevent.h"
+#include "zclient.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_network.h"
+#include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_updgrp.h"
+
+/* need these to link in libbgp */
+struct event_loop *master = NULL;
+extern struct zclient *zclient;
+struct zebra_privs_t bgpd_privs = {
+	.user = NULL,
+	.group = NULL,
+	.vty_group = NULL,
+};
+
+#define TEST_PREFIXES 100000
+#define TEST_ROUNDS 20
+
+static struct prefix *prefixes;
+
+static void test_prefixes_make(int family)
+{
+	struct prefix *p;
+	uint8_t maxlen;
+	int i;
+
+	maxlen = family == AF_INET ? IPV4_MAX_BITLEN : IPV6_MAX_BITLEN;
+	for (i = 0; i < TEST_PREFIXES; i++) {
+		p = &prefixes[i];
+		memset(p, 0, sizeof(*p));
+		p->family = family;
+		p->prefixlen = frr_weak_random() % (maxlen + 1);
+		if (family == AF_INET)
+			p->u.prefix4.s_addr = frr_weak_random();
+		else {
+			p->u.prefix6.s6_addr32[0] = frr_weak_random();
+			p->u.prefix6.s6_addr32[1] = frr_weak_random();
+			p->u.prefix6.s6_addr32[2] = frr_weak_random();
+			p->u.prefix6.s6_addr32[3] = frr_weak_random();
+		}
+		apply_mask(p);
+	}
+}
+
+/*
+ * Fill packets of 'size' bytes with all test prefixes, the way
+ * subgroup_update_packet() does, and return the number of packets.
+ */
+static unsigned int pack_bulk(struct stream *s, size_t size, bool addpath,
+			      struct stream *out)
+{
+	struct bpacket_nlri_batch batch;
+	unsigned int packets = 1;
+	size_t needed, flushed;
+	int i;
+
+	bpacket_nlri_batch_init(&batch, addpath);
+	stream_reset(s);
+
+	for (i = 0; i < TEST_PREFIXES; i++) {
+		needed = BGP_NLRI_LENGTH + PSIZE(prefixes[i].prefixlen) +
+			 (addpath ? BGP_ADDPATH_ID_LEN : 0);
+
+		if (size - stream_get_endp(s) - batch.len < needed) {
+			if (batch.count) {
+				flushed = bpacket_nlri_batch_flush(&batch, s);
+				assert(flushed);
+			}
+			if (out)
+				stream_put(out, STREAM_DATA(s),
+					   stream_get_endp(s));
+			stream_reset(s);
+			packets++;
+		}
+
+		if (bpacket_nlri_batch_add(&batch, &prefixes[i], i)) {
+			flushed = bpacket_nlri_batch_flush(&batch, s);
+			assert(flushed);
+		}
+	}
+
+	if (batch.count) {
+		flushed = bpacket_nlri_batch_flush(&batch, s);
+		assert(flushed);
+	}
+	if (out)
+		stream_put(out, STREAM_DATA(s), stream_get_endp(s));
+
+	return packets;
+}
+
+static unsigned int pack_single(struct stream *s, size_t size, bool addpath,
+				struct stream *out)
+{
+	unsigned int packets = 1;
+	size_t needed;
+	int i;
+
+	stream_reset(s);
+
+	for (i = 0; i < TEST_PREFIXES; i++) {
+		needed = BGP_NLRI_LENGTH + PSIZE(prefixes[i].prefixlen) +
+			 (addpath ? BGP_ADDPATH_ID_LEN : 0);
+
+		if (size - stream_get_endp(s) < needed) {
+			if (out)
+				stream_put(out, STREAM_DATA(s),
+					   stream_get_endp(s));
+			stream_reset(s);
+			packets++;
+		}
+
+		stream_put_prefix_addpath(s, &prefixes[i], addpath, i);
+	}
+
+	if (out)
+		stream_put(out, STREAM_DATA(s), stream_get_endp(s));
+
+	return packets;
+}
+
+static void test_pack(const char *name, size_t size, bool addpath)
+{
+	struct stream *s = stream_new(size);
+	struct stream *ref, *bulk;
+	struct timeval start, stop;
+	unsigned int packets, ref_packets;
+	unsigned long usec_bulk, usec_single;
+	bool ok;
+	int i;
+
+	/* large enough for all prefixes with addpath */
+	ref = stream_new(TEST_PREFIXES * (BGP_NLRI_LENGTH + IPV6_MAX_BYTELEN +
+					  BGP_ADDPATH_ID_LEN));
+	bulk = stream_new(STREAM_SIZE(ref));
+
+	ref_packets = pack_single(s, size, addpath, ref);
+	packets = pack_bulk(s, size, addpath, bulk);
+
+	ok = packets == ref_packets &&
+	     stream_get_endp(ref) == stream_get_endp(bulk) &&
+	     !memcmp(STREAM_DATA(ref), STREAM_DATA(bulk),
+		     stream_get_endp(ref));
+
+	printf("%s packing: %s\n", name, ok ? "OK" : "failed");
+
+	monotime(&start);
+	for (i = 0; i < TEST_ROUNDS; i++)
+		pack_single(s, size, addpath, NULL);
+	monotime(&stop);
+	usec_single = timeval_elapsed(stop, start);
+
+	monotime(&start);
+	for (i = 0; i < TEST_ROUNDS; i++)
+		pack_bulk(s, size, addpath, NULL);
+	monotime(&stop);
+	usec_bulk = timeval_elapsed(stop, start);
+
+	printf("  %u packets, %d prefixes x %d: per-prefix %lu.%06lus, bulk %lu.%06lus (%lu prefixes/s)\n",
+	       packets, TEST_PREFIXES, TEST_ROUNDS, usec_single / 1000000,
+	       usec_single % 1000000, usec_bulk / 1000000, usec_bulk % 1000000,
+	       usec_bulk ? (unsigned long)TEST_PREFIXES * TEST_ROUNDS *
+				   1000000 / usec_bulk
+			 : 0);
+
+	stream_free(bulk);
+	stream_free(ref);
+	stream_free(s);
+}
+
+static void test_overflow(void)
+{
+	struct bpacket_nlri_batch batch;
+	struct stream *s = stream_new(16);
+	struct prefix p;
+	bool ok = true;
+
+	str2prefix("2001:db8::/64", &p);
+	bpacket_nlri_batch_init(&batch, true);
+	bpacket_nlri_batch_add(&batch, &p, 1);
+	bpacket_nlri_batch_add(&batch, &p, 2);
+
+	if (bpacket_nlri_batch_flush(&batch, s) || stream_get_endp(s) ||
+	    batch.count != 2)
+		ok = false;
+
+	stream_free(s);
+	s = stream_new(batch.len);
+	if (bpacket_nlri_batch_flush(&batch, s) != STREAM_SIZE(s) ||
+	    batch.count || batch.len)
+		ok = false;
+
+	printf("batch overflow: %s\n", ok ? "OK" : "failed");
+	stream_free(s);
+}
+
+int main(void)
+{
+	qobj_init();
+	master = event_master_create(NULL);
+	zclient = zclient_new(master, &zclient_options_default, NULL, 0);
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE, list_new());
+	vrf_init(NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+
+	prefixes = XCALLOC(MTYPE_TMP, TEST_PREFIXES * sizeof(*prefixes));
+
+	test_prefixes_make(AF_INET);
+	test_pack("ipv4", BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE, false);
+	test_pack("ipv4 addpath", BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE, true);
+	test_pack("ipv4 extended message",
+		  BGP_EXTENDED_MESSAGE_MAX_PACKET_SIZE, false);
+
+	test_prefixes_make(AF_INET6);
+	test_pack("ipv6", BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE, false);
+	test_pack("ipv6 addpath extended message",
+		  BGP_EXTENDED_MESSAGE_MAX_PACKET_SIZE, true);
+
+	test_overflow();
+
+	XFREE(MTYPE_TMP, prefixes);
+	zclient_free(zclient);
+	event_master_free(master);
+	return 0;
+}
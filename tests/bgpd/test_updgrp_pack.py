@@ -0,0 +1,13 @@
+import frrtest
+
+
+class TestUpdgrpPack(frrtest.TestMultiOut):
+    program = "./test_updgrp_pack"
+
+
+TestUpdgrpPack.okfail("ipv4 packing")
+TestUpdgrpPack.okfail("ipv4 addpath packing")
+TestUpdgrpPack.okfail("ipv4 extended message packing")
+TestUpdgrpPack.okfail("ipv6 packing")
+TestUpdgrpPack.okfail("ipv6 addpath extended message packing")
+TestUpdgrpPack.okfail("batch overflow")
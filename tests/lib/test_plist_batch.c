@@ -0,0 +1,260 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Prefix list lookup test
+ *
+ * Compares prefix_list_apply() and prefix_list_apply_batch() against a
+ * plain walk of the entries in sequence order, for lists with ge/le
+ * ranges, exact matches and "any" entries, and checks that both account
+ * the same hit counts.
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "memory.h"
+#include "prefix.h"
+#include "lib/plist.h"
+#include "lib/plist_int.h"
+
+#include "tests/helpers/c/prng.h"
+
+#define TEST_PREFIXES 20000
+
+struct test_entry {
+	int64_t seq;
+	enum prefix_list_type type;
+	const char *prefix; /* NULL for "any" */
+	int ge;
+	int le;
+};
+
+static const struct test_entry test_v4[] = {
+	{ 5, PREFIX_DENY, "10.0.0.0/8", 24, 28 },
+	{ 10, PREFIX_PERMIT, "10.0.0.0/8", 0, 24 },
+	{ 15, PREFIX_PERMIT, "10.1.0.0/16", 0, 0 },
+	{ 20, PREFIX_DENY, "192.168.0.0/16", 20, 0 },
+	{ 25, PREFIX_PERMIT, "192.168.1.0/24", 0, 32 },
+	{ 30, PREFIX_PERMIT, "172.16.0.0/12", 16, 20 },
+	{ 35, PREFIX_DENY, "0.0.0.0/0", 0, 8 },
+	{ 40, PREFIX_PERMIT, "198.51.100.0/24", 0, 0 },
+	{ 45, PREFIX_PERMIT, "10.1.2.0/24", 25, 30 },
+	{ 0 },
+};
+
+static const struct test_entry test_v4_any[] = {
+	{ 10, PREFIX_DENY, "10.0.0.0/8", 16, 24 },
+	{ 20, PREFIX_DENY, "192.168.0.0/16", 0, 32 },
+	{ 30, PREFIX_PERMIT, NULL, 0, 0 },
+	{ 40, PREFIX_DENY, "172.16.0.0/12", 0, 32 },
+	{ 0 },
+};
+
+static const struct test_entry test_v6[] = {
+	{ 5, PREFIX_PERMIT, "2001:db8::/32", 0, 48 },
+	{ 10, PREFIX_DENY, "2001:db8:1::/48", 49, 64 },
+	{ 15, PREFIX_PERMIT, "2001:db8:1:2::/64", 96, 128 },
+	{ 20, PREFIX_PERMIT, "2001:db8:1:2:3::/80", 0, 0 },
+	{ 25, PREFIX_DENY, "::/0", 0, 16 },
+	{ 30, PREFIX_PERMIT, "fc00::/7", 48, 64 },
+	{ 35, PREFIX_PERMIT, NULL, 0, 0 },
+	{ 0 },
+};
+
+static struct prefix prefixes[TEST_PREFIXES];
+static const struct prefix *prefix_ptrs[TEST_PREFIXES];
+static enum prefix_list_type results[TEST_PREFIXES];
+
+static struct prefix_list *test_list_make(afi_t afi, const char *name,
+					  const struct test_entry *entries)
+{
+	struct prefix_list *plist = prefix_list_get(afi, 0, name);
+	struct prefix_list_entry *ple;
+
+	for (; entries->seq; entries++) {
+		ple = prefix_list_entry_new();
+		ple->pl = plist;
+		ple->seq = entries->seq;
+		ple->type = entries->type;
+		if (entries->prefix) {
+			str2prefix(entries->prefix, &ple->prefix);
+			ple->ge = entries->ge;
+			ple->le = entries->le;
+		} else {
+			ple->any = true;
+			ple->prefix.family = afi2family(afi);
+			ple->le = afi == AFI_IP ? IPV4_MAX_BITLEN
+						: IPV6_MAX_BITLEN;
+		}
+		prefix_list_entry_update_finish(ple);
+	}
+
+	return plist;
+}
+
+/*
+ * Random prefixes, most of them somewhere below or near the prefix of a
+ * list entry so that every entry gets exercised.
+ */
+static void test_prefixes_make(struct prng *prng, afi_t afi,
+			       const struct test_entry *entries)
+{
+	uint8_t maxlen = afi == AFI_IP ? IPV4_MAX_BITLEN : IPV6_MAX_BITLEN;
+	const struct test_entry *entry;
+	size_t nentries, i, j;
+	struct prefix *p;
+
+	for (nentries = 0; entries[nentries].seq; nentries++)
+		;
+
+	for (i = 0; i < TEST_PREFIXES; i++) {
+		p = &prefixes[i];
+		memset(p, 0, sizeof(*p));
+
+		entry = &entries[prng_rand(prng) % (nentries + 1)];
+		if (entry->seq && entry->prefix)
+			str2prefix(entry->prefix, p);
+		p->family = afi2family(afi);
+
+		/*
+		 * Keep the entry's bytes most of the time, randomize the
+		 * rest; no entry picked means a fully random prefix.
+		 */
+		for (j = 0; j < (size_t)maxlen / 8; j++)
+			if (!entry->seq || !entry->prefix ||
+			    j * 8 >= (size_t)p->prefixlen ||
+			    !(prng_rand(prng) % 3))
+				p->u.val[j] = prng_rand(prng);
+
+		p->prefixlen = prng_rand(prng) % (maxlen + 1);
+		apply_mask(p);
+		prefix_ptrs[i] = p;
+	}
+}
+
+/* the first entry in sequence order that matches, the way it is defined */
+static struct prefix_list_entry *test_ref_lookup(struct prefix_list *plist,
+						 const struct prefix *p)
+{
+	struct prefix_list_entry *ple;
+
+	for (ple = plist->head; ple; ple = ple->next) {
+		if (ple->prefix.family != p->family ||
+		    !prefix_match(&ple->prefix, p))
+			continue;
+
+		if (!ple->le && !ple->ge) {
+			if (ple->prefix.prefixlen == p->prefixlen)
+				return ple;
+			continue;
+		}
+		if (ple->le && p->prefixlen > ple->le)
+			continue;
+		if (ple->ge && p->prefixlen < ple->ge)
+			continue;
+		return ple;
+	}
+
+	return NULL;
+}
+
+/* position of an entry in the list, to index the expected hit counts */
+static size_t test_entry_pos(struct prefix_list *plist,
+			     const struct prefix_list_entry *entry)
+{
+	struct prefix_list_entry *ple;
+	size_t n = 0;
+
+	for (ple = plist->head; ple != entry; ple = ple->next)
+		n++;
+
+	return n;
+}
+
+static void test_list(struct prng *prng, afi_t afi, const char *name,
+		      const struct test_entry *entries)
+{
+	struct prefix_list *plist = test_list_make(afi, name, entries);
+	const struct prefix_list_entry *which;
+	struct prefix_list_entry *ple, *ref;
+	unsigned long *hits;
+	enum prefix_list_type res;
+	bool apply_ok = true, batch_ok = true;
+	size_t i, n;
+
+	test_prefixes_make(prng, afi, entries);
+
+	hits = XCALLOC(MTYPE_TMP, plist->count * sizeof(*hits));
+
+	for (i = 0; i < TEST_PREFIXES; i++) {
+		ref = test_ref_lookup(plist, prefix_ptrs[i]);
+		res = prefix_list_apply_ext(plist, &which, prefix_ptrs[i],
+					    false);
+
+		if (which != ref || res != (ref ? ref->type : PREFIX_DENY))
+			apply_ok = false;
+		if (ref)
+			hits[test_entry_pos(plist, ref)]++;
+	}
+
+	/* every entry counts exactly the prefixes it was the first match of */
+	for (ple = plist->head, n = 0; ple; ple = ple->next, n++) {
+		if (ple->hitcnt != hits[n])
+			apply_ok = false;
+		ple->hitcnt = 0;
+	}
+
+	printf("%s apply: %s\n", name, apply_ok ? "OK" : "failed");
+
+	/* the batch must give the same verdicts and the same hit counts */
+	memset(results, 0xff, sizeof(results));
+	prefix_list_apply_batch(plist, prefix_ptrs, TEST_PREFIXES, results);
+	for (i = 0; i < TEST_PREFIXES; i++) {
+		ref = test_ref_lookup(plist, prefix_ptrs[i]);
+		if (results[i] != (ref ? ref->type : PREFIX_DENY))
+			batch_ok = false;
+	}
+	for (ple = plist->head, n = 0; ple; ple = ple->next, n++)
+		if (ple->hitcnt != hits[n])
+			batch_ok = false;
+
+	printf("%s batch: %s\n", name, batch_ok ? "OK" : "failed");
+
+	XFREE(MTYPE_TMP, hits);
+	prefix_list_delete(plist);
+}
+
+static void test_empty(void)
+{
+	struct prefix_list *plist = prefix_list_get(AFI_IP, 0, "empty");
+	enum prefix_list_type res[2];
+	bool ok;
+
+	/* an empty list permits everything, a missing one denies */
+	prefix_list_apply_batch(plist, prefix_ptrs, 2, res);
+	ok = res[0] == PREFIX_PERMIT && res[1] == PREFIX_PERMIT &&
+	     prefix_list_apply(plist, prefix_ptrs[0]) == PREFIX_PERMIT;
+
+	prefix_list_apply_batch(NULL, prefix_ptrs, 2, res);
+	ok = ok && res[0] == PREFIX_DENY && res[1] == PREFIX_DENY &&
+	     prefix_list_apply(NULL, prefix_ptrs[0]) == PREFIX_DENY;
+
+	printf("empty list: %s\n", ok ? "OK" : "failed");
+	prefix_list_delete(plist);
+}
+
+int main(int argc, char **argv)
+{
+	struct prng *prng = prng_new(0);
+
+	cmd_init(1);
+	prefix_list_init();
+
+	test_list(prng, AFI_IP, "ipv4 ge/le", test_v4);
+	test_list(prng, AFI_IP, "ipv4 any", test_v4_any);
+	test_list(prng, AFI_IP6, "ipv6 ge/le any", test_v6);
+	test_empty();
+
+	prefix_list_reset();
+	prng_free(prng);
+	return 0;
+}
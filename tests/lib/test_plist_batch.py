@@ -0,0 +1,14 @@
+import frrtest
+
+
+class TestPlistBatch(frrtest.TestMultiOut):
+    program = "./test_plist_batch"
+
+
+TestPlistBatch.okfail("ipv4 ge/le apply")
+TestPlistBatch.okfail("ipv4 ge/le batch")
+TestPlistBatch.okfail("ipv4 any apply")
+TestPlistBatch.okfail("ipv4 any batch")
+TestPlistBatch.okfail("ipv6 ge/le any apply")
+TestPlistBatch.okfail("ipv6 ge/le any batch")
+TestPlistBatch.okfail("empty list")
@@ -53,12 +53,23 @@
 #include "zebra/zebra_neigh.h"
 #include "zebra/zebra_ptm.h"
 
+DEFINE_MTYPE_STATIC(ZEBRA, SHOW_ROUTE_STREAM, "Zebra show route stream");
+
 /* context to manage dumps in multiple tables or vrfs */
 struct route_show_ctx {
 	bool multi;       /* dump multiple tables or vrf */
 	bool header_done; /* common header already displayed */
+
+	/* table is shown in steps, see show_route_stream() */
+	bool stream;
+	bool resume;		/* continue at resume_p */
+	struct prefix resume_p;
+	unsigned long shown;	/* prefixes shown from the table so far */
 };
 
+/* Destinations looked at per step when streaming a table */
+#define SHOW_ROUTE_STREAM_CHUNK 2000
+
 static int do_show_ip_route(struct vty *vty, const char *vrf_name, afi_t afi,
 			    safi_t safi, bool use_fib, bool use_json,
 			    route_tag_t tag,
@@ -858,19 +869,20 @@ static void vty_show_ip_route_detail_json(struct vty *vty,
 	vty_json(vty, json);
 }
 
-static void do_show_route_helper(struct vty *vty, struct zebra_vrf *zvrf,
-				 struct route_table *table, afi_t afi,
-				 bool use_fib, route_tag_t tag,
-				 const struct prefix *longer_prefix_p,
-				 bool supernets_only, int type,
-				 unsigned short ospf_instance_id, bool use_json,
-				 uint32_t tableid, bool show_ng,
-				 struct route_show_ctx *ctx)
+static int do_show_route_helper(struct vty *vty, struct zebra_vrf *zvrf,
+				struct route_table *table, afi_t afi,
+				bool use_fib, route_tag_t tag,
+				const struct prefix *longer_prefix_p,
+				bool supernets_only, int type,
+				unsigned short ospf_instance_id, bool use_json,
+				uint32_t tableid, bool show_ng,
+				struct route_show_ctx *ctx)
 {
 	struct route_node *rn;
 	struct route_entry *re;
-	bool first_json = true;
-	int first = 1;
+	bool first_json;
+	int first;
+	unsigned int visited = 0;
 	rib_dest_t *dest;
 	json_object *json_prefix = NULL;
 	uint32_t addr;
@@ -885,10 +897,32 @@ static void do_show_route_helper(struct vty *vty, struct zebra_vrf *zvrf,
 	 * else:
 	 *   => display the common header if at least one entry is found
 	 *   => display the VRF and table if specific
+	 *
+	 * ctx->stream has the table shown in chunks: the walk stops at a
+	 * destination node, returning CMD_SUSPEND, and the next call picks
+	 * up at that prefix again (or the one after it if it went away).
 	 */
+	if (ctx->resume) {
+		rn = route_node_lookup_maynull(table, &ctx->resume_p);
+		if (!rn)
+			rn = route_table_get_next(table, &ctx->resume_p);
+		ctx->resume = false;
+	} else {
+		rn = route_top(table);
+		ctx->shown = 0;
+	}
+	first = first_json = !ctx->shown;
 
 	/* Show all routes. */
-	for (rn = route_top(table); rn; rn = srcdest_route_next(rn)) {
+	for (; rn; rn = srcdest_route_next(rn)) {
+		if (ctx->stream && !rnode_is_srcnode(rn) &&
+		    ++visited > SHOW_ROUTE_STREAM_CHUNK) {
+			prefix_copy(&ctx->resume_p, &rn->p);
+			ctx->resume = true;
+			route_unlock_node(rn);
+			return CMD_SUSPEND;
+		}
+
 		dest = rib_dest_from_rnode(rn);
 
 		if (longer_prefix_p && !prefix_match(longer_prefix_p, &rn->p))
@@ -949,6 +983,7 @@ static void do_show_route_helper(struct vty *vty, struct zebra_vrf *zvrf,
 							tableid);
 				}
 				ctx->header_done = true;
+				ctx->shown++;
 				first = 0;
 			}
 
@@ -962,11 +997,14 @@ static void do_show_route_helper(struct vty *vty, struct zebra_vrf *zvrf,
 			vty_json_no_pretty(vty, json_prefix);
 
 			json_prefix = NULL;
+			ctx->shown++;
 		}
 	}
 
 	if (use_json)
 		vty_json_close(vty, first_json);
+
+	return CMD_SUCCESS;
 }
 
 static void do_show_ip_route_all(struct vty *vty, struct zebra_vrf *zvrf,
@@ -1008,7 +1046,25 @@ static int do_show_ip_route(struct vty *vty, const char *vrf_name, afi_t afi,
 	struct route_table *table;
 	struct zebra_vrf *zvrf = NULL;
 
-	if (!(zvrf = zebra_vrf_lookup_by_name(vrf_name))) {
+	zvrf = zebra_vrf_lookup_by_name(vrf_name);
+	if (zvrf && zvrf_id(zvrf) != VRF_UNKNOWN) {
+		if (tableid)
+			table = zebra_router_find_table(zvrf, tableid, afi,
+							SAFI_UNICAST);
+		else
+			table = zebra_vrf_table(afi, safi, zvrf_id(zvrf));
+	} else
+		table = NULL;
+
+	/* The table went away while it was streamed, end the output */
+	if (ctx->resume && !table) {
+		ctx->resume = false;
+		if (use_json)
+			vty_json_close(vty, !ctx->shown);
+		return CMD_SUCCESS;
+	}
+
+	if (!zvrf) {
 		if (use_json)
 			vty_out(vty, "{}\n");
 		else
@@ -1024,21 +1080,87 @@ static int do_show_ip_route(struct vty *vty, const char *vrf_name, afi_t afi,
 		return CMD_SUCCESS;
 	}
 
-	if (tableid)
-		table = zebra_router_find_table(zvrf, tableid, afi, SAFI_UNICAST);
-	else
-		table = zebra_vrf_table(afi, safi, zvrf_id(zvrf));
 	if (!table) {
 		if (use_json)
 			vty_out(vty, "{}\n");
 		return CMD_SUCCESS;
 	}
 
-	do_show_route_helper(vty, zvrf, table, afi, use_fib, tag,
-			     longer_prefix_p, supernets_only, type,
-			     ospf_instance_id, use_json, tableid, show_ng, ctx);
+	return do_show_route_helper(vty, zvrf, table, afi, use_fib, tag,
+				    longer_prefix_p, supernets_only, type,
+				    ospf_instance_id, use_json, tableid,
+				    show_ng, ctx);
+}
 
-	return CMD_SUCCESS;
+/* State of a "show ip route" that is streamed to the vty */
+struct show_route_stream {
+	char vrf_name[VRF_NAMSIZ];
+	afi_t afi;
+	bool use_fib;
+	bool use_json;
+	route_tag_t tag;
+	bool longer;
+	struct prefix longer_prefix;
+	bool supernets_only;
+	int type;
+	unsigned short ospf_instance_id;
+	uint32_t tableid;
+	bool show_ng;
+	struct route_show_ctx ctx;
+};
+
+static int show_route_stream_step(struct vty *vty, void *arg)
+{
+	struct show_route_stream *stream = arg;
+
+	return do_show_ip_route(vty, stream->vrf_name, stream->afi,
+				SAFI_UNICAST, stream->use_fib,
+				stream->use_json, stream->tag,
+				stream->longer ? &stream->longer_prefix : NULL,
+				stream->supernets_only, stream->type,
+				stream->ospf_instance_id, stream->tableid,
+				stream->show_ng, &stream->ctx);
+}
+
+static void show_route_stream_free(void *arg)
+{
+	XFREE(MTYPE_SHOW_ROUTE_STREAM, arg);
+}
+
+/*
+ * Same as do_show_ip_route() on a single table, but the table is walked a
+ * chunk at a time with the event loop running in between, so that a large
+ * table does not hold up zebra until all of it is printed. Nothing is held
+ * between steps; the VRF and table are looked up again on each one.
+ */
+static int show_route_stream(struct vty *vty, const char *vrf_name, afi_t afi,
+			     bool use_fib, bool use_json, route_tag_t tag,
+			     const struct prefix *longer_prefix_p,
+			     bool supernets_only, int type,
+			     unsigned short ospf_instance_id, uint32_t tableid,
+			     bool show_ng)
+{
+	struct show_route_stream *stream;
+
+	stream = XCALLOC(MTYPE_SHOW_ROUTE_STREAM, sizeof(*stream));
+	strlcpy(stream->vrf_name, vrf_name, sizeof(stream->vrf_name));
+	stream->afi = afi;
+	stream->use_fib = use_fib;
+	stream->use_json = use_json;
+	stream->tag = tag;
+	if (longer_prefix_p) {
+		stream->longer = true;
+		prefix_copy(&stream->longer_prefix, longer_prefix_p);
+	}
+	stream->supernets_only = supernets_only;
+	stream->type = type;
+	stream->ospf_instance_id = ospf_instance_id;
+	stream->tableid = tableid;
+	stream->show_ng = show_ng;
+	stream->ctx.stream = true;
+
+	return vty_stream_output(vty, show_route_stream_step, stream,
+				 show_route_stream_free);
 }
 
 DEFPY (show_ip_nht,
@@ -1813,11 +1935,11 @@ DEFPY (show_route,
 					     !!supernets_only, type,
 					     ospf_instance_id, !!ng, &ctx);
 		else
-			do_show_ip_route(vty, vrf->name, afi, SAFI_UNICAST,
-					 !!fib, !!json, tag,
-					 prefix_str ? prefix : NULL,
-					 !!supernets_only, type,
-					 ospf_instance_id, table, !!ng, &ctx);
+			return show_route_stream(vty, vrf->name, afi, !!fib,
+						 !!json, tag,
+						 prefix_str ? prefix : NULL,
+						 !!supernets_only, type,
+						 ospf_instance_id, table, !!ng);
 	}
 
 	return CMD_SUCCESS;